@@ -81,7 +81,7 @@ namespace Falcor
         static SharedPtr create(size_t size, Resource::BindFlags bind, CpuAccess cpuAccess, const void* pInitData = nullptr);
 
         /** Update the buffer's data
-            \param[in] pData Pointer to the source data.
+            \param[in] pData Pointer to the source data. The first byte is written at `offset`, so this should point at the data to copy and not at the beginning of a CPU copy of the entire buffer.
             \param[in] offset Byte offset into the destination buffer, indicating where to start copy into.
             \param[in] size Number of bytes to copy.
             If offset and size will cause an out-of-bound access to the buffer, an error will be logged and the update will fail.
@@ -44,11 +44,11 @@ namespace Falcor
         gpDevice->releaseResource(mApiHandle);
     }
 
-    ComputeStateObject::SharedPtr ComputeStateObject::create(const Desc& desc)
+    ComputeStateObject::SharedPtr ComputeStateObject::create(const Desc& desc, const std::vector<uint8_t>& cachedBlob)
     {
         SharedPtr pState = SharedPtr(new ComputeStateObject(desc));
 
-        if (pState->apiInit() == false)
+        if (pState->apiInit(cachedBlob) == false)
         {
             pState = nullptr;
         }
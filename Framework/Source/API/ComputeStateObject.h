@@ -48,6 +48,7 @@ namespace Falcor
             Desc& setRootSignature(RootSignature::SharedPtr pSignature) { mpRootSignature = pSignature; return *this; }
             Desc& setProgramVersion(ProgramVersion::SharedConstPtr pProgram) { mpProgram = pProgram; return *this; }
             ProgramVersion::SharedConstPtr getProgramVersion() const { return mpProgram; }
+            RootSignature::SharedPtr getRootSignature() const { return mpRootSignature; }
             bool operator==(const Desc& other) const;
         private:
             friend class ComputeStateObject;
@@ -55,13 +56,22 @@ namespace Falcor
             RootSignature::SharedPtr mpRootSignature;
         };
 
-        static SharedPtr create(const Desc& desc);
+        /** Create a new state object
+            \param[in] desc The state description
+            \param[in] cachedBlob A blob returned by getCachedBlob() for the same state, possibly in a previous run. The driver can use it to skip compiling the state. Ignored if the driver rejects it.
+            \return A new object, or nullptr if creation failed
+        */
+        static SharedPtr create(const Desc& desc, const std::vector<uint8_t>& cachedBlob = {});
         const ApiHandle& getApiHandle() { return mApiHandle; }
         const Desc& getDesc() const { return mDesc; }
+
+        /** Get a driver-specific blob which can be passed to create() to speed up creating the same state. Returns an empty blob if the API doesn't support it.
+        */
+        std::vector<uint8_t> getCachedBlob() const;
     private:
         ComputeStateObject(const Desc& desc) : mDesc(desc) {}
         Desc mDesc;
         ApiHandle mApiHandle;
-        bool apiInit();
+        bool apiInit(const std::vector<uint8_t>& cachedBlob);
     };
 }
\ No newline at end of file
@@ -47,6 +47,10 @@ namespace Falcor
             using SharedPtr = std::shared_ptr<ReadTextureTask>;
             static SharedPtr create(CopyContext::SharedPtr pCtx, const Texture* pTexture, uint32_t subresourceIndex);
             std::vector<uint8> getData();
+
+            /** Check if the GPU finished copying the texture. If it did, getData() will not block.
+            */
+            bool isReady() const { return mpFence->getGpuValue() + 1 >= mpFence->getCpuValue(); }
         private:
             ReadTextureTask() = default;
             GpuFence::SharedPtr mpFence;
@@ -113,6 +117,10 @@ namespace Falcor
         void updateTextureData(const Texture* pTexture, const void* pData);
 
         /** Update a buffer
+            \param[in] pBuffer The buffer to update
+            \param[in] pData Pointer to the source data. Points at the data which will be written at `offset`, same as Buffer::updateData()
+            \param[in] offset Byte offset into the destination buffer
+            \param[in] numBytes Number of bytes to copy. If this value is 0, will update the [offset, EndOfBuffer] range.
         */
         void updateBuffer(const Buffer* pBuffer, const void* pData, size_t offset = 0, size_t numBytes = 0);
 
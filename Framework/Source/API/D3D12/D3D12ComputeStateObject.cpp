@@ -88,7 +88,7 @@ namespace Falcor
     bool getIsNvApiComputePsoRequired(const ComputeStateObject::Desc& desc) { return false; }
 #endif
 
-    bool ComputeStateObject::apiInit()
+    bool ComputeStateObject::apiInit(const std::vector<uint8_t>& cachedBlob)
     {
         D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
         assert(mDesc.mpProgram);
@@ -104,8 +104,36 @@ namespace Falcor
         }
         else
         {
-            d3d_call(gpDevice->getApiHandle()->CreateComputePipelineState(&desc, IID_PPV_ARGS(&mApiHandle)));
+            // The driver rejects blobs saved by a different driver version or adapter. Compile the state from scratch in that case.
+            if (cachedBlob.size())
+            {
+                desc.CachedPSO.pCachedBlob = cachedBlob.data();
+                desc.CachedPSO.CachedBlobSizeInBytes = cachedBlob.size();
+                if (FAILED(gpDevice->getApiHandle()->CreateComputePipelineState(&desc, IID_PPV_ARGS(&mApiHandle))))
+                {
+                    desc.CachedPSO = {};
+                    mApiHandle = nullptr;
+                }
+            }
+
+            if (mApiHandle == nullptr)
+            {
+                d3d_call(gpDevice->getApiHandle()->CreateComputePipelineState(&desc, IID_PPV_ARGS(&mApiHandle)));
+            }
         }
         return true;
     }
+
+    std::vector<uint8_t> ComputeStateObject::getCachedBlob() const
+    {
+        // NVAPI states can't be created from a blob
+        std::vector<uint8_t> blob;
+        ID3DBlobPtr pBlob;
+        if (mApiHandle && getIsNvApiComputePsoRequired(mDesc) == false && SUCCEEDED(mApiHandle->GetCachedBlob(&pBlob)))
+        {
+            const uint8_t* pData = (const uint8_t*)pBlob->GetBufferPointer();
+            blob.assign(pData, pData + pBlob->GetBufferSize());
+        }
+        return blob;
+    }
 }
\ No newline at end of file
@@ -99,7 +99,7 @@ namespace Falcor
     bool getIsNvApiGraphicsPsoRequired(const GraphicsStateObject::Desc& desc) { return false; }
 #endif
     
-    bool GraphicsStateObject::apiInit()
+    bool GraphicsStateObject::apiInit(const std::vector<uint8_t>& cachedBlob)
     {
         D3D12_GRAPHICS_PIPELINE_STATE_DESC d3dDesc;
         InputLayoutDesc inputDesc;
@@ -113,8 +113,36 @@ namespace Falcor
         }
         else
         {
-            d3d_call(gpDevice->getApiHandle()->CreateGraphicsPipelineState(&d3dDesc, IID_PPV_ARGS(&mApiHandle)));
+            // The driver rejects blobs saved by a different driver version or adapter. Compile the state from scratch in that case.
+            if (cachedBlob.size())
+            {
+                d3dDesc.CachedPSO.pCachedBlob = cachedBlob.data();
+                d3dDesc.CachedPSO.CachedBlobSizeInBytes = cachedBlob.size();
+                if (FAILED(gpDevice->getApiHandle()->CreateGraphicsPipelineState(&d3dDesc, IID_PPV_ARGS(&mApiHandle))))
+                {
+                    d3dDesc.CachedPSO = {};
+                    mApiHandle = nullptr;
+                }
+            }
+
+            if (mApiHandle == nullptr)
+            {
+                d3d_call(gpDevice->getApiHandle()->CreateGraphicsPipelineState(&d3dDesc, IID_PPV_ARGS(&mApiHandle)));
+            }
         }
         return true;
     }
+
+    std::vector<uint8_t> GraphicsStateObject::getCachedBlob() const
+    {
+        // NVAPI states can't be created from a blob
+        std::vector<uint8_t> blob;
+        ID3DBlobPtr pBlob;
+        if (mApiHandle && getIsNvApiGraphicsPsoRequired(mDesc) == false && SUCCEEDED(mApiHandle->GetCachedBlob(&pBlob)))
+        {
+            const uint8_t* pData = (const uint8_t*)pBlob->GetBufferPointer();
+            blob.assign(pData, pData + pBlob->GetBufferSize());
+        }
+        return blob;
+    }
 }
\ No newline at end of file
@@ -83,7 +83,7 @@ namespace Falcor
         gpDevice->releaseResource(mApiHandle);
     }
 
-    GraphicsStateObject::SharedPtr GraphicsStateObject::create(const Desc& desc)
+    GraphicsStateObject::SharedPtr GraphicsStateObject::create(const Desc& desc, const std::vector<uint8_t>& cachedBlob)
     {
         if (spDefaultBlendState == nullptr)
         {
@@ -100,7 +100,7 @@ namespace Falcor
         if (!pState->mDesc.mpRasterizerState)       pState->mDesc.mpRasterizerState         = spDefaultRasterizerState;
         if (!pState->mDesc.mpDepthStencilState)     pState->mDesc.mpDepthStencilState       = spDefaultDepthStencilState;
 
-        if (pState->apiInit() == false)
+        if (pState->apiInit(cachedBlob) == false)
         {
             pState = nullptr;
         }
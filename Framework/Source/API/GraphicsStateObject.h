@@ -115,12 +115,21 @@ namespace Falcor
 #endif
         };
 
-        static SharedPtr create(const Desc& desc);
+        /** Create a new state object
+            \param[in] desc The state description
+            \param[in] cachedBlob A blob returned by getCachedBlob() for the same state, possibly in a previous run. The driver can use it to skip compiling the state. Ignored if the driver rejects it.
+            \return A new object, or nullptr if creation failed
+        */
+        static SharedPtr create(const Desc& desc, const std::vector<uint8_t>& cachedBlob = {});
 
         const ApiHandle& getApiHandle() { return mApiHandle; }
 
         const Desc& getDesc() const { return mDesc; }
 
+        /** Get a driver-specific blob which can be passed to create() to speed up creating the same state. Returns an empty blob if the API doesn't support it.
+        */
+        std::vector<uint8_t> getCachedBlob() const;
+
     private:
         GraphicsStateObject(const Desc& desc) : mDesc(desc) {}
         Desc mDesc;
@@ -131,6 +140,6 @@ namespace Falcor
         static RasterizerState::SharedPtr spDefaultRasterizerState;
         static DepthStencilState::SharedPtr spDefaultDepthStencilState;
 
-        bool apiInit();
+        bool apiInit(const std::vector<uint8_t>& cachedBlob);
     };
 }
\ No newline at end of file
@@ -0,0 +1,435 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "PipelineStateCache.h"
+#include "Graphics/Program/ShaderCache.h"
+#include "Utils/Hash.h"
+#include "Utils/MappedFileStream.h"
+#include "Utils/Platform/OS.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kMagic[4] = { 'F', 'P', 'S', 'C' };
+        const uint32_t kFormatVersion = 1;
+        const uint8_t kGraphicsStateTag = 'G';
+        const uint8_t kComputeStateTag = 'C';
+        const size_t kMinPruneThreshold = 256;
+
+        void addProgram(PipelineStateKey& key, const ProgramVersion* pProgram)
+        {
+            key.add(pProgram != nullptr);
+            if (pProgram == nullptr) return;
+            for (uint32_t i = 0; i < (uint32_t)ShaderType::Count; i++)
+            {
+                const Shader* pShader = pProgram->getShader((ShaderType)i);
+                key.add(pShader ? pShader->getCodeHash() : uint64_t(0));
+            }
+        }
+
+        void addRootSignature(PipelineStateKey& key, const RootSignature* pRootSig)
+        {
+            key.add(pRootSig != nullptr);
+            if (pRootSig == nullptr) return;
+            key.add((uint32_t)pRootSig->getDescriptorSetCount());
+            for (size_t s = 0; s < pRootSig->getDescriptorSetCount(); s++)
+            {
+                const auto& set = pRootSig->getDescriptorSet(s);
+                key.add(set.getVisibility()).add((uint32_t)set.getRangeCount());
+                for (size_t r = 0; r < set.getRangeCount(); r++)
+                {
+                    const auto& range = set.getRange(r);
+                    key.add(range.type).add(range.baseRegIndex).add(range.descCount).add(range.regSpace);
+                }
+            }
+        }
+
+        // Null states are replaced with the default states when the state object is created. They get their own keys, which costs at most a duplicate of the same state.
+        void addBlendState(PipelineStateKey& key, const BlendState* pState)
+        {
+            key.add(pState != nullptr);
+            if (pState == nullptr) return;
+            key.add(pState->isIndependentBlendEnabled()).add(pState->isAlphaToCoverageEnabled()).add(pState->getBlendFactor()).add(pState->getRtCount());
+            for (uint32_t i = 0; i < pState->getRtCount(); i++)
+            {
+                const auto& rt = pState->getRtDesc(i);
+                key.add(rt.blendEnabled).add(rt.rgbBlendOp).add(rt.alphaBlendOp).add(rt.srcRgbFunc).add(rt.dstRgbFunc).add(rt.srcAlphaFunc).add(rt.dstAlphaFunc);
+                key.add(rt.writeMask.writeRed).add(rt.writeMask.writeGreen).add(rt.writeMask.writeBlue).add(rt.writeMask.writeAlpha);
+            }
+        }
+
+        void addRasterizerState(PipelineStateKey& key, const RasterizerState* pState)
+        {
+            key.add(pState != nullptr);
+            if (pState == nullptr) return;
+            key.add(pState->getCullMode()).add(pState->getFillMode()).add(pState->isFrontCounterCW()).add(pState->getSlopeScaledDepthBias()).add(pState->getDepthBias());
+            key.add(pState->isDepthClampEnabled()).add(pState->isScissorTestEnabled()).add(pState->isLineAntiAliasingEnabled()).add(pState->isConservativeRasterizationEnabled()).add(pState->getForcedSampleCount());
+        }
+
+        void addStencilDesc(PipelineStateKey& key, const DepthStencilState::StencilDesc& desc)
+        {
+            key.add(desc.func).add(desc.stencilFailOp).add(desc.depthFailOp).add(desc.depthStencilPassOp);
+        }
+
+        void addDepthStencilState(PipelineStateKey& key, const DepthStencilState* pState)
+        {
+            key.add(pState != nullptr);
+            if (pState == nullptr) return;
+            key.add(pState->isDepthTestEnabled()).add(pState->isDepthWriteEnabled()).add(pState->getDepthFunc()).add(pState->isStencilTestEnabled());
+            addStencilDesc(key, pState->getStencilDesc(DepthStencilState::Face::Front));
+            addStencilDesc(key, pState->getStencilDesc(DepthStencilState::Face::Back));
+            key.add(pState->getStencilReadMask()).add(pState->getStencilWriteMask()).add(pState->getStencilRef());
+        }
+
+        void addVertexLayout(PipelineStateKey& key, const VertexLayout* pLayout)
+        {
+            key.add(pLayout != nullptr);
+            if (pLayout == nullptr) return;
+            key.add((uint32_t)pLayout->getBufferCount());
+            for (size_t b = 0; b < pLayout->getBufferCount(); b++)
+            {
+                const VertexBufferLayout* pBufferLayout = pLayout->getBufferLayout(b).get();
+                key.add(pBufferLayout != nullptr);
+                if (pBufferLayout == nullptr) continue;
+                key.add(pBufferLayout->getElementCount()).add(pBufferLayout->getStride()).add(pBufferLayout->getInputClass()).add(pBufferLayout->getInstanceStepRate());
+                for (uint32_t e = 0; e < pBufferLayout->getElementCount(); e++)
+                {
+                    key.add(pBufferLayout->getElementName(e)).add(pBufferLayout->getElementFormat(e)).add(pBufferLayout->getElementOffset(e));
+                    key.add(pBufferLayout->getElementArraySize(e)).add(pBufferLayout->getElementShaderLocation(e));
+                }
+            }
+        }
+
+        void addFboDesc(PipelineStateKey& key, const Fbo::Desc& desc)
+        {
+            for (uint32_t i = 0; i < Fbo::getMaxColorTargetCount(); i++)
+            {
+                key.add(desc.getColorTargetFormat(i)).add(desc.isColorTargetUav(i));
+            }
+            key.add(desc.getDepthStencilFormat()).add(desc.isDepthStencilUav()).add(desc.getSampleCount());
+        }
+
+        template<typename T>
+        void write(std::ofstream& stream, const T& value)
+        {
+            stream.write((const char*)&value, sizeof(T));
+        }
+
+        void writeBlob(std::ofstream& stream, const std::vector<uint8_t>& blob)
+        {
+            write(stream, (uint64_t)blob.size());
+            stream.write((const char*)blob.data(), blob.size());
+        }
+
+        bool readBlob(MappedFileStream& stream, std::vector<uint8_t>& blob)
+        {
+            uint64_t size = 0;
+            stream >> size;
+            if (stream.isFail() || size > stream.getRemainingStreamSize()) return false;
+            const uint8_t* pData = stream.readView((size_t)size);
+            blob.assign(pData, pData + size);
+            return true;
+        }
+    }
+
+    PipelineStateKey PipelineStateKey::create(const GraphicsStateObject::Desc& desc)
+    {
+        PipelineStateKey key;
+        key.add(kGraphicsStateTag);
+        addProgram(key, desc.getProgramVersion().get());
+        addRootSignature(key, desc.getRootSignature().get());
+        addBlendState(key, desc.getBlendState().get());
+        addRasterizerState(key, desc.getRasterizerState().get());
+        addDepthStencilState(key, desc.getDepthStencilState().get());
+        addVertexLayout(key, desc.getVertexLayout().get());
+        addFboDesc(key, desc.getFboDesc());
+        key.add(desc.getSampleMask()).add(desc.getPrimitiveType()).add(desc.getSinglePassStereoEnabled());
+#ifdef FALCOR_VK
+        // Vulkan pipelines also depend on the exact topology and on the render pass. Vulkan doesn't save driver blobs, so the render pass handle can be part of the key.
+        key.add(desc.getVao() != nullptr);
+        if (desc.getVao()) key.add(desc.getVao()->getPrimitiveTopology());
+        key.add((uint64_t)desc.getRenderPass());
+#endif
+        return key;
+    }
+
+    PipelineStateKey PipelineStateKey::create(const ComputeStateObject::Desc& desc)
+    {
+        PipelineStateKey key;
+        key.add(kComputeStateTag);
+        addProgram(key, desc.getProgramVersion().get());
+        addRootSignature(key, desc.getRootSignature().get());
+        return key;
+    }
+
+    PipelineStateKey& PipelineStateKey::add(const std::string& str)
+    {
+        add((uint32_t)str.size());
+        return addBytes(str.data(), str.size());
+    }
+
+    PipelineStateKey& PipelineStateKey::addBytes(const void* pData, size_t size)
+    {
+        mData.insert(mData.end(), (const uint8_t*)pData, (const uint8_t*)pData + size);
+        return *this;
+    }
+
+    uint64_t PipelineStateKey::getHash() const
+    {
+        return xxHash64(mData.data(), mData.size());
+    }
+
+    PipelineStateCache& PipelineStateCache::instance()
+    {
+        static PipelineStateCache cache;
+        return cache;
+    }
+
+    GraphicsStateObject::SharedPtr PipelineStateCache::getGraphicsState(const GraphicsStateObject::Desc& desc)
+    {
+        auto pObject = findOrCreate(PipelineStateKey::create(desc), [&desc](const std::vector<uint8_t>& cachedBlob, std::vector<uint8_t>& newBlob) -> std::shared_ptr<void>
+        {
+            GraphicsStateObject::SharedPtr pGso = GraphicsStateObject::create(desc, cachedBlob);
+            if (pGso) newBlob = pGso->getCachedBlob();
+            return pGso;
+        });
+        return std::static_pointer_cast<GraphicsStateObject>(pObject);
+    }
+
+    ComputeStateObject::SharedPtr PipelineStateCache::getComputeState(const ComputeStateObject::Desc& desc)
+    {
+        auto pObject = findOrCreate(PipelineStateKey::create(desc), [&desc](const std::vector<uint8_t>& cachedBlob, std::vector<uint8_t>& newBlob) -> std::shared_ptr<void>
+        {
+            ComputeStateObject::SharedPtr pCso = ComputeStateObject::create(desc, cachedBlob);
+            if (pCso) newBlob = pCso->getCachedBlob();
+            return pCso;
+        });
+        return std::static_pointer_cast<ComputeStateObject>(pObject);
+    }
+
+    PipelineStateCache::Entry* PipelineStateCache::findLocked(uint64_t hash, const std::vector<uint8_t>& key)
+    {
+        auto bucket = mEntries.find(hash);
+        if (bucket == mEntries.end()) return nullptr;
+        for (auto& entry : bucket->second)
+        {
+            if (entry.key == key) return &entry;
+        }
+        return nullptr;
+    }
+
+    std::shared_ptr<void> PipelineStateCache::findOrCreate(const PipelineStateKey& key, const Factory& factory)
+    {
+        const uint64_t hash = key.getHash();
+        std::vector<uint8_t> cachedBlob;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            Entry* pEntry = findLocked(hash, key.getData());
+            if (pEntry)
+            {
+                std::shared_ptr<void> pObject = pEntry->pObject.lock();
+                if (pObject)
+                {
+                    mStats.hits++;
+                    return pObject;
+                }
+                cachedBlob = pEntry->blob;
+            }
+        }
+
+        // Create the object without holding the lock. If another thread creates the same state meanwhile, the first one is kept.
+        std::vector<uint8_t> newBlob;
+        std::shared_ptr<void> pObject = factory(cachedBlob, newBlob);
+        if (pObject == nullptr) return nullptr;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.misses++;
+        if (cachedBlob.size()) mStats.blobHits++;
+
+        Entry* pEntry = findLocked(hash, key.getData());
+        if (pEntry == nullptr)
+        {
+            if (mEntryCount >= mPruneThreshold) pruneLocked();
+            auto& bucket = mEntries[hash];
+            bucket.push_back(Entry());
+            pEntry = &bucket.back();
+            pEntry->key = key.getData();
+            mEntryCount++;
+        }
+
+        std::shared_ptr<void> pExisting = pEntry->pObject.lock();
+        if (pExisting) return pExisting;
+        pEntry->pObject = pObject;
+        if (newBlob.size()) pEntry->blob = std::move(newBlob);
+        return pObject;
+    }
+
+    void PipelineStateCache::pruneLocked()
+    {
+        // A released state without a blob can't be restored from the cache, the entry only holds its key. On Vulkan the key contains the render pass handle, so these keys are often never used again.
+        for (auto bucket = mEntries.begin(); bucket != mEntries.end();)
+        {
+            auto& entries = bucket->second;
+            size_t count = entries.size();
+            entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& e) { return e.blob.empty() && e.pObject.expired(); }), entries.end());
+            mEntryCount -= count - entries.size();
+            bucket = entries.empty() ? mEntries.erase(bucket) : std::next(bucket);
+        }
+
+        // Amortize the pruning over the insertions
+        mPruneThreshold = std::max(kMinPruneThreshold, mEntryCount * 2);
+    }
+
+    bool PipelineStateCache::load(const std::string& filename)
+    {
+        MappedFileStream stream;
+        if (stream.open(filename) == false) return false;
+
+        // Parse the whole file before adding anything to the cache
+        char magic[4] = {};
+        uint32_t version = 0;
+        uint64_t count = 0;
+        stream.read(magic, sizeof(magic));
+        stream >> version >> count;
+        bool valid = stream.isFail() == false && memcmp(magic, kMagic, sizeof(kMagic)) == 0 && version == kFormatVersion;
+        // Each entry has at least two sizes
+        valid = valid && count <= stream.getRemainingStreamSize() / (2 * sizeof(uint64_t));
+
+        std::vector<Entry> entries;
+        if (valid)
+        {
+            entries.resize((size_t)count);
+            for (auto& e : entries)
+            {
+                valid = readBlob(stream, e.key) && readBlob(stream, e.blob);
+                if (valid == false) break;
+            }
+        }
+
+        if (valid == false)
+        {
+            logWarning("Pipeline state cache file '" + filename + "' is corrupted or was saved by a different version. Ignoring it.");
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& e : entries)
+        {
+            uint64_t hash = xxHash64(e.key.data(), e.key.size());
+            Entry* pEntry = findLocked(hash, e.key);
+            if (pEntry == nullptr)
+            {
+                mEntries[hash].push_back(std::move(e));
+                mEntryCount++;
+            }
+            else if (pEntry->blob.empty())
+            {
+                pEntry->blob = std::move(e.blob);
+            }
+        }
+        return true;
+    }
+
+    bool PipelineStateCache::save(const std::string& filename) const
+    {
+        std::string directory = getDirectoryFromFile(filename);
+        if (directory.size() && isDirectoryExists(directory) == false) createDirectory(directory);
+
+        // Write to a temporary file and rename it, so that a crash never leaves a partial file behind
+        std::string tmpName = filename + ".tmp";
+        {
+            std::ofstream stream(tmpName, std::ios::binary | std::ios::trunc);
+            if (stream.is_open() == false)
+            {
+                logWarning("Can't write the pipeline state cache file '" + filename + "'");
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            uint64_t count = 0;
+            for (const auto& bucket : mEntries)
+            {
+                for (const auto& e : bucket.second) count += e.blob.empty() ? 0 : 1;
+            }
+
+            stream.write(kMagic, sizeof(kMagic));
+            write(stream, kFormatVersion);
+            write(stream, count);
+            for (const auto& bucket : mEntries)
+            {
+                for (const auto& e : bucket.second)
+                {
+                    if (e.blob.empty()) continue;
+                    writeBlob(stream, e.key);
+                    writeBlob(stream, e.blob);
+                }
+            }
+            if (stream.good() == false)
+            {
+                stream.close();
+                std::remove(tmpName.c_str());
+                logWarning("Can't write the pipeline state cache file '" + filename + "'");
+                return false;
+            }
+        }
+
+        return replaceFile(tmpName, filename);
+    }
+
+    std::string PipelineStateCache::getDefaultFilename()
+    {
+        std::string directory = ShaderCache::getDirectory();
+        return directory.empty() ? directory : directory + "/PipelineStates.bin";
+    }
+
+    void PipelineStateCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries.clear();
+        mEntryCount = 0;
+        mPruneThreshold = 0;
+    }
+
+    PipelineStateCache::Stats PipelineStateCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Stats stats = mStats;
+        stats.entryCount = mEntryCount;
+        return stats;
+    }
+
+    void PipelineStateCache::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats = Stats();
+    }
+}
@@ -0,0 +1,176 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "API/GraphicsStateObject.h"
+#include "API/ComputeStateObject.h"
+
+namespace Falcor
+{
+    /** Content key of a pipeline state object.
+        The key is a byte string describing everything which affects the compiled state: shader code hashes, root signature layout, fixed-function state and render-target formats.
+        It doesn't contain object addresses, so the same state has the same key in every run.
+    */
+    class PipelineStateKey
+    {
+    public:
+        /** Create the key of a graphics state
+        */
+        static PipelineStateKey create(const GraphicsStateObject::Desc& desc);
+
+        /** Create the key of a compute state
+        */
+        static PipelineStateKey create(const ComputeStateObject::Desc& desc);
+
+        /** Append a value to the key. Only use types without padding bytes.
+        */
+        template<typename T>
+        PipelineStateKey& add(const T& value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "PipelineStateKey::add() requires a trivially copyable type");
+            return addBytes(&value, sizeof(T));
+        }
+
+        /** Append a string to the key
+        */
+        PipelineStateKey& add(const std::string& str);
+
+        /** Append raw bytes to the key
+        */
+        PipelineStateKey& addBytes(const void* pData, size_t size);
+
+        /** Get a 64-bit hash of the key
+        */
+        uint64_t getHash() const;
+
+        /** Get the key data
+        */
+        const std::vector<uint8_t>& getData() const { return mData; }
+
+        bool operator==(const PipelineStateKey& other) const { return mData == other.mData; }
+        bool operator!=(const PipelineStateKey& other) const { return mData != other.mData; }
+
+    private:
+        std::vector<uint8_t> mData;
+    };
+
+    /** Process-wide cache of pipeline state objects, shared by all GraphicsState and ComputeState objects.
+        State objects are found by their content key in constant time, so two passes with identical state share a single object.
+        The cache only holds weak references to the state objects. It also keeps the driver blob of every state it created, which can be saved to a file and loaded in the next run to skip compiling the states again.
+        Entries of released states which have no driver blob are pruned when the cache grows, so keys which are never used again don't accumulate.
+        The file format doesn't depend on the API or the driver. The driver validates the blobs and rejects the ones it can't use, in which case the state is compiled from scratch.
+        All functions are thread-safe.
+    */
+    class PipelineStateCache
+    {
+    public:
+        struct Stats
+        {
+            uint64_t hits = 0;          ///< Lookups which found a live state object
+            uint64_t misses = 0;        ///< Lookups which created a state object
+            uint64_t blobHits = 0;      ///< Misses which passed a driver blob to the driver
+            size_t entryCount = 0;      ///< Number of keys in the cache, including the ones loaded from a file
+        };
+
+        /** Creates a state object. Receives the cached driver blob of the state, which may be empty, and returns the object and its new driver blob.
+        */
+        using Factory = std::function<std::shared_ptr<void>(const std::vector<uint8_t>& cachedBlob, std::vector<uint8_t>& newBlob)>;
+
+        /** Get the global cache
+        */
+        static PipelineStateCache& instance();
+
+        /** Get a graphics state object with the given description, creating it if needed
+        */
+        GraphicsStateObject::SharedPtr getGraphicsState(const GraphicsStateObject::Desc& desc);
+
+        /** Get a compute state object with the given description, creating it if needed
+        */
+        ComputeStateObject::SharedPtr getComputeState(const ComputeStateObject::Desc& desc);
+
+        /** Find a live object by key, or create it. This is the API-independent part of getGraphicsState() and getComputeState().
+            \param[in] key The content key
+            \param[in] factory Called without holding the cache lock if there's no live object for the key
+            \return The object, or nullptr if the factory failed
+        */
+        std::shared_ptr<void> findOrCreate(const PipelineStateKey& key, const Factory& factory);
+
+        /** Load keys and driver blobs saved by save(). Entries already in the cache are kept.
+            \return false if the file doesn't exist or is corrupted
+        */
+        bool load(const std::string& filename);
+
+        /** Save the keys and driver blobs of all the states created so far, and of the ones loaded from a file. Entries without a driver blob are skipped.
+            \return false if the file can't be written
+        */
+        bool save(const std::string& filename) const;
+
+        /** Get the default cache filename, in the shader cache directory. Returns an empty string if the shader cache is disabled.
+        */
+        static std::string getDefaultFilename();
+
+        /** Remove all the entries
+        */
+        void clear();
+
+        /** Get the statistics
+        */
+        Stats getStats() const;
+
+        /** Reset the hit and miss counters
+        */
+        void resetStats();
+
+    private:
+        PipelineStateCache() = default;
+        PipelineStateCache(const PipelineStateCache&) = delete;
+        PipelineStateCache& operator=(const PipelineStateCache&) = delete;
+
+        struct Entry
+        {
+            std::vector<uint8_t> key;
+            std::weak_ptr<void> pObject;
+            std::vector<uint8_t> blob;
+        };
+
+        Entry* findLocked(uint64_t hash, const std::vector<uint8_t>& key);
+        void pruneLocked();
+
+        mutable std::mutex mMutex;
+        std::unordered_map<uint64_t, std::vector<Entry>> mEntries;     ///< Keyed by the key hash. Each bucket almost always has a single entry.
+        size_t mEntryCount = 0;
+        size_t mPruneThreshold = 0;                                     ///< Prune when the entry count reaches this value
+        Stats mStats;
+    };
+}
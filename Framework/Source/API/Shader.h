@@ -30,6 +30,7 @@
 #include <unordered_set>
 
 #include "Externals/Slang/slang.h"
+#include "Utils/Hash.h"
 
 namespace Falcor
 {
@@ -164,6 +165,7 @@ namespace Falcor
         static SharedPtr create(const Blob& shaderBlob, ShaderType type, std::string const&  entryPointName, CompilerFlags flags, std::string& log)
         {
             SharedPtr pShader = SharedPtr(new Shader(type));
+            pShader->mCodeHash = xxHash64(shaderBlob->getBufferPointer(), shaderBlob->getBufferSize());
             return pShader->init(shaderBlob, entryPointName, flags, log) ? pShader : nullptr;
         }
 
@@ -177,6 +179,10 @@ namespace Falcor
         */
         ShaderType getType() const { return mType; }
 
+        /** Get a hash of the shader code. Identical code has the same hash in every run.
+        */
+        uint64_t getCodeHash() const { return mCodeHash; }
+
 
 #ifdef FALCOR_D3D12
         ID3DBlobPtr getD3DBlob() const;
@@ -187,6 +193,7 @@ namespace Falcor
         bool init(const Blob& shaderBlob, const std::string&  entryPointName, CompilerFlags flags, std::string& log);
         Shader(ShaderType Type);
         ShaderType mType;
+        uint64_t mCodeHash = 0;
         ApiHandle mApiHandle;
         void* mpPrivateData = nullptr;
     };
@@ -28,7 +28,6 @@
 #include "Framework.h"
 #include "API/Texture.h"
 #include "API/Device.h"
-#include "Utils/ThreadPool.h"
 
 namespace Falcor
 {
@@ -128,14 +127,7 @@ namespace Falcor
     {
         uint32_t subresource = getSubresourceIndex(arraySlice, mipLevel);
         std::vector<uint8> textureData = gpDevice->getRenderContext()->readTextureSubresource(this, subresource);
-
-        auto func = [=]()
-        {
-            Bitmap::saveImage(filename, getWidth(mipLevel), getHeight(mipLevel), format, exportFlags, getFormat(), true, (void*)textureData.data());
-        };
-
-        static ThreadPool<16> sThreadPool;
-        sThreadPool.getAvailable() = std::thread(func);
+        Bitmap::saveImageAsync(filename, getWidth(mipLevel), getHeight(mipLevel), format, exportFlags, getFormat(), true, std::move(textureData));
     }
 
     void Texture::uploadInitData(const void* pData, bool autoGenMips)
@@ -155,6 +155,8 @@ namespace Falcor
         static SharedPtr create2DMS(uint32_t width, uint32_t height, ResourceFormat format, uint32_t sampleCount, uint32_t arraySize = 1, BindFlags bindFlags = BindFlags::ShaderResource);
         
         /** Capture the texture to an image file.
+            The texture is read back synchronously, which stalls the CPU until the GPU is idle. The image is encoded in the background by the ImageEncodeQueue.
+            Use ScreenCapture to capture frames without stalling.
             \param[in] mipLevel Requested mip-level
             \param[in] arraySlice Requested array-slice
             \param[in] filename Name of the file to save.
@@ -37,54 +37,26 @@
 
 namespace Falcor
 {
-    VariablesBuffer::~VariablesBuffer() = default;
+    // Copies issued by RenderContext::updateBuffer() have a fixed overhead, so it's cheaper to upload small gaps than to split the copy
+    static const size_t kDirtyRangeMergeDistance = 256;
+    static const size_t kMaxDirtyRanges = 32;
 
-    template<typename VarType>
-    ReflectionBasicType::Type getReflectionTypeFromCType()
-    {
-#define c_to_prog(cType, progType) if(typeid(VarType) == typeid(cType)) return ReflectionBasicType::Type::progType;
-        c_to_prog(bool,  Bool);
-        c_to_prog(bvec2, Bool2);
-        c_to_prog(bvec3, Bool3);
-        c_to_prog(bvec4, Bool4);
-
-        c_to_prog(int32_t, Int);
-        c_to_prog(ivec2, Int2);
-        c_to_prog(ivec3, Int3);
-        c_to_prog(ivec4, Int4);
-
-        c_to_prog(uint32_t, Uint);
-        c_to_prog(uvec2, Uint2);
-        c_to_prog(uvec3, Uint3);
-        c_to_prog(uvec4, Uint4);
-
-        c_to_prog(float,     Float);
-        c_to_prog(glm::vec2, Float2);
-        c_to_prog(glm::vec3, Float3);
-        c_to_prog(glm::vec4, Float4);
-
-        c_to_prog(glm::mat2,   Float2x2);
-        c_to_prog(glm::mat2x3, Float2x3);
-        c_to_prog(glm::mat2x4, Float2x4);
-
-        c_to_prog(glm::mat3  , Float3x3);
-        c_to_prog(glm::mat3x2, Float3x2);
-        c_to_prog(glm::mat3x4, Float3x4);
-        
-        c_to_prog(glm::mat4, Float4x4);
-        c_to_prog(glm::mat4x2, Float4x2);
-        c_to_prog(glm::mat4x3, Float4x3);
-
-#undef c_to_prog
-        should_not_get_here();
-        return ReflectionBasicType::Type::Unknown;
-    }
+    VariablesBuffer::UploadStats VariablesBuffer::sUploadStats;
+
+    VariablesBuffer::~VariablesBuffer() = default;
 
     VariablesBuffer::VariablesBuffer(const std::string& name, const ReflectionResourceType::SharedConstPtr& pReflectionType, size_t elementSize, size_t elementCount, BindFlags bindFlags, CpuAccess cpuAccess) :
-       mName(name), mpReflector(pReflectionType), Buffer(elementSize * elementCount, bindFlags, cpuAccess), mElementCount(elementCount), mElementSize(elementSize)
+       mName(name), mpReflector(pReflectionType), Buffer(elementSize * elementCount, bindFlags, cpuAccess), mElementCount(elementCount), mElementSize(elementSize), mDirtyRanges(kDirtyRangeMergeDistance, kMaxDirtyRanges)
     {
         Buffer::apiInit(false);
         mData.assign(mSize, 0);
+        markDirty(0, mSize);
+    }
+
+    void VariablesBuffer::markDirty(size_t offset, size_t size)
+    {
+        mDirtyRanges.add(offset, size);
+        mDirty = true;
     }
 
     size_t VariablesBuffer::getVariableOffset(const std::string& varName) const
@@ -111,7 +83,26 @@ namespace Falcor
             return false;
         }
 
-        updateData(mData.data(), offset, size);
+        sUploadStats.bufferCount++;
+        sUploadStats.dirtyBytes += mDirtyRanges.getDirtyBytes();
+
+        // Write-discard buffers get a new allocation on every update, so everything needs to be copied
+        if (mCpuAccess == CpuAccess::Write || offset != 0 || size != mSize)
+        {
+            updateData(mData.data() + offset, offset, size);
+            sUploadStats.rangeCount++;
+            sUploadStats.uploadedBytes += size;
+        }
+        else
+        {
+            for (const auto& range : mDirtyRanges.getRanges())
+            {
+                updateData(mData.data() + range.begin, range.begin, range.size());
+                sUploadStats.rangeCount++;
+                sUploadStats.uploadedBytes += range.size();
+            }
+        }
+        mDirtyRanges.clear();
         mDirty = false;
         return true;
     }
@@ -177,7 +168,7 @@ namespace Falcor
         {
             const uint8_t* pVar = mData.data() + offset + elementIndex * mElementSize;
             *(VarType*)pVar = value;
-            mDirty = true;
+            markDirty(offset + elementIndex * mElementSize, sizeof(VarType));
         }
     }
 
@@ -277,7 +268,7 @@ namespace Falcor
             {
                 pData[i] = pValue[i];
             }
-            mDirty = true;
+            markDirty((uint8_t*)pData - mData.data(), count * sizeof(VarType));
         }
     }
 
@@ -391,7 +382,7 @@ namespace Falcor
             return;
         }
         std::memcpy(mData.data() + offset, pSrc, size);
-        mDirty = true;
+        markDirty(offset, size);
     }
 
     void VariablesBuffer::renderUI(Gui* pGui, const char* uiGroup)
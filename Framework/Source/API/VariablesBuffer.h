@@ -27,9 +27,11 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <type_traits>
 #include "Graphics/Program/ProgramReflection.h"
 #include "Texture.h"
 #include "Buffer.h"
+#include "Utils/DirtyRanges.h"
 #include "Graphics/Program//Program.h"
 
 namespace Falcor
@@ -38,6 +40,49 @@ namespace Falcor
     // Forward declares for gui draw func
     class Gui;
 
+    /** Get the reflection type matching a C++ type. The comparisons are resolved at compile-time
+    */
+    template<typename VarType>
+    inline ReflectionBasicType::Type getReflectionTypeFromCType()
+    {
+#define c_to_prog(cType, progType) if(std::is_same<VarType, cType>::value) return ReflectionBasicType::Type::progType;
+        c_to_prog(bool,  Bool);
+        c_to_prog(bvec2, Bool2);
+        c_to_prog(bvec3, Bool3);
+        c_to_prog(bvec4, Bool4);
+
+        c_to_prog(int32_t, Int);
+        c_to_prog(ivec2, Int2);
+        c_to_prog(ivec3, Int3);
+        c_to_prog(ivec4, Int4);
+
+        c_to_prog(uint32_t, Uint);
+        c_to_prog(uvec2, Uint2);
+        c_to_prog(uvec3, Uint3);
+        c_to_prog(uvec4, Uint4);
+
+        c_to_prog(float,     Float);
+        c_to_prog(glm::vec2, Float2);
+        c_to_prog(glm::vec3, Float3);
+        c_to_prog(glm::vec4, Float4);
+
+        c_to_prog(glm::mat2,   Float2x2);
+        c_to_prog(glm::mat2x3, Float2x3);
+        c_to_prog(glm::mat2x4, Float2x4);
+
+        c_to_prog(glm::mat3  , Float3x3);
+        c_to_prog(glm::mat3x2, Float3x2);
+        c_to_prog(glm::mat3x4, Float3x4);
+        
+        c_to_prog(glm::mat4, Float4x4);
+        c_to_prog(glm::mat4x2, Float4x2);
+        c_to_prog(glm::mat4x3, Float4x3);
+
+#undef c_to_prog
+        should_not_get_here();
+        return ReflectionBasicType::Type::Unknown;
+    }
+
     /** Manages shader buffers containing named data, such as Constant/Uniform Buffers and Structured Buffers.
         When accessing a variable by name, you can only use a name which points to a basic Type, or an array of basic Type (so if you want the start of a structure, ask for the first field in the struct).
         Note that Falcor has 2 flavors of setting variable by names - SetVariable() and SetVariableArray(). Naming rules for N-dimensional arrays of a basic Type are a little different between the two.
@@ -51,11 +96,22 @@ namespace Falcor
 
         static const size_t kInvalidOffset = -1;// ProgramReflection::kInvalidLocation;
 
+        /** Statistics of the data uploaded by uploadToGPU(), accumulated over all the buffers
+        */
+        struct UploadStats
+        {
+            uint64_t bufferCount = 0;       ///> The number of buffer uploads
+            uint64_t rangeCount = 0;        ///> The number of copies issued
+            uint64_t uploadedBytes = 0;     ///> The number of bytes copied to the GPU
+            uint64_t dirtyBytes = 0;        ///> The number of bytes which were modified on the CPU. Can be lower than uploadedBytes, since write-discard buffers are copied entirely
+        };
+
         VariablesBuffer(const std::string& name, const ReflectionResourceType::SharedConstPtr& pReflectionType, size_t elementSize, size_t elementCount, BindFlags bindFlags, CpuAccess cpuAccess);
 
         virtual ~VariablesBuffer() = 0;
 
         /** Apply the changes to the actual GPU buffer.
+            By default, only the ranges modified since the last upload are copied. Buffers created with CpuAccess::Write are renamed on every update, so they are always copied entirely.
             Note that it is possible to use this function to update only part of the GPU copy of the buffer. This might lead to inconsistencies between the GPU and CPU buffer, so make sure you know what you are doing.
             \param[in] offset Offset into the buffer to write to
             \param[in] size Number of bytes to upload. If this value is -1, will update the [Offset, EndOfBuffer] range.
@@ -88,6 +144,18 @@ namespace Falcor
         */
         void renderUI(Gui* pGui, const char* uiGroup);
 
+        /** Get the ranges which were modified since the last upload
+        */
+        const DirtyRanges& getDirtyRanges() const { return mDirtyRanges; }
+
+        /** Get the upload statistics accumulated since the last call to resetUploadStats()
+        */
+        static const UploadStats& getUploadStats() { return sUploadStats; }
+
+        /** Reset the upload statistics
+        */
+        static void resetUploadStats() { sUploadStats = UploadStats(); }
+
         // Allows UI functions to look through reflection data
         friend class VariablesBufferUI;
 
@@ -104,9 +172,13 @@ namespace Falcor
         template<typename T>
         void setVariableArray(const std::string& name, size_t elementIndex, const T* pValue, size_t count);
 
+        void markDirty(size_t offset, size_t size);
+
         ReflectionResourceType::SharedConstPtr mpReflector;
         std::vector<uint8_t> mData;
         mutable bool mDirty = true;
+        DirtyRanges mDirtyRanges;
+        static UploadStats sUploadStats;
         size_t mElementCount;
         size_t mElementSize;
         std::string mName;
@@ -32,7 +32,7 @@
 
 namespace Falcor
 {
-    bool ComputeStateObject::apiInit()
+    bool ComputeStateObject::apiInit(const std::vector<uint8_t>& cachedBlob)
     {
         std::vector<VkPipelineShaderStageCreateInfo> shaderStageInfos;
         initVkShaderStageInfo(mDesc.getProgramVersion().get(), shaderStageInfos);
@@ -52,4 +52,9 @@ namespace Falcor
         mApiHandle = ApiHandle::create(pipeline);
         return true;
     }
+    std::vector<uint8_t> ComputeStateObject::getCachedBlob() const
+    {
+        // Pipelines are created without a VkPipelineCache
+        return {};
+    }
 }
\ No newline at end of file
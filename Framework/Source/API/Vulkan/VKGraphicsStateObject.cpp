@@ -34,7 +34,7 @@
 
 namespace Falcor
 {
-    bool GraphicsStateObject::apiInit()
+    bool GraphicsStateObject::apiInit(const std::vector<uint8_t>& cachedBlob)
     {
         // Shader Stages
         std::vector<VkPipelineShaderStageCreateInfo> shaderStageInfos;
@@ -106,4 +106,9 @@ namespace Falcor
 
         return true;
     }
+    std::vector<uint8_t> GraphicsStateObject::getCachedBlob() const
+    {
+        // Pipelines are created without a VkPipelineCache
+        return {};
+    }
 }
\ No newline at end of file
@@ -204,6 +204,15 @@ namespace Falcor
         return !isInside;
     }
 
+    void Camera::getFrustumPlanes(glm::vec4 planes[6]) const
+    {
+        calculateCameraParameters();
+        for (int plane = 0; plane < 6; plane++)
+        {
+            planes[plane] = glm::vec4(mFrustumPlanes[plane].xyz, -mFrustumPlanes[plane].negW);
+        }
+    }
+
     void Camera::setRightEyeMatrices(const glm::mat4& view, const glm::mat4& proj)
     {
         mData.rightEyeViewMat = view;
@@ -195,6 +195,11 @@ namespace Falcor
         */
         bool isObjectCulled(const BoundingBox& box) const;
 
+        /** Get the world-space frustum planes. A point p is inside the frustum if dot(plane.xyz, p) + plane.w > 0 for all the planes.
+            \param[out] planes The 6 frustum planes
+        */
+        void getFrustumPlanes(glm::vec4 planes[6]) const;
+
         /** Set camera data into a program's constant buffer.
             \param[in] pBuffer The constant buffer to set the parameters into.
             \param[in] varName The name of the light variable in the program.
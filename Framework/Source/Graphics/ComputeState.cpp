@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "ComputeState.h"
 #include "Graphics/Program/ProgramVars.h"
+#include "API/PipelineStateCache.h"
 
 namespace Falcor
 {
@@ -63,20 +64,9 @@ namespace Falcor
             mDesc.setProgramVersion(pProgVersion);
             mDesc.setRootSignature(pRoot);
 
-            StateGraph::CompareFunc cmpFunc = [&desc = mDesc](ComputeStateObject::SharedPtr pCso) -> bool
-            {
-                return pCso && (desc == pCso->getDesc());
-            };
-
-            if (mpCsoGraph->scanForMatchingNode(cmpFunc))
-            {
-                pCso = mpCsoGraph->getCurrentNode();
-            }
-            else
-            {
-                pCso = ComputeStateObject::create(mDesc);
-                mpCsoGraph->setCurrentNodeData(pCso);
-            }
+            // The global cache shares state objects between all the compute states
+            pCso = PipelineStateCache::instance().getComputeState(mDesc);
+            mpCsoGraph->setCurrentNodeData(pCso);
         }
 
         return pCso;
@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "GraphicsState.h"
 #include "Graphics/Program/ProgramVars.h"
+#include "API/PipelineStateCache.h"
 
 namespace Falcor
 {
@@ -111,21 +112,10 @@ namespace Falcor
             mDesc.setRootSignature(pRoot);
 
             mDesc.setSinglePassStereoEnable(mEnableSinglePassStereo);
-            
-            StateGraph::CompareFunc cmpFunc = [&desc = mDesc](GraphicsStateObject::SharedPtr pGso) -> bool
-            {
-                return pGso && (desc == pGso->getDesc());
-            };
 
-            if (mpGsoGraph->scanForMatchingNode(cmpFunc))
-            {
-                pGso = mpGsoGraph->getCurrentNode();
-            }
-            else
-            {
-                pGso = GraphicsStateObject::create(mDesc);
-                mpGsoGraph->setCurrentNodeData(pGso);
-            }
+            // The global cache shares state objects between all the graphics states
+            pGso = PipelineStateCache::instance().getGraphicsState(mDesc);
+            mpGsoGraph->setCurrentNodeData(pGso);
         }
         return pGso;
     }
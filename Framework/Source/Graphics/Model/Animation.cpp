@@ -30,6 +30,7 @@
 #include "AnimationController.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/transform.hpp"
+#include <algorithm>
 
 namespace Falcor
 {
@@ -56,69 +57,126 @@ namespace Falcor
     Animation::~Animation() = default;
 
     template<typename T>
-    uint32_t findCurrentFrame(T channel, float ticks)
+    uint32_t findCurrentFrame(const Animation::AnimationChannel<T>& channel, float ticks)
     {
-        uint32_t curKeyID = channel.lastKeyUsed;
-        while(curKeyID < channel.keys.size() - 1)
+        const std::vector<float>& times = channel.times;
+        uint32_t keyCount = (uint32_t)times.size();
+        uint32_t hint = channel.lastKeyUsed;
+
+        // Fast path - the time is still inside the cached interval or advanced to the next one
+        if (hint < keyCount && times[hint] <= ticks)
         {
-            if(channel.keys[curKeyID + 1].time > ticks)
-            {
-                break;
-            }
-            curKeyID++;
+            if (hint + 1 == keyCount || ticks < times[hint + 1]) return hint;
+            if (hint + 2 == keyCount || ticks < times[hint + 2]) return hint + 1;
         }
-        return curKeyID;
+
+        // Binary search for the last key which starts before the current time. Handles scrubbing and looping
+        auto it = std::upper_bound(times.begin(), times.end(), ticks);
+        return (it == times.begin()) ? 0 : uint32_t(it - times.begin()) - 1;
     }
 
-    glm::vec3 interpolate(const glm::vec3& start, const glm::vec3& end, float ratio)
+    static void storeValue(const glm::vec3& v, std::vector<float>* pDst, size_t index)
     {
-        return start + ((end - start) * ratio);
+        for (uint32_t c = 0; c < 3; c++) pDst[c][index] = v[c];
     }
 
-    glm::quat interpolate(const glm::quat& start, const glm::quat& end, float ratio)
+    static void storeValue(const glm::quat& q, std::vector<float>* pDst, size_t index)
     {
-        return glm::slerp(start, end, ratio);
+        pDst[0][index] = q.x;
+        pDst[1][index] = q.y;
+        pDst[2][index] = q.z;
+        pDst[3][index] = q.w;
     }
 
-    template<typename KeyType>
-    KeyType Animation::calcCurrentKey(AnimationChannel<KeyType>& channel, float ticks, float lastUpdateTime)
+    // The interpolation loops below have no dependencies between iterations and no branches, so that the compiler can vectorize them
+    static void lerpBatch(std::vector<float>* pStart, const std::vector<float>* pEnd, const std::vector<float>& ratio, uint32_t componentCount)
     {
-        KeyType curValue;
-        if(channel.keys.size() > 0)
+        size_t count = ratio.size();
+        const float* pRatio = ratio.data();
+        for (uint32_t c = 0; c < componentCount; c++)
         {
-            if(ticks < lastUpdateTime)
+            float* pS = pStart[c].data();
+            const float* pE = pEnd[c].data();
+            for (size_t i = 0; i < count; i++)
             {
-                channel.lastKeyUsed = 0;
+                pS[i] = pS[i] + (pE[i] - pS[i]) * pRatio[i];
             }
+        }
+    }
 
-            // search for the next keyframe
-            uint32_t curKeyIndex = findCurrentFrame(channel, ticks);
-            uint32_t nextKeyIndex = (curKeyIndex + 1) % channel.keys.size();
-            const AnimationKey<KeyType>& curKey = channel.keys[curKeyIndex];
-            const AnimationKey<KeyType>& nextKey = channel.keys[nextKeyIndex];
+    // Approximated slerp along the shortest path. Corrects the interpolation parameter of an nlerp with a polynomial fitted to the slerp curve,
+    // which keeps the error below 0.002 radians while avoiding the acos()/sin() calls.
+    static void slerpBatch(std::vector<float>* pStart, const std::vector<float>* pEnd, const std::vector<float>& ratio)
+    {
+        size_t count = ratio.size();
+        float* pX0 = pStart[0].data(); float* pY0 = pStart[1].data(); float* pZ0 = pStart[2].data(); float* pW0 = pStart[3].data();
+        const float* pX1 = pEnd[0].data(); const float* pY1 = pEnd[1].data(); const float* pZ1 = pEnd[2].data(); const float* pW1 = pEnd[3].data();
+        const float* pRatio = ratio.data();
 
-            assert(ticks >= curKey.time);
-            // Interpolate between them
-            float diff = nextKey.time - curKey.time;
+        for (size_t i = 0; i < count; i++)
+        {
+            float cosTheta = pX0[i] * pX1[i] + pY0[i] * pY1[i] + pZ0[i] * pZ1[i] + pW0[i] * pW1[i];
+            float d = std::abs(cosTheta);
+            float t = pRatio[i];
+            float a = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+            float b = 0.848013f + d * (-1.06021f + d * 0.215638f);
+            float k = a * (t - 0.5f) * (t - 0.5f) + b;
+            float correctedT = t + t * (t - 0.5f) * (t - 1) * k;
+
+            float startWeight = 1 - correctedT;
+            float endWeight = cosTheta < 0 ? -correctedT : correctedT;
+            float x = pX0[i] * startWeight + pX1[i] * endWeight;
+            float y = pY0[i] * startWeight + pY1[i] * endWeight;
+            float z = pZ0[i] * startWeight + pZ1[i] * endWeight;
+            float w = pW0[i] * startWeight + pW1[i] * endWeight;
+            float invLength = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+            pX0[i] = x * invLength;
+            pY0[i] = y * invLength;
+            pZ0[i] = z * invLength;
+            pW0[i] = w * invLength;
+        }
+    }
 
-            if (diff == 0)
-            {
-                curValue = curKey.value;
-            }
-            else
-            {
-                if (diff < 0)
-                {
-                    diff += mDuration;
-                }
+    void Animation::InterpolationBatch::resize(size_t count)
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            start[c].resize(count);
+            end[c].resize(count);
+        }
+        ratio.resize(count);
+    }
 
-                float ratio = (ticks - curKey.time) / diff;
-                curValue = interpolate(curKey.value, nextKey.value, ratio);
-            }
-            
-            channel.lastKeyUsed = curKeyIndex;
+    template<typename KeyType>
+    void Animation::gatherKeys(AnimationChannel<KeyType>& channel, float ticks, const KeyType& defaultValue, InterpolationBatch& batch, size_t index)
+    {
+        uint32_t keyCount = channel.getKeyCount();
+        if (keyCount == 0)
+        {
+            storeValue(defaultValue, batch.start, index);
+            storeValue(defaultValue, batch.end, index);
+            batch.ratio[index] = 0;
+            return;
+        }
+
+        // search for the next keyframe
+        uint32_t curKeyIndex = findCurrentFrame(channel, ticks);
+        uint32_t nextKeyIndex = (curKeyIndex + 1) % keyCount;
+        float curTime = channel.times[curKeyIndex];
+        float nextTime = channel.times[nextKeyIndex];
+
+        // Interpolate between them
+        float diff = nextTime - curTime;
+        if (diff < 0)
+        {
+            diff += mDuration;
         }
-        return curValue;
+        float ratio = (diff > 0) ? (ticks - curTime) / diff : 0;
+
+        storeValue(channel.values[curKeyIndex], batch.start, index);
+        storeValue(channel.values[nextKeyIndex], batch.end, index);
+        batch.ratio[index] = glm::clamp(ratio, 0.0f, 1.0f);
+        channel.lastKeyUsed = curKeyIndex;
     }
 
     void Animation::animate(double totalTime, AnimationController* pAnimationController)
@@ -126,24 +184,38 @@ namespace Falcor
         // Calculate the relative time
         float ticks = (float)fmod(totalTime * mTicksPerSecond, mDuration);
 
-        for(auto& Key : mAnimationSets)
-        {
-            glm::mat4 translation;
-            translation[3] = glm::vec4(calcCurrentKey(Key.translation, ticks, Key.lastUpdateTime), 1);
-
-            glm::mat4 scaling;
-            if (Key.scaling.keys.size() > 0)
-            {
-                scaling = glm::scale(calcCurrentKey(Key.scaling, ticks, Key.lastUpdateTime));
-            }
+        size_t setCount = mAnimationSets.size();
+        mTranslationBatch.resize(setCount);
+        mScalingBatch.resize(setCount);
+        mRotationBatch.resize(setCount);
 
-            glm::quat q = calcCurrentKey(Key.rotation, ticks, Key.lastUpdateTime);
-            glm::mat4 rotation = glm::mat4_cast(q);
+        // Find the keys of all the channels, then interpolate each channel type in one batch
+        for (size_t i = 0; i < setCount; i++)
+        {
+            AnimationSet& set = mAnimationSets[i];
+            gatherKeys(set.translation, ticks, glm::vec3(0), mTranslationBatch, i);
+            gatherKeys(set.scaling, ticks, glm::vec3(1), mScalingBatch, i);
+            gatherKeys(set.rotation, ticks, glm::quat(), mRotationBatch, i);
+        }
 
-            Key.lastUpdateTime = ticks;
+        lerpBatch(mTranslationBatch.start, mTranslationBatch.end, mTranslationBatch.ratio, 3);
+        lerpBatch(mScalingBatch.start, mScalingBatch.end, mScalingBatch.ratio, 3);
+        slerpBatch(mRotationBatch.start, mRotationBatch.end, mRotationBatch.ratio);
 
-            glm::mat4 T = translation * rotation * scaling;
-            pAnimationController->setBoneLocalTransform(Key.boneID, T);
+        for (size_t i = 0; i < setCount; i++)
+        {
+            const auto& t = mTranslationBatch.start;
+            const auto& s = mScalingBatch.start;
+            const auto& r = mRotationBatch.start;
+
+            // T * R * S
+            glm::mat3 rotation = glm::mat3_cast(glm::quat(r[3][i], r[0][i], r[1][i], r[2][i]));
+            glm::mat4 transform;
+            transform[0] = glm::vec4(rotation[0] * s[0][i], 0);
+            transform[1] = glm::vec4(rotation[1] * s[1][i], 0);
+            transform[2] = glm::vec4(rotation[2] * s[2][i], 0);
+            transform[3] = glm::vec4(t[0][i], t[1][i], t[2][i], 1);
+            pAnimationController->setBoneLocalTransform(mAnimationSets[i].boneID, transform);
         }
     }
 }
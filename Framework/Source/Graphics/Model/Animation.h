@@ -40,18 +40,17 @@ namespace Falcor
         using UniquePtr = std::unique_ptr<Animation>;
         using UniqueConstPtr = std::unique_ptr<const Animation>;
 
-        template<typename T>
-        struct AnimationKey
-        {
-            T value;
-            float time;
-        };
-
+        /** A single animation channel. Key times and values are stored as separate arrays, so that the key lookup only touches the times.
+        */
         template<typename T>
         struct AnimationChannel
         {
-            std::vector<AnimationKey<T>> keys;
-            uint32_t lastKeyUsed = 0;
+            std::vector<float> times;   ///< Key times in ticks, sorted in ascending order
+            std::vector<T> values;      ///< Key values
+            uint32_t lastKeyUsed = 0;   ///< Cursor used as a hint by the next lookup
+
+            void addKey(float time, const T& value) { times.push_back(time); values.push_back(value); }
+            uint32_t getKeyCount() const { return (uint32_t)times.size(); }
         };
 
         struct AnimationSet
@@ -60,7 +59,6 @@ namespace Falcor
             AnimationChannel<glm::vec3> translation;
             AnimationChannel<glm::vec3> scaling;
             AnimationChannel<glm::quat> rotation;
-            float lastUpdateTime = 0;
         };
 
         static UniquePtr create(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond);
@@ -79,7 +77,22 @@ namespace Falcor
 
         std::vector<AnimationSet> mAnimationSets;
 
+        /** Interpolation inputs for all the animation sets, stored as structure-of-arrays so that the interpolation loops can be vectorized.
+            The results are written back into 'start'.
+        */
+        struct InterpolationBatch
+        {
+            std::vector<float> start[4];
+            std::vector<float> end[4];
+            std::vector<float> ratio;
+
+            void resize(size_t count);
+        };
+        InterpolationBatch mTranslationBatch;
+        InterpolationBatch mScalingBatch;
+        InterpolationBatch mRotationBatch;
+
         template<typename _KeyType>
-        _KeyType calcCurrentKey(AnimationChannel<_KeyType>& channel, float ticks, float lastUpdateTime);
+        void gatherKeys(AnimationChannel<_KeyType>& channel, float ticks, const _KeyType& defaultValue, InterpolationBatch& batch, size_t index);
     };
-}
\ No newline at end of file
+}
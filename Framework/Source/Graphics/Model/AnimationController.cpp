@@ -30,10 +30,47 @@
 #include "Model.h"
 #include <fstream>
 #include "Animation.h"
+#include "Utils/TaskScheduler.h"
 #include <algorithm>
 
 namespace Falcor
 {
+    // Levels with fewer bones than this are evaluated on the calling thread
+    static const uint32_t kMinBonesPerParallelLevel = 1024;
+
+    static glm::mat4x3 affineMultiply(const glm::mat4x3& a, const glm::mat4x3& b)
+    {
+        glm::mat3 a3(a);
+        glm::mat4x3 result;
+        result[0] = a3 * b[0];
+        result[1] = a3 * b[1];
+        result[2] = a3 * b[2];
+        result[3] = a3 * b[3] + a[3];
+        return result;
+    }
+
+    /** Calculate transpose(inverse(M)) for an affine M.
+        The inverse-transpose of the upper 3x3 is the cofactor matrix divided by the determinant, which avoids the generic 4x4 inverse.
+    */
+    static glm::mat4 affineInverseTranspose(const glm::mat4x3& m)
+    {
+        glm::vec3 c0 = glm::cross(m[1], m[2]);
+        glm::vec3 c1 = glm::cross(m[2], m[0]);
+        glm::vec3 c2 = glm::cross(m[0], m[1]);
+        float invDet = 1.0f / glm::dot(m[0], c0);
+        c0 *= invDet;
+        c1 *= invDet;
+        c2 *= invDet;
+
+        // The last row holds the transposed inverse translation, -inverse(A) * t
+        glm::mat4 result;
+        result[0] = glm::vec4(c0, -glm::dot(c0, m[3]));
+        result[1] = glm::vec4(c1, -glm::dot(c1, m[3]));
+        result[2] = glm::vec4(c2, -glm::dot(c2, m[3]));
+        result[3] = glm::vec4(0, 0, 0, 1);
+        return result;
+    }
+
     void dumpBonesHeirarchy(const std::string& filename, Bone* pBone, uint32_t count)
     {
         std::ofstream dotfile;
@@ -76,6 +113,7 @@ namespace Falcor
         mBones = Bones;
         mBoneTransforms.resize(mBones.size());
         mBoneInvTransposeTransforms.resize(mBones.size());
+        initHierarchy();
         setActiveAnimation(kBindPoseAnimationId);
     }
 
@@ -89,6 +127,41 @@ namespace Falcor
             mAnimations.push_back(Animation::create(*it));
         }
         mActiveAnimation = other.mActiveAnimation;
+        initHierarchy();
+        mLocalTransforms = other.mLocalTransforms;
+        mGlobalTransforms = other.mGlobalTransforms;
+    }
+
+    void AnimationController::initHierarchy()
+    {
+        uint32_t boneCount = (uint32_t)mBones.size();
+        mLocalTransforms.resize(boneCount);
+        mGlobalTransforms.resize(boneCount);
+        mOffsets.resize(boneCount);
+
+        std::vector<uint32_t> depth(boneCount, 0);
+        uint32_t maxDepth = 0;
+        for (uint32_t i = 0; i < boneCount; i++)
+        {
+            mLocalTransforms[i] = glm::mat4x3(mBones[i].localTransform);
+            mOffsets[i] = glm::mat4x3(mBones[i].offset);
+            uint32_t parentID = mBones[i].parentID;
+            if (parentID != kInvalidBoneID)
+            {
+                assert(parentID < i);
+                depth[i] = depth[parentID] + 1;
+                maxDepth = std::max(maxDepth, depth[i]);
+            }
+        }
+
+        // Counting sort by depth. The sort is stable, so the order of the bones inside a level is preserved
+        mLevelOffsets.assign(maxDepth + 2, 0);
+        for (uint32_t i = 0; i < boneCount; i++) mLevelOffsets[depth[i] + 1]++;
+        for (uint32_t level = 1; level < mLevelOffsets.size(); level++) mLevelOffsets[level] += mLevelOffsets[level - 1];
+
+        mEvaluationOrder.resize(boneCount);
+        std::vector<uint32_t> writeOffsets(mLevelOffsets.begin(), mLevelOffsets.end() - 1);
+        for (uint32_t i = 0; i < boneCount; i++) mEvaluationOrder[writeOffsets[depth[i]]++] = i;
     }
 
     void AnimationController::addAnimation(Animation::UniquePtr pAnimation)
@@ -101,7 +174,21 @@ namespace Falcor
     void AnimationController::setBoneLocalTransform(uint32_t boneID, const glm::mat4& transform)
     {
         assert(boneID < mBones.size());
-        mBones[boneID].localTransform = transform;
+        mLocalTransforms[boneID] = glm::mat4x3(transform);
+    }
+
+    void AnimationController::evaluateBones(uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            uint32_t boneID = mEvaluationOrder[i];
+            uint32_t parentID = mBones[boneID].parentID;
+            mGlobalTransforms[boneID] = (parentID == kInvalidBoneID) ? mLocalTransforms[boneID] : affineMultiply(mGlobalTransforms[parentID], mLocalTransforms[boneID]);
+
+            glm::mat4x3 boneTransform = affineMultiply(mGlobalTransforms[boneID], mOffsets[boneID]);
+            mBoneTransforms[boneID] = glm::mat4(boneTransform);
+            mBoneInvTransposeTransforms[boneID] = affineInverseTranspose(boneTransform);
+        }
     }
 
     void AnimationController::animate(double currentTime)
@@ -111,27 +198,39 @@ namespace Falcor
             mAnimations[mActiveAnimation]->animate(currentTime, this);
         }
 
-        for(uint32_t i = 0; i < mBones.size(); i++)
+        // Each level only depends on the previous one. Large levels are split across threads
+        for (uint32_t level = 0; level + 1 < mLevelOffsets.size(); level++)
         {
-            mBones[i].globalTransform = mBones[i].localTransform;
-            if(mBones[i].parentID != kInvalidBoneID)
+            uint32_t begin = mLevelOffsets[level];
+            uint32_t end = mLevelOffsets[level + 1];
+            if (end - begin < kMinBonesPerParallelLevel)
+            {
+                evaluateBones(begin, end);
+            }
+            else
             {
-                mBones[i].globalTransform = mBones[mBones[i].parentID].globalTransform * mBones[i].localTransform;
+                TaskScheduler::instance().parallelFor(begin, end, [this](size_t b, size_t e) { evaluateBones((uint32_t)b, (uint32_t)e); }, kMinBonesPerParallelLevel / 4);
             }
-            mBoneTransforms[i] = mBones[i].globalTransform * mBones[i].offset;
-            mBoneInvTransposeTransforms[i] = transpose(inverse(mBoneTransforms[i]));
         }
     }
 
+    void AnimationController::animate(const std::vector<AnimationController*>& controllers, double currentTime)
+    {
+        TaskScheduler::instance().parallelFor(0, controllers.size(), [&controllers, currentTime](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++) controllers[i]->animate(currentTime);
+        });
+    }
+
     void AnimationController::setActiveAnimation(uint32_t id)
     {
         assert(id == kBindPoseAnimationId || id < mAnimations.size());
         mActiveAnimation = id;
         if(id == kBindPoseAnimationId)
         {
-            for(auto& bone : mBones)
+            for(uint32_t i = 0; i < mBones.size(); i++)
             {
-                bone.localTransform = bone.originalLocalTransform;
+                mLocalTransforms[i] = glm::mat4x3(mBones[i].originalLocalTransform);
             }
         }
         animate(0);
@@ -29,10 +29,14 @@
 #include <map>
 #include <vector>
 #include "glm/mat4x4.hpp"
+#include "glm/mat4x3.hpp"
 #include "Animation.h"
 
 namespace Falcor
 {
+    /** Bone description used to create an AnimationController. Bones must be sorted so that parents come before their children.
+        The controller keeps the per-frame transforms in its own arrays, so localTransform and globalTransform only hold the initial values.
+    */
     struct Bone
     {
         uint32_t parentID;
@@ -62,6 +66,10 @@ namespace Falcor
         void addAnimation(Animation::UniquePtr pAnimation);
         void animate(double currentTime);
 
+        /** Animate a list of controllers. The controllers are evaluated in parallel using the global TaskScheduler.
+        */
+        static void animate(const std::vector<AnimationController*>& controllers, double currentTime);
+
         uint32_t getAnimationCount() const { return uint32_t(mAnimations.size()); }
         const std::string& getAnimationName(uint32_t ID) const;
         void setActiveAnimation(uint32_t id);
@@ -83,8 +91,18 @@ namespace Falcor
         std::vector<glm::mat4> mBoneInvTransposeTransforms;
         std::vector<Animation::UniquePtr> mAnimations;
 
+        // Bones are affine, so the hierarchy is evaluated using 3x4 matrices
+        std::vector<glm::mat4x3> mLocalTransforms;
+        std::vector<glm::mat4x3> mGlobalTransforms;
+        std::vector<glm::mat4x3> mOffsets;
+
+        // Bone IDs sorted by their depth in the hierarchy. Bones in the same level don't depend on each other
+        std::vector<uint32_t> mEvaluationOrder;
+        std::vector<uint32_t> mLevelOffsets;    // Start of each level in mEvaluationOrder, with an extra entry marking the end
+
         uint32_t mActiveAnimation = kBindPoseAnimationId;
 
-        void calculateBoneTransforms();
+        void initHierarchy();
+        void evaluateBones(uint32_t begin, uint32_t end);
     };
 }
\ No newline at end of file
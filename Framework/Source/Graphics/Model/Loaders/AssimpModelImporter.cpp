@@ -39,15 +39,13 @@
 #include "API/Buffer.h"
 #include "Utils/Platform/OS.h"
 #include "Graphics/TextureHelper.h"
+#include "Graphics/TextureCache.h"
+#include "Utils/TaskScheduler.h"
 #include "API/VertexLayout.h"
 #include "Data/VertexAttrib.h"
 #include "Utils/StringUtils.h"
 #include "API/Device.h"
 
-//So i can hash an int2
-#define GLM_ENABLE_EXPERIMENTAL1
-#include <glm/gtx/hash.hpp>
-
 namespace Falcor
 {
     static_assert(Mesh::kMaxBonesPerVertex == 4, "Fix the weights and IDs container below");
@@ -62,7 +60,8 @@ namespace Falcor
 
     template<typename posType>
     void generateSubmeshTangentData(
-        const std::vector<uint32_t>& indices,
+        const uint32_t* pIndices,
+        size_t indexCount,
         uint32_t vertexCount,
         const posType* vertexPosData,
         const glm::vec3* vertexNormalData,
@@ -138,7 +137,6 @@ namespace Falcor
         std::vector<uint32_t> indices(indexCount);
         const uint32_t firstFacePrimSize = pAiMesh->mFaces[0].mNumIndices;
 
-        std::unordered_map<int2, int> halfEdges = std::unordered_map<int2, int>();
         for (uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
         {
             uint32_t primSize = pAiMesh->mFaces[i].mNumIndices;
@@ -146,72 +144,33 @@ namespace Falcor
             for (uint32_t j = 0; j < firstFacePrimSize; j++)
             {
                 indices[i * firstFacePrimSize + j] = (uint32_t)(pAiMesh->mFaces[i].mIndices[j]);
-             }
-
-            int p0 = indices[3 * i];
-            int p1 = indices[3 * i + 1];
-            int p2 = indices[3 * i + 2];
-
-            halfEdges.insert(std::make_pair(int2(p0, p1), p2));
-            halfEdges.insert(std::make_pair(int2(p1, p2), p0));
-            halfEdges.insert(std::make_pair(int2(p2, p0), p1));
-        }
-
-        if (is_set(Model::LoadFlags::GenerateAdjacency, mFlags))
-        {
-          std::vector<uint32_t> adjIndices(6 * pAiMesh->mNumFaces);
-          for (uint32_t i = 0; i < indexCount; i += 3)
-          {
-            uint32_t adjStartIndex = 2 * i;
-            uint32_t p0 = indices[i];
-            uint32_t p1 = indices[i + 1];
-            uint32_t p2 = indices[i + 2];
-            int2 e0 = int2(p1, p0);
-            int2 e1 = int2(p2, p1);
-            int2 e2 = int2(p0, p2);
-
-            auto adjP0 = halfEdges.find(e0);
-            auto adjP1 = halfEdges.find(e1);
-            auto adjP2 = halfEdges.find(e2);
-            adjIndices[adjStartIndex] = p0;
-            adjIndices[adjStartIndex + 1] = adjP0 == halfEdges.end() ? -1 : adjP0->second;
-            adjIndices[adjStartIndex + 2] = p1;
-            adjIndices[adjStartIndex + 3] = adjP1 == halfEdges.end() ? -1 : adjP1->second;
-            adjIndices[adjStartIndex + 4] = p2;
-            adjIndices[adjStartIndex + 5] = adjP2 == halfEdges.end() ? -1 : adjP2->second;
-          }
-
-          return adjIndices;
+            }
         }
-        else
-          return indices;
+        return indices;
     }
 
-    void AssimpModelImporter::genTangentSpace(const aiMesh* pAiMesh)
+    void AssimpModelImporter::genTangentSpace(const aiMesh* pAiMesh, const std::vector<uint32_t>& indices, std::vector<glm::vec3>& bitangents)
     {
         if (pAiMesh->mFaces[0].mNumIndices == 3)
         {
-            aiMesh* pMesh = const_cast<aiMesh*>(pAiMesh);
-            pMesh->mBitangents = new aiVector3D[pMesh->mNumVertices];
+            bitangents.resize(pAiMesh->mNumVertices);
 
-            const glm::vec3* pPos = (glm::vec3*)pMesh->mVertices;
-            glm::vec3* pBi = (glm::vec3*)pMesh->mBitangents;
-            glm::vec3* pNormals = (glm::vec3*)pMesh->mNormals;
-            std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+            const glm::vec3* pPos = (const glm::vec3*)pAiMesh->mVertices;
+            const glm::vec3* pNormals = (const glm::vec3*)pAiMesh->mNormals;
 
             uint32_t texCrdCount = 0;
             std::vector<glm::vec2> texCrd;
-            if (pMesh->mTextureCoords[0] != nullptr)
+            if (pAiMesh->mTextureCoords[0] != nullptr)
             {
                 texCrdCount = 1;
-                texCrd.resize(pMesh->mNumVertices);
-                for (size_t i = 0; i < pMesh->mNumVertices; ++i)
+                texCrd.resize(pAiMesh->mNumVertices);
+                for (size_t i = 0; i < pAiMesh->mNumVertices; ++i)
                 {
-                    texCrd[i] = glm::vec2(pMesh->mTextureCoords[0][i].x, pMesh->mTextureCoords[0][i].y);
+                    texCrd[i] = glm::vec2(pAiMesh->mTextureCoords[0][i].x, pAiMesh->mTextureCoords[0][i].y);
                 }
             }
 
-            generateSubmeshTangentData<glm::vec3>(indices, pAiMesh->mNumVertices, pPos, pNormals, (texCrdCount > 0 ? texCrd.data() : nullptr), texCrdCount, pBi);
+            generateSubmeshTangentData<glm::vec3>(indices.data(), indices.size(), pAiMesh->mNumVertices, pPos, pNormals, (texCrdCount > 0 ? texCrd.data() : nullptr), texCrdCount, bitangents.data());
         }
     }
 
@@ -336,22 +295,22 @@ namespace Falcor
                     continue;
                 }
 
-                // Check if the texture was already loaded
-                const auto& a = mTextureCache.find(s);
-                if (a != mTextureCache.end())
+                // Textures are shared with other models through the texture cache
+                std::string fullpath = folder + '/' + s;
+                fullpath = replaceSubstring(fullpath, "\\", "/");
+                bool loadAsSrgb = isSrgbRequired(aiType, useSrgb, pMaterial->getShadingModel());
+
+                const auto& prefetched = mPrefetchedBitmaps.find(s);
+                if (prefetched != mPrefetchedBitmaps.end())
                 {
-                    pTex = a->second;
+                    Bitmap::UniqueConstPtr pBitmap = prefetched->second.get();
+                    mPrefetchedBitmaps.erase(prefetched);
+                    prefetchNextBitmaps();
+                    pTex = TextureCache::instance().createFromBitmap(pBitmap.get(), fullpath, true, loadAsSrgb);
                 }
                 else
                 {
-                    // create a new texture
-                    std::string fullpath = folder + '/' + s;
-                    fullpath = replaceSubstring(fullpath, "\\", "/");
-                    pTex = createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb, pMaterial->getShadingModel()));
-                    if (pTex)
-                    {
-                        mTextureCache[s] = pTex;
-                    }
+                    pTex = TextureCache::instance().createFromFile(fullpath, true, loadAsSrgb);
                 }
 
                 assert(pTex != nullptr);
@@ -473,8 +432,76 @@ namespace Falcor
     {
     }
 
+    void AssimpModelImporter::prefetchTextures(const aiScene* pScene, const std::string& folder)
+    {
+        std::unordered_set<std::string> names;
+        for (uint32_t m = 0; m < pScene->mNumMaterials; m++)
+        {
+            const aiMaterial* pAiMaterial = pScene->mMaterials[m];
+            for (int i = 0; i < AI_TEXTURE_TYPE_MAX; ++i)
+            {
+                if (pAiMaterial->GetTextureCount((aiTextureType)i) != 1) continue;
+
+                aiString path;
+                pAiMaterial->GetTexture((aiTextureType)i, 0, &path);
+                std::string s(path.data);
+
+                // DDS files are not loaded through bitmaps
+                if (s.empty() || hasSuffix(s, ".dds", false) || names.insert(s).second == false) continue;
+
+                // Textures shared with models loaded before don't need to be decoded
+                std::string fullpath = replaceSubstring(folder + '/' + s, "\\", "/");
+                if (TextureCache::instance().containsFile(fullpath)) continue;
+                mPrefetchQueue.push_back({ s, fullpath });
+            }
+        }
+
+        mFormatCaps = Bitmap::getDeviceFormatCaps();
+        prefetchNextBitmaps();
+    }
+
+    void AssimpModelImporter::prefetchNextBitmaps()
+    {
+        // Limit the number of decoded bitmaps waiting to be uploaded
+        const size_t maxPending = 2 * (TaskScheduler::instance().getThreadCount() + 1);
+
+        std::vector<std::string> names;
+        std::vector<std::string> filenames;
+        while (mNextPrefetch < mPrefetchQueue.size() && (mPrefetchedBitmaps.size() + names.size()) < maxPending)
+        {
+            // Skip textures the materials already loaded synchronously because they were used before their prefetch started
+            const PrefetchedTexture& texture = mPrefetchQueue[mNextPrefetch++];
+            if (TextureCache::instance().containsFile(texture.fullpath)) continue;
+            names.push_back(texture.name);
+            filenames.push_back(texture.fullpath);
+        }
+
+        if (filenames.empty()) return;
+
+        // Bitmaps are loaded top-down, like createTextureFromFile() does
+        auto bitmaps = Bitmap::loadMany(filenames, true, mFormatCaps);
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            mPrefetchedBitmaps[names[i]] = std::move(bitmaps[i]);
+        }
+    }
+
+    void AssimpModelImporter::releasePrefetchedBitmaps()
+    {
+        // Bitmaps no material used. Wait for the decoding tasks, they must not outlive the import
+        for (auto& prefetched : mPrefetchedBitmaps)
+        {
+            prefetched.second.wait();
+        }
+        mPrefetchedBitmaps.clear();
+        mPrefetchQueue.clear();
+        mNextPrefetch = 0;
+    }
+
     bool AssimpModelImporter::createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb)
     {
+        prefetchTextures(pScene, modelFolder);
+
         for (uint32_t i = 0; i < pScene->mNumMaterials; i++)
         {
             const aiMaterial* pAiMaterial = pScene->mMaterials[i];
@@ -482,6 +509,7 @@ namespace Falcor
             if (pMaterial == nullptr)
             {
                 logError("Can't allocate memory for material");
+                releasePrefetchedBitmaps();
                 return false;
             }
             auto pAdded = checkForExistingMaterial(pMaterial);
@@ -493,10 +521,11 @@ namespace Falcor
             mAiMaterialToFalcor[i] = pMaterial;
         }
 
+        releasePrefetchedBitmaps();
         return true;
     }
 
-    bool AssimpModelImporter::parseAiSceneNode(const aiNode* pCurrent, const aiScene* pScene, IdToMesh& aiToFalcorMesh)
+    bool AssimpModelImporter::parseAiSceneNode(const aiNode* pCurrent, const IdToMesh& aiToFalcorMesh)
     {
         if (pCurrent->mNumMeshes)
         {
@@ -509,37 +538,91 @@ namespace Falcor
                 pParent = pParent->mParent;
             }
 
-            // Initialize the meshes
+            // Add the instances. The meshes were created by createMeshes()
             for (uint32_t i = 0; i < pCurrent->mNumMeshes; i++)
             {
-                uint32_t aiId = pCurrent->mMeshes[i];
-
-                // New mesh
-                if (aiToFalcorMesh.find(aiId) == aiToFalcorMesh.end())
-                {
-                    // Cache mesh
-                    aiToFalcorMesh[aiId] = createMesh(pScene->mMeshes[aiId]);
-                }
-
-                mModel.addMeshInstance(aiToFalcorMesh[aiId], aiMatToGLM(transform));
+                const auto& it = aiToFalcorMesh.find(pCurrent->mMeshes[i]);
+                if (it == aiToFalcorMesh.end()) return false;
+                mModel.addMeshInstance(it->second, aiMatToGLM(transform));
             }
         }
 
-        bool b = true;
         // visit the children
         for (uint32_t i = 0; i < pCurrent->mNumChildren; i++)
         {
-            b |= parseAiSceneNode(pCurrent->mChildren[i], pScene, aiToFalcorMesh);
+            if (parseAiSceneNode(pCurrent->mChildren[i], aiToFalcorMesh) == false) return false;
         }
-        return b;
+        return true;
     }
 
-    bool AssimpModelImporter::createDrawList(const aiScene* pScene)
+    void AssimpModelImporter::createMeshes(const aiScene* pScene, std::vector<MeshStagingData>& staging, IdToMesh& aiToFalcorMesh)
+    {
+        // The buffers of many meshes share one upload buffer, so the upload costs one allocation and one copy per buffer instead of an upload buffer per buffer.
+        // Batches are limited in size, so the upload heap isn't forced to hold the whole model at once
+        const size_t kMaxBatchSize = 64 * 1024 * 1024;
+        const size_t kAlignment = 16;
+        const Buffer::BindFlags srvFlag = is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource) ? Buffer::BindFlags::ShaderResource : Buffer::BindFlags::None;
+        RenderContext* pContext = gpDevice->getRenderContext().get();
+
+        uint32_t batchBegin = 0;
+        while (batchBegin < (uint32_t)staging.size())
+        {
+            // Collect the meshes of the batch. A mesh larger than the limit gets a batch of its own
+            size_t batchSize = 0;
+            uint32_t batchEnd = batchBegin;
+            for (; batchEnd < (uint32_t)staging.size(); batchEnd++)
+            {
+                const MeshStagingData& mesh = staging[batchEnd];
+                if (mesh.valid == false) continue;
+
+                size_t meshSize = align_to(kAlignment, mesh.indices.size() * sizeof(uint32_t));
+                for (const auto& vb : mesh.vertexData) meshSize += align_to(kAlignment, vb.size());
+                if (batchSize && batchSize + meshSize > kMaxBatchSize) break;
+                batchSize += meshSize;
+            }
+
+            Buffer::SharedPtr pUpload = batchSize ? Buffer::create(batchSize, Buffer::BindFlags::None, Buffer::CpuAccess::Write, nullptr) : nullptr;
+            uint8_t* pUploadData = pUpload ? (uint8_t*)pUpload->map(Buffer::MapType::WriteDiscard) : nullptr;
+            size_t offset = 0;
+            const auto& uploadBuffer = [&](const void* pData, size_t size, Buffer::BindFlags bindFlags)
+            {
+                Buffer::SharedPtr pBuffer = Buffer::create(size, bindFlags | srvFlag, Buffer::CpuAccess::None, nullptr);
+                memcpy(pUploadData + offset, pData, size);
+                pContext->copyBufferRegion(pBuffer.get(), 0, pUpload.get(), offset, size);
+                offset += align_to(kAlignment, size);
+                return pBuffer;
+            };
+
+            for (uint32_t aiId = batchBegin; aiId < batchEnd; aiId++)
+            {
+                MeshStagingData& mesh = staging[aiId];
+                if (mesh.valid == false) continue;
+
+                const uint32_t indexCount = (uint32_t)mesh.indices.size();
+                Buffer::SharedPtr pIB = uploadBuffer(mesh.indices.data(), sizeof(uint32_t) * indexCount, Buffer::BindFlags::Index);
+                std::vector<Buffer::SharedPtr> pVBs(mesh.vertexData.size());
+                for (size_t i = 0; i < pVBs.size(); i++)
+                {
+                    pVBs[i] = uploadBuffer(mesh.vertexData[i].data(), mesh.vertexData[i].size(), Buffer::BindFlags::Vertex);
+                }
+
+                auto pMaterial = mAiMaterialToFalcor[pScene->mMeshes[aiId]->mMaterialIndex];
+                assert(pMaterial);
+                aiToFalcorMesh[aiId] = Mesh::create(pVBs, mesh.vertexCount, pIB, indexCount, mesh.pLayout, mesh.topology, pMaterial, mesh.boundingBox, mesh.hasBones);
+
+                // The staging data is no longer needed once the copies were recorded
+                mesh = MeshStagingData();
+            }
+            assert(offset == batchSize);
+            batchBegin = batchEnd;
+        }
+    }
+
+    bool AssimpModelImporter::createDrawList(const aiScene* pScene, std::vector<MeshStagingData>& staging)
     {
-        createAnimationController(pScene);
         IdToMesh aiToFalcorMeshId;
-        aiNode* pRoot = pScene->mRootNode;
-        return parseAiSceneNode(pRoot, pScene, aiToFalcorMeshId);
+        createMeshes(pScene, staging, aiToFalcorMeshId);
+        return parseAiSceneNode(pScene->mRootNode, aiToFalcorMeshId);
     }
 
     bool AssimpModelImporter::initModel(const std::string& filename)
@@ -579,15 +662,34 @@ namespace Falcor
         std::string modelFolder = fullpath.substr(0, last);
 
         // Order of initialization matters, materials, bones and animations need to loaded before mesh initialization
+        createAnimationController(pScene);
+
+        // The mesh CPU stage only depends on the bones. Run it in the background while the materials are created
+        std::vector<MeshStagingData> staging;
+        std::future<bool> stagingDone = TaskScheduler::instance().async([this, pScene, &staging]() { return stageMeshes(pScene, mFlags, mBoneNameToIdMap, staging); });
+
         bool isObjFile = hasSuffix(filename, ".obj", false);
         bool useSrgbTextures = !is_set(mFlags, Model::LoadFlags::AssumeLinearSpaceTextures);
         if(createAllMaterials(pScene, modelFolder, isObjFile, useSrgbTextures) == false)
         {
+            stagingDone.wait();
             logError(std::string("Can't create materials for model ") + filename, true);
             return false;
         }
 
-        if (createDrawList(pScene) == false)
+        if (stagingDone.get() == false)
+        {
+            // The workers don't log, report their errors here
+            std::string errors;
+            for (uint32_t i = 0; i < (uint32_t)staging.size(); i++)
+            {
+                if (staging[i].error.size()) errors += "\nMesh " + std::to_string(i) + ": " + staging[i].error;
+            }
+            logError(std::string("Can't create meshes for model ") + filename + errors, true);
+            return false;
+        }
+
+        if (createDrawList(pScene, staging) == false)
         {
             logError(std::string("Can't create draw lists for model ") + filename, true);
             return false;
@@ -752,28 +854,19 @@ namespace Falcor
             for (uint32_t j = 0; j < pAiNode->mNumPositionKeys; j++)
             {
                 const aiVectorKey& key = pAiNode->mPositionKeys[j];
-                Animation::AnimationKey<glm::vec3> position;
-                position.value = glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z);
-                position.time = float(key.mTime);
-                animationSets[i].translation.keys.push_back(position);
+                animationSets[i].translation.addKey(float(key.mTime), glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
             }
 
             for (uint32_t j = 0; j < pAiNode->mNumScalingKeys; j++)
             {
                 const aiVectorKey& key = pAiNode->mScalingKeys[j];
-                Animation::AnimationKey<glm::vec3> scale;
-                scale.value = glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z);
-                scale.time = float(key.mTime);
-                animationSets[i].scaling.keys.push_back(scale);
+                animationSets[i].scaling.addKey(float(key.mTime), glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
             }
 
             for (uint32_t j = 0; j < pAiNode->mNumRotationKeys; j++)
             {
                 const aiQuatKey& key = pAiNode->mRotationKeys[j];
-                Animation::AnimationKey<glm::quat> rotation;
-                rotation.value = glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z);
-                rotation.time = float(key.mTime);
-                animationSets[i].rotation.keys.push_back(rotation);
+                animationSets[i].rotation.addKey(float(key.mTime), glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z));
             }
         }
 
@@ -803,100 +896,109 @@ namespace Falcor
         return BoundingBox::fromMinMax(boxMin, boxMax);
     }
 
-    Mesh::SharedPtr AssimpModelImporter::createMesh(const aiMesh* pAiMesh)
+    bool AssimpModelImporter::isAdjacencyRequired(const aiMesh* pAiMesh, Model::LoadFlags flags)
     {
-        uint32_t vertexCount = pAiMesh->mNumVertices;
-
-        uint32_t indexCount = pAiMesh->mNumFaces * pAiMesh->mFaces[0].mNumIndices;
-        if(is_set(Model::LoadFlags::GenerateAdjacency, mFlags))
-          indexCount *= 2;
-        auto pIB = createIndexBuffer(pAiMesh);
-        BoundingBox boundingBox = createMeshBbox(pAiMesh);
+        return is_set(Model::LoadFlags::GenerateAdjacency, flags) && (pAiMesh->mFaces[0].mNumIndices == 3);
+    }
 
-        const bool generateTangentSpace = (pAiMesh->HasTangentsAndBitangents() == false) && (is_set(mFlags, Model::LoadFlags::DontGenerateTangentSpace) == false);
+    bool AssimpModelImporter::stageMesh(const aiMesh* pAiMesh, Model::LoadFlags flags, const BoneNameToIdMap& boneNameToIdMap, MeshStagingData& staging)
+    {
+        staging.vertexCount = pAiMesh->mNumVertices;
+        staging.hasBones = pAiMesh->HasBones();
+        staging.indices = createIndexBufferData(pAiMesh);
+        staging.boundingBox = createMeshBbox(pAiMesh);
+
+        // The bitangents are generated into a local array. The aiMesh is shared between the threads and must not be modified
+        std::vector<glm::vec3> bitangents;
+        const bool generateTangentSpace = (pAiMesh->HasTangentsAndBitangents() == false) && (is_set(flags, Model::LoadFlags::DontGenerateTangentSpace) == false);
         if (generateTangentSpace)
         {
-            genTangentSpace(pAiMesh);
+            genTangentSpace(pAiMesh, staging.indices, bitangents);
         }
+        const glm::vec3* pBitangents = bitangents.empty() ? (const glm::vec3*)pAiMesh->mBitangents : bitangents.data();
 
-        VertexLayout::SharedPtr pLayout = createVertexLayout(pAiMesh);
-        if (pLayout == nullptr)
+        if (isAdjacencyRequired(pAiMesh, flags))
         {
-            assert(0);
-            return nullptr;
+            staging.indices = generateAdjacencyIndices(staging.indices);
         }
 
-        std::vector<Buffer::SharedPtr> pVBs(pLayout->getBufferCount());
+        staging.pLayout = createVertexLayout(pAiMesh, pBitangents != nullptr, staging.error);
+        if (staging.pLayout == nullptr)
+        {
+            return false;
+        }
 
         // Initialize the bones data
         VertexWeightsVec weights;
         VertexIdsVec ids;
         if (pAiMesh->HasBones())
         {
-            loadBones(pAiMesh, weights, ids, vertexCount, mBoneNameToIdMap);
+            loadBones(pAiMesh, weights, ids, staging.vertexCount, boneNameToIdMap);
         }
 
-        // Create corresponding vertex buffers
-        for (uint32_t i = 0; i < pLayout->getBufferCount(); i++)
+        // Pack the vertex buffers
+        staging.vertexData.resize(staging.pLayout->getBufferCount());
+        for (uint32_t i = 0; i < staging.pLayout->getBufferCount(); i++)
         {
-            const VertexBufferLayout* pVbLayout = pLayout->getBufferLayout(i).get();
-            pVBs[i] = createVertexBuffer(pAiMesh, pVbLayout, (uint8_t*)ids.data(), weights.data());
+            const VertexBufferLayout* pVbLayout = staging.pLayout->getBufferLayout(i).get();
+            if (packVertexData(pAiMesh, pVbLayout, pBitangents, (uint8_t*)ids.data(), weights.data(), staging.vertexData[i], staging.error) == false)
+            {
+                return false;
+            }
         }
 
-        Vao::Topology topology = Vao::Topology::TriangleList;
         switch (pAiMesh->mFaces[0].mNumIndices)
         {
         case 1:
-            topology = Vao::Topology::PointList;
+            staging.topology = Vao::Topology::PointList;
             break;
         case 2:
-            topology = Vao::Topology::LineList;
+            staging.topology = Vao::Topology::LineList;
             break;
         case 3:
-        {
-            if(is_set(Model::LoadFlags::GenerateAdjacency, mFlags))
-            {
-              topology = Vao::Topology::TriangleListAdj;
-            }
-            else
-            {
-              topology = Vao::Topology::TriangleList;
-            }
+            staging.topology = is_set(Model::LoadFlags::GenerateAdjacency, flags) ? Vao::Topology::TriangleListAdj : Vao::Topology::TriangleList;
             break;
-        }
         default:
-            logError(std::string("Error when creating mesh. Unknown topology with " + std::to_string(pAiMesh->mFaces[0].mNumIndices) + " indices."));
-            assert(0);
+            staging.error = "Unknown topology with " + std::to_string(pAiMesh->mFaces[0].mNumIndices) + " indices.";
+            return false;
         }
 
-        auto pMaterial = mAiMaterialToFalcor[pAiMesh->mMaterialIndex];
-        assert(pMaterial);
+        staging.valid = true;
+        return true;
+    }
 
-        Mesh::SharedPtr pMesh = Mesh::create(pVBs, vertexCount, pIB, indexCount, pLayout, topology, pMaterial, boundingBox, pAiMesh->HasBones());
+    bool AssimpModelImporter::stageMeshes(const aiScene* pScene, Model::LoadFlags flags, const BoneNameToIdMap& boneNameToIdMap, std::vector<MeshStagingData>& staging)
+    {
+        staging.clear();
+        staging.resize(pScene->mNumMeshes);
 
-        if (generateTangentSpace)
+        // Only stage the meshes the node hierarchy references
+        std::vector<bool> referenced(pScene->mNumMeshes, false);
+        std::vector<const aiNode*> nodes = { pScene->mRootNode };
+        while (nodes.size())
         {
-            aiMesh* pM = const_cast<aiMesh*>(pAiMesh);
-            safe_delete_array(pM->mBitangents);
+            const aiNode* pNode = nodes.back();
+            nodes.pop_back();
+            for (uint32_t i = 0; i < pNode->mNumMeshes; i++) referenced[pNode->mMeshes[i]] = true;
+            nodes.insert(nodes.end(), pNode->mChildren, pNode->mChildren + pNode->mNumChildren);
         }
 
-        return pMesh;
-    }
-
-    Buffer::SharedPtr AssimpModelImporter::createIndexBuffer(const aiMesh* pAiMesh)
-    {
-        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
-        const uint32_t size = (uint32_t)(sizeof(uint32_t) * indices.size());
-        Buffer::BindFlags bindFlags = Buffer::BindFlags::Index;
-        if (is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource))
+        // Mesh sizes vary wildly, so every mesh is a separate task
+        std::atomic<bool> success = { true };
+        TaskScheduler::instance().parallelFor(0, pScene->mNumMeshes, [&](size_t begin, size_t end)
         {
-            bindFlags |= Buffer::BindFlags::ShaderResource;
-        }
-        return Buffer::create(size, bindFlags, Buffer::CpuAccess::None, indices.data());;
+            for (size_t i = begin; i < end; i++)
+            {
+                if (referenced[i] && stageMesh(pScene->mMeshes[i], flags, boneNameToIdMap, staging[i]) == false)
+                {
+                    success = false;
+                }
+            }
+        }, 1);
+        return success;
     }
 
-
-    bool isElementUsed(const aiMesh* pAiMesh, uint32_t location)
+    bool isElementUsed(const aiMesh* pAiMesh, uint32_t location, bool hasBitangents)
     {
         switch (location)
         {
@@ -905,7 +1007,7 @@ namespace Falcor
         case VERTEX_NORMAL_LOC:
             return pAiMesh->HasNormals();
         case VERTEX_BITANGENT_LOC:
-            return (pAiMesh->mBitangents != nullptr); // ASSIMP doesn't have a function that checks only for bitangents
+            return hasBitangents;
         case VERTEX_BONE_WEIGHT_LOC:
         case VERTEX_BONE_ID_LOC:
             return pAiMesh->HasBones();
@@ -923,13 +1025,13 @@ namespace Falcor
         }
     }
 
-    VertexLayout::SharedPtr AssimpModelImporter::createVertexLayout(const aiMesh* pAiMesh)
+    VertexLayout::SharedPtr AssimpModelImporter::createVertexLayout(const aiMesh* pAiMesh, bool hasBitangents, std::string& error)
     {
         static const uint32_t kMaxSupportedUVs = 2;
         // Must have position!!!
         if (pAiMesh->HasPositions() == false)
         {
-            logError("AssimpModelImporter: Loaded mesh with no positions!");
+            error = "Loaded mesh with no positions!";
             return nullptr;
         }
 
@@ -942,7 +1044,7 @@ namespace Falcor
         {
             if (pAiMesh->HasTextureCoords(i) == false)
             {
-                logError("AssimpModelImporter: Unsupported texture coordinate set used in model.");
+                error = "Unsupported texture coordinate set used in model.";
                 return nullptr;
             }
         }
@@ -952,7 +1054,7 @@ namespace Falcor
         uint32_t bufferCount = 0;
         for (uint32_t location = 0; location < VERTEX_LOCATION_COUNT; ++location)
         {
-            if (isElementUsed(pAiMesh, location))
+            if (isElementUsed(pAiMesh, location, hasBitangents))
             {
                 VertexBufferLayout::SharedPtr pVbLayout = VertexBufferLayout::create();
                 pVbLayout->addElement(kLayoutData[location].name, 0, kLayoutData[location].format, 1, location);
@@ -964,10 +1066,10 @@ namespace Falcor
         return pLayout;
     }
 
-    Buffer::SharedPtr AssimpModelImporter::createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights)
+    bool AssimpModelImporter::packVertexData(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const glm::vec3* pBitangents, const uint8_t* pBoneIds, const vec4* pBoneWeights, std::vector<uint8_t>& initData, std::string& error)
     {
         const uint32_t vertexStride = pLayout->getStride();
-        std::vector<uint8_t> initData(vertexStride * pAiMesh->mNumVertices, 0);
+        initData.assign(vertexStride * pAiMesh->mNumVertices, 0);
 
         for (uint32_t vertexID = 0; vertexID < pAiMesh->mNumVertices; vertexID++)
         {
@@ -992,8 +1094,8 @@ namespace Falcor
                     size = sizeof(pAiMesh->mNormals[0]);
                     break;
                 case VERTEX_BITANGENT_LOC:
-                    pSrc = (uint8_t*)(&pAiMesh->mBitangents[vertexID]);
-                    size = sizeof(pAiMesh->mBitangents[0]);
+                    pSrc = (uint8_t*)(&pBitangents[vertexID]);
+                    size = sizeof(pBitangents[0]);
                     break;
                 case VERTEX_DIFFUSE_COLOR_LOC:
                     pSrc = (uint8_t*)(&pAiMesh->mColors[0][vertexID]);
@@ -1002,7 +1104,8 @@ namespace Falcor
                 case VERTEX_TEXCOORD_LOC:
                     if (pAiMesh->mTextureCoords[0][vertexID].z != 0.f)
                     {
-                        Falcor::logErrorAndExit("AssimpModelImporter::createVertexBuffer: Texcoord[0].z != 0.0");
+                        error = "Texcoord[0].z != 0.0";
+                        return false;
                     }
                     pSrc = (uint8_t*)(&pAiMesh->mTextureCoords[0][vertexID]);
                     size = sizeof(pAiMesh->mTextureCoords[0][vertexID]);
@@ -1010,7 +1113,8 @@ namespace Falcor
                 case VERTEX_LIGHTMAP_UV_LOC:
                     if (pAiMesh->mTextureCoords[1][vertexID].z != 0.f)
                     {
-                        Falcor::logErrorAndExit("AssimpModelImporter::createVertexBuffer: Texcoord[1].z != 0.0");
+                        error = "Texcoord[1].z != 0.0";
+                        return false;
                     }
                     pSrc = (uint8_t*)(&pAiMesh->mTextureCoords[1][vertexID]);
                     size = sizeof(pAiMesh->mTextureCoords[1][vertexID]);
@@ -1031,12 +1135,6 @@ namespace Falcor
                 memcpy(pDst, pSrc, size);
             }
         }
-        Buffer::BindFlags bindFlags = Buffer::BindFlags::Vertex;
-        if (is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource))
-        {
-            bindFlags |= Buffer::BindFlags::ShaderResource;
-        }
-
-        return Buffer::create(vertexStride * pAiMesh->mNumVertices, bindFlags, Buffer::CpuAccess::None, initData.data());;
+        return true;
     }
 }
\ No newline at end of file
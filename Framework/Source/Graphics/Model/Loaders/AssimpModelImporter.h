@@ -26,6 +26,7 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <future>
 #include <map>
 #include <unordered_set>
 #include <vector>
@@ -33,6 +34,7 @@
 #include "../AnimationController.h"
 #include "../Mesh.h"
 #include "../Model.h"
+#include "Utils/Bitmap.h"
 
 struct aiScene;
 struct aiNode;
@@ -65,6 +67,42 @@ namespace Falcor
         */
         static bool import(Model& model, const std::string& filename, Model::LoadFlags flags);
 
+        /** CPU-side data of a single mesh, produced by the CPU stage of the import. Creating the GPU resources from it is the only part of the import which requires the device.
+        */
+        struct MeshStagingData
+        {
+            std::vector<uint32_t> indices;                  ///> Index data, including the adjacency if it was requested
+            std::vector<std::vector<uint8_t>> vertexData;   ///> Packed vertex data, one entry per buffer in pLayout
+            VertexLayout::SharedPtr pLayout;
+            Vao::Topology topology = Vao::Topology::TriangleList;
+            BoundingBox boundingBox;
+            uint32_t vertexCount = 0;
+            bool hasBones = false;
+            bool valid = false;                             ///> False if the mesh couldn't be staged, or wasn't staged because no node references it
+            std::string error;                              ///> Why the mesh couldn't be staged. Errors are reported by the importing thread
+        };
+
+        using BoneNameToIdMap = std::map<std::string, uint32_t>;
+
+        /** Run the CPU stage for a single mesh - index conversion, tangent generation, bone weight packing and vertex packing.
+            Doesn't modify the aiMesh, access the device or log, can be called from any thread.
+            \param[in] pAiMesh The mesh to stage
+            \param[in] flags Flags controlling model creation
+            \param[in] boneNameToIdMap Maps bone names to the IDs written into the vertex data. Can be empty if the mesh has no bones
+            \param[out] staging The staging data. On failure, staging.error describes the problem
+            \return Whether the mesh could be staged
+        */
+        static bool stageMesh(const aiMesh* pAiMesh, Model::LoadFlags flags, const BoneNameToIdMap& boneNameToIdMap, MeshStagingData& staging);
+
+        /** Run the CPU stage for all the meshes in a scene. The meshes are staged in parallel using the global TaskScheduler. Meshes that no node references are skipped and left invalid.
+            \param[in] pScene The scene
+            \param[in] flags Flags controlling model creation
+            \param[in] boneNameToIdMap Maps bone names to the IDs written into the vertex data
+            \param[out] staging Resized to the scene's mesh count. Entry i holds the data of pScene->mMeshes[i]
+            \return Whether all the referenced meshes could be staged
+        */
+        static bool stageMeshes(const aiScene* pScene, Model::LoadFlags flags, const BoneNameToIdMap& boneNameToIdMap, std::vector<MeshStagingData>& staging);
+
     private:
 
         using IdToMesh = std::unordered_map<uint32_t, Mesh::SharedPtr>;
@@ -74,8 +112,9 @@ namespace Falcor
         void operator=(const AssimpModelImporter&) = delete;
 
         bool initModel(const std::string& filename);
-        bool createDrawList(const aiScene* pScene);
-        bool parseAiSceneNode(const aiNode* pCurrent, const aiScene* pScene, IdToMesh& aiToFalcorMesh);
+        bool createDrawList(const aiScene* pScene, std::vector<MeshStagingData>& staging);
+        bool parseAiSceneNode(const aiNode* pCurrent, const IdToMesh& aiToFalcorMesh);
+        void createMeshes(const aiScene* pScene, std::vector<MeshStagingData>& staging, IdToMesh& aiToFalcorMesh);
         bool createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb);
 
         void createAnimationController(const aiScene* pScene);
@@ -85,19 +124,21 @@ namespace Falcor
 
         Animation::UniquePtr createAnimation(const aiAnimation* pAiAnim);
 
-        Mesh::SharedPtr createMesh(const aiMesh* pAiMesh);
-        VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh);
-        Buffer::SharedPtr createIndexBuffer(const aiMesh* pAiMesh);
-        Buffer::SharedPtr createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights);
+        static VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh, bool hasBitangents, std::string& error);
+        static bool isAdjacencyRequired(const aiMesh* pAiMesh, Model::LoadFlags flags);
+        static bool packVertexData(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const glm::vec3* pBitangents, const uint8_t* pBoneIds, const vec4* pBoneWeights, std::vector<uint8_t>& initData, std::string& error);
         void loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool isObjFile, bool useSrgb);
         Material::SharedPtr createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb);
+        void prefetchTextures(const aiScene* pScene, const std::string& folder);
+        void prefetchNextBitmaps();
+        void releasePrefetchedBitmaps();
         //Hacked in for index buffer
-        std::vector<uint32_t> createIndexBufferData(const aiMesh* pAiMesh);
-        void genTangentSpace(const aiMesh* pAiMesh);
+        static std::vector<uint32_t> createIndexBufferData(const aiMesh* pAiMesh);
+        static void genTangentSpace(const aiMesh* pAiMesh, const std::vector<uint32_t>& indices, std::vector<glm::vec3>& bitangents);
         // Checks whether a node or its name corresponds to a used bone or node in the skeleton hierarchy
         bool isUsedNode(const aiNode* pNode) const;
 
-        std::map<std::string, uint32_t> mBoneNameToIdMap;
+        BoneNameToIdMap mBoneNameToIdMap;
         // Non-bone nodes need to be counted by pointer because they can have duplicate names after assimp processing (e.g. "RootNode")
         std::unordered_set<const aiNode*> mAdditionalUsedNodes;
 
@@ -107,6 +148,16 @@ namespace Falcor
 
         std::vector<Bone> mBones;
         Model::LoadFlags mFlags;
-        std::map<const std::string, Texture::SharedPtr> mTextureCache;
+
+        // Texture files are decoded in the background while the materials are created
+        struct PrefetchedTexture
+        {
+            std::string name;
+            std::string fullpath;
+        };
+        std::vector<PrefetchedTexture> mPrefetchQueue;      // In the order the materials use them
+        size_t mNextPrefetch = 0;
+        std::map<std::string, std::future<Bitmap::UniqueConstPtr>> mPrefetchedBitmaps;
+        Bitmap::FormatCaps mFormatCaps;
     };
 }
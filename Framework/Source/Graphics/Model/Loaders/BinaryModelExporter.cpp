@@ -36,6 +36,11 @@
 #include "BinaryImage.hpp"
 #include "Data/VertexAttrib.h"
 #include "API/Device.h"
+#include "Utils/TaskScheduler.h"
+#include "Utils/Hash.h"
+#include "Utils/Lz4.h"
+#include <algorithm>
+#include <cstring>
 
 namespace Falcor
 {
@@ -452,4 +457,308 @@ namespace Falcor
         mStream.write(data.data(), data.size());
         return true;
     }
-}
\ No newline at end of file
+
+    struct ExportedChunk
+    {
+        ChunkType type = ChunkType::Texture;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> compressed;    // Empty if the chunk is stored uncompressed
+        uint64_t hash = 0;
+    };
+
+    template<size_t N>
+    static void copyName(char (&dst)[N], const std::string& src)
+    {
+        std::memset(dst, 0, N);
+        std::memcpy(dst, src.c_str(), std::min(src.size(), N));
+    }
+
+    template<typename T>
+    static T alignUp(T offset, T alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // Appends a section to a chunk, aligned to kChunkSectionAlignment. Returns the section's offset.
+    static size_t appendSection(std::vector<uint8_t>& chunk, const void* pData, size_t size)
+    {
+        size_t offset = alignUp(chunk.size(), size_t(kChunkSectionAlignment));
+        chunk.resize(offset + size);
+        if(size) std::memcpy(chunk.data() + offset, pData, size);
+        return offset;
+    }
+
+    static bool createTextureChunk(const Texture* pTexture, ExportedChunk& chunk, std::string& errorMsg)
+    {
+        if(pTexture->getType() != Texture::Type::Texture2D || pTexture->getArraySize() > 1)
+        {
+            errorMsg = "Chunked file format only supports 2D textures.";
+            return false;
+        }
+
+        ResourceFormat format = pTexture->getFormat();
+        std::vector<uint8_t> texels = gpDevice->getRenderContext()->readTextureSubresource(pTexture, 0);
+        uint64_t blocksX = (pTexture->getWidth() + getFormatWidthCompressionRatio(format) - 1) / getFormatWidthCompressionRatio(format);
+        uint64_t blocksY = (pTexture->getHeight() + getFormatHeightCompressionRatio(format) - 1) / getFormatHeightCompressionRatio(format);
+        if(texels.size() != blocksX * blocksY * getFormatBytesPerBlock(format))
+        {
+            errorMsg = "Can't read back texture " + pTexture->getSourceFilename() + ".";
+            return false;
+        }
+
+        const std::string& name = pTexture->getSourceFilename();
+        TextureChunkHeader header = {};
+        header.width = pTexture->getWidth();
+        header.height = pTexture->getHeight();
+        header.nameLength = (uint32_t)name.size();
+        copyName(header.format, to_string(format));
+        header.dataSize = texels.size();
+
+        chunk.type = ChunkType::Texture;
+        appendSection(chunk.data, &header, sizeof(header));
+        chunk.data.insert(chunk.data.end(), name.begin(), name.end());
+        header.dataOffset = appendSection(chunk.data, texels.data(), texels.size());
+        std::memcpy(chunk.data.data(), &header, sizeof(header));
+        return true;
+    }
+
+    static bool createGeometryChunk(const Model* pModel, const std::vector<uint32_t>& meshIDs, const std::map<const Material*, uint32_t>& materialIDs, ExportedChunk& chunk, std::string& errorMsg)
+    {
+        // All the meshes share the same vertex buffers, use the first one for the vertex data
+        const Mesh* pMesh = pModel->getMesh(meshIDs[0]).get();
+        const Vao* pVao = pMesh->getVao().get();
+        const VertexLayout* pLayout = pVao->getVertexLayout().get();
+
+        GeometryChunkHeader header = {};
+        header.vertexCount = pMesh->getVertexCount();
+        header.attribCount = pVao->getVertexBuffersCount();
+        header.submeshCount = (uint32_t)meshIDs.size();
+        std::vector<VertexAttribDesc> attribs(header.attribCount);
+        std::vector<SubmeshDesc> submeshes(header.submeshCount);
+
+        // Reserve the tables, they are filled once the data offsets are known
+        chunk.type = ChunkType::Geometry;
+        chunk.data.resize(sizeof(GeometryChunkHeader) + attribs.size() * sizeof(VertexAttribDesc) + submeshes.size() * sizeof(SubmeshDesc));
+
+        for(uint32_t i = 0; i < header.attribCount; i++)
+        {
+            const VertexBufferLayout* pBufferLayout = pLayout->getBufferLayout(i).get();
+            if(pBufferLayout->getElementCount() != 1)
+            {
+                errorMsg = "Chunked file format doesn't support interleaved vertex buffers.";
+                return false;
+            }
+
+            ResourceFormat format = pBufferLayout->getElementFormat(0);
+            copyName(attribs[i].semanticName, pBufferLayout->getElementName(0));
+            copyName(attribs[i].format, to_string(format));
+            attribs[i].shaderLocation = pBufferLayout->getElementShaderLocation(0);
+
+            const Buffer::SharedPtr& pBuffer = pVao->getVertexBuffer(i);
+            const void* pData = pBuffer->map(Buffer::MapType::Read);
+            attribs[i].dataOffset = appendSection(chunk.data, pData, size_t(getFormatBytesPerBlock(format)) * header.vertexCount);
+            pBuffer->unmap();
+        }
+
+        for(uint32_t i = 0; i < header.submeshCount; i++)
+        {
+            const Mesh* pSubmesh = pModel->getMesh(meshIDs[i]).get();
+            const Buffer::SharedPtr& pIB = pSubmesh->getVao()->getIndexBuffer();
+            SubmeshDesc& submesh = submeshes[i];
+            submesh.materialIndex = materialIDs.at(pSubmesh->getMaterial().get());
+            submesh.topology = (uint32_t)pSubmesh->getVao()->getPrimitiveTopology();
+            submesh.indexCount = pSubmesh->getIndexCount();
+            submesh.boundingBoxMin = pSubmesh->getBoundingBox().getMinPos();
+            submesh.boundingBoxMax = pSubmesh->getBoundingBox().getMaxPos();
+
+            const void* pIndices = pIB->map(Buffer::MapType::Read);
+            submesh.indexOffset = appendSection(chunk.data, pIndices, submesh.indexCount * sizeof(uint32_t));
+            pIB->unmap();
+        }
+
+        uint8_t* pTables = chunk.data.data();
+        std::memcpy(pTables, &header, sizeof(header));
+        std::memcpy(pTables + sizeof(header), attribs.data(), attribs.size() * sizeof(VertexAttribDesc));
+        std::memcpy(pTables + sizeof(header) + attribs.size() * sizeof(VertexAttribDesc), submeshes.data(), submeshes.size() * sizeof(SubmeshDesc));
+        return true;
+    }
+
+    bool BinaryModelExporter::exportToChunkedFile(const std::string& filename, const Model* pModel, ChunkCompression compression)
+    {
+        auto error = [&filename](const std::string& msg)
+        {
+            logError("Error when exporting model \"" + filename + "\".\n" + msg);
+            return false;
+        };
+
+        if(pModel->hasBones()) return error("Chunked file format doesn't support model with bones");
+        if(pModel->hasAnimations()) return error("Chunked file format doesn't support model with animations");
+
+        // Meshes which share vertex buffers are stored as submeshes of a single geometry chunk
+        std::map<std::vector<const Buffer*>, uint32_t> geometryIDs;
+        std::vector<std::vector<uint32_t>> geometryMeshes;
+        std::vector<std::pair<uint32_t, uint32_t>> meshLocations(pModel->getMeshCount(), { kInvalidChunkIndex, kInvalidChunkIndex });
+        for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+        {
+            const Vao* pVao = pModel->getMesh(meshID)->getVao().get();
+            if(pVao->getPrimitiveTopology() == Vao::Topology::TriangleListAdj)
+            {
+                logWarning("Warning when exporting model \"" + filename + "\".\nChunked file format doesn't store adjacency, it's generated at load time. Skipping mesh " + std::to_string(meshID) + ".");
+                continue;
+            }
+
+            std::vector<const Buffer*> vbs;
+            for(uint32_t i = 0; i < pVao->getVertexBuffersCount(); i++) vbs.push_back(pVao->getVertexBuffer(i).get());
+            auto it = geometryIDs.emplace(vbs, (uint32_t)geometryMeshes.size()).first;
+            if(it->second == geometryMeshes.size()) geometryMeshes.emplace_back();
+            meshLocations[meshID] = { it->second, (uint32_t)geometryMeshes[it->second].size() };
+            geometryMeshes[it->second].push_back(meshID);
+        }
+
+        // Materials and the textures they use
+        std::map<const Texture*, int32_t> textureIDs;
+        std::vector<const Texture*> textures;
+        auto getTextureID = [&](const Texture::SharedPtr& pTexture)
+        {
+            if(pTexture == nullptr) return -1;
+            auto it = textureIDs.emplace(pTexture.get(), (int32_t)textures.size()).first;
+            if((size_t)it->second == textures.size()) textures.push_back(pTexture.get());
+            return it->second;
+        };
+
+        std::map<const Material*, uint32_t> materialIDs;
+        std::vector<MaterialDesc> materials;
+        for(const auto& meshes : geometryMeshes)
+        {
+            for(uint32_t meshID : meshes)
+            {
+                const Material* pMaterial = pModel->getMesh(meshID)->getMaterial().get();
+                if(materialIDs.emplace(pMaterial, (uint32_t)materials.size()).second == false) continue;
+
+                MaterialDesc desc = {};
+                copyName(desc.name, pMaterial->getName());
+                desc.baseColor = pMaterial->getBaseColor();
+                desc.specular = pMaterial->getSpecularParams();
+                desc.emissive = pMaterial->getEmissiveColor();
+                desc.alphaThreshold = pMaterial->getAlphaThreshold();
+                desc.heightScale = pMaterial->getHeightScale();
+                desc.heightOffset = pMaterial->getHeightOffset();
+                desc.indexOfRefraction = pMaterial->getIndexOfRefraction();
+                desc.shadingModel = pMaterial->getShadingModel();
+                desc.alphaMode = pMaterial->getAlphaMode();
+                desc.doubleSided = pMaterial->getDoubleSided() ? 1 : 0;
+                desc.textures[MaterialTextureSlot_BaseColor] = getTextureID(pMaterial->getBaseColorTexture());
+                desc.textures[MaterialTextureSlot_Specular] = getTextureID(pMaterial->getSpecularTexture());
+                desc.textures[MaterialTextureSlot_Emissive] = getTextureID(pMaterial->getEmissiveTexture());
+                desc.textures[MaterialTextureSlot_Normal] = getTextureID(pMaterial->getNormalMap());
+                desc.textures[MaterialTextureSlot_Occlusion] = getTextureID(pMaterial->getOcclusionMap());
+                desc.textures[MaterialTextureSlot_LightMap] = getTextureID(pMaterial->getLightMap());
+                desc.textures[MaterialTextureSlot_Height] = getTextureID(pMaterial->getHeightMap());
+                materials.push_back(desc);
+            }
+        }
+
+        // Read back the resources. This needs the render context, so it's done on this thread.
+        std::vector<ExportedChunk> chunks(textures.size() + geometryMeshes.size() + 2);
+        std::string errorMsg;
+        for(size_t i = 0; i < textures.size(); i++)
+        {
+            if(createTextureChunk(textures[i], chunks[i], errorMsg) == false) return error(errorMsg);
+        }
+
+        ExportedChunk& materialsChunk = chunks[textures.size()];
+        materialsChunk.type = ChunkType::Materials;
+        appendSection(materialsChunk.data, materials.data(), materials.size() * sizeof(MaterialDesc));
+
+        for(size_t i = 0; i < geometryMeshes.size(); i++)
+        {
+            if(createGeometryChunk(pModel, geometryMeshes[i], materialIDs, chunks[textures.size() + 1 + i], errorMsg) == false) return error(errorMsg);
+        }
+
+        ExportedChunk& instancesChunk = chunks.back();
+        instancesChunk.type = ChunkType::Instances;
+        for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+        {
+            if(meshLocations[meshID].first == kInvalidChunkIndex) continue;
+            for(uint32_t i = 0; i < pModel->getMeshInstanceCount(meshID); i++)
+            {
+                InstanceDesc instance = {};
+                instance.geometryIndex = meshLocations[meshID].first;
+                instance.submeshIndex = meshLocations[meshID].second;
+                instance.transform = pModel->getMeshInstance(meshID, i)->getTransformMatrix();
+                appendSection(instancesChunk.data, &instance, sizeof(instance));
+            }
+        }
+
+        // Hash and compress the chunks in parallel. A chunk is stored compressed only if it gets smaller.
+        TaskScheduler::instance().parallelFor(0, chunks.size(), [&](size_t begin, size_t end)
+        {
+            for(size_t i = begin; i < end; i++)
+            {
+                ExportedChunk& chunk = chunks[i];
+                chunk.hash = xxHash64(chunk.data.data(), chunk.data.size());
+                if(compression == ChunkCompression::LZ4 && chunk.data.size())
+                {
+                    chunk.compressed.resize(lz4CompressBound(chunk.data.size()));
+                    size_t size = lz4Compress(chunk.data.data(), chunk.data.size(), chunk.compressed.data(), chunk.compressed.size());
+                    chunk.compressed.resize((size < chunk.data.size()) ? size : 0);
+                    chunk.compressed.shrink_to_fit();
+                }
+            }
+        }, 1);
+
+        // Lay out the file
+        ChunkedFileHeader header = {};
+        std::memcpy(header.magic, kChunkedFileMagic, sizeof(kChunkedFileMagic));
+        header.version = kChunkedFileVersion;
+        header.chunkAlignment = kDefaultChunkAlignment;
+        header.chunkCount = (uint32_t)chunks.size();
+        header.tocOffset = sizeof(ChunkedFileHeader);
+
+        std::vector<ChunkTocEntry> toc(chunks.size());
+        uint64_t offset = header.tocOffset + toc.size() * sizeof(ChunkTocEntry);
+        for(size_t i = 0; i < chunks.size(); i++)
+        {
+            const ExportedChunk& chunk = chunks[i];
+            bool isCompressed = chunk.compressed.size() > 0;
+            toc[i].type = chunk.type;
+            toc[i].compression = isCompressed ? compression : ChunkCompression::None;
+            toc[i].offset = alignUp(offset, uint64_t(kDefaultChunkAlignment));
+            toc[i].storedSize = isCompressed ? chunk.compressed.size() : chunk.data.size();
+            toc[i].size = chunk.data.size();
+            toc[i].hash = chunk.hash;
+            offset = toc[i].offset + toc[i].storedSize;
+        }
+
+        BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+        stream << header;
+        stream.write(toc.data(), toc.size() * sizeof(ChunkTocEntry));
+        offset = header.tocOffset + toc.size() * sizeof(ChunkTocEntry);
+        const uint8_t padding[kDefaultChunkAlignment] = {};
+        for(size_t i = 0; i < chunks.size(); i++)
+        {
+            stream.write(padding, size_t(toc[i].offset - offset));
+            const auto& data = chunks[i].compressed.size() ? chunks[i].compressed : chunks[i].data;
+            stream.write(data.data(), data.size());
+            offset = toc[i].offset + toc[i].storedSize;
+        }
+
+        if(stream.isGood() == false)
+        {
+            stream.remove();
+            return error("Can't write the file.");
+        }
+        return true;
+    }
+
+    bool BinaryModelExporter::convertToChunkedFile(const std::string& srcFilename, const std::string& dstFilename, Model::LoadFlags flags, ChunkCompression compression)
+    {
+        Model::SharedPtr pModel = Model::createFromFile(srcFilename.c_str(), flags & ~Model::LoadFlags::GenerateAdjacency);
+        if(pModel == nullptr)
+        {
+            logError("Can't convert model \"" + srcFilename + "\". The model can't be loaded.");
+            return false;
+        }
+        return exportToChunkedFile(dstFilename, pModel.get(), compression);
+    }
+}
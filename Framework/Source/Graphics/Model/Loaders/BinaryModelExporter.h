@@ -31,6 +31,8 @@
 #include <map>
 #include <vector>
 #include "Graphics/Model/Mesh.h"
+#include "Graphics/Model/Model.h"
+#include "Graphics/Model/Loaders/ChunkedModelSpec.h"
 
 namespace Falcor
 {
@@ -48,6 +50,24 @@ namespace Falcor
         */
         static void exportToFile(const std::string& filename, const Model* pModel);
 
+        /** Export a model into a chunked binary file, see ChunkedModelSpec.h
+            \param[in] filename Model's filename or full path
+            \param[in] pModel The model to export
+            \param[in] compression The compression to use for the chunks. Chunks which don't get smaller are stored uncompressed.
+            \return true if the model was exported, otherwise false
+        */
+        static bool exportToChunkedFile(const std::string& filename, const Model* pModel, ChunkCompression compression = ChunkCompression::LZ4);
+
+        /** Convert a model file into a chunked binary file.
+            The source can be any file Model::createFromFile() can load, including binary scene files and the formats supported by Assimp.
+            \param[in] srcFilename The model to convert. Can include a full path or a relative path from a data directory
+            \param[in] dstFilename The chunked file's filename or full path
+            \param[in] flags Flags controlling how the source model is loaded. Adjacency is never stored, it's generated when the chunked file is loaded.
+            \param[in] compression The compression to use for the chunks
+            \return true if the model was converted, otherwise false
+        */
+        static bool convertToChunkedFile(const std::string& srcFilename, const std::string& dstFilename, Model::LoadFlags flags = Model::LoadFlags::None, ChunkCompression compression = ChunkCompression::LZ4);
+
     private:
         BinaryModelExporter(const std::string& filename, const Model* pModel);
         const Model* mpModel = nullptr;
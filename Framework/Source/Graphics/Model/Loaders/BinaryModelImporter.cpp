@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "BinaryModelImporter.h"
 #include "BinaryModelSpec.h"
+#include "ChunkedModelImporter.h"
 #include "../Model.h"
 #include "../Mesh.h"
 #include "Utils/Platform/OS.h"
@@ -38,16 +39,15 @@
 #include "BinaryImage.hpp"
 #include "API/Formats.h"
 #include "API/Texture.h"
+#include "Graphics/TextureCache.h"
 #include "Graphics/Material/Material.h"
 #include "glm/geometric.hpp"
 #include "API/Device.h"
+#include "Utils/TaskScheduler.h"
+#include <algorithm>
 #include <numeric>
 #include <cstring>
 
-//So i can hash an int2
-#define GLM_ENABLE_EXPERIMENTAL1
-#include <glm/gtx/hash.hpp>
-
 namespace Falcor
 {
     struct TextureData
@@ -55,7 +55,8 @@ namespace Falcor
         uint32_t width  = 0;
         uint32_t height = 0;
         ResourceFormat format = ResourceFormat::Unknown;
-        std::vector<uint8_t> data;
+        const uint8_t* pData = nullptr;     // Points into the file mapping, or into expandedData
+        std::vector<uint8_t> expandedData;  // Only used by 3-channel formats, which are padded to 4 channels
         std::string name;
     };
 
@@ -88,7 +89,8 @@ namespace Falcor
 
     template<typename posType>
     void generateSubmeshTangentData(
-        const std::vector<uint32_t>& indices,
+        const uint32_t* pIndices,
+        size_t indexCount,
         uint32_t vertexCount,
         const posType* vertexPosData,
         const glm::vec3* vertexNormalData,
@@ -99,7 +101,7 @@ namespace Falcor
         std::memset(bitangentData, 0, vertexCount * sizeof(vec3));
 
         // calculate the tangent and bitangent for every face
-        size_t primCount = indices.size() / 3;
+        size_t primCount = indexCount / 3;
         for(size_t primID = 0; primID < primCount; primID++)
         {
             struct Data
@@ -113,7 +115,7 @@ namespace Falcor
             // Get the data
             for(uint32_t i = 0; i < 3; i++)
             {
-                uint32_t index = indices[primID * 3 + i];
+                uint32_t index = pIndices[primID * 3 + i];
                 V[i].position = vertexPosData[index];
                 V[i].normal = vertexNormalData[index];
                 V[i].uv = texCrdData ? texCrdData[index * texCrdCount] : vec2(0);
@@ -162,7 +164,7 @@ namespace Falcor
                 if (isInvalidVec(bitangent) == false)
                 {
                     // and write it into the mesh
-                    uint32_t index = indices[primID * 3 + i];
+                    uint32_t index = pIndices[primID * 3 + i];
                     bitangentData[index] += normalize(localBitangent);
                 }
             }
@@ -355,17 +357,20 @@ namespace Falcor
         }
     }
 
-    std::string readString(BinaryFileStream& stream)
+    std::string readString(MappedFileStream& stream)
     {
-        int32_t length;
+        int32_t length = 0;
         stream >> length;
-        std::vector<char> charVec(length + 1);
-        stream.read(&charVec[0], length);
-        charVec[length] = 0;
-        return std::string(charVec.data());
+        const char* pChars = (length > 0) ? (const char*)stream.readView(length) : nullptr;
+        if(pChars == nullptr)
+        {
+            return std::string();
+        }
+        // The string may contain a null terminator
+        return std::string(pChars, std::find(pChars, pChars + length, '\0'));
     }
 
-    bool loadBinaryTextureData(BinaryFileStream& stream, const std::string& modelName, TextureData& data)
+    bool loadBinaryTextureData(MappedFileStream& stream, const std::string& modelName, TextureData& data)
     {
         // ImageHeader.
         char tag[9];
@@ -451,29 +456,36 @@ namespace Falcor
         {
             dataSize = bpp * texelCount;
         }
-        size_t storageSize = dataSize;
-        if(bpp == 3)
-            storageSize = 4 * texelCount;
-
-        data.data.resize(storageSize);
-        stream.read(data.data.data(), dataSize);
+        const uint8_t* pImageData = stream.readView(dataSize);
+        if(pImageData == nullptr)
+        {
+            std::string msg = "Error when loading model " + modelName + ".\nBinary image data is truncated.";
+            logError(msg);
+            return false;
+        }
 
-        // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding
+        // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding. Other formats are used straight from the file mapping.
         if(bpp == 3)
         {
-            for(int32_t i=texelCount-1;i>=0;--i)
+            data.expandedData.resize(4 * texelCount);
+            for(int32_t i = 0; i < texelCount; i++)
             {
-                data.data[i * 4 + 0] = data.data[i * 3 + 0];
-                data.data[i * 4 + 1] = data.data[i * 3 + 1];
-                data.data[i * 4 + 2] = data.data[i * 3 + 2];
-                data.data[i * 4 + 3] = 0xff;
+                data.expandedData[i * 4 + 0] = pImageData[i * 3 + 0];
+                data.expandedData[i * 4 + 1] = pImageData[i * 3 + 1];
+                data.expandedData[i * 4 + 2] = pImageData[i * 3 + 2];
+                data.expandedData[i * 4 + 3] = 0xff;
             }
+            data.pData = data.expandedData.data();
+        }
+        else
+        {
+            data.pData = pImageData;
         }
 
         return true;
     }
 
-    bool importTextures(std::vector<TextureData>& textures, uint32_t textureCount, BinaryFileStream& stream, const std::string& modelName)
+    bool importTextures(std::vector<TextureData>& textures, uint32_t textureCount, MappedFileStream& stream, const std::string& modelName)
     {
         textures.assign(textureCount, TextureData());
 
@@ -493,7 +505,7 @@ namespace Falcor
         return success;
     }
 
-    BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath.c_str(), BinaryFileStream::Mode::Read)
+    BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath)
     {
     }
 
@@ -506,6 +518,12 @@ namespace Falcor
             return false;
         }
 
+        // Chunked files share the .bin extension
+        if(ChunkedModelImporter::isChunkedFile(fullpath))
+        {
+            return ChunkedModelImporter::import(model, fullpath, flags);
+        }
+
         BinaryModelImporter loader(fullpath);
         return loader.importModel(model, flags);
     }
@@ -564,6 +582,12 @@ namespace Falcor
     
     bool BinaryModelImporter::importModel(Model& model, Model::LoadFlags flags)
     {
+        if(mStream.isOpen() == false)
+        {
+            logError("Error when loading model " + mModelName + ".\nCan't map the file.");
+            return false;
+        }
+
         // Format ID and version.
         char formatID[9];
         mStream.read(formatID, 8);
@@ -656,7 +680,7 @@ namespace Falcor
             }
             bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
         };
-        std::map<TexSignature, Texture::SharedPtr> textures;
+        std::map<TexSignature, Texture::SharedPtr> textures;    // Avoids hashing the same texture data for every mesh
         bool loadTexAsSrgb = !is_set(flags, Model::LoadFlags::AssumeLinearSpaceTextures);
 
         // Load the meshes
@@ -691,8 +715,10 @@ namespace Falcor
             struct BufferData
             {
                 std::vector<uint8_t> vec;
+                const uint8_t* pData = nullptr;     // Points into the file mapping if the attribute isn't interleaved, otherwise into vec
                 bool shouldSkip = false;
                 uint32_t elementSize = 0;
+                uint32_t fileOffset = 0;            // Offset of the attribute in the file's interleaved vertex
             };
 
             std::vector<BufferData> buffers;
@@ -704,6 +730,7 @@ namespace Falcor
             uint32_t normalBufferIndex = kInvalidBufferIndex;
             uint32_t bitangentBufferIndex = kInvalidBufferIndex;
             uint32_t texCoordBufferIndex = kInvalidBufferIndex;
+            uint32_t fileVertexStride = 0;
 
             for(int i = 0; i < numAttribs; i++)
             {
@@ -744,10 +771,11 @@ namespace Falcor
                     }
 
                     buffers[i].elementSize = getFormatBytesPerBlock(falcorFormat);
+                    buffers[i].fileOffset = fileVertexStride;
+                    fileVertexStride += buffers[i].elementSize;
                     if(shaderLocation != kUnusedShaderElement)
                     {
                         pBufferLayout->addElement(falcorName, 0, falcorFormat, 1, shaderLocation);
-                        buffers[i].vec.resize(buffers[i].elementSize * numVertices);
                     }
                     else
                     {
@@ -778,33 +806,59 @@ namespace Falcor
                     pLayout->addBufferLayout(bitangentBufferIndex, pBitangentLayout);
                     pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
                     buffers[bitangentBufferIndex].vec.resize(sizeof(glm::vec3) * numVertices);
+                    buffers[bitangentBufferIndex].pData = buffers[bitangentBufferIndex].vec.data();
                 }
             }
             
 
-            // Read the data, one vertex at a time
-            for(int32_t i = 0; i < numVertices; i++)
+            // The vertices are stored interleaved, Falcor uses a buffer per attribute.
+            // An attribute which fills the entire vertex is used straight from the file mapping, the others are de-interleaved in parallel.
+            const uint8_t* pVertexData = mStream.readView(size_t(fileVertexStride) * numVertices);
+            if(pVertexData == nullptr)
+            {
+                std::string msg = "Error when loading model " + mModelName + ".\nVertex data is truncated.";
+                logError(msg);
+                return false;
+            }
+
+            for(int32_t i = 0; i < numAttribs; ++i)
             {
-                for (int32_t attributes = 0; attributes < numAttribs; ++attributes)
+                if(buffers[i].shouldSkip) continue;
+                if(buffers[i].elementSize == fileVertexStride)
                 {
-                    if (buffers[attributes].shouldSkip)
-                    {
-                        mStream.skip(buffers[attributes].elementSize);
-                    }
-                    else
+                    buffers[i].pData = pVertexData;
+                }
+                else
+                {
+                    buffers[i].vec.resize(size_t(buffers[i].elementSize) * numVertices);
+                    buffers[i].pData = buffers[i].vec.data();
+                }
+            }
+
+            static const size_t kVertexGrainSize = 64 * 1024;
+            TaskScheduler::instance().parallelFor(0, numVertices, [&](size_t begin, size_t end)
+            {
+                for(int32_t i = 0; i < numAttribs; ++i)
+                {
+                    if(buffers[i].shouldSkip || buffers[i].vec.empty()) continue;
+
+                    const uint32_t size = buffers[i].elementSize;
+                    const uint8_t* pSrc = pVertexData + begin * fileVertexStride + buffers[i].fileOffset;
+                    uint8_t* pDst = buffers[i].vec.data() + begin * size;
+                    for(size_t v = begin; v < end; v++)
                     {
-                        uint32_t stride = pLayout->getBufferLayout(attributes)->getStride();
-                        uint8_t* pDest = buffers[attributes].vec.data() + stride * i;
-                        mStream.read(pDest, stride);
+                        std::memcpy(pDst, pSrc, size);
+                        pSrc += fileVertexStride;
+                        pDst += size;
                     }
                 }
-            }
+            }, kVertexGrainSize);
 
             for (int32_t i = 0; i < numAttribs; ++i)
             {
                 if(buffers[i].shouldSkip == false)
                 {
-                    pVBs[i] = Buffer::create(buffers[i].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[i].vec.data());
+                    pVBs[i] = Buffer::create(size_t(buffers[i].elementSize) * numVertices, Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[i].pData);
                 }
             }
 
@@ -863,7 +917,7 @@ namespace Falcor
                         // Load the texture
                         TexSignature texSig;
                         texSig.format = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, falcorType);
-                        texSig.pData = texData[texID].data.data();
+                        texSig.pData = texData[texID].pData;
                         // Check if we already created a matching texture
                         auto existingTex = textures.find(texSig);
                         if(existingTex != textures.end())
@@ -872,8 +926,10 @@ namespace Falcor
                         }
                         else
                         {
-                            auto pTexture = Texture::create2D(texData[texID].width, texData[texID].height, texSig.format, 1, Texture::kMaxPossible, texSig.pData);
-                            pTexture->setSourceFilename(texData[texID].name);
+                            // The texture cache also shares identical textures with other models
+                            const TextureData& data = texData[texID];
+                            size_t dataSize = size_t(data.width) * data.height * getFormatBytesPerBlock(texSig.format);
+                            auto pTexture = TextureCache::instance().create2D(data.width, data.height, texSig.format, Texture::kMaxPossible, texSig.pData, dataSize, data.name);
                             textures[texSig] = pTexture;
                             basicMaterial.pTextures[falcorType] = pTexture;
                         }
@@ -892,32 +948,37 @@ namespace Falcor
                     return false;
                 }
 
-                // create the index buffer
+                // create the index buffer. The indices are used straight from the file mapping
                 uint32_t numIndices = numTriangles * 3;
-                std::vector<uint32_t> indices(numIndices);
                 uint32_t ibSize = 3 * numTriangles * sizeof(uint32_t);
-                mStream.read(&indices[0], ibSize);
+                const uint32_t* pIndices = (const uint32_t*)mStream.readView(ibSize);
+                if(pIndices == nullptr)
+                {
+                    std::string msg = "Error when loading model " + mModelName + ".\nIndex data is truncated.";
+                    logError(msg);
+                    return false;
+                }
 
                 // Generate tangent space data if needed
                 if (genTangentForMesh)
                 {
                   uint32_t texCrdCount = 0;
-                  glm::vec2* texCrd = nullptr;
+                  const glm::vec2* texCrd = nullptr;
                   if (texCoordBufferIndex != kInvalidBufferIndex)
                   {
                     texCrdCount = pLayout->getBufferLayout(texCoordBufferIndex)->getStride() / sizeof(glm::vec2);
-                    texCrd = (glm::vec2*)buffers[texCoordBufferIndex].vec.data();
+                    texCrd = (const glm::vec2*)buffers[texCoordBufferIndex].pData;
                   }
 
                   ResourceFormat posFormat = pLayout->getBufferLayout(positionBufferIndex)->getElementFormat(0);
 
                   if (posFormat == ResourceFormat::RGB32Float)
                   {
-                    generateSubmeshTangentData<glm::vec3>(indices, numVertices, (glm::vec3*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
+                    generateSubmeshTangentData<glm::vec3>(pIndices, numIndices, numVertices, (const glm::vec3*)buffers[positionBufferIndex].pData, (const glm::vec3*)buffers[normalBufferIndex].pData, texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
                   }
                   else if (posFormat == ResourceFormat::RGBA32Float)
                   {
-                    generateSubmeshTangentData<glm::vec4>(indices, numVertices, (glm::vec4*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
+                    generateSubmeshTangentData<glm::vec4>(pIndices, numIndices, numVertices, (const glm::vec4*)buffers[positionBufferIndex].pData, (const glm::vec3*)buffers[normalBufferIndex].pData, texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
                   }
 
                   pVBs[bitangentBufferIndex] = Buffer::create(buffers[bitangentBufferIndex].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[bitangentBufferIndex].vec.data());
@@ -927,10 +988,10 @@ namespace Falcor
                 glm::vec3 max, min;
                 for (uint32_t i = 0; i < numIndices; i++)
                 {
-                  uint32_t vertexID = indices[i];
-                  uint8_t* pVertex = (pLayout->getBufferLayout(positionBufferIndex)->getStride() * vertexID) + buffers[positionBufferIndex].vec.data();
+                  uint32_t vertexID = pIndices[i];
+                  const uint8_t* pVertex = (pLayout->getBufferLayout(positionBufferIndex)->getStride() * vertexID) + buffers[positionBufferIndex].pData;
 
-                  float* pPosition = (float*)pVertex;
+                  const float* pPosition = (const float*)pVertex;
 
                   glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
                   min = glm::min(min, xyz);
@@ -939,50 +1000,16 @@ namespace Falcor
                 BoundingBox box = BoundingBox::fromMinMax(min, max);
 
                 //Generate Adjacency information if required
+                std::vector<uint32_t> adjacencyIndices;
                 if (is_set(Model::LoadFlags::GenerateAdjacency, flags))
                 {
-                  //Determine half edges
-                  std::unordered_map<int2, int> halfEdges = std::unordered_map<int2, int>();
-                  for(uint32_t i = 0; i < numIndices; i += 3)
-                  {
-                    int p0 = indices[i];
-                    int p1 = indices[i + 1];
-                    int p2 = indices[i + 2];
-
-                    halfEdges.insert(std::make_pair(int2(p0, p1), p2));
-                    halfEdges.insert(std::make_pair(int2(p1, p2), p0));
-                    halfEdges.insert(std::make_pair(int2(p2, p0), p1));         
-                  }
-
-                  //save adjacncy indices
-                  std::vector<uint32_t> adjIndices(2 * numIndices);
-                  for (uint32_t i = 0; i < numIndices; i += 3)
-                  {
-                    uint32_t adjStartIndex = 2 * i;
-                    uint32_t p0 = indices[i];
-                    uint32_t p1 = indices[i + 1];
-                    uint32_t p2 = indices[i + 2];
-                    int2 e0 = int2(p1, p0);
-                    int2 e1 = int2(p2, p1);
-                    int2 e2 = int2(p0, p2);
-
-                    auto adjP0 = halfEdges.find(e0);
-                    auto adjP1 = halfEdges.find(e1);
-                    auto adjP2 = halfEdges.find(e2);
-                    adjIndices[adjStartIndex] = p0;
-                    adjIndices[adjStartIndex + 1] = adjP0 == halfEdges.end() ? -1 : adjP0->second;
-                    adjIndices[adjStartIndex + 2] = p1;
-                    adjIndices[adjStartIndex + 3] = adjP1 == halfEdges.end() ? -1 : adjP1->second;
-                    adjIndices[adjStartIndex + 4] = p2;
-                    adjIndices[adjStartIndex + 5] = adjP2 == halfEdges.end() ? -1 : adjP2->second;
-                  }
-
-                  indices = adjIndices;
+                  adjacencyIndices = generateAdjacencyIndices(std::vector<uint32_t>(pIndices, pIndices + numIndices));
+                  pIndices = adjacencyIndices.data();
                   ibSize *= 2;
                   numIndices *= 2;
                 }
 
-                auto pIB = Buffer::create(ibSize, Buffer::BindFlags::Index, Buffer::CpuAccess::None, indices.data());
+                auto pIB = Buffer::create(ibSize, Buffer::BindFlags::Index, Buffer::CpuAccess::None, pIndices);
 
                 // create the mesh
                 auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false);
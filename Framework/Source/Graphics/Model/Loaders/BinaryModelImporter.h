@@ -27,7 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <string>
-#include "Utils/BinaryFileStream.h"
+#include "Utils/MappedFileStream.h"
 #include "glm/vec3.hpp"
 #include "../Model.h"
 #include "Graphics/Model/Loaders/ModelImporter.h"
@@ -51,7 +51,7 @@ namespace Falcor
         bool importModel(Model& model, Model::LoadFlags flags);
 
         std::string mModelName;
-        BinaryFileStream mStream;
+        MappedFileStream mStream;
 
         struct TangentSpace
         {
@@ -0,0 +1,687 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ChunkedModelImporter.h"
+#include "../Mesh.h"
+#include "API/VertexLayout.h"
+#include "API/Buffer.h"
+#include "API/Texture.h"
+#include "API/Formats.h"
+#include "API/Device.h"
+#include "Graphics/TextureCache.h"
+#include "Data/VertexAttrib.h"
+#include "Utils/Platform/OS.h"
+#include "Utils/TaskScheduler.h"
+#include "Utils/Hash.h"
+#include "Utils/Lz4.h"
+#include "glm/common.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
+namespace Falcor
+{
+    template<typename posType>
+    void generateSubmeshTangentData(
+        const uint32_t* pIndices,
+        size_t indexCount,
+        uint32_t vertexCount,
+        const posType* vertexPosData,
+        const glm::vec3* vertexNormalData,
+        const glm::vec2* texCrdData,
+        uint32_t texCrdCount,
+        glm::vec3* bitangentData);
+
+    static bool getFormatFromName(const char* name, size_t maxLength, ResourceFormat& format)
+    {
+        const std::string str(name, strnlen(name, maxLength));
+        for (uint32_t i = 0; i < (uint32_t)ResourceFormat::Count; i++)
+        {
+            if (to_string(ResourceFormat(i)) == str)
+            {
+                format = ResourceFormat(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool isRangeInside(uint64_t offset, uint64_t size, uint64_t totalSize)
+    {
+        return offset <= totalSize && size <= totalSize - offset;
+    }
+
+    bool ChunkedModelImporter::isChunkedFile(const std::string& fullpath)
+    {
+        std::ifstream file(fullpath, std::ios::binary);
+        char magic[sizeof(kChunkedFileMagic)] = {};
+        file.read(magic, sizeof(magic));
+        return file.good() && std::memcmp(magic, kChunkedFileMagic, sizeof(magic)) == 0;
+    }
+
+    ChunkedModelImporter::ChunkedModelImporter(const std::string& fullpath, Model::LoadFlags flags) : mModelName(fullpath), mFlags(flags), mStream(fullpath)
+    {
+    }
+
+    bool ChunkedModelImporter::import(Model& model, const std::string& filename, Model::LoadFlags flags, const std::vector<uint32_t>& geometrySubset)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logError(std::string("Can't find model file ") + filename);
+            return false;
+        }
+
+        ChunkedModelImporter loader(fullpath, flags);
+        return loader.importModel(model, geometrySubset);
+    }
+
+    bool ChunkedModelImporter::readToc()
+    {
+        if (mStream.isOpen() == false)
+        {
+            logError("Error when loading model " + mModelName + ".\nCan't map the file.");
+            return false;
+        }
+
+        ChunkedFileHeader header;
+        mStream >> header;
+        if (mStream.isFail() || std::memcmp(header.magic, kChunkedFileMagic, sizeof(kChunkedFileMagic)) != 0)
+        {
+            logError("Error when loading model " + mModelName + ".\nNot a chunked binary scene file!");
+            return false;
+        }
+
+        if (header.version != kChunkedFileVersion)
+        {
+            logError("Error when loading model " + mModelName + ".\nUnsupported chunked binary scene version " + std::to_string(header.version));
+            return false;
+        }
+
+        // Uncompressed chunks are read in place, so their sections are only aligned if the chunks are
+        if (header.chunkAlignment == 0 || (header.chunkAlignment % kChunkSectionAlignment) != 0)
+        {
+            logError("Error when loading model " + mModelName + ".\nUnsupported chunk alignment " + std::to_string(header.chunkAlignment) + ". It must be a multiple of " + std::to_string(kChunkSectionAlignment) + ".");
+            return false;
+        }
+
+        const ChunkTocEntry* pToc = (const ChunkTocEntry*)mStream.getView(header.tocOffset, size_t(header.chunkCount) * sizeof(ChunkTocEntry));
+        if (pToc == nullptr)
+        {
+            logError("Error when loading model " + mModelName + ".\nThe table of contents is truncated.");
+            return false;
+        }
+        mToc.assign(pToc, pToc + header.chunkCount);
+        mChunks.resize(mToc.size());
+
+        // Validate the entries, so that the decoders can trust them
+        for (uint32_t i = 0; i < (uint32_t)mToc.size(); i++)
+        {
+            const ChunkTocEntry& entry = mToc[i];
+            const std::string chunkName = "Chunk " + std::to_string(i);
+            if (mStream.getView(entry.offset, entry.storedSize) == nullptr)
+            {
+                logError("Error when loading model " + mModelName + ".\n" + chunkName + " is truncated.");
+                return false;
+            }
+
+            if ((entry.offset % header.chunkAlignment) != 0)
+            {
+                logError("Error when loading model " + mModelName + ".\n" + chunkName + " isn't aligned to " + std::to_string(header.chunkAlignment) + " bytes.");
+                return false;
+            }
+
+            switch (entry.compression)
+            {
+            case ChunkCompression::None:
+                if (entry.storedSize != entry.size)
+                {
+                    logError("Error when loading model " + mModelName + ".\n" + chunkName + " is uncompressed, but its stored size doesn't match its size.");
+                    return false;
+                }
+                break;
+            case ChunkCompression::LZ4:
+                // LZ4 can't expand data more than 255 times. Check it before trusting the size with an allocation.
+                if (entry.size / 255 > entry.storedSize)
+                {
+                    logError("Error when loading model " + mModelName + ".\n" + chunkName + " is corrupted.");
+                    return false;
+                }
+                break;
+            default:
+                logError("Error when loading model " + mModelName + ".\n" + chunkName + " uses an unknown compression " + std::to_string((uint32_t)entry.compression) + ".");
+                return false;
+            }
+
+            switch (entry.type)
+            {
+            case ChunkType::Texture:
+                mTextureChunks.push_back(i);
+                break;
+            case ChunkType::Geometry:
+                mGeometryChunks.push_back(i);
+                break;
+            case ChunkType::Materials:
+            case ChunkType::Instances:
+            {
+                uint32_t& chunk = (entry.type == ChunkType::Materials) ? mMaterialsChunk : mInstancesChunk;
+                if (chunk != kInvalidChunkIndex)
+                {
+                    logError("Error when loading model " + mModelName + ".\nThe file contains more than one materials or instances chunk.");
+                    return false;
+                }
+                chunk = i;
+                break;
+            }
+            default:
+                // Skip unknown chunks, so that newer writers can add chunk types without breaking older readers
+                logWarning("Model " + mModelName + " contains a chunk of unknown type " + std::to_string((uint32_t)entry.type) + ". Ignoring it.");
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool ChunkedModelImporter::decodeChunk(uint32_t chunkIndex)
+    {
+        const ChunkTocEntry& entry = mToc[chunkIndex];
+        DecodedChunk& chunk = mChunks[chunkIndex];
+        const uint8_t* pStored = mStream.getView(entry.offset, entry.storedSize);
+
+        if (entry.compression == ChunkCompression::None)
+        {
+            // Use the mapping directly. The chunk offset is aligned, so the sections inside the chunk can be accessed in place.
+            chunk.pData = pStored;
+        }
+        else
+        {
+            chunk.storage.resize((size_t)entry.size);
+            if (lz4Decompress(pStored, (size_t)entry.storedSize, chunk.storage.data(), chunk.storage.size()) == false)
+            {
+                logError("Error when loading model " + mModelName + ".\nChunk " + std::to_string(chunkIndex) + " can't be decompressed.");
+                return false;
+            }
+            chunk.pData = chunk.storage.data();
+        }
+        chunk.size = (size_t)entry.size;
+
+        if (xxHash64(chunk.pData, chunk.size) != entry.hash)
+        {
+            logError("Error when loading model " + mModelName + ".\nChunk " + std::to_string(chunkIndex) + " is corrupted, its hash doesn't match.");
+            return false;
+        }
+        return true;
+    }
+
+    bool ChunkedModelImporter::prepareGeometry(uint32_t geometryIndex)
+    {
+        const DecodedChunk& chunk = mChunks[mGeometryChunks[geometryIndex]];
+        GeometryData& geometry = mGeometry[geometryIndex];
+        const std::string errorPrefix = "Error when loading model " + mModelName + ".\nGeometry chunk " + std::to_string(geometryIndex) + " ";
+
+        if (chunk.size < sizeof(GeometryChunkHeader))
+        {
+            logError(errorPrefix + "is truncated.");
+            return false;
+        }
+        geometry.pHeader = (const GeometryChunkHeader*)chunk.pData;
+        const GeometryChunkHeader& header = *geometry.pHeader;
+
+        uint64_t tablesSize = uint64_t(header.attribCount) * sizeof(VertexAttribDesc) + uint64_t(header.submeshCount) * sizeof(SubmeshDesc);
+        if (isRangeInside(sizeof(GeometryChunkHeader), tablesSize, chunk.size) == false)
+        {
+            logError(errorPrefix + "is truncated.");
+            return false;
+        }
+        geometry.pAttribs = (const VertexAttribDesc*)(chunk.pData + sizeof(GeometryChunkHeader));
+        geometry.pSubmeshes = (const SubmeshDesc*)(geometry.pAttribs + header.attribCount);
+
+        // Vertex attributes
+        uint32_t positionAttrib = kInvalidChunkIndex;
+        uint32_t normalAttrib = kInvalidChunkIndex;
+        uint32_t texCoordAttrib = kInvalidChunkIndex;
+        bool hasBitangents = false;
+        geometry.attribFormats.resize(header.attribCount);
+        for (uint32_t i = 0; i < header.attribCount; i++)
+        {
+            const VertexAttribDesc& attrib = geometry.pAttribs[i];
+            ResourceFormat& format = geometry.attribFormats[i];
+            if (getFormatFromName(attrib.format, sizeof(attrib.format), format) == false || isCompressedFormat(format))
+            {
+                logError(errorPrefix + "has a vertex attribute with an unknown format.");
+                return false;
+            }
+
+            uint64_t size = uint64_t(getFormatBytesPerBlock(format)) * header.vertexCount;
+            if ((attrib.dataOffset % kChunkSectionAlignment) != 0 || isRangeInside(attrib.dataOffset, size, chunk.size) == false)
+            {
+                logError(errorPrefix + "has a vertex attribute outside of the chunk.");
+                return false;
+            }
+
+            switch (attrib.shaderLocation)
+            {
+            case VERTEX_POSITION_LOC:
+                positionAttrib = i;
+                break;
+            case VERTEX_NORMAL_LOC:
+                normalAttrib = (format == ResourceFormat::RGB32Float) ? i : normalAttrib;
+                break;
+            case VERTEX_BITANGENT_LOC:
+                hasBitangents = true;
+                break;
+            case VERTEX_TEXCOORD_LOC:
+                texCoordAttrib = (getFormatType(format) == FormatType::Float && getFormatBytesPerBlock(format) == 4 * getFormatChannelCount(format)) ? i : texCoordAttrib;
+                break;
+            }
+        }
+
+        if (positionAttrib == kInvalidChunkIndex || (geometry.attribFormats[positionAttrib] != ResourceFormat::RGB32Float && geometry.attribFormats[positionAttrib] != ResourceFormat::RGBA32Float))
+        {
+            logError(errorPrefix + "doesn't have 32-bit float positions.");
+            return false;
+        }
+
+        // Submeshes. Validate the indices here, so that a corrupted file can't make the GPU or the tangent generation read out of bounds.
+        for (uint32_t i = 0; i < header.submeshCount; i++)
+        {
+            const SubmeshDesc& submesh = geometry.pSubmeshes[i];
+            if (submesh.topology > (uint32_t)Vao::Topology::TriangleStrip)
+            {
+                logError(errorPrefix + "has a submesh with an unknown topology.");
+                return false;
+            }
+
+            if ((submesh.indexOffset % kChunkSectionAlignment) != 0 || isRangeInside(submesh.indexOffset, uint64_t(submesh.indexCount) * sizeof(uint32_t), chunk.size) == false)
+            {
+                logError(errorPrefix + "has a submesh with indices outside of the chunk.");
+                return false;
+            }
+
+            const uint32_t* pIndices = (const uint32_t*)(chunk.pData + submesh.indexOffset);
+            for (uint32_t j = 0; j < submesh.indexCount; j++)
+            {
+                if (pIndices[j] >= header.vertexCount)
+                {
+                    logError(errorPrefix + "has a submesh with an out-of-range index.");
+                    return false;
+                }
+            }
+        }
+
+        // Tangent space
+        bool generateTangents = (hasBitangents == false) && (is_set(mFlags, Model::LoadFlags::DontGenerateTangentSpace) == false);
+        if (generateTangents)
+        {
+            if (normalAttrib == kInvalidChunkIndex)
+            {
+                logWarning("Can't generate tangent space for geometry chunk " + std::to_string(geometryIndex) + " when loading model " + mModelName + ".\nGeometry doesn't contain normals\n");
+            }
+            else
+            {
+                // The tangents are accumulated per vertex, so all the triangles sharing the vertex buffer are processed together
+                std::vector<uint32_t> indices;
+                for (uint32_t i = 0; i < header.submeshCount; i++)
+                {
+                    const SubmeshDesc& submesh = geometry.pSubmeshes[i];
+                    if (submesh.topology != (uint32_t)Vao::Topology::TriangleList) continue;
+                    const uint32_t* pIndices = (const uint32_t*)(chunk.pData + submesh.indexOffset);
+                    indices.insert(indices.end(), pIndices, pIndices + submesh.indexCount - (submesh.indexCount % 3));
+                }
+
+                std::vector<glm::vec2> texCrd;
+                if (texCoordAttrib != kInvalidChunkIndex)
+                {
+                    const float* pTexCrd = (const float*)(chunk.pData + geometry.pAttribs[texCoordAttrib].dataOffset);
+                    uint32_t channels = getFormatChannelCount(geometry.attribFormats[texCoordAttrib]);
+                    texCrd.resize(header.vertexCount);
+                    for (uint32_t v = 0; v < header.vertexCount; v++)
+                    {
+                        texCrd[v] = glm::vec2(pTexCrd[v * channels], (channels > 1) ? pTexCrd[v * channels + 1] : 0.f);
+                    }
+                }
+
+                const uint8_t* pPositions = chunk.pData + geometry.pAttribs[positionAttrib].dataOffset;
+                const glm::vec3* pNormals = (const glm::vec3*)(chunk.pData + geometry.pAttribs[normalAttrib].dataOffset);
+                const glm::vec2* pTexCrd = texCrd.empty() ? nullptr : texCrd.data();
+                geometry.bitangents.resize(header.vertexCount);
+                if (geometry.attribFormats[positionAttrib] == ResourceFormat::RGB32Float)
+                {
+                    generateSubmeshTangentData<glm::vec3>(indices.data(), indices.size(), header.vertexCount, (const glm::vec3*)pPositions, pNormals, pTexCrd, 1, geometry.bitangents.data());
+                }
+                else
+                {
+                    generateSubmeshTangentData<glm::vec4>(indices.data(), indices.size(), header.vertexCount, (const glm::vec4*)pPositions, pNormals, pTexCrd, 1, geometry.bitangents.data());
+                }
+            }
+        }
+
+        // Adjacency
+        if (is_set(mFlags, Model::LoadFlags::GenerateAdjacency))
+        {
+            geometry.adjacency.resize(header.submeshCount);
+            for (uint32_t i = 0; i < header.submeshCount; i++)
+            {
+                const SubmeshDesc& submesh = geometry.pSubmeshes[i];
+                if (submesh.topology != (uint32_t)Vao::Topology::TriangleList) continue;
+                const uint32_t* pIndices = (const uint32_t*)(chunk.pData + submesh.indexOffset);
+                geometry.adjacency[i] = generateAdjacencyIndices(std::vector<uint32_t>(pIndices, pIndices + submesh.indexCount));
+            }
+        }
+
+        return true;
+    }
+
+    bool ChunkedModelImporter::decodeChunks(const std::vector<uint32_t>& chunks)
+    {
+        std::atomic<bool> success(true);
+        TaskScheduler::instance().parallelFor(0, chunks.size(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end && success; i++)
+            {
+                uint32_t chunkIndex = chunks[i];
+                bool decoded = decodeChunk(chunkIndex);
+                if (decoded && mToc[chunkIndex].type == ChunkType::Geometry)
+                {
+                    // mGeometryChunks is in TOC order
+                    uint32_t geometryIndex = uint32_t(std::lower_bound(mGeometryChunks.begin(), mGeometryChunks.end(), chunkIndex) - mGeometryChunks.begin());
+                    decoded = prepareGeometry(geometryIndex);
+                }
+                if (decoded == false) success = false;
+            }
+        }, 1);
+        return success;
+    }
+
+    bool ChunkedModelImporter::parseMaterials()
+    {
+        if (mMaterialsChunk == kInvalidChunkIndex) return true;
+
+        const DecodedChunk& chunk = mChunks[mMaterialsChunk];
+        if ((chunk.size % sizeof(MaterialDesc)) != 0)
+        {
+            logError("Error when loading model " + mModelName + ".\nThe materials chunk is corrupted.");
+            return false;
+        }
+        mpMaterials = (const MaterialDesc*)chunk.pData;
+        mMaterialCount = uint32_t(chunk.size / sizeof(MaterialDesc));
+
+        for (uint32_t i = 0; i < mMaterialCount; i++)
+        {
+            for (uint32_t slot = 0; slot < MaterialTextureSlot_Count; slot++)
+            {
+                int32_t texture = mpMaterials[i].textures[slot];
+                if (texture < -1 || texture >= (int32_t)mTextureChunks.size())
+                {
+                    logError("Error when loading model " + mModelName + ".\nMaterial " + std::to_string(i) + " uses a texture which doesn't exist.");
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    Texture::SharedPtr ChunkedModelImporter::createTexture(uint32_t textureIndex)
+    {
+        const DecodedChunk& chunk = mChunks[mTextureChunks[textureIndex]];
+        const std::string errorPrefix = "Error when loading model " + mModelName + ".\nTexture " + std::to_string(textureIndex) + " ";
+        if (chunk.size < sizeof(TextureChunkHeader))
+        {
+            logError(errorPrefix + "is truncated.");
+            return nullptr;
+        }
+
+        const TextureChunkHeader& header = *(const TextureChunkHeader*)chunk.pData;
+        ResourceFormat format;
+        if (getFormatFromName(header.format, sizeof(header.format), format) == false)
+        {
+            logError(errorPrefix + "has an unknown format.");
+            return nullptr;
+        }
+
+        uint64_t blocksX = (header.width + getFormatWidthCompressionRatio(format) - 1) / getFormatWidthCompressionRatio(format);
+        uint64_t blocksY = (header.height + getFormatHeightCompressionRatio(format) - 1) / getFormatHeightCompressionRatio(format);
+        uint64_t expectedSize = blocksX * blocksY * getFormatBytesPerBlock(format);
+        if (header.width == 0 || header.height == 0 || header.dataSize != expectedSize || isRangeInside(header.dataOffset, header.dataSize, chunk.size) == false
+            || isRangeInside(sizeof(TextureChunkHeader), header.nameLength, chunk.size) == false)
+        {
+            logError(errorPrefix + "is corrupted.");
+            return nullptr;
+        }
+
+        if (is_set(mFlags, Model::LoadFlags::AssumeLinearSpaceTextures) && isSrgbFormat(format))
+        {
+            format = srgbToLinearFormat(format);
+        }
+
+        std::string name((const char*)chunk.pData + sizeof(TextureChunkHeader), header.nameLength);
+        return TextureCache::instance().create2D(header.width, header.height, format, Texture::kMaxPossible, chunk.pData + header.dataOffset, header.dataSize, name);
+    }
+
+    Material::SharedPtr ChunkedModelImporter::createMaterial(uint32_t materialIndex)
+    {
+        const MaterialDesc& desc = mpMaterials[materialIndex];
+        Material::SharedPtr pMaterial = Material::create(std::string(desc.name, strnlen(desc.name, sizeof(desc.name))));
+        pMaterial->setShadingModel(desc.shadingModel);
+        pMaterial->setBaseColor(desc.baseColor);
+        pMaterial->setSpecularParams(desc.specular);
+        pMaterial->setEmissiveColor(desc.emissive);
+        pMaterial->setAlphaMode(desc.alphaMode);
+        pMaterial->setAlphaThreshold(desc.alphaThreshold);
+        pMaterial->setHeightScaleOffset(desc.heightScale, desc.heightOffset);
+        pMaterial->setIndexOfRefraction(desc.indexOfRefraction);
+        pMaterial->setDoubleSided(desc.doubleSided != 0);
+
+        auto getTexture = [&](MaterialTextureSlot slot) { return (desc.textures[slot] >= 0) ? mTextures[desc.textures[slot]] : nullptr; };
+        Texture::SharedPtr pBaseColor = getTexture(MaterialTextureSlot_BaseColor);
+        if (pBaseColor) pMaterial->setBaseColorTexture(pBaseColor);
+        if (auto pTexture = getTexture(MaterialTextureSlot_Specular)) pMaterial->setSpecularTexture(pTexture);
+        if (auto pTexture = getTexture(MaterialTextureSlot_Emissive)) pMaterial->setEmissiveTexture(pTexture);
+        if (auto pTexture = getTexture(MaterialTextureSlot_Normal)) pMaterial->setNormalMap(pTexture);
+        if (auto pTexture = getTexture(MaterialTextureSlot_Occlusion)) pMaterial->setOcclusionMap(pTexture);
+        if (auto pTexture = getTexture(MaterialTextureSlot_LightMap)) pMaterial->setLightMap(pTexture);
+        if (auto pTexture = getTexture(MaterialTextureSlot_Height)) pMaterial->setHeightMap(pTexture);
+
+        return checkForExistingMaterial(pMaterial);
+    }
+
+    void ChunkedModelImporter::createMeshes(GeometryData& geometry)
+    {
+        const GeometryChunkHeader& header = *geometry.pHeader;
+        const uint8_t* pChunk = (const uint8_t*)geometry.pHeader;
+        Buffer::BindFlags srvFlag = is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource) ? Buffer::BindFlags::ShaderResource : Buffer::BindFlags::None;
+
+        // The vertex buffers are shared by all the submeshes
+        Vao::BufferVec pVBs;
+        VertexLayout::SharedPtr pLayout = VertexLayout::create();
+        for (uint32_t i = 0; i < header.attribCount; i++)
+        {
+            const VertexAttribDesc& attrib = geometry.pAttribs[i];
+            ResourceFormat format = geometry.attribFormats[i];
+            VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+            pBufferLayout->addElement(std::string(attrib.semanticName, strnlen(attrib.semanticName, sizeof(attrib.semanticName))), 0, format, 1, attrib.shaderLocation);
+            pLayout->addBufferLayout((uint32_t)pVBs.size(), pBufferLayout);
+            pVBs.push_back(Buffer::create(size_t(getFormatBytesPerBlock(format)) * header.vertexCount, Buffer::BindFlags::Vertex | srvFlag, Buffer::CpuAccess::None, pChunk + attrib.dataOffset));
+        }
+
+        if (geometry.bitangents.size())
+        {
+            VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+            pBufferLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
+            pLayout->addBufferLayout((uint32_t)pVBs.size(), pBufferLayout);
+            pVBs.push_back(Buffer::create(sizeof(glm::vec3) * geometry.bitangents.size(), Buffer::BindFlags::Vertex | srvFlag, Buffer::CpuAccess::None, geometry.bitangents.data()));
+        }
+
+        geometry.meshes.resize(header.submeshCount);
+        for (uint32_t i = 0; i < header.submeshCount; i++)
+        {
+            const SubmeshDesc& submesh = geometry.pSubmeshes[i];
+            const uint32_t* pIndices = (const uint32_t*)(pChunk + submesh.indexOffset);
+            uint32_t indexCount = submesh.indexCount;
+            Vao::Topology topology = (Vao::Topology)submesh.topology;
+            if (geometry.adjacency.size() && geometry.adjacency[i].size())
+            {
+                pIndices = geometry.adjacency[i].data();
+                indexCount = (uint32_t)geometry.adjacency[i].size();
+                topology = Vao::Topology::TriangleListAdj;
+            }
+
+            auto pIB = Buffer::create(sizeof(uint32_t) * indexCount, Buffer::BindFlags::Index | srvFlag, Buffer::CpuAccess::None, pIndices);
+            BoundingBox box = BoundingBox::fromMinMax(submesh.boundingBoxMin, submesh.boundingBoxMax);
+            geometry.meshes[i] = Mesh::create(pVBs, header.vertexCount, pIB, indexCount, pLayout, topology, mMaterials[submesh.materialIndex], box, false);
+        }
+    }
+
+    bool ChunkedModelImporter::createInstances(Model& model, const std::vector<uint32_t>& geometryIndices)
+    {
+        if (mInstancesChunk == kInvalidChunkIndex)
+        {
+            // No instances, every submesh is drawn once
+            for (uint32_t g : geometryIndices)
+            {
+                for (const auto& pMesh : mGeometry[g].meshes) model.addMeshInstance(pMesh, glm::mat4());
+            }
+            return true;
+        }
+
+        const DecodedChunk& chunk = mChunks[mInstancesChunk];
+        if ((chunk.size % sizeof(InstanceDesc)) != 0)
+        {
+            logError("Error when loading model " + mModelName + ".\nThe instances chunk is corrupted.");
+            return false;
+        }
+
+        const InstanceDesc* pInstances = (const InstanceDesc*)chunk.pData;
+        for (size_t i = 0; i < chunk.size / sizeof(InstanceDesc); i++)
+        {
+            const InstanceDesc& instance = pInstances[i];
+            if (instance.geometryIndex >= mGeometry.size() || (mGeometry[instance.geometryIndex].pHeader && instance.submeshIndex >= mGeometry[instance.geometryIndex].pHeader->submeshCount))
+            {
+                logError("Error when loading model " + mModelName + ".\nInstance " + std::to_string(i) + " references a submesh which doesn't exist.");
+                return false;
+            }
+
+            // Skip the geometry which wasn't loaded
+            const auto& meshes = mGeometry[instance.geometryIndex].meshes;
+            if (meshes.size())
+            {
+                model.addMeshInstance(meshes[instance.submeshIndex], instance.transform);
+            }
+        }
+        return true;
+    }
+
+    bool ChunkedModelImporter::importModel(Model& model, const std::vector<uint32_t>& geometrySubset)
+    {
+        if (readToc() == false) return false;
+
+        std::vector<uint32_t> geometryIndices = geometrySubset;
+        if (geometryIndices.empty())
+        {
+            geometryIndices.resize(mGeometryChunks.size());
+            for (uint32_t i = 0; i < (uint32_t)geometryIndices.size(); i++) geometryIndices[i] = i;
+        }
+        std::sort(geometryIndices.begin(), geometryIndices.end());
+        geometryIndices.erase(std::unique(geometryIndices.begin(), geometryIndices.end()), geometryIndices.end());
+        if (geometryIndices.size() && geometryIndices.back() >= mGeometryChunks.size())
+        {
+            logError("Error when loading model " + mModelName + ".\nRequested geometry " + std::to_string(geometryIndices.back()) + ", but the file only has " + std::to_string(mGeometryChunks.size()) + ".");
+            return false;
+        }
+        mGeometry.resize(mGeometryChunks.size());
+
+        // Decode the materials, instances and requested geometry in parallel. Geometry is validated and its tangents and adjacency are generated on the worker threads.
+        std::vector<uint32_t> chunks;
+        if (mMaterialsChunk != kInvalidChunkIndex) chunks.push_back(mMaterialsChunk);
+        if (mInstancesChunk != kInvalidChunkIndex) chunks.push_back(mInstancesChunk);
+        for (uint32_t g : geometryIndices) chunks.push_back(mGeometryChunks[g]);
+        if (decodeChunks(chunks) == false) return false;
+        if (parseMaterials() == false) return false;
+
+        // Find the materials and textures used by the requested geometry, and decode only those textures
+        std::vector<bool> materialUsed(mMaterialCount, false);
+        for (uint32_t g : geometryIndices)
+        {
+            const GeometryData& geometry = mGeometry[g];
+            for (uint32_t i = 0; i < geometry.pHeader->submeshCount; i++)
+            {
+                uint32_t materialIndex = geometry.pSubmeshes[i].materialIndex;
+                if (materialIndex >= mMaterialCount)
+                {
+                    logError("Error when loading model " + mModelName + ".\nGeometry " + std::to_string(g) + " uses a material which doesn't exist.");
+                    return false;
+                }
+                materialUsed[materialIndex] = true;
+            }
+        }
+
+        std::vector<bool> textureUsed(mTextureChunks.size(), false);
+        for (uint32_t i = 0; i < mMaterialCount; i++)
+        {
+            if (materialUsed[i] == false) continue;
+            for (int32_t texture : mpMaterials[i].textures)
+            {
+                if (texture >= 0) textureUsed[texture] = true;
+            }
+        }
+
+        chunks.clear();
+        for (uint32_t i = 0; i < (uint32_t)mTextureChunks.size(); i++)
+        {
+            if (textureUsed[i]) chunks.push_back(mTextureChunks[i]);
+        }
+        if (decodeChunks(chunks) == false) return false;
+
+        // Create the GPU resources
+        mTextures.resize(mTextureChunks.size());
+        for (uint32_t i = 0; i < (uint32_t)mTextureChunks.size(); i++)
+        {
+            if (textureUsed[i] == false) continue;
+            mTextures[i] = createTexture(i);
+            if (mTextures[i] == nullptr) return false;
+            // Release the decompressed texels once uploaded
+            mChunks[mTextureChunks[i]] = DecodedChunk();
+        }
+
+        mMaterials.resize(mMaterialCount);
+        for (uint32_t i = 0; i < mMaterialCount; i++)
+        {
+            if (materialUsed[i]) mMaterials[i] = createMaterial(i);
+        }
+
+        for (uint32_t g : geometryIndices)
+        {
+            createMeshes(mGeometry[g]);
+        }
+
+        // Flush the upload heap, so the memory isn't held until the next frame
+        gpDevice->flushAndSync();
+        return createInstances(model, geometryIndices);
+    }
+}
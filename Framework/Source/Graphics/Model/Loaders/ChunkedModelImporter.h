@@ -0,0 +1,115 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include "Utils/MappedFileStream.h"
+#include "Graphics/Model/Loaders/ChunkedModelSpec.h"
+#include "Graphics/Model/Loaders/ModelImporter.h"
+#include "../Model.h"
+
+namespace Falcor
+{
+    /** Imports models stored in the chunked binary format, see ChunkedModelSpec.h.
+        The file is memory-mapped. Chunks are decompressed, validated and prepared in parallel, the GPU resources are created once all the chunks were decoded.
+        Typically, the user should use Model::createFromFile() or Model::createFromChunkedFile() to load a model instead of this class.
+    */
+    class ChunkedModelImporter : public ModelImporter
+    {
+    public:
+        /** Check if a file uses the chunked binary format
+            \param[in] fullpath The full path of the file
+        */
+        static bool isChunkedFile(const std::string& fullpath);
+
+        /** Import a model
+            \param[out] model Model object to load into
+            \param[in] filename Model's filename. Can include a full path or a relative path from a data directory
+            \param[in] flags Flags controlling model creation
+            \param[in] geometrySubset Indices of the geometry chunks to load. Only the instances, materials and textures used by these chunks are loaded. If empty, everything is loaded.
+            \return Whether import succeeded
+        */
+        static bool import(Model& model, const std::string& filename, Model::LoadFlags flags, const std::vector<uint32_t>& geometrySubset = {});
+
+    private:
+        ChunkedModelImporter(const std::string& fullpath, Model::LoadFlags flags);
+        ChunkedModelImporter(const ChunkedModelImporter&) = delete;
+        void operator=(const ChunkedModelImporter&) = delete;
+
+        /** A chunk after decompression
+        */
+        struct DecodedChunk
+        {
+            const uint8_t* pData = nullptr;     ///< Points into the file mapping for uncompressed chunks, otherwise into storage
+            size_t size = 0;
+            std::vector<uint8_t> storage;
+        };
+
+        /** CPU-side data of a geometry chunk, prepared in parallel with the other chunks
+        */
+        struct GeometryData
+        {
+            const GeometryChunkHeader* pHeader = nullptr;
+            const VertexAttribDesc* pAttribs = nullptr;
+            const SubmeshDesc* pSubmeshes = nullptr;
+            std::vector<ResourceFormat> attribFormats;
+            std::vector<glm::vec3> bitangents;                  ///< Generated bitangents. Empty if the chunk has bitangents or they weren't generated.
+            std::vector<std::vector<uint32_t>> adjacency;       ///< Per submesh indices with adjacency. Empty if adjacency wasn't requested.
+            std::vector<Mesh::SharedPtr> meshes;                ///< One per submesh
+        };
+
+        bool importModel(Model& model, const std::vector<uint32_t>& geometrySubset);
+        bool readToc();
+        bool decodeChunks(const std::vector<uint32_t>& chunks);
+        bool decodeChunk(uint32_t chunkIndex);
+        bool prepareGeometry(uint32_t geometryIndex);
+        void generateTangents(GeometryData& geometry);
+        bool parseMaterials();
+        Texture::SharedPtr createTexture(uint32_t textureIndex);
+        Material::SharedPtr createMaterial(uint32_t materialIndex);
+        void createMeshes(GeometryData& geometry);
+        bool createInstances(Model& model, const std::vector<uint32_t>& geometryIndices);
+
+        std::string mModelName;
+        Model::LoadFlags mFlags;
+        MappedFileStream mStream;
+
+        std::vector<ChunkTocEntry> mToc;
+        std::vector<DecodedChunk> mChunks;              ///< Indexed like mToc
+        std::vector<uint32_t> mTextureChunks;           ///< TOC index of each texture
+        std::vector<uint32_t> mGeometryChunks;          ///< TOC index of each geometry chunk
+        uint32_t mMaterialsChunk = kInvalidChunkIndex;
+        uint32_t mInstancesChunk = kInvalidChunkIndex;
+
+        const MaterialDesc* mpMaterials = nullptr;
+        uint32_t mMaterialCount = 0;
+        std::vector<GeometryData> mGeometry;            ///< Indexed like mGeometryChunks
+        std::vector<Texture::SharedPtr> mTextures;      ///< Indexed like mTextureChunks
+        std::vector<Material::SharedPtr> mMaterials;
+    };
+}
@@ -0,0 +1,204 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <cstdint>
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "glm/mat4x4.hpp"
+
+//------------------------------------------------------------------------
+/*
+
+Chunked binary scene file format v1
+-----------------------------------
+
+A chunked successor of the sequential BinScene format (see BinaryModelSpec.h). The file starts with a header and a table of contents (TOC),
+which lists every chunk with its offset, size, compression and content hash. Chunks can be located, decoded and validated independently,
+so they can be decoded in parallel and a reader can load only the geometry it needs.
+
+- All values are little-endian. Offsets and sizes are in bytes.
+- Every chunk starts at a multiple of ChunkedFileHeader::chunkAlignment from the start of the file.
+- Sections inside a chunk start at multiples of kChunkSectionAlignment from the start of the chunk. Uncompressed chunks can be used straight from a file mapping.
+- The content hash is the XXH64 (seed 0) of the uncompressed chunk.
+- Chunks of the same type are numbered in TOC order. Texture indices refer to the texture chunks, geometry indices to the geometry chunks.
+- A file has at most one materials chunk and one instances chunk.
+
+File
+    ChunkedFileHeader
+    ChunkTocEntry[chunkCount]           (at tocOffset)
+    Chunks
+
+Texture chunk
+    TextureChunkHeader
+    char[nameLength]                    The source filename, not null-terminated
+    Texel data of mip level 0           (at dataOffset)
+
+Materials chunk
+    MaterialDesc[]                      (chunk size / sizeof(MaterialDesc))
+
+Geometry chunk
+    Vertex buffers shared by all its submeshes, each submesh has its own index buffer and material.
+    GeometryChunkHeader
+    VertexAttribDesc[attribCount]
+    SubmeshDesc[submeshCount]
+    Vertex data                         One non-interleaved array per attribute (at VertexAttribDesc::dataOffset)
+    Index data                          32-bit indices (at SubmeshDesc::indexOffset)
+
+Instances chunk
+    InstanceDesc[]                      (chunk size / sizeof(InstanceDesc))
+*/
+//------------------------------------------------------------------------
+
+namespace Falcor
+{
+    static const char kChunkedFileMagic[8] = { 'B', 'i', 'n', 'C', 'h', 'u', 'n', 'k' };
+    static const uint32_t kChunkedFileVersion = 1;
+    static const uint32_t kDefaultChunkAlignment = 64;
+    static const uint32_t kChunkSectionAlignment = 16;
+    static const uint32_t kInvalidChunkIndex = uint32_t(-1);
+
+    enum class ChunkType : uint32_t
+    {
+        Texture = 1,
+        Materials = 2,
+        Geometry = 3,
+        Instances = 4,
+    };
+
+    enum class ChunkCompression : uint32_t
+    {
+        None = 0,
+        LZ4 = 1,        ///< LZ4 block format
+    };
+
+    struct ChunkedFileHeader
+    {
+        char magic[8];                  ///< kChunkedFileMagic
+        uint32_t version;               ///< kChunkedFileVersion
+        uint32_t chunkAlignment;
+        uint32_t chunkCount;
+        uint32_t reserved;
+        uint64_t tocOffset;
+    };
+    static_assert(sizeof(ChunkedFileHeader) == 32, "ChunkedFileHeader has the wrong size");
+
+    struct ChunkTocEntry
+    {
+        ChunkType type;
+        ChunkCompression compression;
+        uint64_t offset;                ///< Offset of the stored chunk from the start of the file
+        uint64_t storedSize;            ///< The size in the file
+        uint64_t size;                  ///< The uncompressed size
+        uint64_t hash;                  ///< XXH64 of the uncompressed chunk
+    };
+    static_assert(sizeof(ChunkTocEntry) == 40, "ChunkTocEntry has the wrong size");
+
+    struct TextureChunkHeader
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t nameLength;
+        uint32_t reserved;
+        char format[32];                ///< The ResourceFormat name, see to_string(ResourceFormat). Names are stable across Falcor versions, enum values aren't.
+        uint64_t dataOffset;
+        uint64_t dataSize;
+    };
+    static_assert(sizeof(TextureChunkHeader) == 64, "TextureChunkHeader has the wrong size");
+
+    /** Material texture slots
+    */
+    enum MaterialTextureSlot : uint32_t
+    {
+        MaterialTextureSlot_BaseColor,
+        MaterialTextureSlot_Specular,
+        MaterialTextureSlot_Emissive,
+        MaterialTextureSlot_Normal,
+        MaterialTextureSlot_Occlusion,
+        MaterialTextureSlot_LightMap,
+        MaterialTextureSlot_Height,
+        MaterialTextureSlot_Count
+    };
+
+    struct MaterialDesc
+    {
+        char name[64];
+        glm::vec4 baseColor;
+        glm::vec4 specular;
+        glm::vec3 emissive;
+        float alphaThreshold;
+        float heightScale;
+        float heightOffset;
+        float indexOfRefraction;
+        uint32_t shadingModel;
+        uint32_t alphaMode;
+        uint32_t doubleSided;
+        int32_t textures[MaterialTextureSlot_Count];     ///< Texture indices, -1 if the slot is empty
+        uint32_t reserved[3];
+    };
+    static_assert(sizeof(MaterialDesc) == 176, "MaterialDesc has the wrong size");
+
+    struct GeometryChunkHeader
+    {
+        uint32_t vertexCount;
+        uint32_t attribCount;
+        uint32_t submeshCount;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(GeometryChunkHeader) == 16, "GeometryChunkHeader has the wrong size");
+
+    struct VertexAttribDesc
+    {
+        char semanticName[32];
+        char format[32];                ///< The ResourceFormat name
+        uint32_t shaderLocation;
+        uint32_t reserved;
+        uint64_t dataOffset;            ///< Offset of the attribute array from the start of the chunk. The array is vertexCount * getFormatBytesPerBlock(format) bytes.
+    };
+    static_assert(sizeof(VertexAttribDesc) == 80, "VertexAttribDesc has the wrong size");
+
+    struct SubmeshDesc
+    {
+        uint32_t materialIndex;
+        uint32_t topology;              ///< Vao::Topology
+        uint32_t indexCount;
+        uint32_t reserved;
+        uint64_t indexOffset;           ///< Offset of the index array from the start of the chunk
+        glm::vec3 boundingBoxMin;
+        glm::vec3 boundingBoxMax;
+    };
+    static_assert(sizeof(SubmeshDesc) == 48, "SubmeshDesc has the wrong size");
+
+    struct InstanceDesc
+    {
+        uint32_t geometryIndex;
+        uint32_t submeshIndex;
+        uint32_t reserved[2];
+        glm::mat4 transform;
+    };
+    static_assert(sizeof(InstanceDesc) == 80, "InstanceDesc has the wrong size");
+}
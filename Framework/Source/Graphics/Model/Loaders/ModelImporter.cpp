@@ -28,9 +28,74 @@
 
 #include "Framework.h"
 #include "Graphics/Model/Loaders/ModelImporter.h"
+#include "Utils/TaskScheduler.h"
 
 namespace Falcor
 {
+    static const uint64_t kEmptyEdge = uint64_t(-1);
+    static const size_t kAdjacencyGrainSize = 16384;
+
+    static uint64_t makeEdgeKey(uint32_t from, uint32_t to)
+    {
+        return (uint64_t(from) << 32) | to;
+    }
+
+    static size_t hashEdge(uint64_t key, uint32_t shift)
+    {
+        return size_t((key * 0x9E3779B97F4A7C15ull) >> shift);
+    }
+
+    std::vector<uint32_t> ModelImporter::generateAdjacencyIndices(const std::vector<uint32_t>& indices)
+    {
+        const size_t triangleCount = indices.size() / 3;
+
+        // Keep the load factor at or below 50%
+        uint32_t log2Size = 4;
+        while ((size_t(1) << log2Size) < triangleCount * 3 * 2) log2Size++;
+        const size_t tableMask = (size_t(1) << log2Size) - 1;
+        const uint32_t shift = 64 - log2Size;
+        std::vector<uint64_t> edges(tableMask + 1, kEmptyEdge);
+        std::vector<uint32_t> opposite(tableMask + 1);
+
+        // Map each directed edge to the vertex opposite to it. For non-manifold edges, the first triangle wins
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            const uint32_t* pTri = indices.data() + t * 3;
+            for (uint32_t e = 0; e < 3; e++)
+            {
+                uint64_t key = makeEdgeKey(pTri[e], pTri[(e + 1) % 3]);
+                size_t slot = hashEdge(key, shift);
+                while (edges[slot] != kEmptyEdge && edges[slot] != key) slot = (slot + 1) & tableMask;
+                if (edges[slot] == kEmptyEdge)
+                {
+                    edges[slot] = key;
+                    opposite[slot] = pTri[(e + 2) % 3];
+                }
+            }
+        }
+
+        // The neighbor across an edge is the triangle which has the same edge in the opposite direction
+        std::vector<uint32_t> adjIndices(triangleCount * 6);
+        TaskScheduler::instance().parallelFor(0, triangleCount, [&](size_t begin, size_t end)
+        {
+            for (size_t t = begin; t < end; t++)
+            {
+                const uint32_t* pTri = indices.data() + t * 3;
+                uint32_t* pAdj = adjIndices.data() + t * 6;
+                for (uint32_t e = 0; e < 3; e++)
+                {
+                    uint64_t key = makeEdgeKey(pTri[(e + 1) % 3], pTri[e]);
+                    size_t slot = hashEdge(key, shift);
+                    while (edges[slot] != kEmptyEdge && edges[slot] != key) slot = (slot + 1) & tableMask;
+                    pAdj[e * 2] = pTri[e];
+                    pAdj[e * 2 + 1] = (edges[slot] == key) ? opposite[slot] : uint32_t(-1);
+                }
+            }
+        }, kAdjacencyGrainSize);
+
+        return adjIndices;
+    }
+
     Material::SharedPtr ModelImporter::checkForExistingMaterial(const Material::SharedPtr& pMaterial)
     {
         // Check if the material already exists
@@ -37,6 +37,15 @@ namespace Falcor
     */
     class ModelImporter
     {
+    public:
+        /** Generate an index buffer for a triangle-list-with-adjacency topology.
+            For each edge of each triangle, the output contains the edge's first vertex followed by the vertex opposite to the edge in the neighboring triangle, or -1 if there is no neighbor.
+            Edges are matched using an open-addressing hash table, and the lookups are processed in parallel.
+            \param[in] indices The triangle-list indices
+            \return The adjacency indices. The size is twice the size of the input.
+        */
+        static std::vector<uint32_t> generateAdjacencyIndices(const std::vector<uint32_t>& indices);
+
     protected:
 
         // If a similar material already exists, will return the existing one. Otherwise, will cache the material in pMaterial and return it
@@ -29,8 +29,10 @@
 #include "Model.h"
 #include "Loaders/AssimpModelImporter.h"
 #include "Loaders/BinaryModelImporter.h"
+#include "Loaders/ChunkedModelImporter.h"
 #include "Loaders/BinaryModelExporter.h"
 #include "Utils/Platform/OS.h"
+#include "Utils/Platform/FileWatcher.h"
 #include "Mesh.h"
 #include "AnimationController.h"
 #include "Animation.h"
@@ -101,13 +103,7 @@ namespace Falcor
 
         if(res)
         {
-            pModel->calculateModelProperties();
-            pModel->setFilename(filename);
-
-            std::string name = getFilenameFromPath(filename);
-            size_t extPos = name.find_last_of('.');
-            name = (extPos == std::string::npos) ? name : name.substr(0, extPos);
-            pModel->setName(name);
+            pModel->onFileLoaded(filename);
         }
         else
         {
@@ -117,6 +113,32 @@ namespace Falcor
         return pModel;
     }
 
+    Model::SharedPtr Model::createFromChunkedFile(const char* filename, const std::vector<uint32_t>& geometrySubset, LoadFlags flags)
+    {
+        SharedPtr pModel = SharedPtr(new Model());
+        if(ChunkedModelImporter::import(*pModel, filename, flags, geometrySubset) == false)
+        {
+            return nullptr;
+        }
+
+        pModel->onFileLoaded(filename);
+        return pModel;
+    }
+
+    void Model::onFileLoaded(const char* filename)
+    {
+        calculateModelProperties();
+        setFilename(filename);
+
+        std::string name = getFilenameFromPath(filename);
+        size_t extPos = name.find_last_of('.');
+        name = (extPos == std::string::npos) ? name : name.substr(0, extPos);
+        setName(name);
+
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath)) FileWatcher::instance().watchDataFile(fullpath);
+    }
+
     Model::SharedPtr Model::create()
     {
         return SharedPtr(new Model());
@@ -235,6 +257,26 @@ namespace Falcor
         return changed;
     }
 
+    bool Model::animate(const std::vector<Model*>& models, double currentTime)
+    {
+        std::vector<AnimationController*> controllers;
+        controllers.reserve(models.size());
+        for (Model* pModel : models)
+        {
+            if (pModel->mpAnimationController) controllers.push_back(pModel->mpAnimationController.get());
+        }
+
+        if (controllers.empty()) return false;
+        AnimationController::animate(controllers, currentTime);
+
+        // Skinning touches GPU resources, so it stays on the calling thread
+        for (Model* pModel : models)
+        {
+            if (pModel->mpAnimationController) pModel->update();
+        }
+        return true;
+    }
+
     bool Model::hasAnimations() const
     {
         return (getAnimationsCount() != 0);
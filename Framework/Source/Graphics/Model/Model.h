@@ -72,6 +72,13 @@ namespace Falcor
         */
         static SharedPtr createFromFile(const char* filename, LoadFlags flags = LoadFlags::None);
 
+        /** Create a new model from a chunked binary file, loading only some of its geometry
+            \param[in] filename The file to load
+            \param[in] geometrySubset Indices of the geometry chunks to load. Only the materials, textures and instances they use are loaded.
+            \param[in] flags Flags controlling model creation
+        */
+        static SharedPtr createFromChunkedFile(const char* filename, const std::vector<uint32_t>& geometrySubset, LoadFlags flags = LoadFlags::None);
+
         static SharedPtr create();
 
         static const char* kSupportedFileFormatsStr;
@@ -162,7 +169,14 @@ namespace Falcor
         /** Animate the active animation. Use setActiveAnimation() to switch between different animations.
             \param[in] currentTime The current global time
         */
-        void animate(double currentTime);
+        bool animate(double currentTime);
+
+        /** Animate a list of models. The bone hierarchies of all the models are evaluated together in parallel.
+            \param[in] models The models to animate
+            \param[in] currentTime The current global time
+            \return true if any of the models changed
+        */
+        static bool animate(const std::vector<Model*>& models, double currentTime);
 
         /** Get the animation name from animation ID.
         */
@@ -267,6 +281,7 @@ namespace Falcor
         static uint32_t sModelCounter;
 
         void calculateModelProperties();
+        void onFileLoaded(const char* filename);
     };
 
     enum_class_operators(Model::LoadFlags);
@@ -321,6 +321,11 @@ namespace Falcor
 
         ParameterBlockReflection::BindLocation bindLoc = mpReflector->getResourceBinding(name);
         if (checkResourceIndices(bindLoc, descOffset, type, funcName) == false) return;
+        setResourceSrvUavCommon(bindLoc, descOffset, type, pResource);
+    }
+
+    void ParameterBlock::setResourceSrvUavCommon(const BindLocation& bindLoc, uint32_t descOffset, DescriptorSet::Type type, const Resource::SharedPtr& pResource)
+    {
         auto& desc = mAssignedResources[bindLoc.setIndex][bindLoc.rangeIndex][descOffset];
         if (desc.pResource == pResource) return;
 
@@ -523,6 +528,160 @@ namespace Falcor
         return getResourceSrvUavCommon<Texture>(name, pVar->getDescOffset(), type, "getTexture()");
     }
 
+    static ParameterBlock::VarHandle::Type getHandleTypeFromResource(const ReflectionResourceType* pType)
+    {
+        switch (pType->getType())
+        {
+        case ReflectionResourceType::Type::Texture:
+            return ParameterBlock::VarHandle::Type::Texture;
+        case ReflectionResourceType::Type::RawBuffer:
+            return ParameterBlock::VarHandle::Type::RawBuffer;
+        case ReflectionResourceType::Type::TypedBuffer:
+            return ParameterBlock::VarHandle::Type::TypedBuffer;
+        case ReflectionResourceType::Type::StructuredBuffer:
+            return ParameterBlock::VarHandle::Type::StructuredBuffer;
+        case ReflectionResourceType::Type::Sampler:
+            return ParameterBlock::VarHandle::Type::Sampler;
+        case ReflectionResourceType::Type::ConstantBuffer:
+            return ParameterBlock::VarHandle::Type::ConstantBuffer;
+        default:
+            should_not_get_here();
+            return ParameterBlock::VarHandle::Type::Invalid;
+        }
+    }
+
+    ParameterBlock::VarHandle ParameterBlock::getHandle(const std::string& name) const
+    {
+        VarHandle handle;
+
+        // Resources are bound by their name without the array indices
+        std::string resourceName = name;
+        uint32_t index;
+        while (parseArrayIndex(resourceName, resourceName, index)) {};
+        BindLocation bindLoc = mpReflector->getResourceBinding(resourceName);
+
+        if (bindLoc.setIndex != BindLocation::kInvalidLocation)
+        {
+            const ReflectionVar::SharedConstPtr pVar = mpReflector->getResource(name);
+            if (pVar == nullptr) return handle;
+            const auto& range = mAssignedResources[bindLoc.setIndex][bindLoc.rangeIndex];
+            if (pVar->getDescOffset() >= range.size())
+            {
+                logWarning("Array index out of range when creating a handle for '" + name + "'.");
+                return handle;
+            }
+            handle.type = getHandleTypeFromResource(pVar->getType()->unwrapArray()->asResourceType());
+            handle.arrayIndex = pVar->getDescOffset();
+            handle.setType = range[handle.arrayIndex].type;
+        }
+        else
+        {
+            // Not a resource. Look for a variable inside a constant buffer
+            const std::string cbName = name.substr(0, name.find_first_of(".["));
+            bindLoc = mpReflector->getResourceBinding(cbName);
+            const ReflectionVar::SharedConstPtr pCbVar = (bindLoc.setIndex != BindLocation::kInvalidLocation) ? mpReflector->getResource(cbName) : nullptr;
+            const ReflectionResourceType* pCbType = pCbVar ? pCbVar->getType()->asResourceType() : nullptr;
+            if (pCbType == nullptr || pCbType->getType() != ReflectionResourceType::Type::ConstantBuffer || name.size() == cbName.size() || name[cbName.size()] != '.')
+            {
+                logWarning("Can't find a resource or a constant buffer variable named '" + name + "'. Can't create a handle.");
+                return handle;
+            }
+
+            const ReflectionVar::SharedConstPtr pVar = pCbType->findMember(name.substr(cbName.size() + 1));
+            if (pVar == nullptr) return handle;
+            const ReflectionBasicType* pBasicType = pVar->getType()->asBasicType();
+            if (pBasicType == nullptr)
+            {
+                logWarning("'" + name + "' is not a basic-type variable. Can't create a handle.");
+                return handle;
+            }
+            handle.type = VarHandle::Type::Variable;
+            handle.setType = DescriptorSet::Type::Cbv;
+            handle.offset = pVar->getOffset();
+            handle.varType = pBasicType->getType();
+        }
+
+        handle.bindLocation = bindLoc;
+        handle.reflectionId = mpReflector->getId();
+        return handle;
+    }
+
+    bool ParameterBlock::checkHandle(const VarHandle& handle, VarHandle::Type type, const char* funcName) const
+    {
+        if (handle.isValid() == false)
+        {
+            logWarning(std::string("ParameterBlock::") + funcName + " was called with an invalid handle. Ignoring call.");
+            return false;
+        }
+        if (handle.reflectionId != mpReflector->getId())
+        {
+            logWarning(std::string("ParameterBlock::") + funcName + " - the handle was resolved against a different program version. Call getHandle() again. Ignoring call.");
+            return false;
+        }
+        if (handle.type != type)
+        {
+            logWarning(std::string("ParameterBlock::") + funcName + " - the handle points to a different type of variable. Ignoring call.");
+            return false;
+        }
+        return true;
+    }
+
+    ConstantBuffer* ParameterBlock::getHandleConstantBuffer(const VarHandle& handle, ReflectionBasicType::Type varType) const
+    {
+        if (checkHandle(handle, VarHandle::Type::Variable, "setVariable()") == false) return nullptr;
+        if (handle.varType != varType)
+        {
+            logError("Error when setting a variable using a handle. Type mismatch. Expecting " + to_string(handle.varType) + " but the user provided a " + to_string(varType));
+            return nullptr;
+        }
+        ConstantBuffer* pCB = static_cast<ConstantBuffer*>(mAssignedResources[handle.bindLocation.setIndex][handle.bindLocation.rangeIndex][handle.arrayIndex].pResource.get());
+        if (pCB == nullptr)
+        {
+            logWarning("ParameterBlock::setVariable() - no constant buffer is bound to the handle's location. Ignoring call.");
+        }
+        return pCB;
+    }
+
+    bool ParameterBlock::setConstantBuffer(const VarHandle& handle, const ConstantBuffer::SharedPtr& pCB)
+    {
+        if (checkHandle(handle, VarHandle::Type::ConstantBuffer, "setConstantBuffer()") == false) return false;
+        return setConstantBuffer(handle.bindLocation, handle.arrayIndex, pCB);
+    }
+
+    bool ParameterBlock::setTexture(const VarHandle& handle, const Texture::SharedPtr& pTexture)
+    {
+        if (checkHandle(handle, VarHandle::Type::Texture, "setTexture()") == false) return false;
+        setResourceSrvUavCommon(handle.bindLocation, handle.arrayIndex, handle.setType, pTexture);
+        return true;
+    }
+
+    bool ParameterBlock::setRawBuffer(const VarHandle& handle, const Buffer::SharedPtr& pBuf)
+    {
+        if (checkHandle(handle, VarHandle::Type::RawBuffer, "setRawBuffer()") == false) return false;
+        setResourceSrvUavCommon(handle.bindLocation, handle.arrayIndex, handle.setType, pBuf);
+        return true;
+    }
+
+    bool ParameterBlock::setTypedBuffer(const VarHandle& handle, const TypedBufferBase::SharedPtr& pBuf)
+    {
+        if (checkHandle(handle, VarHandle::Type::TypedBuffer, "setTypedBuffer()") == false) return false;
+        setResourceSrvUavCommon(handle.bindLocation, handle.arrayIndex, handle.setType, pBuf);
+        return true;
+    }
+
+    bool ParameterBlock::setStructuredBuffer(const VarHandle& handle, const StructuredBuffer::SharedPtr& pBuf)
+    {
+        if (checkHandle(handle, VarHandle::Type::StructuredBuffer, "setStructuredBuffer()") == false) return false;
+        setResourceSrvUavCommon(handle.bindLocation, handle.arrayIndex, handle.setType, pBuf);
+        return true;
+    }
+
+    bool ParameterBlock::setSampler(const VarHandle& handle, const Sampler::SharedPtr& pSampler)
+    {
+        if (checkHandle(handle, VarHandle::Type::Sampler, "setSampler()") == false) return false;
+        return setSampler(handle.bindLocation, handle.arrayIndex, pSampler);
+    }
+
     template<typename ViewType>
     Resource::SharedPtr getResourceFromView(const ViewType* pView)
     {
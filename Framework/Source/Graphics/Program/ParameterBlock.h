@@ -58,6 +58,35 @@ namespace Falcor
 
         using BindLocation = ParameterBlockReflection::BindLocation;
 
+        /** A pre-resolved reference to a variable or a resource in the block, created by getHandle().
+            Setting a value through a handle skips the name lookup and most of the validation, which are done once when the handle is resolved.
+            A handle is only valid for the reflection it was resolved against. When the program version changes, calls using old handles are ignored and the handles need to be resolved again.
+        */
+        struct VarHandle
+        {
+            enum class Type
+            {
+                Invalid,            ///> The name couldn't be resolved
+                Variable,           ///> A variable inside a constant buffer
+                ConstantBuffer,
+                Texture,
+                RawBuffer,
+                TypedBuffer,
+                StructuredBuffer,
+                Sampler,
+            };
+
+            Type type = Type::Invalid;                                              ///> The type tag
+            BindLocation bindLocation;                                              ///> The bind-location of the resource. For variables, the bind-location of the constant buffer containing the variable
+            uint32_t arrayIndex = 0;                                                ///> The resource array index, or 0 for non-arrays
+            DescriptorSet::Type setType = DescriptorSet::Type::Count;               ///> The descriptor type of the resource
+            size_t offset = ConstantBuffer::kInvalidOffset;                         ///> For variables, the byte offset inside the constant buffer
+            ReflectionBasicType::Type varType = ReflectionBasicType::Type::Unknown; ///> For variables, the type declared in the shader
+            uint64_t reflectionId = 0;                                              ///> The ID of the ParameterBlockReflection the handle was resolved against
+
+            bool isValid() const { return type != Type::Invalid; }
+        };
+
         /** Create a new object
         */
         static SharedPtr create(const ParameterBlockReflection::SharedConstPtr& pReflection, bool createBuffers);
@@ -201,6 +230,74 @@ namespace Falcor
         */
         Sampler::SharedPtr getSampler(const BindLocation& bindLocation, uint32_t arrayIndex) const;
 
+        /** Resolve a name into a handle which can be used for repeated sets.
+            The name can refer to a resource in the block, or to a variable inside one of the block's constant buffers ("gMaterial.baseColor").
+            \param[in] name The name of the resource or variable
+            \return A handle. If the name couldn't be resolved, the handle will be invalid
+        */
+        VarHandle getHandle(const std::string& name) const;
+
+        /** Check if a handle can be used with this block, meaning it was resolved against the block's reflection
+        */
+        bool isHandleCompatible(const VarHandle& handle) const { return handle.isValid() && handle.reflectionId == mpReflector->getId(); }
+
+        /** Set a variable using a handle.
+            The type of the value must match the declaration in the shader, otherwise the call is ignored
+            \param[in] handle A handle to a variable, created by getHandle()
+            \param[in] value The value to set
+            \return false if the call failed, otherwise true
+        */
+        template<typename T>
+        bool setVariable(const VarHandle& handle, const T& value)
+        {
+            ConstantBuffer* pCB = getHandleConstantBuffer(handle, getReflectionTypeFromCType<T>());
+            if (pCB == nullptr) return false;
+            pCB->setBlob(&value, handle.offset, sizeof(T));
+            return true;
+        }
+
+        /** Bind a constant buffer using a handle
+            \param[in] handle A handle to a constant buffer, created by getHandle()
+            \param[in] pCB The constant buffer object
+            \return false if the call failed, otherwise true
+        */
+        bool setConstantBuffer(const VarHandle& handle, const ConstantBuffer::SharedPtr& pCB);
+
+        /** Bind a texture using a handle
+            \param[in] handle A handle to a texture, created by getHandle()
+            \param[in] pTexture The texture object to bind
+            \return false if the call failed, otherwise true
+        */
+        bool setTexture(const VarHandle& handle, const Texture::SharedPtr& pTexture);
+
+        /** Bind a raw-buffer using a handle
+            \param[in] handle A handle to a raw-buffer, created by getHandle()
+            \param[in] pBuf The buffer object
+            \return false if the call failed, otherwise true
+        */
+        bool setRawBuffer(const VarHandle& handle, const Buffer::SharedPtr& pBuf);
+
+        /** Bind a typed buffer using a handle
+            \param[in] handle A handle to a typed buffer, created by getHandle()
+            \param[in] pBuf The buffer object
+            \return false if the call failed, otherwise true
+        */
+        bool setTypedBuffer(const VarHandle& handle, const TypedBufferBase::SharedPtr& pBuf);
+
+        /** Bind a structured buffer using a handle
+            \param[in] handle A handle to a structured buffer, created by getHandle()
+            \param[in] pBuf The buffer object
+            \return false if the call failed, otherwise true
+        */
+        bool setStructuredBuffer(const VarHandle& handle, const StructuredBuffer::SharedPtr& pBuf);
+
+        /** Bind a sampler using a handle
+            \param[in] handle A handle to a sampler, created by getHandle()
+            \param[in] pSampler The sampler object to bind
+            \return false if the call failed, otherwise true
+        */
+        bool setSampler(const VarHandle& handle, const Sampler::SharedPtr& pSampler);
+
         /** Get the program reflection interface
         */
         ParameterBlockReflection::SharedConstPtr getReflection() const { return mpReflector; }
@@ -257,6 +354,9 @@ namespace Falcor
 
         std::vector<RootSet> mRootSets;
         void setResourceSrvUavCommon(std::string name, uint32_t descOffset, DescriptorSet::Type type, const Resource::SharedPtr& pResource, const std::string& funcName);
+        void setResourceSrvUavCommon(const BindLocation& bindLoc, uint32_t descOffset, DescriptorSet::Type type, const Resource::SharedPtr& pResource);
+        bool checkHandle(const VarHandle& handle, VarHandle::Type type, const char* funcName) const;
+        ConstantBuffer* getHandleConstantBuffer(const VarHandle& handle, ReflectionBasicType::Type varType) const;
         template<typename ResourceType>
         typename ResourceType::SharedPtr getResourceSrvUavCommon(const std::string& name, uint32_t descOffset, DescriptorSet::Type type, const std::string& funcName) const;
     };
@@ -28,6 +28,8 @@
 #include "Framework.h"
 #include "Program.h"
 #include <vector>
+#include <atomic>
+#include <mutex>
 #include "glm/gtc/type_ptr.hpp"
 #include "Graphics/TextureHelper.h"
 #include "Utils/Platform/OS.h"
@@ -38,6 +40,8 @@
 #include "API/RenderContext.h"
 #include "Utils/StringUtils.h"
 #include "ShaderLibrary.h"
+#include "ShaderCache.h"
+#include "Utils/TaskScheduler.h"
 
 namespace Falcor
 {
@@ -158,6 +162,7 @@ namespace Falcor
 
     // Program
     std::vector<Program*> Program::sPrograms;
+    std::atomic<bool> Program::sFilesChanged = { false };
 
     Program::Program()
     {
@@ -172,6 +177,8 @@ namespace Falcor
 
     Program::~Program()
     {
+        unwatchFiles();
+
         // Remove the current program from the program vector
         for(auto it = sPrograms.begin() ; it != sPrograms.end() ; it++)
         {
@@ -321,15 +328,43 @@ namespace Falcor
         return false;
     }
 
+    void Program::watchFile(const std::string& path) const
+    {
+        if (mFileSubscriptions.find(path) != mFileSubscriptions.end()) return;
+
+        // The callback is called from the watcher thread. unwatchFiles() makes sure it isn't called after the program is destroyed.
+        FileWatcher::SubscriptionID id = FileWatcher::instance().subscribe(path, [this](const std::string&)
+        {
+            mFilesChanged = true;
+            sFilesChanged = true;
+        });
+        if (id == FileWatcher::kInvalidSubscription) mPollFiles = true;
+        mFileSubscriptions[path] = id;
+    }
+
+    void Program::unwatchFiles()
+    {
+        for (const auto& s : mFileSubscriptions)
+        {
+            if (s.second != FileWatcher::kInvalidSubscription) FileWatcher::instance().unsubscribe(s.second);
+        }
+        mFileSubscriptions.clear();
+        mFilesChanged = false;
+        mPollFiles = false;
+    }
+
     bool Program::checkIfFilesChanged()
     {
-        if(mActiveProgram.pVersion == nullptr)
+        if(mActiveProgram.pVersion == nullptr && mFailedVersions.empty())
         {
             // We never linked, so nothing really changed
             return false;
         }
 
-        // Have any of the files we depend on changed?
+        if (mFilesChanged.exchange(false)) return true;
+        if (mPollFiles == false) return false;
+
+        // Some of the files can't be watched. Have any of the files we depend on changed?
         for(auto& entry : mFileTimeMap)
         {
             auto& path = entry.first;
@@ -345,9 +380,38 @@ namespace Falcor
 
     ProgramVersion::SharedConstPtr Program::getActiveVersion() const
     {
+        if (mPendingVersions.size()) updatePendingVersions(false);
+
         if(mLinkRequired)
         {
-            const auto& it = mProgramVersions.find(mDefineList);
+            auto it = mProgramVersions.find(mDefineList);
+            if(it == mProgramVersions.end())
+            {
+                // In async mode, compile the new version in the background and keep using the fallback or the previous version until it's ready.
+                // If there's no version we can use, we have to block.
+                if (mAsyncCompilation)
+                {
+                    if (mHasFallback)
+                    {
+                        const auto& fallbackIt = mProgramVersions.find(mFallbackDefines);
+                        if (fallbackIt != mProgramVersions.end()) mActiveProgram = fallbackIt->second;
+                    }
+
+                    if (mActiveProgram.pVersion)
+                    {
+                        compileAsync(mDefineList);
+                        return mActiveProgram.pVersion;
+                    }
+                }
+
+                // If the version is already compiled in the background, wait for it
+                if (mPendingVersions.find(mDefineList) != mPendingVersions.end())
+                {
+                    updatePendingVersions(true);
+                    it = mProgramVersions.find(mDefineList);
+                }
+            }
+
             if(it == mProgramVersions.end())
             {
                 if(link() == false)
@@ -361,24 +425,47 @@ namespace Falcor
             }
             else
             {
-                mActiveProgram = mProgramVersions[mDefineList];
+                mActiveProgram = it->second;
             }
         }
 
         return mActiveProgram.pVersion;
     }
 
+    // Slang sessions are not thread-safe, so every thread which compiles programs uses its own session.
+    // Builtins are recorded and added to each session the first time the thread uses it
+    static std::mutex sSlangBuiltinsMutex;
+    static std::vector<std::pair<std::string, std::string>> sSlangBuiltins;
+
+    // Destroys the thread's session when the thread exits. Worker threads exit when TaskScheduler::shutdown() joins them
+    struct SlangSessionOwner
+    {
+        ~SlangSessionOwner() { if (pSession) spDestroySession(pSession); }
+        SlangSession* pSession = nullptr;
+        size_t builtinsAdded = 0;
+    };
+
     SlangSession* getSlangSession()
     {
-        // TODO: figure out a strategy for finalizing the Slang session, if desired
+        thread_local SlangSessionOwner owner;
+        if (owner.pSession == nullptr) owner.pSession = spCreateSession(NULL);
 
-        static SlangSession* slangSession = spCreateSession(NULL);
-        return slangSession;
+        std::lock_guard<std::mutex> lock(sSlangBuiltinsMutex);
+        for (; owner.builtinsAdded < sSlangBuiltins.size(); owner.builtinsAdded++)
+        {
+            const auto& builtin = sSlangBuiltins[owner.builtinsAdded];
+            spAddBuiltins(owner.pSession, builtin.first.c_str(), builtin.second.c_str());
+        }
+        return owner.pSession;
     }
 
     void loadSlangBuiltins(char const* name, char const* text)
     {
-        spAddBuiltins(getSlangSession(), name, text);
+        {
+            std::lock_guard<std::mutex> lock(sSlangBuiltinsMutex);
+            sSlangBuiltins.push_back({ name, text });
+        }
+        getSlangSession();
     }
 
     // Translation a Falcor `ShaderType` to the corresponding `SlangStage`
@@ -417,9 +504,156 @@ namespace Falcor
 #endif
     }
 
-    Program::VersionData Program::preprocessAndCreateProgramVersion(std::string& log) const
+    // Bump this when upgrading Slang or changing the way programs are compiled, to invalidate existing shader cache entries
+    static const uint32_t kShaderCacheVersion = 1;
+
+    // ISlangBlob implementation for code loaded from the shader cache
+    class CachedShaderBlob : public ISlangBlob
     {
-        mFileTimeMap.clear();
+    public:
+        CachedShaderBlob(std::vector<uint8_t>&& data) : mData(std::move(data)) {}
+        virtual ~CachedShaderBlob() = default;
+
+        SLANG_NO_THROW SlangResult SLANG_MCALL queryInterface(SlangUUID const& uuid, void** ppObject) override { *ppObject = nullptr; return SLANG_E_NO_INTERFACE; }
+        SLANG_NO_THROW uint32_t SLANG_MCALL addRef() override { return ++mRefCount; }
+        SLANG_NO_THROW uint32_t SLANG_MCALL release() override
+        {
+            uint32_t refCount = --mRefCount;
+            if (refCount == 0) delete this;
+            return refCount;
+        }
+        SLANG_NO_THROW void const* SLANG_MCALL getBufferPointer() override { return mData.data(); }
+        SLANG_NO_THROW size_t SLANG_MCALL getBufferSize() override { return mData.size(); }
+    private:
+        std::atomic<uint32_t> mRefCount{ 0 };
+        std::vector<uint8_t> mData;
+    };
+
+    Program::CompileJob Program::createCompileJob(const DefineList& defines) const
+    {
+        // Resolve everything which depends on global state here, so that compile() doesn't need to access it
+        CompileJob job;
+        job.desc = mDesc;
+        job.defines = defines;
+        job.searchPaths = getDataDirectoriesList();
+        for (const auto& src : mDesc.mSources)
+        {
+            std::string fullpath;
+            if (src.type == Desc::Source::Type::File) findFileInDataDirectories(src.pLibrary->getFilename(), fullpath);
+            job.sourcePaths.push_back(fullpath);
+        }
+
+        // We skip the shader cache when dumping intermediates, since the user wants to see the compiler output
+        bool dumpIR = is_set(mDesc.getCompilerFlags(), Shader::CompilerFlags::DumpIntermediates);
+        if (ShaderCache::isEnabled() == false || dumpIR) return job;
+
+        // Everything that affects the compiler output must be part of the key. The content of the source files and their includes is validated by the cache itself.
+        std::string& key = job.cacheKey;
+        key = "Version " + std::to_string(kShaderCacheVersion) + "\n";
+#ifdef FALCOR_VK
+        key += "API FALCOR_VK\n";
+#elif defined FALCOR_D3D12
+        key += "API FALCOR_D3D12\n";
+#endif
+        key += "Profile " + getSlangProfileString(mDesc.mShaderModel) + "\n";
+        key += "Flags " + std::to_string((uint32_t)mDesc.getCompilerFlags()) + "\n";
+        for (const auto& path : job.searchPaths)
+        {
+            key += "SearchPath " + path + "\n";
+        }
+
+        for (size_t i = 0; i < mDesc.mSources.size(); i++)
+        {
+            const auto& src = mDesc.mSources[i];
+            if (src.type == Desc::Source::Type::File)
+            {
+                key += "File " + job.sourcePaths[i] + "\n";
+            }
+            else
+            {
+                key += "String " + std::to_string(src.str.size()) + "\n" + src.str + "\n";
+            }
+        }
+
+        for (uint32_t i = 0; i < kShaderCount; i++)
+        {
+            const auto& entryPoint = mDesc.mEntryPoints[i];
+            if (entryPoint.index < 0) continue;
+            key += "EntryPoint " + std::to_string(i) + " " + std::to_string(entryPoint.index) + " " + entryPoint.name + "\n";
+        }
+
+        for (const auto& define : defines)
+        {
+            key += "Define " + define.first + "=" + define.second + "\n";
+        }
+        return job;
+    }
+
+    bool Program::loadFromShaderCache(const CompileJob& job, CompileResult& result)
+    {
+        ShaderCache::Entry entry;
+        if (ShaderCache::load(job.cacheKey, entry) == false) return false;
+        if (entry.code.size() != kShaderCount || entry.reflection.size() != 3) return false;
+
+        ProgramReflectors& reflectors = result.reflectors;
+        reflectors.pReflector = ProgramReflection::deserialize(entry.reflection[0]);
+        reflectors.pLocalReflector = ProgramReflection::deserialize(entry.reflection[1]);
+        reflectors.pGlobalReflector = ProgramReflection::deserialize(entry.reflection[2]);
+        if (!reflectors.pReflector || !reflectors.pLocalReflector || !reflectors.pGlobalReflector)
+        {
+            logWarning("Invalid reflection data in the shader cache. The program will be recompiled");
+            reflectors = ProgramReflectors();
+            return false;
+        }
+
+        for (uint32_t i = 0; i < kShaderCount; i++)
+        {
+            if (entry.code[i].size()) result.shaderBlob[i] = Shader::Blob(new CachedShaderBlob(std::move(entry.code[i])));
+        }
+
+        for (const auto& dep : entry.dependencies)
+        {
+            result.fileTimeMap[dep.path] = getFileModifiedTime(dep.path);
+        }
+        result.loadedFromCache = true;
+        return true;
+    }
+
+    void Program::storeInShaderCache(const CompileJob& job, const CompileResult& result)
+    {
+        ShaderCache::Entry entry;
+        for (const auto& file : result.fileTimeMap)
+        {
+            entry.dependencies.push_back({ file.first, ShaderCache::hashFile(file.first) });
+        }
+
+        entry.code.resize(kShaderCount);
+        for (uint32_t i = 0; i < kShaderCount; i++)
+        {
+            const Shader::Blob& blob = result.shaderBlob[i];
+            if (blob)
+            {
+                const uint8_t* pCode = (const uint8_t*)blob->getBufferPointer();
+                entry.code[i].assign(pCode, pCode + blob->getBufferSize());
+            }
+        }
+
+        entry.reflection.resize(3);
+        result.reflectors.pReflector->serialize(entry.reflection[0]);
+        result.reflectors.pLocalReflector->serialize(entry.reflection[1]);
+        result.reflectors.pGlobalReflector->serialize(entry.reflection[2]);
+        ShaderCache::store(job.cacheKey, entry);
+    }
+
+    Program::CompileResult Program::compile(const CompileJob& job)
+    {
+        CompileResult result;
+
+        // Look for the compiled program in the shader cache
+        if (job.cacheKey.size() && loadFromShaderCache(job, result))
+        {
+            return result;
+        }
 
         // Run all of the shaders through Slang, so that we can get final code,
         // reflection data, etc.
@@ -436,18 +670,18 @@ namespace Falcor
         //
         // TODO: Slang should probably support a callback API for all file I/O,
         // rather than having us specify data directories to it...
-        for (auto path : getDataDirectoriesList())
+        for (const auto& path : job.searchPaths)
         {
             spAddSearchPath(slangRequest, path.c_str());
         }
 
         // Enable/disable intermediates dump
-        bool dumpIR = is_set(mDesc.getCompilerFlags(), Shader::CompilerFlags::DumpIntermediates);
+        bool dumpIR = is_set(job.desc.getCompilerFlags(), Shader::CompilerFlags::DumpIntermediates);
         spSetDumpIntermediates(slangRequest, dumpIR);
 
         // Pass any `#define` flags along to Slang, since we aren't doing our
         // own preprocessing any more.
-        for(auto shaderDefine : mDefineList)
+        for(auto shaderDefine : job.defines)
         {
             spAddPreprocessorDefine(slangRequest, shaderDefine.first.c_str(), shaderDefine.second.c_str());
         }
@@ -461,15 +695,15 @@ namespace Falcor
 #elif defined FALCOR_D3D12
         preprocessorDefine = "FALCOR_D3D";
         // If the profile string starts with a `4_` or a `5_`, use DXBC. Otherwise, use DXIL
-        if (hasPrefix(mDesc.mShaderModel, "4_") || hasPrefix(mDesc.mShaderModel, "5_")) slangTarget = SLANG_DXBC;
-        else                                                                            slangTarget = SLANG_DXIL;
+        if (hasPrefix(job.desc.mShaderModel, "4_") || hasPrefix(job.desc.mShaderModel, "5_")) slangTarget = SLANG_DXBC;
+        else                                                                                  slangTarget = SLANG_DXIL;
 #else
 #error unknown shader compilation target
 #endif
         spSetCodeGenTarget(slangRequest, slangTarget);
         spAddPreprocessorDefine(slangRequest, preprocessorDefine, "1");
 
-        spSetTargetProfile(slangRequest, 0, spFindProfile(slangSession, getSlangProfileString(mDesc.mShaderModel).c_str()));
+        spSetTargetProfile(slangRequest, 0, spFindProfile(slangSession, getSlangProfileString(job.desc.mShaderModel).c_str()));
 
         // We always use row-major matrix layout (and when we invoke fxc/dxc we pass in the
         // appropriate flags to request this behavior), so we need to inform Slang that
@@ -487,8 +721,10 @@ namespace Falcor
         // Now lets add all our input shader code, one-by-one
         int translationUnitsAdded = 0;
 
-        for(auto src : mDesc.mSources)
+        for(size_t s = 0; s < job.desc.mSources.size(); s++)
         {
+            const auto& src = job.desc.mSources[s];
+
             // Register the translation unit with Slang
             int translationUnitIndex = spAddTranslationUnit(slangRequest, SLANG_SOURCE_LANGUAGE_SLANG, nullptr);
             assert(translationUnitIndex == translationUnitsAdded);
@@ -502,9 +738,7 @@ namespace Falcor
                 {
                     logWarning("Compiling a shader file which is not a SLANG file or an HLSL file. This is not an error, but make sure that the file contains valid shaders");
                 }
-                std::string fullpath;
-                findFileInDataDirectories(src.pLibrary->getFilename(), fullpath);
-                spAddTranslationUnitSourceFile(slangRequest, translationUnitIndex, fullpath.c_str());
+                spAddTranslationUnitSourceFile(slangRequest, translationUnitIndex, job.sourcePaths[s].c_str());
             }
             else
             {
@@ -519,7 +753,7 @@ namespace Falcor
         // indices directly.
         for(uint32_t i = 0; i < kShaderCount; ++i)
         {
-            auto& entryPoint = mDesc.mEntryPoints[i];
+            auto& entryPoint = job.desc.mEntryPoints[i];
 
             // Skip unused entry points
             if(entryPoint.index < 0)
@@ -533,20 +767,32 @@ namespace Falcor
         }
 
         int anySlangErrors = spCompile(slangRequest);
-        log += spGetDiagnosticOutput(slangRequest);
+        result.log += spGetDiagnosticOutput(slangRequest);
+
+        // Extract list of files referenced, for dependency-tracking purposes. This is done for failed compilations too, so fixing the error triggers a recompilation
+        for (const auto& path : job.sourcePaths)
+        {
+            if (path.size()) result.fileTimeMap[path] = getFileModifiedTime(path);
+        }
+        int depFileCount = spGetDependencyFileCount(slangRequest);
+        for(int ii = 0; ii < depFileCount; ++ii)
+        {
+            std::string depFilePath = spGetDependencyFilePath(slangRequest, ii);
+            result.fileTimeMap[depFilePath] = getFileModifiedTime(depFilePath);
+        }
+
         if(anySlangErrors)
         {
             spDestroyCompileRequest(slangRequest);
-            return VersionData();
+            return result;
         }
 
         // Extract the generated code for each stage
         int entryPointCounter = 0;
-        Shader::Blob shaderBlob[kShaderCount];
 
         for (uint32_t i = 0; i < kShaderCount; i++)
         {
-            auto& entryPoint = mDesc.mEntryPoints[i];
+            auto& entryPoint = job.desc.mEntryPoints[i];
             // Skip unused entry points
             if(entryPoint.index < 0)
                 continue;
@@ -554,30 +800,54 @@ namespace Falcor
             int entryPointIndex = entryPointCounter++;
             int targetIndex = 0; // We always compile for a single target
 
-            spGetEntryPointCodeBlob(slangRequest, entryPointIndex, targetIndex, shaderBlob[i].writeRef());
+            spGetEntryPointCodeBlob(slangRequest, entryPointIndex, targetIndex, result.shaderBlob[i].writeRef());
         }
 
-        VersionData programVersion;
-
         // Extract the reflection data
-        programVersion.reflectors.pReflector = ProgramReflection::create(slang::ShaderReflection::get(slangRequest), ProgramReflection::ResourceScope::All, log);
-        programVersion.reflectors.pLocalReflector = ProgramReflection::create(slang::ShaderReflection::get(slangRequest), ProgramReflection::ResourceScope::Local, log);
-        programVersion.reflectors.pGlobalReflector = ProgramReflection::create(slang::ShaderReflection::get(slangRequest), ProgramReflection::ResourceScope::Global, log);
+        result.reflectors.pReflector = ProgramReflection::create(slang::ShaderReflection::get(slangRequest), ProgramReflection::ResourceScope::All, result.log);
+        result.reflectors.pLocalReflector = ProgramReflection::create(slang::ShaderReflection::get(slangRequest), ProgramReflection::ResourceScope::Local, result.log);
+        result.reflectors.pGlobalReflector = ProgramReflection::create(slang::ShaderReflection::get(slangRequest), ProgramReflection::ResourceScope::Global, result.log);
 
-        // Extract list of files referenced, for dependency-tracking purposes
-        int depFileCount = spGetDependencyFileCount(slangRequest);
-        for(int ii = 0; ii < depFileCount; ++ii)
+        spDestroyCompileRequest(slangRequest);
+        result.success = true;
+        return result;
+    }
+
+    Program::VersionData Program::createVersion(const CompileJob& job, CompileResult& result, std::string& log) const
+    {
+        VersionData programVersion;
+        std::string versionLog;
+        if (result.success || result.loadedFromCache)
         {
-            std::string depFilePath = spGetDependencyFilePath(slangRequest, ii);
-            mFileTimeMap[depFilePath] = getFileModifiedTime(depFilePath);
+            // Now that we've preprocessed things, dispatch to the actual program creation logic,
+            // which may vary in subclasses of `Program`
+            programVersion.reflectors = result.reflectors;
+            programVersion.pVersion = createProgramVersion(versionLog, result.shaderBlob, programVersion.reflectors);
         }
 
-        spDestroyCompileRequest(slangRequest);
+        if (programVersion.pVersion == nullptr && result.loadedFromCache)
+        {
+            // The cached code was rejected. Compile it again, this time without the cache
+            CompileJob uncachedJob = job;
+            uncachedJob.cacheKey.clear();
+            result = compile(uncachedJob);
+            return createVersion(job, result, log);
+        }
+
+        log += result.log + versionLog;
 
-        // Now that we've preprocessed things, dispatch to the actual program creation logic,
-        // which may vary in subclasses of `Program`
-        programVersion.pVersion = createProgramVersion(log, shaderBlob, programVersion.reflectors);
+        // The program versions can depend on different files, track all of them. Failed versions are tracked too, so they are compiled again once the files are fixed
+        for (const auto& file : result.fileTimeMap)
+        {
+            mFileTimeMap[file.first] = file.second;
+            watchFile(file.first);
+        }
+        if (programVersion.pVersion == nullptr) return VersionData();
 
+        if (result.loadedFromCache == false && job.cacheKey.size())
+        {
+            storeInShaderCache(job, result);
+        }
         return programVersion;
     }
 
@@ -615,11 +885,13 @@ namespace Falcor
 
     bool Program::link() const
     {
+        CompileJob job = createCompileJob(mDefineList);
         while(1)
         {
             // create the program
             std::string log;
-            VersionData programVersion = preprocessAndCreateProgramVersion(log);
+            CompileResult result = compile(job);
+            VersionData programVersion = createVersion(job, result, log);
 
             if(programVersion.pVersion == nullptr)
             {
@@ -646,11 +918,80 @@ namespace Falcor
         }
     }
 
+    void Program::compileAsync(const DefineList& defines) const
+    {
+        if (mProgramVersions.find(defines) != mProgramVersions.end()) return;
+        if (mPendingVersions.find(defines) != mPendingVersions.end()) return;
+        if (mFailedVersions.find(defines) != mFailedVersions.end()) return;
+
+        PendingVersion& pending = mPendingVersions[defines];
+        pending.pJob = std::make_shared<CompileJob>(createCompileJob(defines));
+        // The task only accesses the job, so it's OK if the program is destroyed before it finishes
+        std::shared_ptr<const CompileJob> pJob = pending.pJob;
+        pending.result = TaskScheduler::instance().async([pJob]() { return compile(*pJob); });
+    }
+
+    void Program::updatePendingVersions(bool wait) const
+    {
+        for (auto it = mPendingVersions.begin(); it != mPendingVersions.end();)
+        {
+            PendingVersion& pending = it->second;
+            if (wait == false && pending.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+
+            std::string log;
+            CompileResult result = pending.result.get();
+            VersionData version = createVersion(*pending.pJob, result, log);
+            if (version.pVersion)
+            {
+                mProgramVersions[it->first] = version;
+            }
+            else
+            {
+                // Don't block the caller with a message box. Remember the failure so that we don't retry every frame. The version will be compiled again after the files are modified.
+                logError("Program Linkage failed.\n\n" + getProgramDescString() + "\n" + log);
+                mFailedVersions.insert(it->first);
+            }
+            it = mPendingVersions.erase(it);
+        }
+    }
+
+    bool Program::precompile(const std::vector<DefineList>& defineLists, bool blocking)
+    {
+        for (const auto& defines : defineLists) compileAsync(defines);
+        if (blocking == false) return true;
+
+        updatePendingVersions(true);
+        for (const auto& defines : defineLists)
+        {
+            if (mProgramVersions.find(defines) == mProgramVersions.end()) return false;
+        }
+        return true;
+    }
+
+    void Program::setAsyncCompilation(bool enable)
+    {
+        mAsyncCompilation = enable;
+        if (enable == false) updatePendingVersions(true);
+    }
+
+    void Program::setFallbackDefines(const DefineList& dl)
+    {
+        mFallbackDefines = dl;
+        mHasFallback = true;
+    }
+
     void Program::reset()
     {
         mActiveProgram = VersionData();
         mProgramVersions.clear();
+        mPendingVersions.clear();
+        mFailedVersions.clear();
         mFileTimeMap.clear();
+        unwatchFiles();
         mLinkRequired = true;
     }
 
@@ -664,4 +1005,17 @@ namespace Falcor
             }
         }
     }
+
+    void Program::reloadModifiedPrograms()
+    {
+        if (sFilesChanged.exchange(false) == false) return;
+
+        for (auto& pProgram : sPrograms)
+        {
+            if ((pProgram->mActiveProgram.pVersion || pProgram->mFailedVersions.size()) && pProgram->mFilesChanged.exchange(false))
+            {
+                pProgram->reset();
+            }
+        }
+    }
 }
@@ -28,8 +28,12 @@
 #pragma once
 #include <string>
 #include <map>
+#include <set>
+#include <future>
+#include <atomic>
 #include <vector>
 #include "Graphics/Program//ProgramVersion.h"
+#include "Utils/Platform/FileWatcher.h"
 
 namespace Falcor
 {
@@ -262,10 +266,35 @@ namespace Falcor
         */
         virtual const DefineList& getDefines() const override { return mDefineList; }
 
-        /** Reload and relink all programs.
+        /** Reload and relink all programs whose files changed.
         */
         static void reloadAllPrograms();
 
+        /** Reload and relink the programs whose files changed, based only on the file watcher notifications. When nothing changed this is cheap enough to call every frame.
+        */
+        static void reloadModifiedPrograms();
+
+        /** Enable or disable asynchronous compilation.
+            When enabled, changing the defines doesn't block getActiveVersion(). The new version is compiled on a worker thread, and until it's ready getActiveVersion() returns the fallback version (see setFallbackDefines()) or the previous version. If neither exists, the call blocks.
+            Compilation errors of background versions are logged instead of displaying a message box.
+        */
+        void setAsyncCompilation(bool enable);
+
+        /** Check if asynchronous compilation is enabled
+        */
+        bool isAsyncCompilationEnabled() const { return mAsyncCompilation; }
+
+        /** Set the defines of the version to use while a new version is compiled asynchronously. The fallback is only used once it was compiled, usually by calling precompile().
+        */
+        void setFallbackDefines(const DefineList& dl);
+
+        /** Compile program versions in parallel on worker threads. Use it to warm up all the required permutations at load time.
+            \param[in] defineLists The macro definitions of each version.
+            \param[in] blocking If true, returns once all the versions are compiled. Otherwise, the versions are compiled in the background and become available to getActiveVersion() when they are ready.
+            \return In blocking mode, true if all the versions compiled successfully. Always true in non-blocking mode.
+        */
+        bool precompile(const std::vector<DefineList>& defineLists, bool blocking = true);
+
         deprecate("3.2", "Use setDefines({}) instead")
         bool clearDefines();
 
@@ -298,8 +327,39 @@ namespace Falcor
             ProgramReflectors reflectors;
         };
 
+        using string_time_map = std::unordered_map<std::string, time_t>;
+
+        /** Everything required to compile a program version. Compilation only accesses this data, so it can run on a worker thread.
+        */
+        struct CompileJob
+        {
+            Desc desc;
+            DefineList defines;
+            std::vector<std::string> searchPaths;
+            std::vector<std::string> sourcePaths;   // Full path of each source. Empty for string sources
+            std::string cacheKey;                   // The shader cache key. Empty if the cache is disabled
+        };
+
+        /** The shaders and reflection data generated by compile()
+        */
+        struct CompileResult
+        {
+            Shader::Blob shaderBlob[kShaderCount];
+            ProgramReflectors reflectors;
+            string_time_map fileTimeMap;
+            std::string log;
+            bool success = false;
+            bool loadedFromCache = false;
+        };
+
         bool link() const;
-        VersionData preprocessAndCreateProgramVersion(std::string& log) const;
+        CompileJob createCompileJob(const DefineList& defines) const;
+        static CompileResult compile(const CompileJob& job);
+        static bool loadFromShaderCache(const CompileJob& job, CompileResult& result);
+        static void storeInShaderCache(const CompileJob& job, const CompileResult& result);
+        VersionData createVersion(const CompileJob& job, CompileResult& result, std::string& log) const;
+        void compileAsync(const DefineList& defines) const;
+        void updatePendingVersions(bool wait) const;
         virtual ProgramVersion::SharedPtr createProgramVersion(std::string& log, const Shader::Blob shaderBlob[kShaderCount], const ProgramReflectors& reflectors) const;
 
         // The description used to create this program
@@ -312,12 +372,30 @@ namespace Falcor
         mutable std::map<const DefineList, VersionData> mProgramVersions;
         mutable VersionData mActiveProgram;
 
+        struct PendingVersion
+        {
+            std::shared_ptr<const CompileJob> pJob;
+            std::future<CompileResult> result;
+        };
+        mutable std::map<const DefineList, PendingVersion> mPendingVersions;
+        mutable std::set<DefineList> mFailedVersions;
+        bool mAsyncCompilation = false;
+        bool mHasFallback = false;
+        DefineList mFallbackDefines;
+
         std::string getProgramDescString() const;
         static std::vector<Program*> sPrograms;
 
-        using string_time_map = std::unordered_map<std::string, time_t>;
         mutable string_time_map mFileTimeMap;
 
+        // Subscriptions to changes of the files in mFileTimeMap
+        mutable std::unordered_map<std::string, FileWatcher::SubscriptionID> mFileSubscriptions;
+        mutable std::atomic<bool> mFilesChanged = { false };
+        mutable bool mPollFiles = false;    // True if some of the files can't be watched, so we have to check their modification time
+        static std::atomic<bool> sFilesChanged;
+
+        void watchFile(const std::string& path) const;
+        void unwatchFiles();
         bool checkIfFilesChanged();
         void reset();
     };
@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "ProgramReflection.h"
 #include "Utils/StringUtils.h"
+#include <atomic>
 using namespace slang;
 
 namespace Falcor
@@ -840,6 +841,8 @@ namespace Falcor
 
     ParameterBlockReflection::ParameterBlockReflection(const std::string& name) : mName(name)
     {
+        static std::atomic<uint64_t> sNextId(0);
+        mId = ++sNextId;
         mpResourceVars = ReflectionStructType::create(0, 0);
     }
 
@@ -973,6 +976,7 @@ namespace Falcor
         uint32_t elementCount = max(1u, pVar->getType()->getTotalArraySize());
         mResources.push_back(getResourceDesc(pVar, elementCount, pVar->getName()));
         mpResourceVars->addMember(pVar);
+        mAddedVars.push_back(pVar);
 
         // If this is a constant-buffer, it might contain resources. Extract them.
         const ReflectionType* pType = pResourceType->getStructType().get();
@@ -1458,4 +1462,279 @@ namespace Falcor
         const auto& offsetIt = mOffsetDescMap.find(offset);
         return (offsetIt == mOffsetDescMap.end()) ? empty : offsetIt->second;
     }
+
+    /** Helper class for ProgramReflection::serialize() and ProgramReflection::deserialize()
+        Parameter blocks are stored as the list of variables which were passed to addResource(). Deserialization replays the same calls, so all the derived data is recreated exactly like it was during reflection.
+    */
+    class ReflectionSerializer
+    {
+    public:
+        enum class TypeTag : uint8_t
+        {
+            Null,
+            Basic,
+            Array,
+            Struct,
+            Resource,
+        };
+
+        static const uint32_t kVersion = 1;
+
+        // Writer
+        ReflectionSerializer(std::vector<uint8_t>& data) : mpOut(&data) {}
+
+        template<typename T>
+        void write(const T& value)
+        {
+            const uint8_t* pBytes = (const uint8_t*)&value;
+            mpOut->insert(mpOut->end(), pBytes, pBytes + sizeof(T));
+        }
+
+        void write(const std::string& str)
+        {
+            write((uint32_t)str.size());
+            mpOut->insert(mpOut->end(), str.begin(), str.end());
+        }
+
+        void writeType(const ReflectionType* pType)
+        {
+            if (pType == nullptr)
+            {
+                write(TypeTag::Null);
+            }
+            else if (const ReflectionBasicType* pBasic = pType->asBasicType())
+            {
+                write(TypeTag::Basic);
+                write((uint64_t)pType->mOffset);
+                write(pBasic->getType());
+                write(pBasic->isRowMajor());
+                write((uint64_t)pBasic->getSize());
+            }
+            else if (const ReflectionArrayType* pArray = pType->asArrayType())
+            {
+                write(TypeTag::Array);
+                write((uint64_t)pType->mOffset);
+                write(pArray->getArraySize());
+                write(pArray->getArrayStride());
+                writeType(pArray->getType().get());
+            }
+            else if (const ReflectionStructType* pStruct = pType->asStructType())
+            {
+                write(TypeTag::Struct);
+                write((uint64_t)pType->mOffset);
+                write((uint64_t)pStruct->getSize());
+                write(pStruct->getName());
+                write(pStruct->getMemberCount());
+                for (const auto& pMember : *pStruct) writeVar(pMember.get());
+            }
+            else if (const ReflectionResourceType* pResource = pType->asResourceType())
+            {
+                write(TypeTag::Resource);
+                write(pResource->getType());
+                write(pResource->getDimensions());
+                write(pResource->getStructuredBufferType());
+                write(pResource->getReturnType());
+                write(pResource->getShaderAccess());
+                writeType(pResource->getStructType().get());
+            }
+            else
+            {
+                should_not_get_here();
+            }
+        }
+
+        void writeVar(const ReflectionVar* pVar)
+        {
+            write(pVar->getName());
+            writeType(pVar->getType().get());
+            write((uint64_t)pVar->getOffset());
+            write(pVar->getDescOffset());
+            write(pVar->getRegisterSpace());
+            write(pVar->getModifier());
+        }
+
+        void writeVariableMap(const ProgramReflection::VariableMap& map)
+        {
+            write((uint32_t)map.size());
+            for (const auto& v : map)
+            {
+                write(v.first);
+                write(v.second.bindLocation);
+                write(v.second.semanticName);
+                write(v.second.type);
+            }
+        }
+
+        void writeProgram(const ProgramReflection* pReflection)
+        {
+            write(kVersion);
+            write((uint32_t)pReflection->mpParameterBlocks.size());
+            for (const auto& pBlock : pReflection->mpParameterBlocks)
+            {
+                write(pBlock->mName);
+                write((uint32_t)pBlock->mAddedVars.size());
+                for (const auto& pVar : pBlock->mAddedVars) writeVar(pVar.get());
+            }
+            write(pReflection->mThreadGroupSize);
+            write(pReflection->mIsSampleFrequency);
+            writeVariableMap(pReflection->mPsOut);
+            writeVariableMap(pReflection->mVertAttr);
+            writeVariableMap(pReflection->mVertAttrBySemantic);
+        }
+
+        // Reader
+        ReflectionSerializer(const std::vector<uint8_t>& data) : mpIn(&data) {}
+
+        template<typename T>
+        bool read(T& value)
+        {
+            if (mReadOffset + sizeof(T) > mpIn->size()) return false;
+            std::memcpy(&value, mpIn->data() + mReadOffset, sizeof(T));
+            mReadOffset += sizeof(T);
+            return true;
+        }
+
+        bool read(std::string& str)
+        {
+            uint32_t size;
+            if (read(size) == false || mReadOffset + size > mpIn->size()) return false;
+            str.assign((const char*)mpIn->data() + mReadOffset, size);
+            mReadOffset += size;
+            return true;
+        }
+
+        bool readType(ReflectionType::SharedConstPtr& pType)
+        {
+            TypeTag tag;
+            if (read(tag) == false) return false;
+            uint64_t offset, size;
+            switch (tag)
+            {
+            case TypeTag::Null:
+                pType = nullptr;
+                return true;
+            case TypeTag::Basic:
+            {
+                ReflectionBasicType::Type type;
+                bool isRowMajor;
+                if ((read(offset) && read(type) && read(isRowMajor) && read(size)) == false) return false;
+                pType = ReflectionBasicType::create((size_t)offset, type, isRowMajor, (size_t)size);
+                return true;
+            }
+            case TypeTag::Array:
+            {
+                uint32_t arraySize, arrayStride;
+                ReflectionType::SharedConstPtr pElementType;
+                if ((read(offset) && read(arraySize) && read(arrayStride) && readType(pElementType)) == false) return false;
+                pType = ReflectionArrayType::create((size_t)offset, arraySize, arrayStride, pElementType);
+                return true;
+            }
+            case TypeTag::Struct:
+            {
+                std::string name;
+                uint32_t memberCount;
+                if ((read(offset) && read(size) && read(name) && read(memberCount)) == false) return false;
+                ReflectionStructType::SharedPtr pStruct = ReflectionStructType::create((size_t)offset, (size_t)size, name);
+                for (uint32_t i = 0; i < memberCount; i++)
+                {
+                    ReflectionVar::SharedConstPtr pMember;
+                    if (readVar(pMember) == false) return false;
+                    pStruct->addMember(pMember);
+                }
+                pType = pStruct;
+                return true;
+            }
+            case TypeTag::Resource:
+            {
+                ReflectionResourceType::Type type;
+                ReflectionResourceType::Dimensions dims;
+                ReflectionResourceType::StructuredType structuredType;
+                ReflectionResourceType::ReturnType retType;
+                ReflectionResourceType::ShaderAccess shaderAccess;
+                ReflectionType::SharedConstPtr pStructType;
+                if ((read(type) && read(dims) && read(structuredType) && read(retType) && read(shaderAccess) && readType(pStructType)) == false) return false;
+                ReflectionResourceType::SharedPtr pResource = ReflectionResourceType::create(type, dims, structuredType, retType, shaderAccess);
+                if (pStructType) pResource->setStructType(pStructType);
+                pType = pResource;
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        bool readVar(ReflectionVar::SharedConstPtr& pVar)
+        {
+            std::string name;
+            ReflectionType::SharedConstPtr pType;
+            uint64_t offset;
+            uint32_t descOffset, regSpace;
+            ReflectionVar::Modifier modifier;
+            if ((read(name) && readType(pType) && read(offset) && read(descOffset) && read(regSpace) && read(modifier)) == false) return false;
+            if (pType == nullptr) return false;
+            pVar = ReflectionVar::create(name, pType, (size_t)offset, descOffset, regSpace, modifier);
+            return true;
+        }
+
+        bool readVariableMap(ProgramReflection::VariableMap& map)
+        {
+            uint32_t count;
+            if (read(count) == false) return false;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                std::string name;
+                ProgramReflection::ShaderVariable var;
+                if ((read(name) && read(var.bindLocation) && read(var.semanticName) && read(var.type)) == false) return false;
+                map[name] = var;
+            }
+            return true;
+        }
+
+        bool readProgram(ProgramReflection* pReflection)
+        {
+            uint32_t version, blockCount;
+            if ((read(version) && version == kVersion && read(blockCount)) == false) return false;
+            for (uint32_t b = 0; b < blockCount; b++)
+            {
+                std::string name;
+                uint32_t varCount;
+                if ((read(name) && read(varCount)) == false) return false;
+                ParameterBlockReflection::SharedPtr pBlock = ParameterBlockReflection::create(name);
+                for (uint32_t v = 0; v < varCount; v++)
+                {
+                    ReflectionVar::SharedConstPtr pVar;
+                    if (readVar(pVar) == false) return false;
+                    if (pVar->getType()->unwrapArray()->asResourceType() == nullptr) return false;
+                    pBlock->addResource(pVar);
+                }
+                pBlock->finalize();
+                if (pReflection->mParameterBlocksIndices.find(name) != pReflection->mParameterBlocksIndices.end()) return false;
+                pReflection->addParameterBlock(pBlock);
+            }
+            if (pReflection->mpDefaultBlock == nullptr) return false;
+            pReflection->updateDefaultBlockResourceBindings();
+
+            bool valid = read(pReflection->mThreadGroupSize) && read(pReflection->mIsSampleFrequency);
+            valid = valid && readVariableMap(pReflection->mPsOut) && readVariableMap(pReflection->mVertAttr) && readVariableMap(pReflection->mVertAttrBySemantic);
+            return valid && (mReadOffset == mpIn->size());
+        }
+
+    private:
+        std::vector<uint8_t>* mpOut = nullptr;
+        const std::vector<uint8_t>* mpIn = nullptr;
+        size_t mReadOffset = 0;
+    };
+
+    void ProgramReflection::serialize(std::vector<uint8_t>& data) const
+    {
+        data.clear();
+        ReflectionSerializer(data).writeProgram(this);
+    }
+
+    ProgramReflection::SharedPtr ProgramReflection::deserialize(const std::vector<uint8_t>& data)
+    {
+        SharedPtr pReflection = SharedPtr(new ProgramReflection());
+        if (ReflectionSerializer(data).readProgram(pReflection.get()) == false) return nullptr;
+        return pReflection;
+    }
 }
@@ -39,6 +39,7 @@ namespace Falcor
     class ReflectionBasicType;
     class ReflectionStructType;
     class ReflectionArrayType;
+    class ReflectionSerializer;
 
     /** Base class for reflection types
     */
@@ -88,6 +89,7 @@ namespace Falcor
         virtual bool operator==(const ReflectionType& other) const = 0;
         virtual bool operator!=(const ReflectionType& other) const { return !(*this == other); }
     protected:
+        friend class ReflectionSerializer;
         ReflectionType(size_t offset) : mOffset(offset) {}
         size_t mOffset;
     };
@@ -521,6 +523,10 @@ namespace Falcor
         */
         const std::string& getName() const { return mName; }
 
+        /** Get an ID which is unique to this reflection object across the process lifetime. Reflection objects created for a new program version will always have a different ID
+        */
+        uint64_t getId() const { return mId; }
+
         /** Check if the block contains any resources
         */
         bool isEmpty() const;
@@ -547,12 +553,15 @@ namespace Falcor
         bool merge(const ParameterBlockReflection* pOther);
     private:
         friend class ProgramReflection;
+        friend class ReflectionSerializer;
         void addResource(const ReflectionVar::SharedConstPtr& pVar);
         void finalize();
         ParameterBlockReflection(const std::string& name);
         ResourceVec mResources;
         ReflectionStructType::SharedPtr mpResourceVars;
+        std::vector<ReflectionVar::SharedConstPtr> mAddedVars;  // The variables passed to addResource(), in order. Used for serialization
         std::string mName;
+        uint64_t mId;
         std::unordered_map<std::string, BindLocation> mResourceBindings;
 
         SetLayoutVec mSetLayouts;
@@ -649,7 +658,18 @@ namespace Falcor
         const ParameterBlockReflection::BindLocation translateRegisterIndicesToBindLocation(uint32_t regSpace, uint32_t baseRegIndex, BindType type) const { return mResourceBindMap.at({regSpace, baseRegIndex, type}); }
 
         bool merge(const ProgramReflection* pOther);
+
+        /** Serialize the object into a byte array. Used by the shader cache
+        */
+        void serialize(std::vector<uint8_t>& data) const;
+
+        /** Create a new object from data generated by serialize()
+            \return A new object, or nullptr if the data is invalid
+        */
+        static SharedPtr deserialize(const std::vector<uint8_t>& data);
     private:
+        friend class ReflectionSerializer;
+        ProgramReflection() = default;
         ProgramReflection(slang::ShaderReflection* pSlangReflector, ResourceScope scopeToReflect, std::string& log);
         void addParameterBlock(const ParameterBlockReflection::SharedConstPtr& pBlock);
         void updateDefaultBlockResourceBindings();
@@ -658,7 +678,7 @@ namespace Falcor
         std::unordered_map<std::string, size_t> mParameterBlocksIndices;
 
         ParameterBlockReflection::SharedConstPtr mpDefaultBlock;
-        uvec3 mThreadGroupSize;
+        uvec3 mThreadGroupSize = uvec3(0);
         bool mIsSampleFrequency = false;
 
         VariableMap mPsOut;
@@ -0,0 +1,305 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ShaderCache.h"
+#include "Utils/Platform/OS.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace Falcor
+{
+    std::mutex ShaderCache::sMutex;
+    std::string ShaderCache::sDirectory;
+    bool ShaderCache::sDirectoryInitialized = false;
+    ShaderCache::Stats ShaderCache::sStats;
+    std::unordered_map<std::string, ShaderCache::FileHash> ShaderCache::sFileHashes;
+
+    namespace
+    {
+        const char kMagic[4] = { 'F', 'S', 'C', '1' };
+        const uint32_t kFormatVersion = 2;
+        const uint32_t kMaxListSize = 16384;  // Sanity check for corrupted files
+
+        // Entries end with a hash of the preceding bytes, so truncated and corrupted files are rejected
+        class CacheReader
+        {
+        public:
+            CacheReader(const uint8_t* pData, size_t size) : mpData(pData), mSize(size) {}
+
+            template<typename T>
+            bool read(T& value)
+            {
+                if (mSize - mOffset < sizeof(T)) return false;
+                memcpy(&value, mpData + mOffset, sizeof(T));
+                mOffset += sizeof(T);
+                return true;
+            }
+
+            bool read(std::vector<uint8_t>& data)
+            {
+                uint64_t size;
+                if (read(size) == false || size > mSize - mOffset) return false;
+                data.assign(mpData + mOffset, mpData + mOffset + size);
+                mOffset += (size_t)size;
+                return true;
+            }
+
+            bool read(std::string& str)
+            {
+                uint64_t size;
+                if (read(size) == false || size > mSize - mOffset) return false;
+                str.assign((const char*)mpData + mOffset, (size_t)size);
+                mOffset += (size_t)size;
+                return true;
+            }
+        private:
+            const uint8_t* mpData;
+            size_t mSize;
+            size_t mOffset = 0;
+        };
+
+        class CacheWriter
+        {
+        public:
+            template<typename T>
+            void write(const T& value)
+            {
+                write(&value, sizeof(T));
+            }
+
+            void write(const std::vector<uint8_t>& data)
+            {
+                write((uint64_t)data.size());
+                write(data.data(), data.size());
+            }
+
+            void write(const std::string& str)
+            {
+                write((uint64_t)str.size());
+                write(str.data(), str.size());
+            }
+
+            const std::vector<uint8_t>& getData() const { return mData; }
+        private:
+            void write(const void* pData, size_t size)
+            {
+                mData.insert(mData.end(), (const uint8_t*)pData, (const uint8_t*)pData + size);
+            }
+            std::vector<uint8_t> mData;
+        };
+
+        bool readBlobs(CacheReader& reader, std::vector<std::vector<uint8_t>>& blobs)
+        {
+            uint32_t count;
+            if (reader.read(count) == false || count > kMaxListSize) return false;
+            blobs.resize(count);
+            for (auto& b : blobs)
+            {
+                if (reader.read(b) == false) return false;
+            }
+            return true;
+        }
+
+        void writeBlobs(CacheWriter& writer, const std::vector<std::vector<uint8_t>>& blobs)
+        {
+            writer.write((uint32_t)blobs.size());
+            for (const auto& b : blobs) writer.write(b);
+        }
+    }
+
+    void ShaderCache::setDirectory(const std::string& directory)
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sDirectory = directory;
+        sDirectoryInitialized = true;
+    }
+
+    std::string ShaderCache::getDirectory()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        if (sDirectoryInitialized == false)
+        {
+            sDirectory = getExecutableDirectory() + "/ShaderCache";
+            sDirectoryInitialized = true;
+        }
+        return sDirectory;
+    }
+
+    uint64_t ShaderCache::hash(const void* pData, size_t size)
+    {
+        uint64_t h = 14695981039346656037ull;
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        for (size_t i = 0; i < size; i++)
+        {
+            h ^= pBytes[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    uint64_t ShaderCache::hashFile(const std::string& path)
+    {
+        // The modification time has a 1 second resolution on some file systems, so the size is checked as well
+        struct stat s;
+        if (stat(path.c_str(), &s) != 0) return 0;
+        const time_t modifiedTime = s.st_mtime;
+        const uint64_t size = (uint64_t)s.st_size;
+
+        {
+            std::lock_guard<std::mutex> lock(sMutex);
+            auto it = sFileHashes.find(path);
+            if (it != sFileHashes.end() && it->second.modifiedTime == modifiedTime && it->second.size == size) return it->second.hash;
+        }
+
+        MappedFile file;
+        if (mapFile(path, file) == false) return 0;
+        uint64_t h = hash(file.pData, file.size);
+        unmapFile(file);
+
+        std::lock_guard<std::mutex> lock(sMutex);
+        sFileHashes[path] = { modifiedTime, size, h };
+        return h;
+    }
+
+    std::string ShaderCache::getEntryFilename(const std::string& key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.fsc", (unsigned long long)hash(key.data(), key.size()));
+        return getDirectory() + "/" + name;
+    }
+
+    bool ShaderCache::load(const std::string& key, Entry& entry)
+    {
+        bool found = false;
+        std::string filename = getEntryFilename(key);
+        MappedFile file;
+        if (mapFile(filename, file))
+        {
+            uint64_t checksum = 0;
+            const size_t size = (file.size >= sizeof(checksum)) ? file.size - sizeof(checksum) : 0;
+            if (size) memcpy(&checksum, file.pData + size, sizeof(checksum));
+
+            CacheReader reader(file.pData, size);
+            char magic[4];
+            uint32_t version;
+            std::string storedKey;
+            found = (size > 0) && (hash(file.pData, size) == checksum);
+            found = found && reader.read(magic) && memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+            found = found && reader.read(version) && version == kFormatVersion;
+            // The filename is just a hash, make sure it's not a collision
+            found = found && reader.read(storedKey) && storedKey == key;
+
+            uint32_t count = 0;
+            found = found && reader.read(count) && count <= kMaxListSize;
+            if (found)
+            {
+                entry.dependencies.resize(count);
+                for (auto& d : entry.dependencies)
+                {
+                    found = reader.read(d.path) && reader.read(d.hash);
+                    // Stale entry. One of the source files or includes changed.
+                    found = found && (hashFile(d.path) == d.hash);
+                    if (found == false) break;
+                }
+            }
+
+            found = found && readBlobs(reader, entry.code);
+            found = found && readBlobs(reader, entry.reflection);
+            unmapFile(file);
+        }
+
+        std::lock_guard<std::mutex> lock(sMutex);
+        if (found) sStats.hits++;
+        else sStats.misses++;
+        return found;
+    }
+
+    void ShaderCache::store(const std::string& key, const Entry& entry)
+    {
+        std::string directory = getDirectory();
+        if (directory.empty()) return;
+        if (isDirectoryExists(directory) == false && createDirectory(directory) == false && isDirectoryExists(directory) == false)
+        {
+            logWarning("Can't create the shader cache directory '" + directory + "'");
+            return;
+        }
+
+        // Write to a temporary file and rename it, so that concurrent readers never see a partial entry
+        std::string filename = getEntryFilename(key);
+        std::ostringstream tmpName;
+        tmpName << filename << "." << std::this_thread::get_id() << ".tmp";
+        {
+            std::ofstream stream(tmpName.str(), std::ios::binary | std::ios::trunc);
+            if (stream.is_open() == false)
+            {
+                logWarning("Can't write the shader cache entry '" + filename + "'");
+                return;
+            }
+
+            CacheWriter writer;
+            writer.write(kMagic);
+            writer.write(kFormatVersion);
+            writer.write(key);
+            writer.write((uint32_t)entry.dependencies.size());
+            for (const auto& d : entry.dependencies)
+            {
+                writer.write(d.path);
+                writer.write(d.hash);
+            }
+            writeBlobs(writer, entry.code);
+            writeBlobs(writer, entry.reflection);
+
+            const std::vector<uint8_t>& data = writer.getData();
+            const uint64_t checksum = hash(data.data(), data.size());
+            stream.write((const char*)data.data(), data.size());
+            stream.write((const char*)&checksum, sizeof(checksum));
+            if (stream.good() == false)
+            {
+                stream.close();
+                std::remove(tmpName.str().c_str());
+                logWarning("Can't write the shader cache entry '" + filename + "'");
+                return;
+            }
+        }
+
+        if (replaceFile(tmpName.str(), filename) == false) return;
+
+        std::lock_guard<std::mutex> lock(sMutex);
+        sStats.stores++;
+    }
+
+    ShaderCache::Stats ShaderCache::getStats()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        return sStats;
+    }
+}
@@ -0,0 +1,121 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Falcor
+{
+    /** Persistent on-disk cache for compiled shader code and reflection data.
+        Entries are content-addressed. The key is a string describing everything that affects the compilation (sources, entry points, defines, search paths, target and profile), and the entry's filename is a hash of it.
+        Each entry also records the content hash of every file the compiler read, including the include closure. An entry is only used if all of these files are unchanged.
+        Entries end with a checksum, so truncated or corrupted entries are treated as misses.
+        All functions are thread-safe.
+    */
+    class ShaderCache
+    {
+    public:
+        /** A cache entry
+        */
+        struct Entry
+        {
+            struct Dependency
+            {
+                std::string path;
+                uint64_t hash = 0;
+            };
+            std::vector<Dependency> dependencies;               ///< The files the compilation read
+            std::vector<std::vector<uint8_t>> code;             ///< The code for each shader stage. Empty for unused stages.
+            std::vector<std::vector<uint8_t>> reflection;       ///< Serialized reflection objects
+        };
+
+        /** Cache statistics
+        */
+        struct Stats
+        {
+            uint32_t hits = 0;      ///< Number of successful lookups
+            uint32_t misses = 0;    ///< Number of lookups which didn't find a valid entry
+            uint32_t stores = 0;    ///< Number of entries written
+        };
+
+        /** Set the cache directory. An empty string disables the cache. By default, the cache is stored in the ShaderCache folder in the executable directory.
+        */
+        static void setDirectory(const std::string& directory);
+
+        /** Get the cache directory. Returns an empty string if the cache is disabled.
+        */
+        static std::string getDirectory();
+
+        /** Check if the cache is enabled
+        */
+        static bool isEnabled() { return getDirectory().empty() == false; }
+
+        /** Look for a valid entry
+            \param[in] key The cache key
+            \param[out] entry The entry, if it was found
+            \return true if an entry with a matching key was found and none of its dependencies changed
+        */
+        static bool load(const std::string& key, Entry& entry);
+
+        /** Store an entry, replacing existing entries with the same key
+        */
+        static void store(const std::string& key, const Entry& entry);
+
+        /** Get the content hash of a file. Hashes are memoized using the file's modification time and size.
+            \return The hash, or 0 if the file can't be read
+        */
+        static uint64_t hashFile(const std::string& path);
+
+        /** Compute a 64-bit FNV-1a hash
+        */
+        static uint64_t hash(const void* pData, size_t size);
+
+        /** Get the cache statistics
+        */
+        static Stats getStats();
+
+    private:
+        ShaderCache() = delete;
+        static std::string getEntryFilename(const std::string& key);
+
+        struct FileHash
+        {
+            time_t modifiedTime;
+            uint64_t size;
+            uint64_t hash;
+        };
+
+        static std::mutex sMutex;
+        static std::string sDirectory;
+        static bool sDirectoryInitialized;
+        static Stats sStats;
+        static std::unordered_map<std::string, FileHash> sFileHashes;
+    };
+}
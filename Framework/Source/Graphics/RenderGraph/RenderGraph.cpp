@@ -35,6 +35,8 @@
 
 namespace Falcor
 {
+    static const LogSubsystem kLogSubsystem = { "RenderGraph" };
+
     RenderGraph::SharedPtr RenderGraph::create(const std::string& name)
     {
         try
@@ -91,7 +93,7 @@ namespace Falcor
             mNameToIndex[passName] = passIndex;
         }
 
-        auto passChangedCB = [this]() {mRecompile = true; };
+        auto passChangedCB = [this, passIndex]() { mNodeData[passIndex].reflectionDirty = true; mPassesChanged = true; };
         pPass->setPassChangedCB(passChangedCB);
         pPass->setScene(mpScene);
         mNodeData[passIndex] = { passName, pPass };
@@ -150,12 +152,13 @@ namespace Falcor
         std::string passTypeName = pOldPass->getName();
         auto pPass = RenderPassLibrary::instance().createPass(passTypeName.c_str(), dict);
         pPassIt->second.pPass = pPass;
+        pPassIt->second.reflectionDirty = true;
 
-        auto passChangedCB = [this]() {mRecompile = true; };
+        auto passChangedCB = [this, index]() { mNodeData[index].reflectionDirty = true; mPassesChanged = true; };
         pPass->setPassChangedCB(passChangedCB);
 
         pPass->setScene(mpScene);
-        mRecompile = true;
+        mPassesChanged = true;
     }
 
     const RenderPass::SharedPtr& RenderGraph::getPass(const std::string& name) const
@@ -427,8 +430,7 @@ namespace Falcor
             uint32_t nodeIndex = mExecutionList[i];
             const DirectedGraph::Node* pNode = mpGraph->getNode(nodeIndex);
             assert(pNode);
-            RenderPass* pSrcPass = mNodeData[nodeIndex].pPass.get();
-            RenderPassReflection passReflection = pSrcPass->reflect();
+            const RenderPassReflection& passReflection = getReflection(nodeIndex);
 
             // Check for opportunities to automatically resolve MSAA
             // - Only take explicitly specified MS output
@@ -457,7 +459,7 @@ namespace Falcor
                         // If edge is connected to something that isn't executed, ignore
                         if (std::find(mExecutionList.begin(), mExecutionList.end(), pEdge->getDestNode()) == mExecutionList.end()) continue;
 
-                        RenderPassReflection dstReflection = mNodeData[pEdge->getDestNode()].pPass->reflect();
+                        const RenderPassReflection& dstReflection = getReflection(pEdge->getDestNode());
                         const auto& dstField = dstReflection.getField(edgeData.dstField, RenderPassReflection::Field::Type::Input);
 
                         assert(srcField.isValid() && dstField.isValid());
@@ -541,8 +543,7 @@ namespace Falcor
             uint32_t nodeIndex = mExecutionList[i];
             const DirectedGraph::Node* pNode = mpGraph->getNode(nodeIndex);
             assert(pNode);
-            RenderPass* pCurrPass = mNodeData[nodeIndex].pPass.get();
-            RenderPassReflection passReflection = pCurrPass->reflect();
+            const RenderPassReflection& passReflection = getReflection(nodeIndex);
 
             const auto isGraphOutput = [=](uint32_t nodeId, const std::string& field)
             {
@@ -584,11 +585,12 @@ namespace Falcor
                 std::string dstFieldName = mNodeData[nodeIndex].nodeName + '.' + dstField.getName();
 
                 const auto& pSrcPass = mNodeData[pEdge->getSourceNode()].pPass;
-                auto srcReflection = pSrcPass->reflect();
+                const RenderPassReflection& srcReflection = getReflection(pEdge->getSourceNode());
                 const RenderPassReflection::Field& srcField = srcReflection.getField(edgeData.srcField);
 
+                // The resource must stay alive until this pass reads it
                 assert(passToIndex.count(pSrcPass.get()) > 0);
-                mpResourcesCache->registerField(dstFieldName, srcField, passToIndex[pSrcPass.get()], srcFieldName);
+                mpResourcesCache->registerField(dstFieldName, srcField, uint32_t(i), srcFieldName);
             }
         }
 
@@ -596,20 +598,59 @@ namespace Falcor
         return true;
     }
 
+    const RenderPassReflection& RenderGraph::getReflection(uint32_t nodeId)
+    {
+        NodeData& nodeData = mNodeData[nodeId];
+        if (nodeData.reflectionDirty)
+        {
+            nodeData.reflection = nodeData.pPass->reflect();
+            nodeData.reflectionDirty = false;
+        }
+        return nodeData.reflection;
+    }
+
+    bool RenderGraph::refreshReflections()
+    {
+        bool changed = false;
+        for (auto& it : mNodeData)
+        {
+            if (it.second.reflectionDirty == false) continue;
+            RenderPassReflection reflection = it.second.pPass->reflect();
+            changed = changed || (reflection != it.second.reflection);
+            it.second.reflection = reflection;
+            it.second.reflectionDirty = false;
+        }
+        return changed;
+    }
+
     bool RenderGraph::compile(std::string& log)
     {
+        if (mRecompile == false && mPassesChanged == false && mResourcesChanged == false) return true;
+        PROFILE(compileRenderGraph);
+
+        // Passes that only changed their settings keep the compiled graph, unless their reflection changed
+        if (refreshReflections()) mRecompile = true;
+        mPassesChanged = false;
+
         if (mRecompile)
         {
-            mpResourcesCache->reset();
             restoreCompilationChanges();
 
             if (resolveExecutionOrder() == false) return false;
             // If passes were added, resolve execution order again
             if (insertAutoPasses()) if (resolveExecutionOrder() == false) return false;
+        }
+
+        if (mRecompile || mResourcesChanged)
+        {
+            // The cache keeps the textures of resources whose properties didn't change
+            mpResourcesCache->reset();
             if (resolveResourceTypes() == false) return false;
             if (isValid(log) == false) return false;
         }
+
         mRecompile = false;
+        mResourcesChanged = false;
         return true;
     }
 
@@ -622,7 +663,7 @@ namespace Falcor
         std::string log;
         if (!compile(log))
         {
-            logWarning("Failed to compile RenderGraph\n" + log + "Ignoring RenderGraph::execute() call");
+            logWarning(kLogSubsystem, "Failed to compile RenderGraph\n" + log + "Ignoring RenderGraph::execute() call");
             return;
         }
 
@@ -771,10 +812,10 @@ namespace Falcor
         const Texture* pDepth = pTargetFbo->getDepthStencilTexture().get();
         assert(pColor && pDepth);
 
-        // If the back-buffer values changed, recompile
-        mRecompile = mRecompile || (mSwapChainData.format != pColor->getFormat());
-        mRecompile = mRecompile || (mSwapChainData.width != pTargetFbo->getWidth());
-        mRecompile = mRecompile || (mSwapChainData.height != pTargetFbo->getHeight());
+        // If the back-buffer values changed, reallocate the resources
+        mResourcesChanged = mResourcesChanged || (mSwapChainData.format != pColor->getFormat());
+        mResourcesChanged = mResourcesChanged || (mSwapChainData.width != pTargetFbo->getWidth());
+        mResourcesChanged = mResourcesChanged || (mSwapChainData.height != pTargetFbo->getHeight());
 
         // Store the values
         mSwapChainData.format = pColor->getFormat();
@@ -787,8 +828,9 @@ namespace Falcor
             it.second.pPass->onResize(mSwapChainData.width, mSwapChainData.height);
         }
 
-        // Invalidate the graph. Render-passes might change their reflection based on the resize information
-        mRecompile = true;
+        // Render-passes might change their reflection based on the resize information
+        for (auto& it : mNodeData) it.second.reflectionDirty = true;
+        mPassesChanged = true;
     }
 
     bool canFieldsConnect(const RenderPassReflection::Field& src, const RenderPassReflection::Field& dst)
@@ -191,6 +191,7 @@ namespace Falcor
         bool resolveExecutionOrder();
         bool insertAutoPasses();
         bool resolveResourceTypes();
+        bool refreshReflections();
         
         struct EdgeData
         {
@@ -203,15 +204,21 @@ namespace Falcor
         {
             std::string nodeName;
             RenderPass::SharedPtr pPass;
+            RenderPassReflection reflection;    // Cached result of pPass->reflect()
+            bool reflectionDirty = true;
         };
 
+        const RenderPassReflection& getReflection(uint32_t nodeId);
+
         uint32_t getEdge(const std::string& src, const std::string& dst);
         void getUnsatisfiedInputs(const NodeData* pNodeData, const RenderPassReflection& passReflection, std::vector<RenderPassReflection::Field>& outList) const;
         void autoConnectPasses(const NodeData* pSrcNode, const RenderPassReflection& srcReflection, const NodeData* pDestNode, std::vector<RenderPassReflection::Field>& unsatisfiedInputs);
         bool canAutoResolve(const RenderPassReflection::Field& src, const RenderPassReflection::Field& dst);
         void restoreCompilationChanges();
 
-        bool mRecompile = true;
+        bool mRecompile = true;         // The graph topology changed. The execution order and resources need to be rebuilt
+        bool mPassesChanged = false;    // Some passes need to be reflected again. The graph is only rebuilt if their reflection changed
+        bool mResourcesChanged = false; // The default resource properties changed, so resources need to be reallocated
         std::shared_ptr<Scene> mpScene;
 
         std::unordered_map<std::string, uint32_t> mNameToIndex;
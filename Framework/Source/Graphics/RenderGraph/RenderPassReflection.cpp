@@ -49,6 +49,14 @@ namespace Falcor
         return (mType != Type::None) && (mName.empty() == false);
     }
 
+    bool RenderPassReflection::Field::operator==(const Field& other) const
+    {
+        // Resource types are compared by pointer. Passes usually return the same object, and a false mismatch only causes a recompilation
+        return mName == other.mName && mpType == other.mpType && mWidth == other.mWidth && mHeight == other.mHeight && mDepth == other.mDepth &&
+            mSampleCount == other.mSampleCount && mMipLevels == other.mMipLevels && mArraySize == other.mArraySize && mFormat == other.mFormat &&
+            mBindFlags == other.mBindFlags && mFlags == other.mFlags && mType == other.mType;
+    }
+
     RenderPassReflection::Field& RenderPassReflection::addField(const std::string& name, Field::Type type)
     {
         mFields.push_back(Field(name, type));
@@ -64,6 +64,9 @@ namespace Falcor
 
             bool isValid() const;
 
+            bool operator==(const Field& other) const;
+            bool operator!=(const Field& other) const { return !(*this == other); }
+
             Field& setResourceType(const ReflectionResourceType::SharedConstPtr& pType) { mpType = pType; return *this; }
             Field& setDimensions(uint32_t w, uint32_t h, uint32_t d) { mWidth = w; mHeight = h; mDepth = d; return *this; }
             Field& setSampleCount(uint32_t count) { mSampleCount = count; return *this; }
@@ -111,6 +114,9 @@ namespace Falcor
         const Field& getField(size_t f) const { return mFields[f]; }
         const Field& getField(const std::string& name, Field::Type type = Field::Type::None) const;
         Flags getFlags() const { return mFlags; }
+
+        bool operator==(const RenderPassReflection& other) const { return mFlags == other.mFlags && mFields == other.mFields; }
+        bool operator!=(const RenderPassReflection& other) const { return !(*this == other); }
     private:
         Field& addField(const std::string& name, Field::Type type);
         RenderPassReflection::Flags mFlags = Flags::None;
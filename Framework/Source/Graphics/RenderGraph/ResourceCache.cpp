@@ -27,6 +27,7 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "ResourceCache.h"
+#include <queue>
 
 namespace Falcor
 {
@@ -37,6 +38,12 @@ namespace Falcor
 
     void ResourceCache::reset()
     {
+        for (const auto& it : mNameToIndex)
+        {
+            const auto& pResource = mResourceData[it.second].pResource;
+            if (pResource) mPreviousResources[it.first] = pResource;
+        }
+
         mNameToIndex.clear();
         mResourceData.clear();
     }
@@ -125,6 +132,12 @@ namespace Falcor
             }
         }
 
+        // A resource is persistent if any of the fields using it is
+        if (is_set(newField.getFlags(), RenderPassReflection::Field::Flags::Persistent))
+        {
+            base.setFlags(base.getFlags() | RenderPassReflection::Field::Flags::Persistent);
+        }
+
         Resource::BindFlags baseFlags = base.getBindFlags();
         Resource::BindFlags newFlags = newField.getBindFlags();
 
@@ -210,48 +223,200 @@ namespace Falcor
         }
     }
 
-    Texture::SharedPtr createTextureForPass(const ResourceCache::DefaultProperties& params, const RenderPassReflection::Field& field)
+    using TextureDesc = ResourceCache::TextureDesc;
+
+    TextureDesc resolveTextureDesc(const ResourceCache::DefaultProperties& params, const RenderPassReflection::Field& field)
+    {
+        TextureDesc desc;
+        desc.width = field.getWidth() ? field.getWidth() : params.width;
+        desc.height = field.getHeight() ? field.getHeight() : params.height;
+        desc.depth = field.getDepth() ? field.getDepth() : 1;
+        desc.sampleCount = field.getSampleCount() ? field.getSampleCount() : 1;
+        desc.format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
+        desc.depthStencil = is_set(field.getBindFlags(), Resource::BindFlags::DepthStencil);
+        return desc;
+    }
+
+    uint64_t getTextureSize(const TextureDesc& desc)
+    {
+        uint64_t width = (desc.width + getFormatWidthCompressionRatio(desc.format) - 1) / getFormatWidthCompressionRatio(desc.format);
+        uint64_t height = (desc.height + getFormatHeightCompressionRatio(desc.format) - 1) / getFormatHeightCompressionRatio(desc.format);
+        return width * height * desc.depth * desc.sampleCount * getFormatBytesPerBlock(desc.format);
+    }
+
+    Texture::SharedPtr createTextureForPass(const TextureDesc& desc, Resource::BindFlags bindFlags)
     {
-        uint32_t width = field.getWidth() ? field.getWidth() : params.width;
-        uint32_t height = field.getHeight() ? field.getHeight() : params.height;
-        uint32_t depth = field.getDepth() ? field.getDepth() : 1;
-        uint32_t sampleCount = field.getSampleCount() ? field.getSampleCount() : 1;
-        ResourceFormat format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
+        uint32_t width = desc.width;
+        uint32_t height = desc.height;
+        uint32_t depth = desc.depth;
+        uint32_t sampleCount = desc.sampleCount;
+        ResourceFormat format = desc.format;
 
         Texture::SharedPtr pTexture;
         if (depth > 1)
         {
             assert(sampleCount == 1);
-            pTexture = Texture::create3D(width, height, depth, format, 1, nullptr, field.getBindFlags() | Resource::BindFlags::ShaderResource);
+            pTexture = Texture::create3D(width, height, depth, format, 1, nullptr, bindFlags | Resource::BindFlags::ShaderResource);
         }
         else if (height > 1 || sampleCount > 1)
         {
             if (sampleCount > 1)
             {
-                pTexture = Texture::create2DMS(width, height, format, sampleCount, 1, field.getBindFlags() | Resource::BindFlags::ShaderResource);
+                pTexture = Texture::create2DMS(width, height, format, sampleCount, 1, bindFlags | Resource::BindFlags::ShaderResource);
             }
             else
             {
-                pTexture = Texture::create2D(width, height, format, 1, 1, nullptr, field.getBindFlags() | Resource::BindFlags::ShaderResource);
+                pTexture = Texture::create2D(width, height, format, 1, 1, nullptr, bindFlags | Resource::BindFlags::ShaderResource);
             }
         }
         else
         {
-            pTexture = Texture::create1D(width, format, 1, 1, nullptr, field.getBindFlags() | Resource::BindFlags::ShaderResource);
+            pTexture = Texture::create1D(width, format, 1, 1, nullptr, bindFlags | Resource::BindFlags::ShaderResource);
         }
 
         return pTexture;
     }
 
+    std::vector<uint32_t> ResourceCache::packResources(const std::vector<ResourceLifetime>& lifetimes, uint32_t& allocationCount)
+    {
+        std::vector<uint32_t> allocations(lifetimes.size());
+        allocationCount = 0;
+
+        std::vector<uint32_t> transients;
+        for (uint32_t i = 0; i < (uint32_t)lifetimes.size(); i++)
+        {
+            if (lifetimes[i].transient) transients.push_back(i);
+            else allocations[i] = allocationCount++;
+        }
+        std::stable_sort(transients.begin(), transients.end(), [&lifetimes](uint32_t a, uint32_t b) { return lifetimes[a].firstUsed < lifetimes[b].firstUsed; });
+
+        // For each description, the allocations sorted by the time they become free
+        using BusyAllocation = std::pair<uint32_t, uint32_t>;
+        using BusyQueue = std::priority_queue<BusyAllocation, std::vector<BusyAllocation>, std::greater<BusyAllocation>>;
+        std::unordered_map<uint32_t, BusyQueue> busyAllocations;
+
+        for (uint32_t i : transients)
+        {
+            const ResourceLifetime& lifetime = lifetimes[i];
+            assert(lifetime.firstUsed <= lifetime.lastUsed);
+            BusyQueue& queue = busyAllocations[lifetime.descIndex];
+            if (queue.empty() == false && queue.top().first < lifetime.firstUsed)
+            {
+                allocations[i] = queue.top().second;
+                queue.pop();
+            }
+            else
+            {
+                allocations[i] = allocationCount++;
+            }
+            queue.push({ lifetime.lastUsed, allocations[i] });
+        }
+        return allocations;
+    }
+
     void ResourceCache::allocateResources(const DefaultProperties& params)
     {
-        for (auto& data : mResourceData)
+        bool needsAllocation = false;
+        for (const auto& data : mResourceData)
         {
-            if ((data.pResource == nullptr || data.dirty) && data.field.isValid())
+            needsAllocation = needsAllocation || ((data.pResource == nullptr || data.dirty) && data.field.isValid());
+        }
+        if (needsAllocation == false) return;
+
+        // Resolve the texture properties and lifetimes of all the resources
+        std::vector<TextureDesc> descs;
+        std::vector<ResourceLifetime> lifetimes;
+        std::vector<uint32_t> dataIndices;
+        for (uint32_t i = 0; i < (uint32_t)mResourceData.size(); i++)
+        {
+            const ResourceData& data = mResourceData[i];
+            if (data.field.isValid() == false) continue;
+
+            TextureDesc desc = resolveTextureDesc(params, data.field);
+            ResourceLifetime lifetime;
+            lifetime.firstUsed = data.firstUsed;
+            lifetime.lastUsed = data.lastUsed;
+            lifetime.descIndex = uint32_t(std::find(descs.begin(), descs.end(), desc) - descs.begin());
+            if (lifetime.descIndex == descs.size()) descs.push_back(desc);
+
+            // Graph outputs are used after the graph executes, and persistent resources must keep their data between executions
+            lifetime.transient = mAliasingEnabled && data.lastUsed != uint32_t(-1) && is_set(data.field.getFlags(), RenderPassReflection::Field::Flags::Persistent) == false;
+            lifetimes.push_back(lifetime);
+            dataIndices.push_back(i);
+        }
+
+        uint32_t allocationCount;
+        std::vector<uint32_t> allocations = packResources(lifetimes, allocationCount);
+
+        // Textures shared by multiple resources need the bind flags of all of them
+        std::vector<Resource::BindFlags> bindFlags(allocationCount, Resource::BindFlags::None);
+        std::vector<uint32_t> allocationDescs(allocationCount);
+        mMemoryStats = MemoryStats();
+        for (size_t i = 0; i < allocations.size(); i++)
+        {
+            bindFlags[allocations[i]] |= mResourceData[dataIndices[i]].field.getBindFlags();
+            allocationDescs[allocations[i]] = lifetimes[i].descIndex;
+            mMemoryStats.unaliasedBytes += getTextureSize(descs[lifetimes[i].descIndex]);
+        }
+
+        // The textures each allocation's fields had before the last reset()
+        std::vector<std::vector<const Resource*>> previousResources(allocationCount);
+        for (const auto& it : mNameToIndex)
+        {
+            auto prevIt = mPreviousResources.find(it.first);
+            if (prevIt == mPreviousResources.end()) continue;
+            auto dataIt = std::find(dataIndices.begin(), dataIndices.end(), it.second);
+            if (dataIt != dataIndices.end()) previousResources[allocations[dataIt - dataIndices.begin()]].push_back(prevIt->second.get());
+        }
+
+        // Reuse the existing textures with matching properties, so that only resources which actually changed are recreated.
+        // First try to give each allocation a texture one of its fields already had, then any matching texture
+        std::vector<Allocation> newAllocations(allocationCount);
+        std::vector<bool> claimed(mAllocations.size(), false);
+        for (uint32_t pass = 0; pass < 2; pass++)
+        {
+            for (uint32_t a = 0; a < allocationCount; a++)
+            {
+                if (newAllocations[a].pTexture) continue;
+                const TextureDesc& desc = descs[allocationDescs[a]];
+                for (size_t p = 0; p < mAllocations.size(); p++)
+                {
+                    const Allocation& prev = mAllocations[p];
+                    if (claimed[p] || (prev.desc == desc) == false || (prev.bindFlags & bindFlags[a]) != bindFlags[a]) continue;
+                    const auto& prevResources = previousResources[a];
+                    if (pass == 0 && std::find(prevResources.begin(), prevResources.end(), prev.pTexture.get()) == prevResources.end()) continue;
+
+                    newAllocations[a] = prev;
+                    claimed[p] = true;
+                    mMemoryStats.reusedCount++;
+                    break;
+                }
+            }
+        }
+
+        for (uint32_t a = 0; a < allocationCount; a++)
+        {
+            if (newAllocations[a].pTexture == nullptr)
             {
-                data.pResource = createTextureForPass(params, data.field);
-                data.dirty = false;
+                newAllocations[a] = { descs[allocationDescs[a]], bindFlags[a], createTextureForPass(descs[allocationDescs[a]], bindFlags[a]) };
             }
+            mMemoryStats.aliasedBytes += getTextureSize(newAllocations[a].desc);
+        }
+
+        for (size_t i = 0; i < allocations.size(); i++)
+        {
+            ResourceData& data = mResourceData[dataIndices[i]];
+            data.pResource = newAllocations[allocations[i]].pTexture;
+            data.dirty = false;
         }
+
+        // Textures that weren't reused are released here
+        mAllocations = std::move(newAllocations);
+        mPreviousResources.clear();
+
+        mMemoryStats.resourceCount = (uint32_t)allocations.size();
+        mMemoryStats.allocationCount = allocationCount;
+        logInfo("ResourceCache: " + std::to_string(mMemoryStats.resourceCount) + " resources in " + std::to_string(allocationCount) + " allocations, " + std::to_string(mMemoryStats.reusedCount) + " reused. Peak memory " +
+            std::to_string(mMemoryStats.unaliasedBytes / (1024 * 1024)) + "MB without aliasing, " + std::to_string(mMemoryStats.aliasedBytes / (1024 * 1024)) + "MB with aliasing");
     }
 }
@@ -49,6 +49,52 @@ namespace Falcor
             ResourceFormat format = ResourceFormat::Unknown;    ///< Format to use for texture creation
         };
 
+        /** Texture properties after applying the default properties. Textures can only share memory if these match.
+        */
+        struct TextureDesc
+        {
+            uint32_t width;
+            uint32_t height;
+            uint32_t depth;
+            uint32_t sampleCount;
+            ResourceFormat format;
+            bool depthStencil;
+
+            bool operator==(const TextureDesc& other) const
+            {
+                return width == other.width && height == other.height && depth == other.depth && sampleCount == other.sampleCount && format == other.format && depthStencil == other.depthStencil;
+            }
+        };
+
+        /** Lifetime of a resource, used to decide which resources can share memory.
+        */
+        struct ResourceLifetime
+        {
+            uint32_t firstUsed = 0;     ///< First time point the resource is used
+            uint32_t lastUsed = 0;      ///< Last time point the resource is used, inclusive
+            uint32_t descIndex = 0;     ///< Resources can only share memory with resources that have the same description index
+            bool transient = true;      ///< Non-transient resources always get their own allocation
+        };
+
+        /** Memory usage of the allocated resources
+        */
+        struct MemoryStats
+        {
+            uint32_t resourceCount = 0;         ///< Number of resources the graph requested
+            uint32_t allocationCount = 0;       ///< Number of resources actually allocated
+            uint32_t reusedCount = 0;           ///< Number of allocations that reused a texture from before the last reset()
+            uint64_t unaliasedBytes = 0;        ///< Memory required if every resource had its own allocation
+            uint64_t aliasedBytes = 0;          ///< Memory actually allocated
+        };
+
+        /** Assign resources to allocations so that resources sharing an allocation have matching descriptions and non-overlapping lifetimes.
+            This is a greedy interval partitioning, which uses the minimal number of allocations for each description.
+            \param[in] lifetimes The resources to pack
+            \param[out] allocationCount The number of allocations required
+            \return The allocation index of each resource
+        */
+        static std::vector<uint32_t> packResources(const std::vector<ResourceLifetime>& lifetimes, uint32_t& allocationCount);
+
         // Add/Remove reference to a graph input resource not owned by the cache
         void registerExternalInput(const std::string& name, const std::shared_ptr<Resource>& pResource);
         void removeExternalInput(const std::string& name);
@@ -71,7 +117,17 @@ namespace Falcor
         */
         void allocateResources(const DefaultProperties& params);
 
-        /** Clears all registered field/resource properties and allocated resources.
+        /** Get the memory usage of the resources created by the last allocateResources() call.
+        */
+        const MemoryStats& getMemoryStats() const { return mMemoryStats; }
+
+        /** Enable/disable sharing memory between transient resources whose lifetimes don't overlap. Takes effect on the next allocation.
+        */
+        void setAliasingEnabled(bool enabled) { mAliasingEnabled = enabled; }
+        bool isAliasingEnabled() const { return mAliasingEnabled; }
+
+        /** Clears all registered field/resource properties.
+            The allocated textures are kept until the next allocateResources() call, which reuses the ones whose properties didn't change.
         */
         void reset();
 
@@ -94,8 +150,22 @@ namespace Falcor
         std::unordered_map<std::string, uint32_t> mNameToIndex;
         std::vector<ResourceData> mResourceData;
 
+        struct Allocation
+        {
+            TextureDesc desc;
+            Resource::BindFlags bindFlags;
+            Texture::SharedPtr pTexture;
+        };
+        std::vector<Allocation> mAllocations;
+
+        // The resources each field had before the last reset(), used to give fields back their textures
+        std::unordered_map<std::string, std::shared_ptr<Resource>> mPreviousResources;
+
         // References to output resources not to be allocated by the render graph
         std::unordered_map<std::string, std::shared_ptr<Resource>> mExternalInputs;
+
+        bool mAliasingEnabled = true;
+        MemoryStats mMemoryStats;
     };
 
 }
\ No newline at end of file
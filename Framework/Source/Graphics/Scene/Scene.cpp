@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "Scene.h"
 #include "SceneImporter.h"
+#include "Utils/Platform/FileWatcher.h"
 #include "glm/gtx/euler_angles.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
@@ -44,9 +45,12 @@ namespace Falcor
         Scene::SharedPtr pScene = create();
         if (SceneImporter::loadScene(*pScene, filename, modelLoadFlags, sceneLoadFlags) == false)
         {
-            pScene = nullptr;
+            return nullptr;
         }
         pScene->mFilename = filename;
+
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath)) FileWatcher::instance().watchDataFile(fullpath);
         return pScene;
     }
 
@@ -114,12 +118,15 @@ namespace Falcor
             }
         }
 
+        std::vector<Model*> models(mModels.size());
         for (uint32_t i = 0; i < mModels.size(); i++)
         {
-            if (mModels[i][0]->getObject()->animate(currentTime))
-            {
-                changed = true;
-            }
+            models[i] = mModels[i][0]->getObject().get();
+        }
+
+        if (Model::animate(models, currentTime))
+        {
+            changed = true;
         }
 
         mExtentsDirty = mExtentsDirty || changed;
@@ -145,12 +152,14 @@ namespace Falcor
         // Delete entire vector of instances
         mModels.erase(mModels.begin() + modelID);
         mExtentsDirty = true;
+        mModelInstanceGeneration++;
     }
 
     void Scene::deleteAllModels()
     {
         mModels.clear();
         mExtentsDirty = true;
+        mModelInstanceGeneration++;
     }
 
     uint32_t Scene::getModelInstanceCount(uint32_t modelID) const
@@ -167,6 +176,8 @@ namespace Falcor
 
     void Scene::addModelInstance(const ModelInstance::SharedPtr& pInstance)
     {
+        mModelInstanceGeneration++;
+
         // Checking for existing instance list for model
         for (uint32_t modelID = 0; modelID < (uint32_t)mModels.size(); modelID++)
         {
@@ -200,6 +211,7 @@ namespace Falcor
         {
             //  Erase the instance.
             instances.erase(instances.begin() + instanceID);
+            mModelInstanceGeneration++;
         }
 
         //  Extents will be dirty in either case.
@@ -321,6 +333,7 @@ namespace Falcor
 #undef merge
         mUserVars.insert(pFrom->mUserVars.begin(), pFrom->mUserVars.end());
         mExtentsDirty = true;
+        mModelInstanceGeneration++;
     }
 
     void Scene::createAreaLights()
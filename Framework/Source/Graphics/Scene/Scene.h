@@ -121,6 +121,10 @@ namespace Falcor
         const ModelInstance::SharedPtr& getModelInstance(uint32_t modelID, uint32_t instanceID) const { return mModels[modelID][instanceID]; };
         void deleteModelInstance(uint32_t modelID, uint32_t instanceID);
 
+        /** Get a counter which is incremented whenever model instances are added or removed. Model and instance IDs are only stable while it doesn't change.
+        */
+        uint32_t getModelInstanceGeneration() const { return mModelInstanceGeneration; }
+
         // Light Sources
         uint32_t addLight(const Light::SharedPtr& pLight);
         void deleteLight(uint32_t lightID);
@@ -259,6 +263,7 @@ namespace Falcor
         vec3 mCenter = vec3(0, 0, 0);
 
         bool mExtentsDirty = true;
+        uint32_t mModelInstanceGeneration = 0;
 
         std::string mFilename;
 
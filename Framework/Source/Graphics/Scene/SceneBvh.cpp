@@ -0,0 +1,265 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneBvh.h"
+#include <algorithm>
+#include <float.h>
+#include <xmmintrin.h>
+
+namespace Falcor
+{
+    SceneBvh::SharedPtr SceneBvh::create()
+    {
+        return SharedPtr(new SceneBvh());
+    }
+
+    void SceneBvh::setSlotBounds(uint32_t node, uint32_t slot, const glm::vec3& minPos, const glm::vec3& maxPos)
+    {
+        Node& n = mNodes[node];
+        n.minX[slot] = minPos.x;
+        n.minY[slot] = minPos.y;
+        n.minZ[slot] = minPos.z;
+        n.maxX[slot] = maxPos.x;
+        n.maxY[slot] = maxPos.y;
+        n.maxZ[slot] = maxPos.z;
+    }
+
+    void SceneBvh::getNodeBounds(uint32_t node, glm::vec3& minPos, glm::vec3& maxPos) const
+    {
+        const Node& n = mNodes[node];
+        minPos = glm::vec3(FLT_MAX);
+        maxPos = glm::vec3(-FLT_MAX);
+        for (uint32_t slot = 0; slot < kNodeWidth; slot++)
+        {
+            if (n.children[slot] == kEmptySlot) continue;
+            minPos = glm::min(minPos, glm::vec3(n.minX[slot], n.minY[slot], n.minZ[slot]));
+            maxPos = glm::max(maxPos, glm::vec3(n.maxX[slot], n.maxY[slot], n.maxZ[slot]));
+        }
+    }
+
+    uint32_t SceneBvh::buildNode(std::vector<uint32_t>& leaves, uint32_t begin, uint32_t end, const std::vector<BoundingBox>& boxes, const std::vector<glm::vec3>& centroids, uint32_t parent, uint32_t parentSlot)
+    {
+        uint32_t nodeIndex = (uint32_t)mNodes.size();
+        mNodes.push_back({});
+        for (uint32_t slot = 0; slot < kNodeWidth; slot++)
+        {
+            mNodes[nodeIndex].children[slot] = kEmptySlot;
+            setSlotBounds(nodeIndex, slot, glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+        }
+        mNodes[nodeIndex].parent = parent;
+        mNodes[nodeIndex].parentSlot = parentSlot;
+
+        // Split the range in 2 at the median of the longest centroid axis
+        const auto split = [&](uint32_t b, uint32_t e)
+        {
+            glm::vec3 minPos(FLT_MAX), maxPos(-FLT_MAX);
+            for (uint32_t i = b; i < e; i++)
+            {
+                minPos = glm::min(minPos, centroids[leaves[i]]);
+                maxPos = glm::max(maxPos, centroids[leaves[i]]);
+            }
+            glm::vec3 size = maxPos - minPos;
+            int axis = (size.x > size.y && size.x > size.z) ? 0 : (size.y > size.z ? 1 : 2);
+            uint32_t mid = (b + e) / 2;
+            std::nth_element(leaves.begin() + b, leaves.begin() + mid, leaves.begin() + e, [&](uint32_t l0, uint32_t l1) { return centroids[l0][axis] < centroids[l1][axis]; });
+            return mid;
+        };
+
+        // Divide the range into up to 4 groups
+        uint32_t groups[kNodeWidth + 1];
+        uint32_t groupCount = 0;
+        if (end - begin <= kNodeWidth)
+        {
+            for (uint32_t i = begin; i <= end; i++) groups[groupCount++] = i;
+            groupCount--;
+        }
+        else
+        {
+            uint32_t mid = split(begin, end);
+            groups[0] = begin;
+            groups[1] = split(begin, mid);
+            groups[2] = mid;
+            groups[3] = split(mid, end);
+            groups[4] = end;
+            groupCount = kNodeWidth;
+        }
+
+        for (uint32_t slot = 0; slot < groupCount; slot++)
+        {
+            uint32_t b = groups[slot];
+            uint32_t e = groups[slot + 1];
+            if (e - b == 1)
+            {
+                uint32_t leafID = leaves[b];
+                mNodes[nodeIndex].children[slot] = ~int32_t(leafID);
+                mLeafLocations[leafID] = { nodeIndex, slot };
+                setSlotBounds(nodeIndex, slot, boxes[leafID].getMinPos(), boxes[leafID].getMaxPos());
+            }
+            else
+            {
+                uint32_t child = buildNode(leaves, b, e, boxes, centroids, nodeIndex, slot);
+                mNodes[nodeIndex].children[slot] = int32_t(child);
+                glm::vec3 minPos, maxPos;
+                getNodeBounds(child, minPos, maxPos);
+                setSlotBounds(nodeIndex, slot, minPos, maxPos);
+            }
+        }
+        return nodeIndex;
+    }
+
+    void SceneBvh::build(const std::vector<BoundingBox>& boxes)
+    {
+        mNodes.clear();
+        mLeafLocations.assign(boxes.size(), { kInvalidIndex, 0 });
+        mDirty = false;
+
+        if (boxes.empty() == false)
+        {
+            std::vector<uint32_t> leaves(boxes.size());
+            std::vector<glm::vec3> centroids(boxes.size());
+            for (uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+            {
+                leaves[i] = i;
+                centroids[i] = boxes[i].center;
+            }
+            mNodes.reserve(boxes.size() / 2 + 1);
+            buildNode(leaves, 0, (uint32_t)boxes.size(), boxes, centroids, kInvalidIndex, 0);
+        }
+        mDirtyNodes.assign(mNodes.size(), false);
+    }
+
+    void SceneBvh::setLeafBounds(uint32_t leafID, const BoundingBox& box)
+    {
+        assert(leafID < mLeafLocations.size());
+        const SlotLocation& location = mLeafLocations[leafID];
+        setSlotBounds(location.node, location.slot, box.getMinPos(), box.getMaxPos());
+        mDirtyNodes[location.node] = true;
+        mDirty = true;
+    }
+
+    void SceneBvh::refit()
+    {
+        if (mDirty == false) return;
+
+        // Children are stored after their parents, so walking backwards updates every node before its parent reads it
+        for (uint32_t node = (uint32_t)mNodes.size(); node-- > 0;)
+        {
+            if (mDirtyNodes[node] == false) continue;
+            mDirtyNodes[node] = false;
+
+            uint32_t parent = mNodes[node].parent;
+            if (parent != kInvalidIndex)
+            {
+                glm::vec3 minPos, maxPos;
+                getNodeBounds(node, minPos, maxPos);
+                setSlotBounds(parent, mNodes[node].parentSlot, minPos, maxPos);
+                mDirtyNodes[parent] = true;
+            }
+        }
+        mDirty = false;
+    }
+
+    void SceneBvh::markVisible(int32_t child, std::vector<uint8_t>& visibility) const
+    {
+        if (child < 0)
+        {
+            visibility[~child] = 1;
+            return;
+        }
+
+        const Node& n = mNodes[child];
+        for (uint32_t slot = 0; slot < kNodeWidth; slot++)
+        {
+            if (n.children[slot] != kEmptySlot) markVisible(n.children[slot], visibility);
+        }
+    }
+
+    void SceneBvh::cull(const glm::vec4 planes[6], std::vector<uint8_t>& visibility) const
+    {
+        visibility.assign(mLeafLocations.size(), 0);
+        if (mNodes.empty()) return;
+
+        // The tree depth is logarithmic in the leaf count and every visited node pushes at most kNodeWidth children
+        uint32_t stack[256];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = 0;
+
+        const __m128 zero = _mm_setzero_ps();
+        while (stackSize > 0)
+        {
+            const Node& n = mNodes[stack[--stackSize]];
+
+            // Test the 4 children against each plane. A box is outside if its corner furthest along the plane normal is behind the plane,
+            // and completely inside if its nearest corner is in front of all the planes
+            __m128 outside = _mm_setzero_ps();
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+            for (uint32_t p = 0; p < 6; p++)
+            {
+                const glm::vec4& plane = planes[p];
+                const __m128 a = _mm_set1_ps(plane.x);
+                const __m128 b = _mm_set1_ps(plane.y);
+                const __m128 c = _mm_set1_ps(plane.z);
+                const __m128 d = _mm_set1_ps(plane.w);
+
+                __m128 farX = _mm_loadu_ps(plane.x > 0 ? n.maxX : n.minX);
+                __m128 farY = _mm_loadu_ps(plane.y > 0 ? n.maxY : n.minY);
+                __m128 farZ = _mm_loadu_ps(plane.z > 0 ? n.maxZ : n.minZ);
+                __m128 nearX = _mm_loadu_ps(plane.x > 0 ? n.minX : n.maxX);
+                __m128 nearY = _mm_loadu_ps(plane.y > 0 ? n.minY : n.maxY);
+                __m128 nearZ = _mm_loadu_ps(plane.z > 0 ? n.minZ : n.maxZ);
+
+                __m128 farDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, farX), _mm_mul_ps(b, farY)), _mm_add_ps(_mm_mul_ps(c, farZ), d));
+                __m128 nearDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, nearX), _mm_mul_ps(b, nearY)), _mm_add_ps(_mm_mul_ps(c, nearZ), d));
+                outside = _mm_or_ps(outside, _mm_cmple_ps(farDist, zero));
+                inside = _mm_and_ps(inside, _mm_cmpgt_ps(nearDist, zero));
+            }
+
+            int outsideMask = _mm_movemask_ps(outside);
+            int insideMask = _mm_movemask_ps(inside);
+            for (uint32_t slot = 0; slot < kNodeWidth; slot++)
+            {
+                int32_t child = n.children[slot];
+                if (child == kEmptySlot || (outsideMask & (1 << slot))) continue;
+
+                if (child < 0)
+                {
+                    visibility[~child] = 1;
+                }
+                else if (insideMask & (1 << slot))
+                {
+                    markVisible(child, visibility);
+                }
+                else
+                {
+                    assert(stackSize < arraysize(stack));
+                    stack[stackSize++] = uint32_t(child);
+                }
+            }
+        }
+    }
+}
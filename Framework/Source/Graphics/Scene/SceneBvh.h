@@ -0,0 +1,111 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <memory>
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    /** A 4-wide bounding volume hierarchy over world-space bounding boxes, used for frustum culling.
+        The hierarchy is built once and refit when boxes move. Each node stores the bounds of its 4 children in SoA layout, so they are tested against a plane using a single SIMD operation.
+    */
+    class SceneBvh
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneBvh>;
+
+        /** Create an empty hierarchy
+        */
+        static SharedPtr create();
+
+        /** Build the hierarchy, replacing the existing one.
+            \param[in] boxes World-space bounds of the leaves. Leaf IDs are indices into this vector.
+        */
+        void build(const std::vector<BoundingBox>& boxes);
+
+        /** Update the bounds of a leaf. The nodes above it are updated by the next refit() call.
+        */
+        void setLeafBounds(uint32_t leafID, const BoundingBox& box);
+
+        /** Refit the nodes whose leaves changed since the last call. The tree topology is kept, so large movements reduce the culling efficiency until the next build().
+        */
+        void refit();
+
+        /** Cull the leaves against a frustum.
+            \param[in] planes The frustum planes, in the format returned by Camera::getFrustumPlanes()
+            \param[out] visibility Resized to the leaf count. Set to 1 for leaves intersecting the frustum and to 0 for culled leaves.
+        */
+        void cull(const glm::vec4 planes[6], std::vector<uint8_t>& visibility) const;
+
+        /** Get the number of leaves
+        */
+        uint32_t getLeafCount() const { return (uint32_t)mLeafLocations.size(); }
+
+        /** Get the number of nodes
+        */
+        uint32_t getNodeCount() const { return (uint32_t)mNodes.size(); }
+
+    private:
+        SceneBvh() = default;
+
+        static const uint32_t kNodeWidth = 4;
+        static const uint32_t kInvalidIndex = uint32_t(-1);
+        static const int32_t kEmptySlot = INT32_MIN;
+
+        struct Node
+        {
+            // Children bounds, SoA
+            float minX[kNodeWidth];
+            float minY[kNodeWidth];
+            float minZ[kNodeWidth];
+            float maxX[kNodeWidth];
+            float maxY[kNodeWidth];
+            float maxZ[kNodeWidth];
+            int32_t children[kNodeWidth];   // Node index for inner nodes, ~leafID for leaves and kEmptySlot for unused slots
+            uint32_t parent;
+            uint32_t parentSlot;
+        };
+
+        struct SlotLocation
+        {
+            uint32_t node;
+            uint32_t slot;
+        };
+
+        std::vector<Node> mNodes;                   // Parents are always stored before their children
+        std::vector<SlotLocation> mLeafLocations;
+        std::vector<bool> mDirtyNodes;
+        bool mDirty = false;
+
+        uint32_t buildNode(std::vector<uint32_t>& leaves, uint32_t begin, uint32_t end, const std::vector<BoundingBox>& boxes, const std::vector<glm::vec3>& centroids, uint32_t parent, uint32_t parentSlot);
+        void setSlotBounds(uint32_t node, uint32_t slot, const glm::vec3& minPos, const glm::vec3& maxPos);
+        void getNodeBounds(uint32_t node, glm::vec3& minPos, glm::vec3& maxPos) const;
+        void markVisible(int32_t child, std::vector<uint8_t>& visibility) const;
+    };
+}
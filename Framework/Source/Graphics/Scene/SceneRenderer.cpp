@@ -36,6 +36,9 @@
 #include "VR/OpenVR/VRSystem.h"
 #include "API/Device.h"
 #include "glm/matrix.hpp"
+#include "Utils/TaskScheduler.h"
+#include <algorithm>
+#include <unordered_map>
 
 namespace Falcor
 {
@@ -59,6 +62,17 @@ namespace Falcor
     const char* SceneRenderer::kAreaLightCbName = "InternalAreaLightCB";
 
 
+    static bool isBlendingEnabled(const GraphicsState* pState)
+    {
+        const BlendState* pBlendState = pState ? pState->getBlendState().get() : nullptr;
+        if (pBlendState == nullptr) return false;
+        for (uint32_t i = 0; i < pBlendState->getRtCount(); i++)
+        {
+            if (pBlendState->isBlendEnabled(i)) return true;
+        }
+        return false;
+    }
+
     SceneRenderer::SharedPtr SceneRenderer::create(const Scene::SharedPtr& pScene)
     {
         return SharedPtr(new SceneRenderer(pScene));
@@ -251,11 +265,12 @@ namespace Falcor
                 return;
             }
             mpLastMaterial = pMesh->getMaterial().get();
+        }
 
-            if(mCompileMaterialWithProgram)
-            {
-                currentData.pState->getProgram()->addDefine("_MS_STATIC_MATERIAL_FLAGS", std::to_string(mpLastMaterial->getFlags()));
-            }
+        // The define is removed after every draw, so consecutive draws with the same material need it as well
+        if(mCompileMaterialWithProgram)
+        {
+            currentData.pState->getProgram()->addDefine("_MS_STATIC_MATERIAL_FLAGS", std::to_string(mpLastMaterial->getFlags()));
         }
 
         executeDraw(currentData, pMesh->getIndexCount(), instanceCount);
@@ -270,75 +285,230 @@ namespace Falcor
 
     bool SceneRenderer::cullMeshInstance(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance)
     {
+        if (currentData.pVisibility)
+        {
+            assert(currentData.pVisibility == mVisibility.data() && currentData.visibilityIndex < mVisibility.size());
+            return currentData.pVisibility[currentData.visibilityIndex] == 0;
+        }
+
         BoundingBox box = pMeshInstance->getBoundingBox().transform(pModelInstance->getTransformMatrix());
         return currentData.pCamera->isObjectCulled(box);
     }
 
-    void SceneRenderer::renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID)
+    uint64_t SceneRenderer::makeSortKey(uint32_t programID, uint32_t materialID, uint32_t vaoID)
     {
-        const Model* pModel = currentData.pModel;
-        const Mesh* pMesh = pModel->getMesh(meshID).get();
+        const uint32_t kProgramBits = 12;
+        const uint32_t kMaterialBits = 26;
+        const uint32_t kVaoBits = 26;
+        static_assert(kProgramBits + kMaterialBits + kVaoBits == 64, "Sort key must use 64 bits");
+
+        uint64_t key = std::min(programID, (1u << kProgramBits) - 1);
+        key = (key << kMaterialBits) | std::min(materialID, (1u << kMaterialBits) - 1);
+        key = (key << kVaoBits) | std::min(vaoID, (1u << kVaoBits) - 1);
+        return key;
+    }
+
+    void SceneRenderer::sortDrawPackets(std::vector<DrawPacket>& packets)
+    {
+        std::sort(packets.begin(), packets.end(), [](const DrawPacket& a, const DrawPacket& b)
+        {
+            if (a.modelID != b.modelID) return a.modelID < b.modelID;
+            return (a.sortKey != b.sortKey) ? (a.sortKey < b.sortKey) : (a.sequence < b.sequence);
+        });
+    }
+
+    void SceneRenderer::buildDrawList(const CurrentWorkingData& currentData)
+    {
+        // Collect the meshes and give dense IDs to the state they use. This only loops over the meshes, not their instances
+        mDrawMeshes.clear();
+        std::vector<uint64_t> meshSortKeys;
+        std::unordered_map<uint64_t, uint32_t> programIDs;
+        std::unordered_map<const Material*, uint32_t> materialIDs;
+        std::unordered_map<const Vao*, uint32_t> vaoIDs;
+
+        struct InstanceRange
+        {
+            uint32_t modelID;
+            uint32_t instanceID;
+            uint32_t firstMesh;
+            uint32_t firstPacket;
+        };
+        std::vector<InstanceRange> instances;
+        uint32_t packetCount = 0;
 
-        if (setPerMeshData(currentData, pMesh))
+        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
         {
-            Program* pProgram = currentData.pState->getProgram().get();
-            bool useVsSkinning = pMesh->hasBones() && !pModel->getSkinningCache();
-            if (useVsSkinning)
+            const Model* pModel = mpScene->getModel(modelID).get();
+            const uint32_t firstMesh = (uint32_t)mDrawMeshes.size();
+            const bool hasSkinningCache = (pModel->getSkinningCache() != nullptr);
+
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
             {
-                pProgram->addDefine("_VERTEX_BLENDING");
+                DrawMesh drawMesh;
+                drawMesh.pModel = pModel;
+                drawMesh.pMesh = pModel->getMesh(meshID).get();
+                drawMesh.useVsSkinning = drawMesh.pMesh->hasBones() && (hasSkinningCache == false);
+                drawMesh.pVao = drawMesh.useVsSkinning ? drawMesh.pMesh->getVao() : pModel->getMeshVao(drawMesh.pMesh);
+
+                // The program changes with the static material flags and vertex-shader skinning
+                const Material* pMaterial = drawMesh.pMesh->getMaterial().get();
+                uint64_t programKey = (uint64_t(mCompileMaterialWithProgram ? pMaterial->getFlags() : 0) << 1) | (drawMesh.useVsSkinning ? 1 : 0);
+                uint32_t programID = programIDs.emplace(programKey, (uint32_t)programIDs.size()).first->second;
+                uint32_t materialID = materialIDs.emplace(pMaterial, (uint32_t)materialIDs.size()).first->second;
+                uint32_t vaoID = vaoIDs.emplace(drawMesh.pVao.get(), (uint32_t)vaoIDs.size()).first->second;
+
+                meshSortKeys.push_back(makeSortKey(programID, materialID, vaoID));
+                mDrawMeshes.push_back(drawMesh);
+
+                // Mesh instances are shared between model instances. Resolve their cached transforms here so the workers only read them
+                for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                {
+                    pModel->getMeshInstance(meshID, meshInstanceID)->getTransformMatrix();
+                }
             }
 
-            // Bind VAO and set topology            
-            currentData.pState->setVao(useVsSkinning ? pMesh->getVao() : pModel->getMeshVao(pMesh));
+            const uint32_t meshInstanceCount = getMeshInstanceCount(pModel);
+            for (uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                instances.push_back({ modelID, instanceID, firstMesh, packetCount });
+                packetCount += meshInstanceCount;
+            }
+        }
 
-            uint32_t activeInstances = 0;
+        if (currentData.pCamera)
+        {
+            currentData.pCamera->getViewProjMatrix();
+        }
 
-            const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
-            for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
+        // Every mesh instance has a fixed slot in the traversal order, so model instances can be processed in parallel without synchronization
+        mDrawPackets.resize(packetCount);
+        TaskScheduler::instance().parallelFor(0, instances.size(), [&](size_t begin, size_t end)
+        {
+            CurrentWorkingData workerData = currentData;
+            for (size_t i = begin; i < end; i++)
             {
-                const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshID, instanceID).get();
+                const InstanceRange& range = instances[i];
+                const Scene::ModelInstance* pModelInstance = mpScene->getModelInstance(range.modelID, range.instanceID).get();
+                const Model* pModel = pModelInstance->getObject().get();
 
-                if (pMeshInstance->isVisible())
+                workerData.visibilityIndex = range.firstPacket;
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
                 {
-                    if ((mCullEnabled == false) || (cullMeshInstance(currentData, pModelInstance, pMeshInstance) == false))
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
                     {
-                        if (setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, activeInstances))
-                        {
-                            currentData.drawID++;
-                            activeInstances++;
-
-                            if (activeInstances == mMaxInstanceCount)
-                            {
-                                // DISABLED_FOR_D3D12
-                                //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
-                                draw(currentData, pMesh, activeInstances);
-                                activeInstances = 0;
-                            }
-                        }
+                        const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshID, meshInstanceID).get();
+                        bool visible = pModelInstance->isVisible() && pMeshInstance->isVisible();
+                        visible = visible && ((mCullEnabled == false) || (cullMeshInstance(workerData, pModelInstance, pMeshInstance) == false));
+
+                        DrawPacket& packet = mDrawPackets[workerData.visibilityIndex];
+                        packet.sortKey = meshSortKeys[range.firstMesh + meshID];
+                        packet.sequence = workerData.visibilityIndex;
+                        packet.modelID = range.modelID;
+                        packet.meshIndex = range.firstMesh + meshID;
+                        packet.modelInstanceID = range.instanceID;
+                        packet.pModelInstance = pModelInstance;
+                        packet.pMeshInstance = visible ? pMeshInstance : nullptr;
+                        workerData.visibilityIndex++;
                     }
                 }
             }
-            if(activeInstances != 0)
+        });
+
+        mDrawPackets.erase(std::remove_if(mDrawPackets.begin(), mDrawPackets.end(), [](const DrawPacket& packet) { return packet.pMeshInstance == nullptr; }), mDrawPackets.end());
+        // Blending depends on the submission order, so blended draws keep the scene traversal order
+        if (mSortDraws && (isBlendingEnabled(currentData.pState) == false)) sortDrawPackets(mDrawPackets);
+    }
+
+    void SceneRenderer::renderDrawList(CurrentWorkingData& currentData)
+    {
+        mpLastMaterial = nullptr;
+        currentData.pModel = nullptr;
+
+        bool modelValid = false;
+        const Scene::ModelInstance* pModelInstance = nullptr;
+        bool modelInstanceValid = false;
+        uint32_t meshIndex = uint32_t(-1);
+        bool meshValid = false;
+        // The program which has the _VERTEX_BLENDING define. The hooks can switch programs, so it isn't necessarily the bound one.
+        Program* pBlendingProgram = nullptr;
+
+        // Replay the packets, only changing the state that differs from the previous packet
+        size_t packetID = 0;
+        while (packetID < mDrawPackets.size())
+        {
+            const DrawPacket& packet = mDrawPackets[packetID];
+            const DrawMesh& drawMesh = mDrawMeshes[packet.meshIndex];
+
+            if (drawMesh.pModel != currentData.pModel)
             {
-                draw(currentData, pMesh, activeInstances);
+                currentData.pModel = drawMesh.pModel;
+                modelValid = setPerModelData(currentData);
+                pModelInstance = nullptr;
             }
 
-            // Restore the program state
-            if (useVsSkinning)
+            if (packet.pModelInstance != pModelInstance)
             {
-                pProgram->removeDefine("_VERTEX_BLENDING");
+                pModelInstance = packet.pModelInstance;
+                modelInstanceValid = modelValid && setPerModelInstanceData(currentData, pModelInstance, packet.modelInstanceID);
+
+                // The per-model and per-instance hooks can bind different vars or programs, so the mesh and material state is set again for every model instance
+                meshIndex = uint32_t(-1);
+                mpLastMaterial = nullptr;
             }
-        }
-    }
 
-    void SceneRenderer::renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance)
-    {
-        mpLastMaterial = nullptr;
+            if (packet.meshIndex != meshIndex)
+            {
+                meshIndex = packet.meshIndex;
+                meshValid = setPerMeshData(currentData, drawMesh.pMesh);
+                if (meshValid)
+                {
+                    // Fetch the program after the per-model and per-mesh hooks, they might have bound a different one
+                    Program* pProgram = currentData.pState->getProgram().get();
+                    Program* pNewBlendingProgram = drawMesh.useVsSkinning ? pProgram : nullptr;
+                    if (pNewBlendingProgram != pBlendingProgram)
+                    {
+                        if (pBlendingProgram) pBlendingProgram->removeDefine("_VERTEX_BLENDING");
+                        if (pNewBlendingProgram) pNewBlendingProgram->addDefine("_VERTEX_BLENDING");
+                        pBlendingProgram = pNewBlendingProgram;
+                    }
+                    currentData.pState->setVao(drawMesh.pVao);
+                }
+            }
+
+            // Consecutive packets of the same mesh and model instance are drawn with instancing
+            size_t batchEnd = packetID + 1;
+            while (batchEnd < mDrawPackets.size() && mDrawPackets[batchEnd].meshIndex == packet.meshIndex && mDrawPackets[batchEnd].pModelInstance == pModelInstance) batchEnd++;
+
+            if (modelInstanceValid && meshValid)
+            {
+                uint32_t activeInstances = 0;
+                for (size_t i = packetID; i < batchEnd; i++)
+                {
+                    if (setPerMeshInstanceData(currentData, pModelInstance, mDrawPackets[i].pMeshInstance, activeInstances))
+                    {
+                        currentData.drawID++;
+                        activeInstances++;
+
+                        if (activeInstances == mMaxInstanceCount)
+                        {
+                            draw(currentData, drawMesh.pMesh, activeInstances);
+                            activeInstances = 0;
+                        }
+                    }
+                }
 
-        // Loop over the meshes
-        for (uint32_t meshID = 0; meshID < pModelInstance->getObject()->getMeshCount(); meshID++)
+                if (activeInstances != 0)
+                {
+                    draw(currentData, drawMesh.pMesh, activeInstances);
+                }
+            }
+            packetID = batchEnd;
+        }
+
+        // Restore the program state
+        if (pBlendingProgram)
         {
-            renderMeshInstances(currentData, pModelInstance, meshID);
+            pBlendingProgram->removeDefine("_VERTEX_BLENDING");
         }
     }
 
@@ -352,31 +522,126 @@ namespace Falcor
         renderScene(pContext, mpScene->getActiveCamera().get());
     }
 
-    void SceneRenderer::renderScene(CurrentWorkingData& currentData)
+    uint32_t SceneRenderer::getMeshInstanceCount(const Model* pModel) const
     {
-        setPerFrameData(currentData);
+        uint32_t count = 0;
+        for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+        {
+            count += pModel->getMeshInstanceCount(meshID);
+        }
+        return count;
+    }
 
-        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+    void SceneRenderer::updateBvh()
+    {
+        // Rebuild the hierarchy if model instances were added or removed, since that invalidates the instance IDs.
+        // A model whose mesh instances changed has a different number of leaves, which also shifts the leaves of the following instances.
+        bool rebuild = (mpBvh == nullptr) || (mBvhSceneGeneration != mpScene->getModelInstanceGeneration());
+        for (size_t i = 0; i < mBvhInstances.size() && rebuild == false; i++)
         {
-            currentData.pModel = mpScene->getModel(modelID).get();
+            const BvhInstance& bvhInstance = mBvhInstances[i];
+            const Model* pModel = mpScene->getModelInstance(bvhInstance.modelID, bvhInstance.instanceID)->getObject().get();
+            rebuild = (getMeshInstanceCount(pModel) != bvhInstance.leafCount);
+        }
 
-            if (setPerModelData(currentData))
+        // Leaves are ordered the same way renderScene() traverses the mesh instances
+        std::vector<BoundingBox> boxes;
+        const auto appendLeafBounds = [&boxes](const Scene::ModelInstance* pInstance, const glm::mat4& transform)
+        {
+            const Model* pModel = pInstance->getObject().get();
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                for (uint32_t i = 0; i < pModel->getMeshInstanceCount(meshID); i++)
+                {
+                    boxes.push_back(pModel->getMeshInstance(meshID, i)->getBoundingBox().transform(transform));
+                }
+            }
+        };
+
+        if (rebuild)
+        {
+            mBvhInstances.clear();
+            for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
             {
                 for (uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
                 {
-                    const auto pInstance = mpScene->getModelInstance(modelID, instanceID).get();
-                    if (pInstance->isVisible())
-                    {
-                        if (setPerModelInstanceData(currentData, pInstance, instanceID))
-                        {
-                            renderModelInstance(currentData, pInstance);
-                        }
-                    }
+                    const Scene::ModelInstance* pInstance = mpScene->getModelInstance(modelID, instanceID).get();
+                    uint32_t firstLeaf = (uint32_t)boxes.size();
+                    appendLeafBounds(pInstance, pInstance->getTransformMatrix());
+                    mBvhInstances.push_back({ modelID, instanceID, pInstance->getTransformMatrix(), firstLeaf, (uint32_t)boxes.size() - firstLeaf });
                 }
             }
+
+            if (mpBvh == nullptr) mpBvh = SceneBvh::create();
+            mpBvh->build(boxes);
+            mBvhSceneGeneration = mpScene->getModelInstanceGeneration();
+            mVisibilityDirty = true;
+            return;
+        }
+
+        // Refit the leaves of the instances that moved
+        bool moved = false;
+        for (auto& bvhInstance : mBvhInstances)
+        {
+            const Scene::ModelInstance* pInstance = mpScene->getModelInstance(bvhInstance.modelID, bvhInstance.instanceID).get();
+            const glm::mat4& transform = pInstance->getTransformMatrix();
+            if (transform == bvhInstance.transform) continue;
+
+            bvhInstance.transform = transform;
+            boxes.clear();
+            appendLeafBounds(pInstance, transform);
+            for (uint32_t i = 0; i < bvhInstance.leafCount; i++)
+            {
+                mpBvh->setLeafBounds(bvhInstance.firstLeaf + i, boxes[i]);
+            }
+            moved = true;
+        }
+
+        if (moved)
+        {
+            mpBvh->refit();
+            mVisibilityDirty = true;
         }
     }
 
+    const std::vector<uint8_t>& SceneRenderer::cullScene(const Camera* pCamera)
+    {
+        updateBvh();
+
+        const glm::mat4& viewProjMat = pCamera->getViewProjMatrix();
+        if (mVisibilityDirty || (viewProjMat != mCulledViewProjMat))
+        {
+            glm::vec4 planes[6];
+            pCamera->getFrustumPlanes(planes);
+            mpBvh->cull(planes, mVisibility);
+
+            mCulledViewProjMat = viewProjMat;
+            mVisibilityDirty = false;
+        }
+        return mVisibility;
+    }
+
+    void SceneRenderer::renderScene(CurrentWorkingData& currentData)
+    {
+        setPerFrameData(currentData);
+        buildDrawList(currentData);
+        renderDrawList(currentData);
+    }
+
+    const std::vector<SceneRenderer::DrawPacket>& SceneRenderer::buildDrawList(const Camera* pCamera)
+    {
+        assert(pCamera);
+        CurrentWorkingData currentData;
+        currentData.pCamera = pCamera;
+        currentData.drawID = 0;
+        if (mCullEnabled)
+        {
+            currentData.pVisibility = cullScene(pCamera).data();
+        }
+        buildDrawList(currentData);
+        return mDrawPackets;
+    }
+
     void SceneRenderer::renderScene(RenderContext* pContext, const Camera* pCamera)
     {
         updateVariableOffsets(pContext->getGraphicsVars()->getReflection().get());
@@ -389,6 +654,10 @@ namespace Falcor
         currentData.pMaterial = nullptr;
         currentData.pModel = nullptr;
         currentData.drawID = 0;
+        if (mCullEnabled && pCamera)
+        {
+            currentData.pVisibility = cullScene(pCamera).data();
+        }
         renderScene(currentData);
     }
 
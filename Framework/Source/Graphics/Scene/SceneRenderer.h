@@ -33,6 +33,7 @@
 #include "Utils/CpuTimer.h"
 #include "API/ConstantBuffer.h"
 #include "Utils/DebugDrawer.h"
+#include "SceneBvh.h"
 
 namespace Falcor
 {
@@ -81,6 +82,52 @@ namespace Falcor
         */
         bool isMeshCullingEnabled() const { return mCullEnabled; }
 
+        /** Cull the scene against a camera using a BVH over the mesh instances' world-space bounds.
+            The result is cached, so passes rendering with the same camera and an unchanged scene (for example a depth pre-pass followed by a forward pass) only cull once.
+            Changes to model-instance transforms are picked up automatically. Mesh-instance transforms inside a model are assumed to be static.
+            \param[in] pCamera The camera to cull against
+            \return Per mesh-instance visibility. Mesh instances are ordered by model, model instance, mesh and mesh instance.
+        */
+        const std::vector<uint8_t>& cullScene(const Camera* pCamera);
+
+        /** A mesh instance to draw. renderScene() builds an array of packets from the scene in parallel, sorts it and then submits it.
+        */
+        struct DrawPacket
+        {
+            uint64_t sortKey;                                   ///< See makeSortKey()
+            uint32_t sequence;                                  ///< Index of the mesh instance in the scene traversal order
+            uint32_t modelID;                                   ///< Index of the model in the scene
+            uint32_t meshIndex;                                 ///< Index of the mesh in the renderer's per-frame mesh table
+            uint32_t modelInstanceID;                           ///< Index of the model instance in its model
+            const Scene::ModelInstance* pModelInstance;
+            const Model::MeshInstance* pMeshInstance;
+        };
+
+        /** Create a draw packet sort key. Packets are ordered by program variant, then by material and then by VAO.
+            The key only affects the order of the packets, so IDs that don't fit into it only make the sorting less effective.
+        */
+        static uint64_t makeSortKey(uint32_t programID, uint32_t materialID, uint32_t vaoID);
+
+        /** Sort draw packets by model, then by key. Keeping the models together means the per-model data, such as the bone matrices, is only set once per model.
+            Packets with equal keys keep the scene traversal order, so the instances of a mesh stay together and are drawn with a single call.
+        */
+        static void sortDrawPackets(std::vector<DrawPacket>& packets);
+
+        /** Run the CPU stage of renderScene() without submitting anything: cull the scene, build the draw packets and sort them.
+            \param[in] pCamera The camera to cull against
+            \return The draw list. It is valid until the next call to buildDrawList() or renderScene().
+        */
+        const std::vector<DrawPacket>& buildDrawList(const Camera* pCamera);
+
+        /** Enable/disable sorting the draw packets. When disabled, meshes are drawn in the scene traversal order.
+            The packets are never sorted when the graphics state has blending enabled, since the result of blending depends on the submission order.
+        */
+        void toggleDrawSorting(bool enable) { mSortDraws = enable; }
+
+        /** Check if draw sorting is enabled
+        */
+        bool isDrawSortingEnabled() const { return mSortDraws; }
+
         /** Set the maximal number of mesh instance to dispatch in a single draw call.
         */
         void setMaxInstanceCount(uint32_t instanceCount) { mMaxInstanceCount = instanceCount; }
@@ -112,6 +159,9 @@ namespace Falcor
             const Material* pMaterial = nullptr;
 
             uint32_t drawID; // Zero-based mesh instance draw order/ID. Resets at the beginning of renderScene, and increments per mesh instance drawn.
+
+            const uint8_t* pVisibility = nullptr; // Result of cullScene(), or nullptr if it isn't used
+            uint32_t visibilityIndex = 0;         // Index of the current mesh instance into pVisibility
         };
 
         SceneRenderer(const Scene::SharedPtr& pScene);
@@ -138,6 +188,8 @@ namespace Falcor
 
         static void updateVariableOffsets(const ProgramReflection* pReflector);
 
+        /** Per-draw hooks. renderScene() calls them on the calling thread while replaying the draw list, so overrides can bind state and call the render context.
+        */
         virtual void setPerFrameData(const CurrentWorkingData& currentData);
         virtual bool setPerModelData(const CurrentWorkingData& currentData);
         virtual bool setPerModelInstanceData(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t instanceID);
@@ -146,13 +198,19 @@ namespace Falcor
         virtual bool setPerMaterialData(const CurrentWorkingData& currentData, const Material* pMaterial);
         virtual void executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount);
         virtual void postFlushDraw(const CurrentWorkingData& currentData);
+        /** Check if a mesh instance should be skipped. Unlike the other hooks, this is called concurrently from TaskScheduler worker threads while building the draw list.
+            Overrides must be thread-safe: they can only read the scene and currentData, and must not change the renderer's members, the vars or the render context.
+            currentData.pContext, pVars and pState are nullptr when the draw list is built by the public buildDrawList().
+        */
         virtual bool cullMeshInstance(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance);
 
-        void renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance);
-        void renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID);
+        void buildDrawList(const CurrentWorkingData& currentData);
+        void renderDrawList(CurrentWorkingData& currentData);
         void draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount);
 
         void renderScene(CurrentWorkingData& currentData);
+        void updateBvh();
+        uint32_t getMeshInstanceCount(const Model* pModel) const;
 
         CameraControllerType mCamControllerType = CameraControllerType::SixDof;
         CameraController::SharedPtr mpCameraController;
@@ -161,5 +219,35 @@ namespace Falcor
         const Material* mpLastMaterial = nullptr;
         bool mCullEnabled = true;
         bool mCompileMaterialWithProgram = true;
+        bool mSortDraws = true;
+
+        // Draw list
+        struct DrawMesh
+        {
+            const Model* pModel;
+            const Mesh* pMesh;
+            Vao::SharedConstPtr pVao;
+            bool useVsSkinning;
+        };
+
+        std::vector<DrawMesh> mDrawMeshes;
+        std::vector<DrawPacket> mDrawPackets;
+
+        // Frustum culling
+        struct BvhInstance
+        {
+            uint32_t modelID;
+            uint32_t instanceID;
+            glm::mat4 transform;    // The transform the instance's leaves were computed with
+            uint32_t firstLeaf;
+            uint32_t leafCount;
+        };
+
+        SceneBvh::SharedPtr mpBvh;
+        std::vector<BvhInstance> mBvhInstances;
+        uint32_t mBvhSceneGeneration = 0;       // The scene's model-instance generation the hierarchy was built for
+        std::vector<uint8_t> mVisibility;
+        glm::mat4 mCulledViewProjMat;           // The frustum the visibility was computed for
+        bool mVisibilityDirty = true;
     };
 }
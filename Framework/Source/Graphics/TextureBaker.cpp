@@ -0,0 +1,966 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureBaker.h"
+#include "Utils/Bitmap.h"
+#include "Utils/DDSHeader.h"
+#include "Utils/Hash.h"
+#include "Utils/MappedFileStream.h"
+#include "Utils/StringUtils.h"
+#include "Utils/TaskScheduler.h"
+#include "Utils/Platform/OS.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <emmintrin.h>
+
+namespace Falcor
+{
+    using namespace DdsHelper;
+
+    std::mutex TextureBaker::sMutex;
+    TextureBaker::Policy TextureBaker::sPolicy = TextureBaker::Policy::PreferBaked;
+    TextureBaker::Options TextureBaker::sOptions;
+
+    static const uint32_t kDdsMagicNumber = 0x20534444;
+    static const uint32_t kDx10FourCC = 0x30315844;     // "DX10"
+    static const uint64_t kBakerVersion = 1;            // Bump whenever the baked output changes, so that old files are baked again
+    static const float kKaiserRadius = 3.0f;            // In destination pixels
+    static const float kKaiserAlpha = 4.0f;
+    static const uint32_t kFromLinearTableSize = 16384;
+
+    /** sRGB conversion tables
+    */
+    struct SrgbTables
+    {
+        float toLinear[256];
+        uint8_t fromLinear[kFromLinearTableSize + 1];
+
+        SrgbTables()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+                toLinear[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (uint32_t i = 0; i <= kFromLinearTableSize; i++)
+            {
+                float c = float(i) / kFromLinearTableSize;
+                float s = (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                fromLinear[i] = uint8_t(std::min(std::max(s * 255.0f + 0.5f, 0.0f), 255.0f));
+            }
+        }
+    };
+
+    static const SrgbTables& getSrgbTables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    /************************************************************************/
+    /* Mip generation                                                       */
+    /************************************************************************/
+    // One RGBA pixel per element. __m128 is wrapped, since GCC ignores its alignment attribute in template arguments
+    struct Pixel
+    {
+        __m128 rgba;
+    };
+    using FloatImage = std::vector<Pixel>;
+
+    static FloatImage toFloat(const uint8_t* pData, uint32_t width, uint32_t height, bool srgb)
+    {
+        const SrgbTables& tables = getSrgbTables();
+        FloatImage image(size_t(width) * height);
+        TaskScheduler::instance().parallelFor(0, image.size(), [&](size_t begin, size_t end)
+        {
+            const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+            for (size_t i = begin; i < end; i++)
+            {
+                const uint8_t* pSrc = pData + i * 4;
+                if (srgb) image[i].rgba = _mm_setr_ps(tables.toLinear[pSrc[0]], tables.toLinear[pSrc[1]], tables.toLinear[pSrc[2]], pSrc[3] / 255.0f);
+                else image[i].rgba = _mm_mul_ps(_mm_setr_ps(pSrc[0], pSrc[1], pSrc[2], pSrc[3]), scale);
+            }
+        });
+        return image;
+    }
+
+    static void toRgba8(const FloatImage& image, bool srgb, std::vector<uint8_t>& data)
+    {
+        const SrgbTables& tables = getSrgbTables();
+        data.resize(image.size() * 4);
+        TaskScheduler::instance().parallelFor(0, image.size(), [&](size_t begin, size_t end)
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 scale = _mm_set1_ps(255.0f);
+            const __m128 tableScale = _mm_set1_ps(float(kFromLinearTableSize));
+            for (size_t i = begin; i < end; i++)
+            {
+                const __m128 pixel = _mm_min_ps(_mm_max_ps(image[i].rgba, zero), one);
+                // Round to nearest and pack the 4 channels into 4 bytes
+                __m128i c = _mm_cvtps_epi32(_mm_mul_ps(pixel, scale));
+                c = _mm_packus_epi16(_mm_packs_epi32(c, c), c);
+                uint32_t packed = (uint32_t)_mm_cvtsi128_si32(c);
+                uint8_t* pDst = data.data() + i * 4;
+                std::memcpy(pDst, &packed, 4);
+                if (srgb)
+                {
+                    alignas(16) int32_t index[4];
+                    _mm_store_si128((__m128i*)index, _mm_cvtps_epi32(_mm_mul_ps(pixel, tableScale)));
+                    pDst[0] = tables.fromLinear[index[0]];
+                    pDst[1] = tables.fromLinear[index[1]];
+                    pDst[2] = tables.fromLinear[index[2]];
+                }
+            }
+        });
+    }
+
+    static FloatImage downsampleBox(const FloatImage& src, uint32_t srcWidth, uint32_t srcHeight, uint32_t width, uint32_t height)
+    {
+        FloatImage dst(size_t(width) * height);
+        TaskScheduler::instance().parallelFor(0, height, [&](size_t begin, size_t end)
+        {
+            const __m128 quarter = _mm_set1_ps(0.25f);
+            for (size_t y = begin; y < end; y++)
+            {
+                const Pixel* pRow0 = src.data() + std::min<size_t>(y * 2, srcHeight - 1) * srcWidth;
+                const Pixel* pRow1 = src.data() + std::min<size_t>(y * 2 + 1, srcHeight - 1) * srcWidth;
+                Pixel* pDst = dst.data() + y * width;
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    uint32_t x0 = std::min(x * 2, srcWidth - 1);
+                    uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+                    __m128 sum = _mm_add_ps(_mm_add_ps(pRow0[x0].rgba, pRow0[x1].rgba), _mm_add_ps(pRow1[x0].rgba, pRow1[x1].rgba));
+                    pDst[x].rgba = _mm_mul_ps(sum, quarter);
+                }
+            }
+        });
+        return dst;
+    }
+
+    static float besselI0(float x)
+    {
+        float sum = 1.0f;
+        float term = 1.0f;
+        for (uint32_t k = 1; k < 20; k++)
+        {
+            float f = x / (2.0f * k);
+            term *= f * f;
+            sum += term;
+        }
+        return sum;
+    }
+
+    static float sinc(float x)
+    {
+        if (std::abs(x) < 1e-6f) return 1.0f;
+        x *= float(M_PI);
+        return std::sin(x) / x;
+    }
+
+    static float kaiser(float x)
+    {
+        if (std::abs(x) >= 1.0f) return 0.0f;
+        return besselI0(kKaiserAlpha * std::sqrt(1.0f - x * x)) / besselI0(kKaiserAlpha);
+    }
+
+    /** The source pixels and weights contributing to each destination pixel along one axis
+    */
+    struct FilterTaps
+    {
+        uint32_t tapCount = 0;
+        std::vector<uint32_t> indices;  // tapCount entries per destination pixel
+        std::vector<float> weights;
+    };
+
+    static FilterTaps computeKaiserTaps(uint32_t srcSize, uint32_t dstSize)
+    {
+        const float scale = float(srcSize) / float(dstSize);
+        const float radius = kKaiserRadius * scale;
+
+        FilterTaps taps;
+        taps.tapCount = uint32_t(std::ceil(radius * 2)) + 1;
+        taps.indices.resize(taps.tapCount * dstSize);
+        taps.weights.resize(taps.tapCount * dstSize);
+        for (uint32_t d = 0; d < dstSize; d++)
+        {
+            const float center = (d + 0.5f) * scale;
+            const int32_t first = int32_t(std::floor(center - radius));
+            float sum = 0;
+            for (uint32_t t = 0; t < taps.tapCount; t++)
+            {
+                int32_t s = first + int32_t(t);
+                float distance = (s + 0.5f - center) / scale;
+                float weight = sinc(distance) * kaiser(distance / kKaiserRadius);
+                taps.indices[d * taps.tapCount + t] = uint32_t(std::min(std::max(s, 0), int32_t(srcSize) - 1));
+                taps.weights[d * taps.tapCount + t] = weight;
+                sum += weight;
+            }
+            for (uint32_t t = 0; t < taps.tapCount; t++) taps.weights[d * taps.tapCount + t] /= sum;
+        }
+        return taps;
+    }
+
+    static FloatImage downsampleKaiser(const FloatImage& src, uint32_t srcWidth, uint32_t srcHeight, uint32_t width, uint32_t height)
+    {
+        TaskScheduler& scheduler = TaskScheduler::instance();
+
+        // Horizontal pass
+        FloatImage horizontal;
+        if (width == srcWidth)
+        {
+            horizontal = src;
+        }
+        else
+        {
+            FilterTaps taps = computeKaiserTaps(srcWidth, width);
+            horizontal.resize(size_t(width) * srcHeight);
+            scheduler.parallelFor(0, srcHeight, [&](size_t begin, size_t end)
+            {
+                for (size_t y = begin; y < end; y++)
+                {
+                    const Pixel* pSrc = src.data() + y * srcWidth;
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        const uint32_t* pIndex = taps.indices.data() + x * taps.tapCount;
+                        const float* pWeight = taps.weights.data() + x * taps.tapCount;
+                        __m128 sum = _mm_setzero_ps();
+                        for (uint32_t t = 0; t < taps.tapCount; t++)
+                        {
+                            sum = _mm_add_ps(sum, _mm_mul_ps(pSrc[pIndex[t]].rgba, _mm_set1_ps(pWeight[t])));
+                        }
+                        horizontal[y * width + x].rgba = sum;
+                    }
+                }
+            });
+        }
+
+        // Vertical pass. The negative lobes can overshoot, so the result is clamped
+        FloatImage dst(size_t(width) * height);
+        FilterTaps taps = computeKaiserTaps(srcHeight, height);
+        scheduler.parallelFor(0, height, [&](size_t begin, size_t end)
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            for (size_t y = begin; y < end; y++)
+            {
+                Pixel* pDst = dst.data() + y * width;
+                for (uint32_t x = 0; x < width; x++) pDst[x].rgba = zero;
+                for (uint32_t t = 0; t < taps.tapCount; t++)
+                {
+                    const Pixel* pSrc = horizontal.data() + size_t(taps.indices[y * taps.tapCount + t]) * width;
+                    const __m128 weight = _mm_set1_ps(taps.weights[y * taps.tapCount + t]);
+                    for (uint32_t x = 0; x < width; x++) pDst[x].rgba = _mm_add_ps(pDst[x].rgba, _mm_mul_ps(pSrc[x].rgba, weight));
+                }
+                for (uint32_t x = 0; x < width; x++) pDst[x].rgba = _mm_min_ps(_mm_max_ps(pDst[x].rgba, zero), one);
+            }
+        });
+        return dst;
+    }
+
+    TextureBaker::Image TextureBaker::generateMips(const uint8_t* pData, uint32_t width, uint32_t height, bool srgb, MipFilter filter)
+    {
+        Image image;
+        image.width = width;
+        image.height = height;
+        image.format = ResourceFormat::RGBA8Unorm;
+        image.mips.resize(bitScanReverse(width | height) + 1);
+        image.mips[0].assign(pData, pData + size_t(width) * height * 4);
+
+        // Each level is filtered from the previous one in full precision
+        FloatImage level = toFloat(pData, width, height, srgb);
+        for (uint32_t mip = 1; mip < image.mips.size(); mip++)
+        {
+            uint32_t srcWidth = std::max(width >> (mip - 1), 1U);
+            uint32_t srcHeight = std::max(height >> (mip - 1), 1U);
+            uint32_t mipWidth = std::max(width >> mip, 1U);
+            uint32_t mipHeight = std::max(height >> mip, 1U);
+            if (filter == MipFilter::Box) level = downsampleBox(level, srcWidth, srcHeight, mipWidth, mipHeight);
+            else level = downsampleKaiser(level, srcWidth, srcHeight, mipWidth, mipHeight);
+            toRgba8(level, srgb, image.mips[mip]);
+        }
+        return image;
+    }
+
+    /************************************************************************/
+    /* Block compression                                                    */
+    /************************************************************************/
+    using Texels = uint8_t[16][4];
+
+    static void loadBlock(const uint8_t* pData, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Texels& texels)
+    {
+        // Blocks on the right and bottom edges replicate the last column and row
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            size_t row = std::min(blockY * 4 + y, height - 1);
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                size_t column = std::min(blockX * 4 + x, width - 1);
+                std::memcpy(texels[y * 4 + x], pData + (row * width + column) * 4, 4);
+            }
+        }
+    }
+
+    /** Find the endpoints of a line fitted to the first N channels of a block. The line follows the principal axis of the colors.
+    */
+    template<uint32_t N>
+    static void fitEndpoints(const Texels& texels, float e0[4], float e1[4])
+    {
+        float mean[N] = {};
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < N; c++) mean[c] += texels[i][c];
+        }
+        for (uint32_t c = 0; c < N; c++) mean[c] /= 16.0f;
+
+        float covariance[N][N] = {};
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t a = 0; a < N; a++)
+            {
+                for (uint32_t b = 0; b < N; b++) covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+            }
+        }
+
+        // Power iteration
+        float axis[N];
+        for (uint32_t c = 0; c < N; c++) axis[c] = 1.0f;
+        for (uint32_t iteration = 0; iteration < 8; iteration++)
+        {
+            float next[N] = {};
+            float largest = 0;
+            for (uint32_t a = 0; a < N; a++)
+            {
+                for (uint32_t b = 0; b < N; b++) next[a] += covariance[a][b] * axis[b];
+                largest = std::max(largest, std::abs(next[a]));
+            }
+            if (largest == 0) break;
+            for (uint32_t c = 0; c < N; c++) axis[c] = next[c] / largest;
+        }
+
+        float length = 0;
+        for (uint32_t c = 0; c < N; c++) length += axis[c] * axis[c];
+        float minT = 0;
+        float maxT = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float t = 0;
+            for (uint32_t c = 0; c < N; c++) t += (texels[i][c] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        minT /= length;
+        maxT /= length;
+
+        for (uint32_t c = 0; c < N; c++)
+        {
+            e0[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+            e1[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+        }
+    }
+
+    /** Least-squares fit of the endpoints to the block, given the selected indices.
+        \param[in] weights The interpolation weight of the second endpoint for each index
+        \return false if the system is singular, in which case the endpoints are unchanged
+    */
+    template<uint32_t N>
+    static bool refineEndpoints(const Texels& texels, const uint8_t indices[16], const float* weights, float e0[4], float e1[4])
+    {
+        float aa = 0, ab = 0, bb = 0;
+        float ax[N] = {};
+        float bx[N] = {};
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float b = weights[indices[i]];
+            float a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (uint32_t c = 0; c < N; c++)
+            {
+                ax[c] += a * texels[i][c];
+                bx[c] += b * texels[i][c];
+            }
+        }
+
+        float det = aa * bb - ab * ab;
+        if (std::abs(det) < 1e-6f) return false;
+        for (uint32_t c = 0; c < N; c++)
+        {
+            e0[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / det, 0.0f), 255.0f);
+            e1[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / det, 0.0f), 255.0f);
+        }
+        return true;
+    }
+
+    /** Select the closest palette entry for each texel.
+        \return The squared error
+    */
+    template<uint32_t N>
+    static float selectIndices(const Texels& texels, const float palette[][4], uint32_t paletteSize, uint8_t indices[16])
+    {
+        float error = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float best = FLT_MAX;
+            for (uint32_t p = 0; p < paletteSize; p++)
+            {
+                float distance = 0;
+                for (uint32_t c = 0; c < N; c++)
+                {
+                    float d = texels[i][c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < best)
+                {
+                    best = distance;
+                    indices[i] = uint8_t(p);
+                }
+            }
+            error += best;
+        }
+        return error;
+    }
+
+    // BC1 - 4-color mode, the weight of the second endpoint for each index
+    static const float kBC1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    static uint16_t packRgb565(const float c[4])
+    {
+        uint16_t r = uint16_t(std::lround(c[0] * 31.0f / 255.0f));
+        uint16_t g = uint16_t(std::lround(c[1] * 63.0f / 255.0f));
+        uint16_t b = uint16_t(std::lround(c[2] * 31.0f / 255.0f));
+        return uint16_t((r << 11) | (g << 5) | b);
+    }
+
+    static void unpackRgb565(uint16_t v, float c[4])
+    {
+        uint32_t r = (v >> 11) & 0x1F;
+        uint32_t g = (v >> 5) & 0x3F;
+        uint32_t b = v & 0x1F;
+        c[0] = float((r << 3) | (r >> 2));
+        c[1] = float((g << 2) | (g >> 4));
+        c[2] = float((b << 3) | (b >> 2));
+        c[3] = 255.0f;
+    }
+
+    static float evaluateBC1(const Texels& texels, uint16_t c0, uint16_t c1, uint8_t indices[16])
+    {
+        float e0[4], e1[4];
+        unpackRgb565(c0, e0);
+        unpackRgb565(c1, e1);
+        float palette[4][4];
+        for (uint32_t p = 0; p < 4; p++)
+        {
+            for (uint32_t c = 0; c < 3; c++) palette[p][c] = e0[c] + (e1[c] - e0[c]) * kBC1Weights[p];
+        }
+        return selectIndices<3>(texels, palette, 4, indices);
+    }
+
+    /** Encode the color part of a BC1, BC2 or BC3 block. Always uses the 4-color mode
+    */
+    static void encodeColorBlock(const Texels& texels, uint8_t* pOut)
+    {
+        float e0[4], e1[4];
+        fitEndpoints<3>(texels, e0, e1);
+        uint16_t c0 = packRgb565(e0);
+        uint16_t c1 = packRgb565(e1);
+        uint8_t indices[16];
+        float error = evaluateBC1(texels, c0, c1, indices);
+
+        if (c0 != c1 && refineEndpoints<3>(texels, indices, kBC1Weights, e0, e1))
+        {
+            uint16_t r0 = packRgb565(e0);
+            uint16_t r1 = packRgb565(e1);
+            uint8_t refined[16];
+            if (evaluateBC1(texels, r0, r1, refined) < error)
+            {
+                c0 = r0;
+                c1 = r1;
+                std::memcpy(indices, refined, sizeof(indices));
+            }
+        }
+
+        // The 4-color mode requires c0 > c1. Swapping the endpoints swaps index 0 with 1 and 2 with 3
+        if (c0 < c1)
+        {
+            std::swap(c0, c1);
+            for (uint32_t i = 0; i < 16; i++) indices[i] ^= 1;
+        }
+        else if (c0 == c1)
+        {
+            std::memset(indices, 0, sizeof(indices));
+        }
+
+        uint32_t bits = 0;
+        for (uint32_t i = 0; i < 16; i++) bits |= uint32_t(indices[i]) << (i * 2);
+        std::memcpy(pOut, &c0, 2);
+        std::memcpy(pOut + 2, &c1, 2);
+        std::memcpy(pOut + 4, &bits, 4);
+    }
+
+    /** Encode a single channel BC4 block. The alpha part of BC3 and each channel of BC5 use the same encoding
+    */
+    static void encodeBC4Block(const uint8_t values[16], uint8_t* pOut)
+    {
+        uint8_t minValue = 255;
+        uint8_t maxValue = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            minValue = std::min(minValue, values[i]);
+            maxValue = std::max(maxValue, values[i]);
+        }
+
+        // 8-value mode, which requires the first endpoint to be the larger one. If all the values are equal, every index is 0
+        uint64_t bits = 0;
+        if (maxValue > minValue)
+        {
+            float palette[8];
+            palette[0] = maxValue;
+            palette[1] = minValue;
+            for (uint32_t i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * maxValue + i * minValue) / 7.0f;
+
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                uint32_t best = 0;
+                for (uint32_t p = 1; p < 8; p++)
+                {
+                    if (std::abs(values[i] - palette[p]) < std::abs(values[i] - palette[best])) best = p;
+                }
+                bits |= uint64_t(best) << (i * 3);
+            }
+        }
+
+        pOut[0] = maxValue;
+        pOut[1] = minValue;
+        for (uint32_t i = 0; i < 6; i++) pOut[2 + i] = uint8_t(bits >> (i * 8));
+    }
+
+    static void encodeChannel(const Texels& texels, uint32_t channel, uint8_t* pOut)
+    {
+        uint8_t values[16];
+        for (uint32_t i = 0; i < 16; i++) values[i] = texels[i][channel];
+        encodeBC4Block(values, pOut);
+    }
+
+    // BC7 - mode 6 only. A single subset with RGBA endpoints, 7 bits per channel plus a p-bit for each endpoint, and 4-bit indices
+    static const uint32_t kBC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    static const float kBC7FloatWeights[16] = { 0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f, 34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f };
+
+    struct BC7Endpoint
+    {
+        uint8_t value[4];   // 7-bit
+        uint8_t pBit;
+    };
+
+    static BC7Endpoint quantizeBC7Endpoint(const float e[4])
+    {
+        BC7Endpoint best = {};
+        float bestError = FLT_MAX;
+        for (uint8_t p = 0; p < 2; p++)
+        {
+            BC7Endpoint candidate;
+            candidate.pBit = p;
+            float error = 0;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                long v = std::lround((e[c] - p) / 2.0f);
+                candidate.value[c] = uint8_t(std::min(std::max(v, 0L), 127L));
+                float d = float((candidate.value[c] << 1) | p) - e[c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                best = candidate;
+            }
+        }
+        return best;
+    }
+
+    static float evaluateBC7(const Texels& texels, const BC7Endpoint& end0, const BC7Endpoint& end1, uint8_t indices[16])
+    {
+        float palette[16][4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            uint32_t a = (end0.value[c] << 1) | end0.pBit;
+            uint32_t b = (end1.value[c] << 1) | end1.pBit;
+            for (uint32_t p = 0; p < 16; p++) palette[p][c] = float(((64 - kBC7Weights[p]) * a + kBC7Weights[p] * b + 32) >> 6);
+        }
+        return selectIndices<4>(texels, palette, 16, indices);
+    }
+
+    class BitWriter
+    {
+    public:
+        BitWriter(uint8_t* pData, size_t size) : mpData(pData) { std::memset(pData, 0, size); }
+        void write(uint32_t value, uint32_t bitCount)
+        {
+            for (uint32_t b = 0; b < bitCount; b++, mPosition++)
+            {
+                if ((value >> b) & 1) mpData[mPosition >> 3] |= uint8_t(1 << (mPosition & 7));
+            }
+        }
+    private:
+        uint8_t* mpData;
+        uint32_t mPosition = 0;
+    };
+
+    static void encodeBC7Block(const Texels& texels, uint8_t* pOut)
+    {
+        float e0[4], e1[4];
+        fitEndpoints<4>(texels, e0, e1);
+        BC7Endpoint end0 = quantizeBC7Endpoint(e0);
+        BC7Endpoint end1 = quantizeBC7Endpoint(e1);
+        uint8_t indices[16];
+        float error = evaluateBC7(texels, end0, end1, indices);
+
+        if (refineEndpoints<4>(texels, indices, kBC7FloatWeights, e0, e1))
+        {
+            BC7Endpoint r0 = quantizeBC7Endpoint(e0);
+            BC7Endpoint r1 = quantizeBC7Endpoint(e1);
+            uint8_t refined[16];
+            if (evaluateBC7(texels, r0, r1, refined) < error)
+            {
+                end0 = r0;
+                end1 = r1;
+                std::memcpy(indices, refined, sizeof(indices));
+            }
+        }
+
+        // The MSB of the first index is implicitly 0
+        if (indices[0] & 0x8)
+        {
+            std::swap(end0, end1);
+            for (uint32_t i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+        }
+
+        BitWriter writer(pOut, 16);
+        writer.write(1 << 6, 7);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            writer.write(end0.value[c], 7);
+            writer.write(end1.value[c], 7);
+        }
+        writer.write(end0.pBit, 1);
+        writer.write(end1.pBit, 1);
+        writer.write(indices[0], 3);
+        for (uint32_t i = 1; i < 16; i++) writer.write(indices[i], 4);
+    }
+
+    using BlockEncoder = void(*)(const Texels& texels, uint8_t* pOut);
+
+    static BlockEncoder getBlockEncoder(ResourceFormat format)
+    {
+        switch (format)
+        {
+        case ResourceFormat::BC1Unorm:
+            return [](const Texels& texels, uint8_t* pOut) { encodeColorBlock(texels, pOut); };
+        case ResourceFormat::BC3Unorm:
+            return [](const Texels& texels, uint8_t* pOut) { encodeChannel(texels, 3, pOut); encodeColorBlock(texels, pOut + 8); };
+        case ResourceFormat::BC4Unorm:
+            return [](const Texels& texels, uint8_t* pOut) { encodeChannel(texels, 0, pOut); };
+        case ResourceFormat::BC5Unorm:
+            return [](const Texels& texels, uint8_t* pOut) { encodeChannel(texels, 0, pOut); encodeChannel(texels, 1, pOut + 8); };
+        case ResourceFormat::BC7Unorm:
+            return encodeBC7Block;
+        default:
+            return nullptr;
+        }
+    }
+
+    std::vector<uint8_t> TextureBaker::compress(const uint8_t* pData, uint32_t width, uint32_t height, ResourceFormat format)
+    {
+        BlockEncoder encoder = getBlockEncoder(format);
+        if (encoder == nullptr)
+        {
+            logError("TextureBaker::compress() - unsupported format " + to_string(format));
+            return {};
+        }
+
+        const uint32_t blockSize = getFormatBytesPerBlock(format);
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+        std::vector<uint8_t> blocks(size_t(blocksX) * blocksY * blockSize);
+        TaskScheduler::instance().parallelFor(0, blocksY, [&](size_t begin, size_t end)
+        {
+            Texels texels;
+            for (size_t y = begin; y < end; y++)
+            {
+                for (uint32_t x = 0; x < blocksX; x++)
+                {
+                    loadBlock(pData, width, height, x, uint32_t(y), texels);
+                    encoder(texels, blocks.data() + (y * blocksX + x) * blockSize);
+                }
+            }
+        });
+        return blocks;
+    }
+
+    /************************************************************************/
+    /* Baking                                                               */
+    /************************************************************************/
+    bool TextureBaker::bake(const Bitmap* pBitmap, bool generateMipLevels, bool srgb, Image& image)
+    {
+        const Options options = getOptions();
+        const uint32_t width = pBitmap->getWidth();
+        const uint32_t height = pBitmap->getHeight();
+        const size_t pixelCount = size_t(width) * height;
+        const uint8_t* pSrc = pBitmap->getData();
+
+        // Convert to RGBA8
+        std::vector<uint8_t> rgba(pixelCount * 4);
+        ResourceFormat format = options.colorFormat;
+        bool opaque = true;
+        switch (pBitmap->getFormat())
+        {
+        case ResourceFormat::BGRA8Unorm:
+        case ResourceFormat::BGRX8Unorm:
+        {
+            const bool hasAlpha = pBitmap->getFormat() == ResourceFormat::BGRA8Unorm;
+            for (size_t i = 0; i < pixelCount; i++)
+            {
+                rgba[i * 4 + 0] = pSrc[i * 4 + 2];
+                rgba[i * 4 + 1] = pSrc[i * 4 + 1];
+                rgba[i * 4 + 2] = pSrc[i * 4 + 0];
+                rgba[i * 4 + 3] = hasAlpha ? pSrc[i * 4 + 3] : 0xFF;
+                opaque = opaque && rgba[i * 4 + 3] == 0xFF;
+            }
+            break;
+        }
+        case ResourceFormat::RG8Unorm:
+            for (size_t i = 0; i < pixelCount; i++)
+            {
+                rgba[i * 4 + 0] = pSrc[i * 2 + 0];
+                rgba[i * 4 + 1] = pSrc[i * 2 + 1];
+                rgba[i * 4 + 3] = 0xFF;
+            }
+            format = ResourceFormat::BC5Unorm;
+            break;
+        case ResourceFormat::R8Unorm:
+            for (size_t i = 0; i < pixelCount; i++)
+            {
+                rgba[i * 4 + 0] = pSrc[i];
+                rgba[i * 4 + 3] = 0xFF;
+            }
+            format = ResourceFormat::BC4Unorm;
+            break;
+        default:
+            return false;
+        }
+
+        if (format == ResourceFormat::BC1Unorm && opaque == false) format = ResourceFormat::BC3Unorm;
+        // Formats without an sRGB variant are always loaded as linear
+        srgb = srgb && (linearToSrgbFormat(format) != format);
+
+        Image mipChain;
+        if (generateMipLevels)
+        {
+            mipChain = generateMips(rgba.data(), width, height, srgb, options.mipFilter);
+        }
+        else
+        {
+            mipChain.mips.push_back(std::move(rgba));
+        }
+
+        image.width = width;
+        image.height = height;
+        image.format = format;
+        image.mips.resize(mipChain.mips.size());
+        for (uint32_t mip = 0; mip < mipChain.mips.size(); mip++)
+        {
+            image.mips[mip] = compress(mipChain.mips[mip].data(), std::max(width >> mip, 1U), std::max(height >> mip, 1U), format);
+        }
+        return true;
+    }
+
+    static DXFormat getDxFormat(ResourceFormat format)
+    {
+        switch (format)
+        {
+        case ResourceFormat::RGBA8Unorm:
+            return FORMAT_R8G8B8A8_UNORM;
+        case ResourceFormat::BC1Unorm:
+            return FORMAT_BC1_UNORM;
+        case ResourceFormat::BC3Unorm:
+            return FORMAT_BC3_UNORM;
+        case ResourceFormat::BC4Unorm:
+            return FORMAT_BC4_UNORM;
+        case ResourceFormat::BC5Unorm:
+            return FORMAT_BC5_UNORM;
+        case ResourceFormat::BC7Unorm:
+            return FORMAT_BC7_UNORM;
+        default:
+            return FORMAT_UNKNOWN;
+        }
+    }
+
+    bool TextureBaker::writeDds(const std::string& filename, const Image& image)
+    {
+        DdsHeaderDX10 dx10Header = {};
+        dx10Header.dxgiFormat = getDxFormat(image.format);
+        dx10Header.resourceDimension = RESOURCE_DIMENSION_TEXTURE2D;
+        dx10Header.arraySize = 1;
+        if (dx10Header.dxgiFormat == FORMAT_UNKNOWN || image.mips.empty())
+        {
+            logError("TextureBaker::writeDds() - can't write a " + to_string(image.format) + " image");
+            return false;
+        }
+
+        DdsHeader header = {};
+        header.headerSize = sizeof(DdsHeader);
+        header.flags = DdsHeader::kCapsMask | DdsHeader::kHeightMask | DdsHeader::kWidthMask | DdsHeader::kPixelFormatMask | DdsHeader::kMipCountMask | DdsHeader::kLinearSizeMask;
+        header.width = image.width;
+        header.height = image.height;
+        header.linearSize = uint32_t(image.mips[0].size());
+        header.mipCount = uint32_t(image.mips.size());
+        header.pixelFormat.structSize = sizeof(DdsHeader::PixelFormat);
+        header.pixelFormat.flags = DdsHeader::PixelFormat::kFourCCFlag;
+        header.pixelFormat.fourCC = kDx10FourCC;
+        header.caps[0] = DdsHeader::kCapsTextureMask | (image.mips.size() > 1 ? DdsHeader::kCapsMipMapMask | DdsHeader::kCapsComplexMask : 0);
+
+        // Write to a temporary file and rename it, so that a crash never leaves a partial file behind. Threads baking the same file use different temporary files
+        std::string tmpName = filename + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        {
+            std::ofstream stream(tmpName, std::ios::binary | std::ios::trunc);
+            if (stream.is_open() == false)
+            {
+                logWarning("Can't write the baked texture '" + filename + "'");
+                return false;
+            }
+
+            stream.write((const char*)&kDdsMagicNumber, sizeof(kDdsMagicNumber));
+            stream.write((const char*)&header, sizeof(header));
+            stream.write((const char*)&dx10Header, sizeof(dx10Header));
+            for (const auto& mip : image.mips) stream.write((const char*)mip.data(), mip.size());
+            if (stream.good() == false)
+            {
+                stream.close();
+                std::remove(tmpName.c_str());
+                logWarning("Can't write the baked texture '" + filename + "'");
+                return false;
+            }
+        }
+
+        return replaceFile(tmpName, filename);
+    }
+
+    std::string TextureBaker::getBakedFilename(const std::string& filename, bool generateMipLevels, bool srgb)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath) == false) return "";
+        MappedFileStream file(fullpath);
+        if (file.isOpen() == false) return "";
+
+        const Options options = getOptions();
+        const size_t size = file.getRemainingStreamSize();
+        const uint64_t key[] = { xxHash64(file.readView(size), size), kBakerVersion, uint64_t(options.colorFormat), uint64_t(options.mipFilter), generateMipLevels ? 1u : 0u, srgb ? 1u : 0u };
+
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)xxHash64(key, sizeof(key)));
+        return fullpath + "." + hash + ".dds";
+    }
+
+    std::string TextureBaker::bakeTo(const std::string& fullpath, const std::string& bakedFilename, bool generateMipLevels, bool srgb)
+    {
+        // Same orientation as createTextureFromFile()
+        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(fullpath, true);
+        if (pBitmap == nullptr) return "";
+
+        Image image;
+        if (bake(pBitmap.get(), generateMipLevels, srgb, image) == false) return "";
+        return writeDds(bakedFilename, image) ? bakedFilename : "";
+    }
+
+    std::string TextureBaker::bakeFile(const std::string& filename, bool generateMipLevels, bool srgb)
+    {
+        std::string fullpath;
+        std::string bakedFilename = getBakedFilename(filename, generateMipLevels, srgb);
+        if (bakedFilename.empty() || findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logWarning("TextureBaker::bakeFile() - can't find the file '" + filename + "'");
+            return "";
+        }
+        return bakeTo(fullpath, bakedFilename, generateMipLevels, srgb);
+    }
+
+    std::string TextureBaker::findBakedFile(const std::string& filename, bool generateMipLevels, bool srgb)
+    {
+        const Policy policy = getPolicy();
+        if (policy == Policy::Disabled) return "";
+        // Only 8-bit images are baked
+        for (const char* suffix : { ".dds", ".hdr", ".exr", ".pfm" })
+        {
+            if (hasSuffix(filename, suffix, false)) return "";
+        }
+
+        std::string bakedFilename = getBakedFilename(filename, generateMipLevels, srgb);
+        if (bakedFilename.empty()) return "";
+        if (doesFileExist(bakedFilename)) return bakedFilename;
+        if (policy == Policy::BakeOnLoad)
+        {
+            std::string fullpath;
+            findFileInDataDirectories(filename, fullpath);
+            return bakeTo(fullpath, bakedFilename, generateMipLevels, srgb);
+        }
+        return "";
+    }
+
+    void TextureBaker::setPolicy(Policy policy)
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sPolicy = policy;
+    }
+
+    TextureBaker::Policy TextureBaker::getPolicy()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        return sPolicy;
+    }
+
+    void TextureBaker::setOptions(const Options& options)
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sOptions = options;
+        if (sOptions.colorFormat != ResourceFormat::BC1Unorm && sOptions.colorFormat != ResourceFormat::BC3Unorm && sOptions.colorFormat != ResourceFormat::BC7Unorm)
+        {
+            logWarning("TextureBaker::setOptions() - the color format must be BC1Unorm, BC3Unorm or BC7Unorm. Using BC7Unorm");
+            sOptions.colorFormat = ResourceFormat::BC7Unorm;
+        }
+    }
+
+    TextureBaker::Options TextureBaker::getOptions()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        return sOptions;
+    }
+}
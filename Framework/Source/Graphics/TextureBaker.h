@@ -0,0 +1,156 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <mutex>
+#include <string>
+#include <vector>
+#include "API/Formats.h"
+
+namespace Falcor
+{
+    class Bitmap;
+
+    /** CPU texture baking.
+        Generates mip-chains and block-compresses 8-bit images, and caches the result as a DDS file next to the source image. The baked file is named after a hash of the source content and the baking options, so editing the image or changing the options creates a new file.
+        Everything runs on the CPU and doesn't require a device. Mip filtering and compression are spread across the task scheduler's threads.
+        createTextureFromFile() loads baked files according to the policy, see setPolicy(). Textures which need to be render-targets or UAVs are never baked.
+        The functions are thread-safe.
+    */
+    class TextureBaker
+    {
+    public:
+        /** Mip-map downsampling filter
+        */
+        enum class MipFilter
+        {
+            Box,        ///< 2x2 average. Fastest
+            Kaiser,     ///< Kaiser-windowed sinc. Sharper mips with less aliasing
+        };
+
+        /** How createTextureFromFile() uses baked files
+        */
+        enum class Policy
+        {
+            Disabled,       ///< Always load the source image
+            PreferBaked,    ///< Load the baked file if there's one for the current source content, otherwise the source image
+            BakeOnLoad,     ///< Like PreferBaked, but bake missing files while loading
+        };
+
+        struct Options
+        {
+            ResourceFormat colorFormat = ResourceFormat::BC7Unorm;  ///< Format for 3 and 4 channel images. BC1Unorm, BC3Unorm or BC7Unorm. BC1 is replaced with BC3 for images with transparency. 1 and 2 channel images use BC4 and BC5
+            MipFilter mipFilter = MipFilter::Kaiser;
+        };
+
+        /** An image with its mip-chain. Each mip-level is tightly packed
+        */
+        struct Image
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            ResourceFormat format = ResourceFormat::Unknown;
+            std::vector<std::vector<uint8_t>> mips;
+        };
+
+        /** Generate a full mip-chain for an RGBA8 image.
+            \param[in] pData The top mip-level, tightly packed
+            \param[in] width The width of the image
+            \param[in] height The height of the image
+            \param[in] srgb If true, the color channels are sRGB-encoded and are averaged in linear space. Alpha is always linear
+            \param[in] filter The downsampling filter
+            \return An RGBA8Unorm image. The first level is a copy of the input
+        */
+        static Image generateMips(const uint8_t* pData, uint32_t width, uint32_t height, bool srgb, MipFilter filter);
+
+        /** Block-compress an RGBA8 image.
+            \param[in] pData The image, tightly packed
+            \param[in] width The width of the image
+            \param[in] height The height of the image
+            \param[in] format The compressed format. BC1Unorm, BC3Unorm, BC4Unorm, BC5Unorm or BC7Unorm. BC4 encodes the red channel and BC5 the red and green channels
+            \return The compressed blocks, or an empty vector if the format isn't supported
+        */
+        static std::vector<uint8_t> compress(const uint8_t* pData, uint32_t width, uint32_t height, ResourceFormat format);
+
+        /** Bake a bitmap using the current options.
+            \param[in] pBitmap The bitmap. Must be an 8-bit per channel format
+            \param[in] generateMipLevels Whether to generate the mip-chain
+            \param[in] srgb Whether the color channels are sRGB-encoded
+            \param[out] image The compressed image. The format is always linear, the texture should be created with the sRGB variant when srgb is true
+            \return false if the bitmap format can't be baked
+        */
+        static bool bake(const Bitmap* pBitmap, bool generateMipLevels, bool srgb, Image& image);
+
+        /** Write an image to a DDS file with a DX10 header. The file is written under a temporary name and renamed, so a crash never leaves a partial file behind.
+            \return true on success, otherwise false
+        */
+        static bool writeDds(const std::string& filename, const Image& image);
+
+        /** Get the name of the baked file for an image. The file might not exist.
+            \param[in] filename The source image. Can also include a full path or relative path from a data directory
+            \param[in] generateMipLevels Whether the baked file holds a mip-chain
+            \param[in] srgb Whether the image is sRGB-encoded
+            \return The full path of the baked file, or an empty string if the source file can't be found
+        */
+        static std::string getBakedFilename(const std::string& filename, bool generateMipLevels, bool srgb);
+
+        /** Bake an image file and write the result next to it. Use it to bake textures offline.
+            \param[in] filename The source image. Can also include a full path or relative path from a data directory
+            \param[in] generateMipLevels Whether to generate the mip-chain
+            \param[in] srgb Whether the image is sRGB-encoded
+            \return The full path of the baked file, or an empty string on failure
+        */
+        static std::string bakeFile(const std::string& filename, bool generateMipLevels, bool srgb);
+
+        /** Find the baked file createTextureFromFile() should load instead of a source image. Depending on the policy, the file might be baked first.
+            \return The full path of the baked file, or an empty string if the source image should be loaded
+        */
+        static std::string findBakedFile(const std::string& filename, bool generateMipLevels, bool srgb);
+
+        /** Set how createTextureFromFile() uses baked files. The default is Policy::PreferBaked
+        */
+        static void setPolicy(Policy policy);
+
+        /** Get how createTextureFromFile() uses baked files
+        */
+        static Policy getPolicy();
+
+        /** Set the options used by bake() and bakeFile(). Files baked with different options are kept apart
+        */
+        static void setOptions(const Options& options);
+
+        /** Get the current baking options
+        */
+        static Options getOptions();
+
+    private:
+        static std::string bakeTo(const std::string& fullpath, const std::string& bakedFilename, bool generateMipLevels, bool srgb);
+        static std::mutex sMutex;   // Protects sPolicy and sOptions
+        static Policy sPolicy;
+        static Options sOptions;
+    };
+}
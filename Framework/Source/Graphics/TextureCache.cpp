@@ -0,0 +1,317 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureCache.h"
+#include "TextureHelper.h"
+#include "Utils/Hash.h"
+#include "Utils/MappedFileStream.h"
+#include "Utils/Platform/OS.h"
+#include <algorithm>
+#include <tuple>
+
+namespace Falcor
+{
+    static size_t getTextureMemorySize(const Texture* pTexture)
+    {
+        ResourceFormat format = pTexture->getFormat();
+        uint32_t ratioX = getFormatWidthCompressionRatio(format);
+        uint32_t ratioY = getFormatHeightCompressionRatio(format);
+        size_t size = 0;
+        for (uint32_t mip = 0; mip < pTexture->getMipCount(); mip++)
+        {
+            size_t blocksX = (pTexture->getWidth(mip) + ratioX - 1) / ratioX;
+            size_t blocksY = (pTexture->getHeight(mip) + ratioY - 1) / ratioY;
+            size += blocksX * blocksY * pTexture->getDepth(mip) * getFormatBytesPerBlock(format);
+        }
+        return size * pTexture->getArraySize() * pTexture->getSampleCount();
+    }
+
+    static void unsubscribe(const std::vector<FileWatcher::SubscriptionID>& subscriptions)
+    {
+        for (auto id : subscriptions) FileWatcher::instance().unsubscribe(id);
+    }
+
+    bool TextureCache::ContentKey::operator<(const ContentKey& other) const
+    {
+        return std::tie(hash, size, width, height, format, mipLevels, mipSkip, bindFlags, loadAsSrgb) < std::tie(other.hash, other.size, other.width, other.height, other.format, other.mipLevels, other.mipSkip, other.bindFlags, other.loadAsSrgb);
+    }
+
+    TextureCache& TextureCache::instance()
+    {
+        static TextureCache cache;
+        return cache;
+    }
+
+    Texture::SharedPtr TextureCache::createFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        return findOrCreateFromFile(filename, generateMipLevels, loadAsSrgb, bindFlags, [&]() { return createTextureFromFile(filename, generateMipLevels, loadAsSrgb, bindFlags); });
+    }
+
+    Texture::SharedPtr TextureCache::createFromBitmap(const Bitmap* pBitmap, const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        if (pBitmap == nullptr) return nullptr;
+        return findOrCreateFromFile(filename, generateMipLevels, loadAsSrgb, bindFlags, [&]() { return createTextureFromBitmap(pBitmap, filename, generateMipLevels, loadAsSrgb, bindFlags); });
+    }
+
+    Texture::SharedPtr TextureCache::create2D(uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevels, const void* pData, size_t dataSize, const std::string& sourceName, Texture::BindFlags bindFlags)
+    {
+        ContentKey key = {};
+        key.hash = xxHash64(pData, dataSize);
+        key.size = dataSize;
+        key.width = width;
+        key.height = height;
+        key.format = format;
+        key.mipLevels = mipLevels;
+        key.bindFlags = bindFlags;
+
+        return findOrCreate(key, "", "", [&]()
+        {
+            Texture::SharedPtr pTexture = Texture::create2D(width, height, format, 1, mipLevels, pData, bindFlags);
+            if (pTexture) pTexture->setSourceFilename(sourceName);
+            return pTexture;
+        });
+    }
+
+    Texture::SharedPtr TextureCache::findOrCreateFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const TextureFactory& factory)
+    {
+        // Let the factory report missing files
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath) == false) return factory();
+
+        ContentKey key = {};
+        key.format = ResourceFormat::Unknown;
+        key.mipLevels = generateMipLevels ? Texture::kMaxPossible : 1;
+        key.mipSkip = getDdsMipSkip();
+        key.bindFlags = bindFlags;
+        key.loadAsSrgb = loadAsSrgb;
+
+        const std::string pathKey = fullpath + '|' + std::to_string(key.mipLevels) + '|' + std::to_string(key.mipSkip) + '|' + std::to_string((uint32_t)bindFlags) + (loadAsSrgb ? "|srgb" : "");
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto path = mPaths.find(pathKey);
+            if (path != mPaths.end())
+            {
+                auto it = mEntries.find(path->second.key);
+                assert(it != mEntries.end());
+                mStats.pathHits++;
+                mLru.splice(mLru.begin(), mLru, it->second.lruIt);
+                return it->second.pTexture;
+            }
+        }
+
+        // Not found by path, look for the same content. Hashing the mapped file is much cheaper than decoding and uploading the image.
+        {
+            MappedFileStream file(fullpath);
+            if (file.isOpen() == false) return factory();
+            key.size = file.getRemainingStreamSize();
+            key.hash = xxHash64(file.readView(key.size), key.size);
+        }
+        return findOrCreate(key, pathKey, fullpath, factory);
+    }
+
+    Texture::SharedPtr TextureCache::findOrCreate(const ContentKey& key, const std::string& pathKey, const std::string& fullpath, const TextureFactory& factory)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mEntries.find(key);
+            if (it != mEntries.end())
+            {
+                mStats.contentHits++;
+                mLru.splice(mLru.begin(), mLru, it->second.lruIt);
+                if (pathKey.size()) addPathLocked(pathKey, fullpath, key, it->second);
+                return it->second.pTexture;
+            }
+        }
+
+        // Create the texture without holding the lock. Another thread may create the same texture meanwhile, in which case the first one is kept.
+        Texture::SharedPtr pTexture = factory();
+        if (pTexture == nullptr) return nullptr;
+
+        std::vector<FileWatcher::SubscriptionID> subscriptions;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStats.misses++;
+            auto insertion = mEntries.emplace(key, Entry());
+            Entry& entry = insertion.first->second;
+            if (insertion.second)
+            {
+                entry.pTexture = pTexture;
+                entry.memorySize = getTextureMemorySize(pTexture.get());
+                entry.lruIt = mLru.insert(mLru.begin(), key);
+                mMemorySize += entry.memorySize;
+            }
+            pTexture = entry.pTexture;
+            if (pathKey.size()) addPathLocked(pathKey, fullpath, key, entry);
+            trimLocked(subscriptions);
+        }
+        unsubscribe(subscriptions);
+        return pTexture;
+    }
+
+    void TextureCache::addPathLocked(const std::string& pathKey, const std::string& fullpath, const ContentKey& key, Entry& entry)
+    {
+        if (mPaths.count(pathKey)) return;
+
+        // Forget the path when the file changes, so that a modified image is loaded again instead of returning the cached texture
+        PathEntry& path = mPaths[pathKey];
+        path.key = key;
+        path.fullpath = fullpath;
+        mFileRefs[fullpath]++;
+        path.subscription = FileWatcher::instance().subscribe(fullpath, [this, pathKey](const std::string&) { onFileChanged(pathKey); });
+        entry.paths.push_back(pathKey);
+    }
+
+    void TextureCache::releaseFileLocked(const std::string& fullpath)
+    {
+        auto it = mFileRefs.find(fullpath);
+        if (--it->second == 0) mFileRefs.erase(it);
+    }
+
+    void TextureCache::onFileChanged(const std::string& pathKey)
+    {
+        FileWatcher::SubscriptionID subscription = FileWatcher::kInvalidSubscription;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto path = mPaths.find(pathKey);
+            if (path == mPaths.end()) return;
+
+            subscription = path->second.subscription;
+            auto it = mEntries.find(path->second.key);
+            if (it != mEntries.end())
+            {
+                auto& paths = it->second.paths;
+                paths.erase(std::remove(paths.begin(), paths.end(), pathKey), paths.end());
+            }
+            releaseFileLocked(path->second.fullpath);
+            mPaths.erase(path);
+        }
+        // Called from the watcher's thread, which allows unsubscribing from inside the callback
+        unsubscribe({ subscription });
+    }
+
+    void TextureCache::eraseLocked(std::map<ContentKey, Entry>::iterator it, std::vector<FileWatcher::SubscriptionID>& subscriptions)
+    {
+        for (const auto& pathKey : it->second.paths)
+        {
+            auto path = mPaths.find(pathKey);
+            subscriptions.push_back(path->second.subscription);
+            releaseFileLocked(path->second.fullpath);
+            mPaths.erase(path);
+        }
+        mLru.erase(it->second.lruIt);
+        mMemorySize -= it->second.memorySize;
+        mEntries.erase(it);
+    }
+
+    void TextureCache::trimLocked(std::vector<FileWatcher::SubscriptionID>& subscriptions)
+    {
+        auto lruIt = mLru.end();
+        while (mMemorySize > mMemoryBudget && lruIt != mLru.begin())
+        {
+            --lruIt;
+            auto it = mEntries.find(*lruIt);
+            // The cache holds the only reference
+            if (it->second.pTexture.use_count() == 1)
+            {
+                lruIt = std::next(lruIt);
+                eraseLocked(it, subscriptions);
+                mStats.evictions++;
+            }
+        }
+    }
+
+    bool TextureCache::containsFile(const std::string& filename) const
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath) == false) return false;
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFileRefs.count(fullpath) != 0;
+    }
+
+    void TextureCache::setMemoryBudget(size_t bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mMemoryBudget = bytes;
+        }
+        trim();
+    }
+
+    size_t TextureCache::getMemoryBudget() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mMemoryBudget;
+    }
+
+    void TextureCache::trim()
+    {
+        std::vector<FileWatcher::SubscriptionID> subscriptions;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            trimLocked(subscriptions);
+        }
+        unsubscribe(subscriptions);
+    }
+
+    void TextureCache::clear()
+    {
+        std::vector<FileWatcher::SubscriptionID> subscriptions;
+        std::map<ContentKey, Entry> entries;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (const auto& path : mPaths) subscriptions.push_back(path.second.subscription);
+            entries.swap(mEntries);
+            mPaths.clear();
+            mFileRefs.clear();
+            mLru.clear();
+            mMemorySize = 0;
+        }
+        unsubscribe(subscriptions);
+        // The textures are released here, outside the lock
+    }
+
+    TextureCache::Stats TextureCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Stats stats = mStats;
+        stats.textureCount = mEntries.size();
+        stats.memorySize = mMemorySize;
+        for (const auto& e : mEntries)
+        {
+            if (e.second.pTexture.use_count() == 1) stats.unreferencedMemorySize += e.second.memorySize;
+        }
+        return stats;
+    }
+
+    void TextureCache::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Stats stats;
+        std::swap(stats, mStats);
+    }
+}
@@ -0,0 +1,181 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "API/Texture.h"
+#include "Utils/Platform/FileWatcher.h"
+
+namespace Falcor
+{
+    class Bitmap;
+
+    /** Process-wide texture cache, shared by the model importers.
+        Textures are found by the canonical path of their file and by a hash of their content, so the same image referenced by several models, or under different paths, is only created once.
+        The cache holds a reference to each texture, so a texture stays cached after its users release it. A texture is unreferenced once the cache holds its only reference.
+        When the textures use more memory than the budget, the unreferenced ones are evicted in least-recently-used order. Referenced textures are never evicted.
+        The functions are thread-safe. Textures are created on the calling thread.
+    */
+    class TextureCache
+    {
+    public:
+        struct Stats
+        {
+            uint64_t pathHits = 0;              ///< Requests which found the texture by its path
+            uint64_t contentHits = 0;           ///< Requests which found a texture with the same content, under a different path or in another model
+            uint64_t misses = 0;                ///< Requests which created a texture
+            uint64_t evictions = 0;             ///< Textures evicted to stay under the memory budget
+            size_t textureCount = 0;            ///< Number of cached textures
+            size_t memorySize = 0;              ///< Estimated memory used by the cached textures
+            size_t unreferencedMemorySize = 0;  ///< The part of memorySize used by unreferenced textures
+        };
+
+        /** Get the global cache
+        */
+        static TextureCache& instance();
+
+        /** Load a texture from a file, or get the cached texture. See createTextureFromFile().
+            \param[in] filename Filename of the image. Can also include a full path or relative path from a data directory
+            \param[in] generateMipLevels Whether the mip-chain should be generated
+            \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3 or 4 component textures.
+            \param[in] bindFlags The bind flags to create the texture with
+            \return The texture, or nullptr if the file can't be loaded
+        */
+        Texture::SharedPtr createFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
+        /** Create a texture from a bitmap which was already loaded from a file, or get the cached texture. See createTextureFromBitmap().
+            The bitmap is only used if the texture isn't in the cache.
+            \param[in] pBitmap The bitmap. Can be nullptr, in which case the function returns nullptr.
+            \param[in] filename The filename the bitmap was loaded from
+            \param[in] generateMipLevels Whether the mip-chain should be generated
+            \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3 or 4 component textures.
+            \param[in] bindFlags The bind flags to create the texture with
+        */
+        Texture::SharedPtr createFromBitmap(const Bitmap* pBitmap, const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
+        /** Create a 2D texture from texel data, or get a cached texture with the same content. Use it for textures stored inside model files.
+            \param[in] width The width of the texture
+            \param[in] height The height of the texture
+            \param[in] format The format of the texture
+            \param[in] mipLevels The number of mip levels, see Texture::create2D()
+            \param[in] pData The texel data
+            \param[in] dataSize The size of the texel data in bytes
+            \param[in] sourceName The source filename to set on a new texture
+            \param[in] bindFlags The bind flags to create the texture with
+        */
+        Texture::SharedPtr create2D(uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevels, const void* pData, size_t dataSize, const std::string& sourceName, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
+        /** Check if a texture loaded from a file is in the cache, with any load options. Importers use it to avoid decoding images which won't be used.
+            \param[in] filename Filename of the image. Can also include a full path or relative path from a data directory
+        */
+        bool containsFile(const std::string& filename) const;
+
+        /** Set the memory budget for the cached textures, and evict unreferenced textures until the cache is within it. The default budget is 1GB.
+        */
+        void setMemoryBudget(size_t bytes);
+
+        /** Get the memory budget
+        */
+        size_t getMemoryBudget() const;
+
+        /** Evict unreferenced textures until the cache is within the memory budget. This is done automatically when textures are added.
+        */
+        void trim();
+
+        /** Release all the cached textures. Must be called before the device is destroyed.
+        */
+        void clear();
+
+        /** Get the statistics
+        */
+        Stats getStats() const;
+
+        /** Reset the hit, miss and eviction counters
+        */
+        void resetStats();
+
+    private:
+        TextureCache() = default;
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        struct ContentKey
+        {
+            uint64_t hash;
+            uint64_t size;
+            uint32_t width;                     ///< 0 for file content
+            uint32_t height;
+            ResourceFormat format;
+            uint32_t mipLevels;
+            uint32_t mipSkip;                   ///< The DDS mip skip the file was loaded with. Also applies to baked images
+            Texture::BindFlags bindFlags;
+            bool loadAsSrgb;
+            bool operator<(const ContentKey& other) const;
+        };
+
+        struct Entry
+        {
+            Texture::SharedPtr pTexture;
+            size_t memorySize = 0;
+            std::list<ContentKey>::iterator lruIt;
+            std::vector<std::string> paths;     ///< The path keys referring to this entry
+        };
+
+        struct PathEntry
+        {
+            ContentKey key;
+            std::string fullpath;
+            FileWatcher::SubscriptionID subscription = FileWatcher::kInvalidSubscription;
+        };
+
+        using TextureFactory = std::function<Texture::SharedPtr()>;
+        Texture::SharedPtr findOrCreateFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const TextureFactory& factory);
+        Texture::SharedPtr findOrCreate(const ContentKey& key, const std::string& pathKey, const std::string& fullpath, const TextureFactory& factory);
+        void onFileChanged(const std::string& pathKey);
+
+        // The functions below must be called with mMutex held. Subscriptions which must be removed are returned in 'subscriptions', FileWatcher::unsubscribe() can't be called while holding the mutex.
+        void addPathLocked(const std::string& pathKey, const std::string& fullpath, const ContentKey& key, Entry& entry);
+        void trimLocked(std::vector<FileWatcher::SubscriptionID>& subscriptions);
+        void eraseLocked(std::map<ContentKey, Entry>::iterator it, std::vector<FileWatcher::SubscriptionID>& subscriptions);
+        void releaseFileLocked(const std::string& fullpath);
+
+        mutable std::mutex mMutex;
+        std::map<ContentKey, Entry> mEntries;
+        std::unordered_map<std::string, PathEntry> mPaths;
+        std::unordered_map<std::string, uint32_t> mFileRefs;   ///< Number of path keys for each file
+        std::list<ContentKey> mLru;             ///< Most recently used first
+        size_t mMemoryBudget = size_t(1) << 30;
+        size_t mMemorySize = 0;
+        Stats mStats;
+    };
+}
@@ -27,12 +27,17 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "TextureHelper.h"
+#include "TextureBaker.h"
 #include "API/Texture.h"
 #include "Utils/Bitmap.h"
 #include "Utils/DDSHeader.h"
-#include "Utils/BinaryFileStream.h"
+#include "Utils/MappedFileStream.h"
 #include "Utils/StringUtils.h"
-#include <cstring>
+#include "Utils/Platform/FileWatcher.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <emmintrin.h>
 
 static const bool kTopDown = true;
 
@@ -494,63 +499,90 @@ namespace Falcor
         }
     }
 
-    //Flip the data so it follows opengl conventions
-    void flipData(DdsData& ddsData, ResourceFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mipDepth, bool isCubemap = false)
+    /** Describes the texture a DDS file holds. The file stores the subresources array slice by array slice, each slice with its full mip-chain.
+    */
+    struct DdsLayout
     {
-        if (!isCompressedFormat(format) && !kTopDown)
-        {
-            std::vector<uint8_t> oldData(ddsData.data.size());
-            oldData.swap(ddsData.data);
-            const uint8_t* currentTexture = oldData.data();
-            const uint8_t* currentDepth = oldData.data();
-            uint8_t* currentPos = ddsData.data.data();
+        Texture::Type type;
+        uint32_t width;
+        uint32_t height;
+        uint32_t depth;
+        uint32_t arraySize;     ///< Number of array elements. A cube counts as a single element
+        uint32_t faceCount;     ///< 6 for cubes, otherwise 1
+        uint32_t mipCount;      ///< Number of mip-levels stored in the file
+    };
+
+    static std::atomic<uint32_t> sDdsMipSkip(0);
+
+    void setDdsMipSkip(uint32_t mipCount)
+    {
+        sDdsMipSkip = mipCount;
+    }
 
-            for (uint32_t mipCounter = 0; mipCounter < mipDepth; ++mipCounter)
-            {
-                uint32_t heightPitch = max(width >> mipCounter, 1U) * getFormatBytesPerBlock(format);
-                uint32_t currentMipHeight = max(height >> mipCounter, 1U);
-                uint32_t depthPitch = currentMipHeight * heightPitch;	
+    uint32_t getDdsMipSkip()
+    {
+        return sDdsMipSkip;
+    }
 
-                for (uint32_t depthCounter = 0; depthCounter < depth; ++depthCounter)
-                {
-                    currentTexture = currentDepth + depthPitch * depthCounter;
-                    
-                    if (isCubemap)
-                    {
-                        if (depthCounter % 6 == 2)
-                        {
-                            currentTexture += depthPitch;
-                        }
-                        else if (depthCounter % 6 == 3)
-                        {
-                            currentTexture -= depthPitch;
-                        }
-                    }
-                    
-                    for (uint32_t heightCounter = 1; heightCounter <= currentMipHeight; ++heightCounter)
-                    {
-                        std::memcpy(currentPos, currentTexture + (currentMipHeight - heightCounter) * heightPitch, heightPitch);
-                        currentPos += heightPitch;
-                    }
-                    
-                }
+    static size_t getDdsSubresourceSize(ResourceFormat format, const DdsLayout& layout, uint32_t mip)
+    {
+        uint32_t ratioX = getFormatWidthCompressionRatio(format);
+        uint32_t ratioY = getFormatHeightCompressionRatio(format);
+        size_t blocksX = (max(layout.width >> mip, 1U) + ratioX - 1) / ratioX;
+        size_t blocksY = (max(layout.height >> mip, 1U) + ratioY - 1) / ratioY;
+        return blocksX * blocksY * max(layout.depth >> mip, 1U) * getFormatBytesPerBlock(format);
+    }
 
-                currentDepth += depthPitch * depth;
-            }
+    /** Flip the rows of an image so it follows OpenGL conventions. The rows are swapped in-place.
+    */
+    static void flipRows(uint8_t* pData, size_t rowPitch, uint32_t rowCount)
+    {
+        uint8_t* pTop = pData;
+        uint8_t* pBottom = pData + (rowCount - 1) * rowPitch;
+        while (pTop < pBottom)
+        {
+            std::swap_ranges(pTop, pTop + rowPitch, pBottom);
+            pTop += rowPitch;
+            pBottom -= rowPitch;
         }
     }
 
-    void loadDDSDataFromFile(const std::string filename, DdsData& ddsData)
+    /** Set the alpha channel of 4-byte pixels to 0xFF
+    */
+    static void fillAlpha(uint8_t* pData, size_t size)
+    {
+        size_t i = 0;
+#if defined(_MSC_VER) || defined(__SSE2__)
+        const __m128i alpha = _mm_set1_epi32(0xFF000000);
+        for (; i + 16 <= size; i += 16)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(pData + i));
+            _mm_storeu_si128((__m128i*)(pData + i), _mm_or_si128(pixels, alpha));
+        }
+#endif
+        for (i += 3; i < size; i += 4)
+        {
+            pData[i] = 0xFF;
+        }
+    }
+
+    /** Map a DDS file and parse its headers. On success, ddsData points at the subresource data inside the mapping.
+    */
+    static bool loadDDSDataFromFile(const std::string& filename, MappedFileStream& stream, DdsData& ddsData)
     {
         std::string fullpath;
         if (findFileInDataDirectories(filename, fullpath) == false)
         {
             msgBox("Error when loading DDS file. Can't find texture file " + filename);
             //could not find file
-            return;
+            return false;
         }
 
-        BinaryFileStream stream(fullpath, BinaryFileStream::Mode::Read);
+        if (stream.open(fullpath) == false)
+        {
+            logError("Can't open the dds file " + filename);
+            return false;
+        }
 
         //check the dds identifier
         uint32_t ddsIdentifier;
@@ -559,7 +591,7 @@ namespace Falcor
         {
             //not valid dds file apparently
             logError(std::string("The dds file ") + filename + std::string(" is not a valid dds file"));
-            return;
+            return false;
         }
 
         stream >> ddsData.header;
@@ -574,127 +606,252 @@ namespace Falcor
             ddsData.hasDX10Header = false;
         }
 
-        uint32_t dataSize = stream.getRemainingStreamSize();
-        ddsData.data.resize(dataSize);
-        stream.read(ddsData.data.data(), dataSize);
+        if (stream.isFail())
+        {
+            logError(std::string("The dds file ") + filename + std::string(" is truncated"));
+            return false;
+        }
+
+        ddsData.dataSize = stream.getRemainingStreamSize();
+        ddsData.pData = stream.readView(ddsData.dataSize);
+        return true;
     }
 
-    static ResourceFormat convertBgrxFormatToBgra(DdsData& ddsData, ResourceFormat format)
+    static ResourceFormat convertBgrxFormatToBgra(ResourceFormat format)
     {
 #ifdef FALCOR_VK
         switch (format)
         {
         case ResourceFormat::BGRX8Unorm:
-            format = ResourceFormat::BGRA8Unorm;
-            break;
+            return ResourceFormat::BGRA8Unorm;
         case ResourceFormat::BGRX8UnormSrgb:
-            format = ResourceFormat::BGRA8UnormSrgb;
-            break;
+            return ResourceFormat::BGRA8UnormSrgb;
         default:
-            return format;
-        }
-
-        for (size_t i = 3; i < ddsData.data.size(); i+=4)
-        {
-            ddsData.data[i] = 0xFF;
+            break;
         }
 #endif
         return format;
     }
 
-    Texture::SharedPtr createTextureFromDx10Dds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels, Texture::BindFlags bindFlags)
+    static bool getDx10DdsLayout(const DdsData& ddsData, const std::string& filename, DdsLayout& layout)
     {
-        format = convertBgrxFormatToBgra(ddsData, format);
-
-        uint32_t arraySize = ddsData.dx10Header.arraySize;
-        assert(arraySize > 0);
-
+        layout.arraySize = ddsData.dx10Header.arraySize;
+        layout.faceCount = 1;
+        layout.depth = 1;
         switch(ddsData.dx10Header.resourceDimension)
         {
         case DXResourceDimension::RESOURCE_DIMENSION_TEXTURE1D:
-            return Texture::create1D(ddsData.header.width, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+            layout.type = Texture::Type::Texture1D;
+            layout.height = 1;
+            return true;
         case DXResourceDimension::RESOURCE_DIMENSION_TEXTURE2D:
             if(ddsData.dx10Header.miscFlag & DdsHeaderDX10::kCubeMapMask)
             {
-                flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 6 * arraySize, mipLevels == Texture::kMaxPossible ? 1 : mipLevels, true);
-                return Texture::createCube(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+                layout.type = Texture::Type::TextureCube;
+                layout.faceCount = 6;
             }
             else
             {
-                flipData(ddsData, format, ddsData.header.width, ddsData.header.height, arraySize, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-                return Texture::create2D(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+                layout.type = Texture::Type::Texture2D;
             }
+            return true;
         case DXResourceDimension::RESOURCE_DIMENSION_TEXTURE3D:
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), bindFlags);
+            layout.type = Texture::Type::Texture3D;
+            layout.depth = ddsData.header.depth;
+            layout.arraySize = 1;
+            return true;
         case DXResourceDimension::RESOURCE_DIMENSION_BUFFER:
         case DXResourceDimension::RESOURCE_DIMENSION_UNKNOWN:
             //these file formats are not supported 
             logError(std::string("the resource dimension specified in ") + filename + std::string(" is not supported by Falcor"));
+            return false;
         default:
             should_not_get_here();
-            return nullptr;
+            return false;
         }
     }
 
-    Texture::SharedPtr createTextureFromLegacyDds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels, Texture::BindFlags bindFlags)
+    static void getLegacyDdsLayout(const DdsData& ddsData, DdsLayout& layout)
     {
-        format = convertBgrxFormatToBgra(ddsData, format);
+        layout.arraySize = 1;
+        layout.faceCount = 1;
+        layout.depth = 1;
 
         //load the volume or 3D texture
         if(ddsData.header.flags & DdsHeader::kDepthMask)
         {
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), bindFlags);
+            layout.type = Texture::Type::Texture3D;
+            layout.depth = ddsData.header.depth;
         }
         //load the cubemap texture
         else if(ddsData.header.caps[1] & DdsHeader::kCaps2CubeMapMask)
         {
-            return Texture::createCube(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), bindFlags);
+            layout.type = Texture::Type::TextureCube;
+            layout.faceCount = 6;
         }
         //This is a 2D Texture
         else
         {
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 1, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create2D(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), bindFlags);
+            layout.type = Texture::Type::Texture2D;
         }
+    }
 
-        should_not_get_here();
-        return nullptr;
+    static Texture::SharedPtr createDdsTexture(const DdsLayout& layout, ResourceFormat format, uint32_t firstMip, uint32_t mipLevels, Texture::BindFlags bindFlags)
+    {
+        uint32_t width = max(layout.width >> firstMip, 1U);
+        uint32_t height = max(layout.height >> firstMip, 1U);
+        uint32_t depth = max(layout.depth >> firstMip, 1U);
+
+        switch (layout.type)
+        {
+        case Texture::Type::Texture1D:
+            return Texture::create1D(width, format, layout.arraySize, mipLevels, nullptr, bindFlags);
+        case Texture::Type::Texture2D:
+            return Texture::create2D(width, height, format, layout.arraySize, mipLevels, nullptr, bindFlags);
+        case Texture::Type::TextureCube:
+            return Texture::createCube(width, height, format, layout.arraySize, mipLevels, nullptr, bindFlags);
+        case Texture::Type::Texture3D:
+            return Texture::create3D(width, height, depth, format, mipLevels, nullptr, bindFlags);
+        default:
+            should_not_get_here();
+            return nullptr;
+        }
     }
 
-    Texture::SharedPtr createTextureFromDDSFile(const std::string filename, bool generateMips, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    Texture::SharedPtr createTextureFromDDSFile(const std::string& filename, bool generateMips, bool loadAsSrgb, Texture::BindFlags bindFlags, uint32_t skipTopMips)
     {
+        // The file is only mapped. Subresources are read straight from the mapping and uploaded one at a time, so mips which are skipped are never touched.
+        MappedFileStream stream;
         DdsData ddsData;
-        loadDDSDataFromFile(filename, ddsData);
+        if (loadDDSDataFromFile(filename, stream, ddsData) == false) return nullptr;
 
-        ResourceFormat format = getDdsResourceFormat(ddsData);
-        assert(format != ResourceFormat::Unknown);
+        const ResourceFormat fileFormat = getDdsResourceFormat(ddsData);
+        if (fileFormat == ResourceFormat::Unknown)
+        {
+            logError("The dds file " + filename + " uses an unsupported format");
+            return nullptr;
+        }
 
+        ResourceFormat format = convertBgrxFormatToBgra(fileFormat);
+        const bool fillAlphaChannel = (format != fileFormat);
         if (loadAsSrgb)
         {
             format = linearToSrgbFormat(format);
         }
 
-        uint32_t mipLevels;
-        if (generateMips == false || isCompressedFormat(format))
+        DdsLayout layout;
+        layout.width = max(ddsData.header.width, 1U);
+        layout.height = max(ddsData.header.height, 1U);
+        layout.mipCount = (ddsData.header.flags & DdsHeader::kMipCountMask) ? max(ddsData.header.mipCount, 1U) : 1;
+        if (ddsData.hasDX10Header)
         {
-            mipLevels = (ddsData.header.flags & DdsHeader::kMipCountMask) ? max(ddsData.header.mipCount, 1U) : 1;
+            if (getDx10DdsLayout(ddsData, filename, layout) == false) return nullptr;
         }
         else
         {
-            mipLevels = Texture::kMaxPossible;
+            getLegacyDdsLayout(ddsData, layout);
         }
+        layout.depth = max(layout.depth, 1U);
+        assert(layout.arraySize > 0);
 
-        if (ddsData.hasDX10Header)
+        // Every mip-level halves the largest dimension. Larger mip counts would shift by 32 bits or more when computing the sizes.
+        uint32_t maxMipCount = 1;
+        for (uint32_t size = max(max(layout.width, layout.height), layout.depth); size > 1; size >>= 1) maxMipCount++;
+        if (layout.mipCount > maxMipCount)
         {
-            return createTextureFromDx10Dds(ddsData, filename, format, mipLevels, bindFlags);
+            logError("The dds file " + filename + " has " + std::to_string(layout.mipCount) + " mip-levels, but a " + std::to_string(layout.width) + "x" + std::to_string(layout.height) + "x" + std::to_string(layout.depth) + " texture can't have more than " + std::to_string(maxMipCount));
+            return nullptr;
         }
-        else
+
+        // Make sure the file holds all the subresources before creating anything. The header values are untrusted, so the sizes are compared with the data size before they can overflow.
+        // The first mip-level is the largest one. Estimate its size in floating-point, since the product of the dimensions can exceed 64 bits.
+        const double mip0Size = double(getFormatBytesPerBlock(fileFormat)) * double(layout.depth) *
+            std::ceil(double(layout.width) / getFormatWidthCompressionRatio(fileFormat)) * std::ceil(double(layout.height) / getFormatHeightCompressionRatio(fileFormat));
+        bool truncated = mip0Size > double(ddsData.dataSize);
+        size_t sliceSize = 0;
+        for (uint32_t mip = 0; mip < layout.mipCount && truncated == false; mip++)
+        {
+            sliceSize += getDdsSubresourceSize(fileFormat, layout, mip);
+            truncated = sliceSize > ddsData.dataSize;
+        }
+        const size_t sliceCount = size_t(layout.arraySize) * layout.faceCount;
+        if (truncated || sliceCount > ddsData.dataSize / sliceSize)
+        {
+            logError("The dds file " + filename + " is truncated");
+            return nullptr;
+        }
+
+        // Always keep at least the last mip-level of the file
+        const uint32_t firstMip = min(skipTopMips, layout.mipCount - 1);
+        const bool autoGenMips = generateMips && (isCompressedFormat(format) == false);
+        const uint32_t uploadMipCount = autoGenMips ? 1 : layout.mipCount - firstMip;
+        if (autoGenMips)
+        {
+            bindFlags |= Texture::BindFlags::RenderTarget;
+        }
+
+        Texture::SharedPtr pTexture = createDdsTexture(layout, format, firstMip, autoGenMips ? Texture::kMaxPossible : uploadMipCount, bindFlags);
+        if (pTexture == nullptr) return nullptr;
+
+        const bool flip = !isCompressedFormat(format) && !kTopDown;
+        const size_t bytesPerBlock = getFormatBytesPerBlock(format);
+        std::vector<uint8_t> staging;
+        auto& pRenderContext = gpDevice->getRenderContext();
+
+        const uint8_t* pSlice = ddsData.pData;
+        for (uint32_t slice = 0; slice < (uint32_t)sliceCount; slice++)
+        {
+            const uint8_t* pSrc = pSlice;
+            for (uint32_t mip = 0; mip < firstMip + uploadMipCount; mip++)
+            {
+                const size_t size = getDdsSubresourceSize(fileFormat, layout, mip);
+                if (mip >= firstMip)
+                {
+                    const uint32_t texMip = mip - firstMip;
+                    uint32_t texSlice = slice;
+                    const void* pUpload = pSrc;
+                    if (flip || fillAlphaChannel)
+                    {
+                        // The mapping is read-only, so the subresource is transformed in a scratch buffer which is reused for the entire file
+                        staging.assign(pSrc, pSrc + size);
+                        if (fillAlphaChannel) fillAlpha(staging.data(), size);
+                        if (flip)
+                        {
+                            const size_t rowPitch = pTexture->getWidth(texMip) * bytesPerBlock;
+                            const uint32_t rowCount = pTexture->getHeight(texMip);
+                            for (uint32_t z = 0; z < pTexture->getDepth(texMip); z++)
+                            {
+                                flipRows(staging.data() + z * rowPitch * rowCount, rowPitch, rowCount);
+                            }
+
+                            // Flipping the cube upside down swaps the +Y and -Y faces
+                            if (layout.faceCount == 6)
+                            {
+                                if (slice % 6 == 2) texSlice++;
+                                else if (slice % 6 == 3) texSlice--;
+                            }
+                        }
+                        pUpload = staging.data();
+                    }
+                    pRenderContext->updateSubresourceData(pTexture.get(), pTexture->getSubresourceIndex(texSlice, texMip), pUpload);
+                }
+                pSrc += size;
+            }
+            pSlice += sliceSize;
+        }
+
+        if (autoGenMips)
         {
-            return createTextureFromLegacyDds(ddsData, filename, format, mipLevels, bindFlags);
+            pTexture->generateMips(pRenderContext.get());
+            pTexture->invalidateViews();
         }
-        return nullptr;
+        return pTexture;
+    }
+
+    static void watchTextureFile(const std::string& filename)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath)) FileWatcher::instance().watchDataFile(fullpath);
     }
 
     Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
@@ -708,29 +865,53 @@ namespace Falcor
         Texture::SharedPtr pTex;
         if (hasSuffix(filename, ".dds"))
         {
-            pTex = createTextureFromDDSFile(filename, generateMipLevels, loadAsSrgb, bindFlags);
+            pTex = createTextureFromDDSFile(filename, generateMipLevels, loadAsSrgb, bindFlags, getDdsMipSkip());
         }
         else
         {
-            Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
-            if(pBitmap)
+            // Prefer the baked version of the image. Block-compressed textures can't be render-targets or UAVs
+            if (is_set(bindFlags, Texture::BindFlags::RenderTarget | Texture::BindFlags::UnorderedAccess) == false)
             {
-                ResourceFormat texFormat = pBitmap->getFormat();
-                if(loadAsSrgb)
-                {
-                    texFormat = linearToSrgbFormat(texFormat);
-                }
+                std::string bakedFilename = TextureBaker::findBakedFile(filename, generateMipLevels, loadAsSrgb);
+                if (bakedFilename.size()) pTex = createTextureFromDDSFile(bakedFilename, false, loadAsSrgb, bindFlags, getDdsMipSkip());
+            }
 
-                pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
+            if (pTex == nullptr)
+            {
+                Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
+                return createTextureFromBitmap(pBitmap.get(), filename, generateMipLevels, loadAsSrgb, bindFlags);
             }
         }
 
         if (pTex != nullptr)
         {
             pTex->setSourceFilename(stripDataDirectories(filename));
+            watchTextureFile(filename);
         }
 
         return pTex;
     }
 #undef no_srgb
+
+    Texture::SharedPtr createTextureFromBitmap(const Bitmap* pBitmap, const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        if (pBitmap == nullptr)
+        {
+            return nullptr;
+        }
+
+        ResourceFormat texFormat = pBitmap->getFormat();
+        if(loadAsSrgb)
+        {
+            texFormat = linearToSrgbFormat(texFormat);
+        }
+
+        Texture::SharedPtr pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
+        if (pTex != nullptr)
+        {
+            pTex->setSourceFilename(stripDataDirectories(filename));
+            watchTextureFile(filename);
+        }
+        return pTex;
+    }
 }
@@ -30,6 +30,8 @@
 #include "API/Texture.h"
 namespace Falcor
 {
+    class Bitmap;
+
     /*!
     *  \addtogroup Falcor
     *  @{
@@ -43,5 +45,33 @@ namespace Falcor
     */
     Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
 
+    /** Create a new texture object from a DDS file. The file is memory-mapped and each subresource is uploaded as soon as it's read, so the file content is never copied in its entirety.
+        \param[in] filename Filename of the image. Can also include a full path or relative path from a data directory
+        \param[in] generateMips Whether the mip-chain should be generated. Ignored for compressed formats, which always use the mip-levels stored in the file
+        \param[in] loadAsSrgb Load the texture using sRGB format
+        \param[in] bindFlags The bind flags to create the texture with
+        \param[in] skipTopMips Number of high-resolution mip-levels to drop. The texture is created from the remaining levels, and the dropped ones are never read from the file. The last mip-level in the file is always loaded.
+        \return A new texture, or nullptr if the file couldn't be loaded
+    */
+    Texture::SharedPtr createTextureFromDDSFile(const std::string& filename, bool generateMips, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource, uint32_t skipTopMips = 0);
+
+    /** Set the number of high-resolution mip-levels createTextureFromFile() drops when loading DDS files. Used to reduce texture memory on low-memory configurations.
+        \param[in] mipCount Number of mip-levels to skip. 0 loads the full mip-chain
+    */
+    void setDdsMipSkip(uint32_t mipCount);
+
+    /** Get the number of high-resolution mip-levels createTextureFromFile() drops when loading DDS files
+    */
+    uint32_t getDdsMipSkip();
+
+    /** Create a new texture object from a bitmap which was already loaded, for example with Bitmap::loadMany().
+        \param[in] pBitmap The bitmap. Can be nullptr, in which case the function returns nullptr.
+        \param[in] filename The filename the bitmap was loaded from
+        \param[in] generateMipLevels Whether the mip-chain should be generated
+        \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3 or 4 component textures.
+        \param[in] bindFlags The bind flags to create the texture with
+    */
+    Texture::SharedPtr createTextureFromBitmap(const Bitmap* pBitmap, const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
     /*! @} */
 }
\ No newline at end of file
@@ -102,10 +102,16 @@ namespace Falcor
         /** Get the fixed delta time */
         virtual float getFixedTimeDelta() = 0;
 
-        /** Takes and outputs a screenshot. 
+        /** Takes and outputs a screenshot. The file is written in the background, once the GPU finished rendering the frame.
+            \return The name of the file
         */
         virtual std::string captureScreen(const std::string explicitFilename = "", const std::string explicitOutputDirectory = "") = 0;
 
+        /** Capture screenshots of the following frames, one file per frame. The files are written in the background.
+            \param[in] frameCount Number of frames to capture. 0 will capture until the sequence is stopped with Ctrl+F12.
+        */
+        virtual void captureScreenSequence(uint32_t frameCount, const std::string explicitFilename = "", const std::string explicitOutputDirectory = "") = 0;
+
         /* Shutdown the app 
         */
         virtual void shutdown() = 0;
@@ -147,7 +153,7 @@ namespace Falcor
         */
         virtual void onResizeSwapChain(SampleCallbacks* pSample, uint32_t width, uint32_t height) {}
 
-        /** Called every time the user requests shader recompilation (by pressing F5)
+        /** Called every time the user requests shader recompilation (by pressing F5), and when a scene, model or texture file which was loaded changes
         */
         virtual void onDataReload(SampleCallbacks* pSample) {}
 
@@ -32,6 +32,7 @@
 #include "API/Window.h"
 #include "Graphics/Program/Program.h"
 #include "Utils/Platform/OS.h"
+#include "Utils/Platform/FileWatcher.h"
 #include "API/FBO.h"
 #include "VR/OpenVR/VRSystem.h"
 #include "Utils/Platform/ProgressBar.h"
@@ -40,10 +41,15 @@
 #include <sstream>
 #include <iomanip>
 #include "Graphics/RenderGraph/RenderPassLibrary.h"
+#include "Graphics/TextureCache.h"
+#include "API/PipelineStateCache.h"
+#include "Utils/TaskScheduler.h"
+#include "Utils/ImageEncodeQueue.h"
 
 namespace Falcor
 {
     static std::string kMonospaceFont = "monospace";
+    static const size_t kVideoCaptureLatency = 2;   // Number of frames a video frame read-back can be in flight before we wait for it
 
     void Sample::handleWindowSizeChange()
     {
@@ -93,6 +99,17 @@ namespace Falcor
                 {
                     initVideoCapture();
                 }
+                else if (keyEvent.mods.isCtrlDown && keyEvent.key == KeyboardEvent::Key::F12)
+                {
+                    if (mpScreenCapture->isSequenceActive()) mpScreenCapture->endSequence();
+                    else captureScreenSequence(0);
+                }
+#if _PROFILING_ENABLED
+                else if (keyEvent.mods.isShiftDown && keyEvent.key == KeyboardEvent::Key::P)
+                {
+                    toggleProfilerCapture();
+                }
+#endif
                 else if (!keyEvent.mods.isAltDown && !keyEvent.mods.isCtrlDown && !keyEvent.mods.isShiftDown)
                 {
                     switch (keyEvent.key)
@@ -180,6 +197,9 @@ namespace Falcor
 
         RenderPassLibrary::instance().shutdown();
         Scripting::shutdown();
+        TextureCache::instance().clear();
+        std::string psoCacheFilename = PipelineStateCache::getDefaultFilename();
+        if (gpDevice && psoCacheFilename.size()) PipelineStateCache::instance().save(psoCacheFilename);
         mpGui.reset();
         mpDefaultPipelineState.reset();
         mpBackBufferFBO.reset();    
@@ -247,6 +267,11 @@ namespace Falcor
             mpDefaultPipelineState->setFbo(mpTargetFBO);
             mpRenderContext = gpDevice->getRenderContext();
             mpRenderContext->setGraphicsState(mpDefaultPipelineState);
+            mpScreenCapture = ScreenCapture::create();
+
+            // Load the driver blobs of the pipeline states created in previous runs
+            std::string psoCacheFilename = PipelineStateCache::getDefaultFilename();
+            if (psoCacheFilename.size()) PipelineStateCache::instance().load(psoCacheFilename);
 
             // Init the UI
             initUI();
@@ -281,8 +306,13 @@ namespace Falcor
         mpWindow->msgLoop();
 
         mpRenderer->onShutdown(this);
+        // Write the pending screenshots while the device is still alive
+        mpScreenCapture = nullptr;
         if (gpDevice) gpDevice->flushAndSync();
         mpRenderer = nullptr;
+        // Write the pending images, and run the tasks which are still queued, they might write files
+        ImageEncodeQueue::shutdown();
+        TaskScheduler::shutdown();
         Logger::shutdown();
     }
 
@@ -325,11 +355,13 @@ namespace Falcor
                 "  'V'       - Toggle VSync\n"
                 "  'F12'     - Capture screenshot\n"
                 "  'Shift+F12' - Video capture\n"
+                "  'Ctrl+F12'  - Start\\stop screenshot sequence capture\n"
                 "  'Pause'     - Pause\\resume timer\n"
                 "  'Z'       - Zoom in on a pixel\n"
                 "  'MouseWheel' - Change level of zoom\n"
 #if _PROFILING_ENABLED
-                "  'P'       - Enable profiling\n";
+                "  'P'       - Enable profiling\n"
+                "  'Shift+P' - Start\\stop profiler trace capture\n";
 #else
                 ;
 #endif
@@ -447,6 +479,10 @@ namespace Falcor
             return;
         }
 
+        // Hot-reload the shaders and data files which changed. When nothing changed this costs an atomic exchange
+        Program::reloadModifiedPrograms();
+        if (FileWatcher::instance().consumeDataFileChanges() && mpRenderer) mpRenderer->onDataReload(this);
+
         mFrameRate.newFrame();
         beginTestFrame();
         {
@@ -507,10 +543,18 @@ namespace Falcor
                 captureScreen();
             }
 
+            if (mpScreenCapture->isSequenceActive())
+            {
+                mpScreenCapture->captureSequenceFrame(mpRenderContext.get(), gpDevice->getSwapChainFbo()->getColorTexture(0).get());
+            }
+
             {
                 PROFILE(present);
                 gpDevice->present();
             }
+
+            // Queue the screenshots which finished reading back for encoding
+            mpScreenCapture->endFrame();
         }
     }
 
@@ -522,11 +566,11 @@ namespace Falcor
         std::string outputDirectory = explicitOutputDirectory != "" ? explicitOutputDirectory : getExecutableDirectory();
 
         std::string pngFile;
-        if (findAvailableFilename(filename, outputDirectory, "png", pngFile))
+        if (mpScreenCapture->findAvailableFilename(filename, outputDirectory, "png", pngFile))
         {
             Texture::SharedPtr pTexture;
             pTexture = gpDevice->getSwapChainFbo()->getColorTexture(0);
-            pTexture->captureToFile(0, 0, pngFile);
+            mpScreenCapture->capture(mpRenderContext.get(), pTexture.get(), pngFile);
         }
         else
         {
@@ -537,6 +581,24 @@ namespace Falcor
          return pngFile;
     }
 
+    void Sample::captureScreenSequence(uint32_t frameCount, const std::string explicitFilename, const std::string explicitOutputDirectory)
+    {
+        std::string filename = explicitFilename != "" ? explicitFilename : getExecutableName();
+        std::string outputDirectory = explicitOutputDirectory != "" ? explicitOutputDirectory : getExecutableDirectory();
+
+        // Don't overwrite previous sequences
+        for (uint32_t i = 0; i < (uint32_t)-1; i++)
+        {
+            std::string prefix = filename + '.' + std::to_string(i);
+            if (doesFileExist(outputDirectory + '/' + prefix + ".000000.png") == false)
+            {
+                mpScreenCapture->beginSequence(prefix, outputDirectory, frameCount);
+                return;
+            }
+        }
+        logError("Could not find available filename when capturing a screen sequence");
+    }
+
     void Sample::initUI()
     {
         float scaling = getDisplayScaleFactor();
@@ -592,6 +654,26 @@ namespace Falcor
         }
     }
 
+    void Sample::toggleProfilerCapture()
+    {
+        if (Profiler::isCapturing() == false)
+        {
+            gProfileEnabled = true;
+            Profiler::startCapture();
+            return;
+        }
+
+        std::string traceFile;
+        if (findAvailableFilename(getExecutableName() + "_trace", getExecutableDirectory(), "json", traceFile))
+        {
+            if (Profiler::endCapture(traceFile)) logInfo("Profiler trace saved to " + traceFile);
+        }
+        else
+        {
+            logError("Could not find available filename when saving the profiler trace");
+        }
+    }
+
     void Sample::initVideoCapture()
     {
         if (mVideoCapture.pUI == nullptr)
@@ -617,7 +699,6 @@ namespace Falcor
         mVideoCapture.pVideoCapture = VideoEncoder::create(desc);
 
         assert(mVideoCapture.pVideoCapture);
-        mVideoCapture.pFrame = new uint8_t[desc.width*desc.height * 4];
 
         mVideoCapture.sampleTimeDelta = mFixedTimeDelta;
         mFixedTimeDelta = 1.0f / (float)desc.fps;
@@ -636,12 +717,23 @@ namespace Falcor
     {
         if (mVideoCapture.pVideoCapture)
         {
+            // Encode the frames which are still being read back
+            for (auto& pTask : mVideoCapture.pendingFrames)
+            {
+                mVideoCapture.pVideoCapture->appendFrame(pTask->getData());
+            }
             mVideoCapture.pVideoCapture->endCapture();
             mShowUI = UIStatus::ShowAll;
+
+            VideoEncoder::Stats stats = mVideoCapture.pVideoCapture->getStats();
+            if (stats.stalledFrames)
+            {
+                logWarning("Video capture stalled on " + std::to_string(stats.stalledFrames) + " out of " + std::to_string(stats.framesAppended) + " frames, waiting " + std::to_string(stats.stallTimeMs) + "ms for the encoder");
+            }
         }
+        mVideoCapture.pendingFrames.clear();
         mVideoCapture.pUI = nullptr;
         mVideoCapture.pVideoCapture = nullptr;
-        safe_delete_array(mVideoCapture.pFrame);
         mFixedTimeDelta = mVideoCapture.sampleTimeDelta;
     }
 
@@ -649,7 +741,13 @@ namespace Falcor
     {
         if (mVideoCapture.pVideoCapture)
         {
-            mVideoCapture.pVideoCapture->appendFrame(mpRenderContext->readTextureSubresource(mpBackBufferFBO->getColorTexture(0).get(), 0).data());
+            // Read the frame back asynchronously and give it to the encoder once the copy had time to complete
+            mVideoCapture.pendingFrames.push_back(mpRenderContext->asyncReadTextureSubresource(mpBackBufferFBO->getColorTexture(0).get(), 0));
+            if (mVideoCapture.pendingFrames.size() > kVideoCaptureLatency)
+            {
+                mVideoCapture.pVideoCapture->appendFrame(mVideoCapture.pendingFrames.front()->getData());
+                mVideoCapture.pendingFrames.pop_front();
+            }
 
             if (mVideoCapture.pUI->useTimeRange())
             {
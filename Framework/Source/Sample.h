@@ -26,6 +26,7 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <deque>
 #include <set>
 #include <string>
 #include <stdint.h>
@@ -38,6 +39,7 @@
 #include "API/Device.h"
 #include "ArgList.h"
 #include "Utils/PixelZoom.h"
+#include "Utils/ScreenCapture.h"
 #include "Renderer.h"
 #include "SampleTest.h"
 
@@ -113,6 +115,7 @@ namespace Falcor
         void freezeTime(bool timeFrozen) override { mFreezeTime = timeFrozen; }
         bool isTimeFrozen() override { return mFreezeTime; }
         std::string captureScreen(const std::string explicitFilename = "", const std::string explicitOutputDirectory = "") override;
+        void captureScreenSequence(uint32_t frameCount, const std::string explicitFilename = "", const std::string explicitOutputDirectory = "") override;
         void shutdown() override { if (mpWindow) { mpWindow->shutdown(); } }
         
         //Any cleanup required by renderer if its being shut down early via testing 
@@ -143,6 +146,7 @@ namespace Falcor
 
         virtual float getTimeScale() final { return mTimeScale; }
         void initVideoCapture();
+        void toggleProfilerCapture();
 
         // Private functions
         void initUI();
@@ -166,6 +170,7 @@ namespace Falcor
         };
         UIStatus mShowUI = UIStatus::ShowAll;
         bool mCaptureScreen = false;
+        ScreenCapture::UniquePtr mpScreenCapture;
 
         Renderer::UniquePtr mpRenderer;
 
@@ -173,7 +178,7 @@ namespace Falcor
         {
             VideoEncoderUI::UniquePtr pUI;
             VideoEncoder::UniquePtr pVideoCapture;
-            uint8_t* pFrame = nullptr;
+            std::deque<CopyContext::ReadTextureTask::SharedPtr> pendingFrames; // Read-backs of the frames which weren't sent to the encoder yet
             float sampleTimeDelta; // Saves the sample's fixed time delta because video capture overwrites it while recording
         };
 
@@ -33,6 +33,10 @@
 #include <cstring>
 #include "StringUtils.h"
 #include "API/Texture.h"
+#include "Utils/TaskScheduler.h"
+#include "Utils/ImageEncodeQueue.h"
+#include <fstream>
+#include <tmmintrin.h>
 
 namespace Falcor
 {
@@ -43,25 +47,86 @@ namespace Falcor
         return nullptr;
     }
 
-    Bitmap::UniqueConstPtr Bitmap::createFromFile(const std::string& filename, bool isTopDown)
+    /** Expand a row of 24-bit pixels to 32-bit in-place. The row is stored at the start of a buffer large enough to hold the 32-bit pixels. Alpha is set to 0xFF.
+    */
+    static void expandRgb8Row(uint8_t* pRow, uint32_t width)
     {
-        std::string fullpath;
-        if(findFileInDataDirectories(filename, fullpath) == false)
+        // Walk backwards, so that the 32-bit pixels never overwrite 24-bit pixels which were not converted yet
+        const uint32_t simdWidth = width & ~3u;
+        for (uint32_t x = width; x > simdWidth; x--)
         {
-            msgBox("Error when loading image file " + filename + "\n. Can't find the file");
-            return nullptr;
+            const uint8_t* pSrc = pRow + (x - 1) * 3;
+            uint8_t b = pSrc[0], g = pSrc[1], r = pSrc[2];
+            uint8_t* pDst = pRow + (x - 1) * 4;
+            pDst[0] = b;
+            pDst[1] = g;
+            pDst[2] = r;
+            pDst[3] = 0xFF;
         }
 
-        FREE_IMAGE_FORMAT fifFormat = FIF_UNKNOWN;
-        
-        fifFormat = FreeImage_GetFileType(fullpath.c_str(), 0);
+#if defined(_MSC_VER) || defined(__SSSE3__)
+        // 4 pixels at a time. The 16-byte load reads one pixel past the group, which is still inside the row buffer
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32(0xFF000000);
+        for (uint32_t x = simdWidth; x > 0; x -= 4)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(pRow + (x - 4) * 3));
+            pixels = _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha);
+            _mm_storeu_si128((__m128i*)(pRow + (x - 4) * 4), pixels);
+        }
+#else
+        for (uint32_t x = simdWidth; x > 0; x--)
+        {
+            const uint8_t* pSrc = pRow + (x - 1) * 3;
+            uint8_t b = pSrc[0], g = pSrc[1], r = pSrc[2];
+            uint8_t* pDst = pRow + (x - 1) * 4;
+            pDst[0] = b;
+            pDst[1] = g;
+            pDst[2] = r;
+            pDst[3] = 0xFF;
+        }
+#endif
+    }
+
+    /** Expand a row of RGB32Float pixels to RGBA32Float in-place. Alpha is set to 1.
+    */
+    static void expandRgb32FloatRow(float* pRow, uint32_t width)
+    {
+        for (uint32_t x = width; x > 0; x--)
+        {
+            const float* pSrc = pRow + (x - 1) * 3;
+            float r = pSrc[0], g = pSrc[1], b = pSrc[2];
+            float* pDst = pRow + (x - 1) * 4;
+            pDst[0] = r;
+            pDst[1] = g;
+            pDst[2] = b;
+            pDst[3] = 1.0f;
+        }
+    }
+
+    Bitmap::FormatCaps Bitmap::getDeviceFormatCaps()
+    {
+        FormatCaps caps;
+        if (gpDevice)
+        {
+            caps.rgb32Float = gpDevice->isRgb32FloatSupported();
+        }
+        return caps;
+    }
+
+    Bitmap::UniqueConstPtr Bitmap::createFromMemory(const void* pData, size_t size, const std::string& filename, bool isTopDown, const FormatCaps& caps)
+    {
+        // FreeImage doesn't write to the memory stream when reading from it
+        FIMEMORY* pMemory = FreeImage_OpenMemory((BYTE*)pData, (DWORD)size);
+        FREE_IMAGE_FORMAT fifFormat = FreeImage_GetFileTypeFromMemory(pMemory, 0);
         if(fifFormat == FIF_UNKNOWN)
         {
             // Can't get the format from the file. Use file extension
-            fifFormat = FreeImage_GetFIFFromFilename(fullpath.c_str());
+            fifFormat = FreeImage_GetFIFFromFilename(filename.c_str());
 
             if(fifFormat == FIF_UNKNOWN)
             {
+                FreeImage_CloseMemory(pMemory);
                 return UniqueConstPtr(genError("Image Type unknown", filename));
             }
         }
@@ -69,28 +134,30 @@ namespace Falcor
         // Check the the library supports loading this image Type
         if(FreeImage_FIFSupportsReading(fifFormat) == false)
         {
+            FreeImage_CloseMemory(pMemory);
             return UniqueConstPtr(genError("Library doesn't support the file format", filename));
         }
 
         // Read the DIB
-        FIBITMAP* pDib = FreeImage_Load(fifFormat, fullpath.c_str());
+        FIBITMAP* pDib = FreeImage_LoadFromMemory(fifFormat, pMemory);
+        FreeImage_CloseMemory(pMemory);
         if(pDib == nullptr)
         {
             return UniqueConstPtr(genError("Can't read image file", filename));
         }
 
         // create the bitmap
-        auto pBmp = new Bitmap;
+        UniquePtr pBmp(new Bitmap);
         pBmp->mHeight = FreeImage_GetHeight(pDib);
         pBmp->mWidth = FreeImage_GetWidth(pDib);
 
         if(pBmp->mHeight == 0 || pBmp->mWidth == 0 || FreeImage_GetBits(pDib) == nullptr)
         {
+            FreeImage_Unload(pDib);
             return UniqueConstPtr(genError("Invalid image", filename));
         }
 
         uint32_t bpp = FreeImage_GetBPP(pDib);
-        bool rgb32FloatSupported = gpDevice->isRgb32FloatSupported();
 
         switch(bpp)
         {
@@ -98,7 +165,7 @@ namespace Falcor
             pBmp->mFormat = ResourceFormat::RGBA32Float;  // 4xfloat32 HDR format
             break;
         case 96:
-            pBmp->mFormat = rgb32FloatSupported ? ResourceFormat::RGB32Float : ResourceFormat::RGBA32Float;  // 4xfloat32 HDR format
+            pBmp->mFormat = caps.rgb32Float ? ResourceFormat::RGB32Float : ResourceFormat::RGBA32Float;  // 4xfloat32 HDR format
             break;
         case 64:
             pBmp->mFormat = ResourceFormat::RGBA16Float;  // 4xfloat16 HDR format
@@ -119,36 +186,98 @@ namespace Falcor
             pBmp->mFormat = ResourceFormat::R8Unorm;
             break;
         default:
-            genError("Unknown bits-per-pixel", filename);
-            return nullptr;
+            FreeImage_Unload(pDib);
+            return UniqueConstPtr(genError("Unknown bits-per-pixel", filename));
         }
 
-        // Convert the image to RGBX image
+        // RGB images are expanded in the bitmap's buffer after copying the rows, instead of converting the DIB which would copy the image twice
+        const uint32_t srcBpp = bpp;
         if(bpp == 24)
         {
             logWarning("Converting 24-bit texture to 32-bit");
             bpp = 32;
-            auto pNew = FreeImage_ConvertTo32Bits(pDib);
-            FreeImage_Unload(pDib);
-            pDib = pNew;
         }
 
-        if (!rgb32FloatSupported && bpp == 96)
+        if (!caps.rgb32Float && bpp == 96)
         {
             logWarning("Converting 96-bit texture to 128-bit");
             bpp = 128;
-            auto pNew = FreeImage_ConvertToRGBAF(pDib);
-            FreeImage_Unload(pDib);
-            pDib = pNew;
         }
 
         uint32_t bytesPerPixel = bpp / 8;
+        size_t pitch = size_t(pBmp->mWidth) * bytesPerPixel;
 
-        pBmp->mpData = new uint8_t[pBmp->mHeight * pBmp->mWidth * bytesPerPixel];
-        FreeImage_ConvertToRawBits(pBmp->mpData, pDib, pBmp->mWidth * bytesPerPixel, bpp, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, isTopDown);
-
+        pBmp->mpData = new uint8_t[pBmp->mHeight * pitch];
+        FreeImage_ConvertToRawBits(pBmp->mpData, pDib, (int)pitch, srcBpp, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, isTopDown);
         FreeImage_Unload(pDib);
-        return UniqueConstPtr(pBmp);
+
+        if (srcBpp != bpp)
+        {
+            for (uint32_t y = 0; y < pBmp->mHeight; y++)
+            {
+                uint8_t* pRow = pBmp->mpData + y * pitch;
+                if (srcBpp == 24) expandRgb8Row(pRow, pBmp->mWidth);
+                else expandRgb32FloatRow((float*)pRow, pBmp->mWidth);
+            }
+        }
+
+        return UniqueConstPtr(pBmp.release());
+    }
+
+    static Bitmap::UniqueConstPtr loadBitmapFile(const std::string& fullpath, const std::string& filename, bool isTopDown, const Bitmap::FormatCaps& caps)
+    {
+        MappedFile file;
+        if (mapFile(fullpath, file) == false)
+        {
+            return Bitmap::UniqueConstPtr(genError("Can't read image file", filename));
+        }
+
+        Bitmap::UniqueConstPtr pBmp = Bitmap::createFromMemory(file.pData, file.size, filename, isTopDown, caps);
+        unmapFile(file);
+        return pBmp;
+    }
+
+    Bitmap::UniqueConstPtr Bitmap::createFromFile(const std::string& filename, bool isTopDown)
+    {
+        return createFromFile(filename, isTopDown, getDeviceFormatCaps());
+    }
+
+    Bitmap::UniqueConstPtr Bitmap::createFromFile(const std::string& filename, bool isTopDown, const FormatCaps& caps)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            msgBox("Error when loading image file " + filename + "\n. Can't find the file");
+            return nullptr;
+        }
+
+        return loadBitmapFile(fullpath, filename, isTopDown, caps);
+    }
+
+    std::vector<std::future<Bitmap::UniqueConstPtr>> Bitmap::loadMany(const std::vector<std::string>& filenames, bool isTopDown, const FormatCaps& caps)
+    {
+        std::vector<std::future<UniqueConstPtr>> bitmaps;
+        bitmaps.reserve(filenames.size());
+
+        for (const auto& filename : filenames)
+        {
+            // Resolve the path on the calling thread, the data directories list isn't thread-safe
+            std::string fullpath;
+            if (findFileInDataDirectories(filename, fullpath) == false)
+            {
+                logError("Error when loading image file " + filename + "\n. Can't find the file");
+                std::promise<UniqueConstPtr> missing;
+                missing.set_value(nullptr);
+                bitmaps.push_back(missing.get_future());
+                continue;
+            }
+
+            bitmaps.push_back(TaskScheduler::instance().async([fullpath, filename, isTopDown, caps]()
+            {
+                return loadBitmapFile(fullpath, filename, isTopDown, caps);
+            }));
+        }
+        return bitmaps;
     }
 
     Bitmap::~Bitmap()
@@ -204,9 +333,16 @@ namespace Falcor
         /* TgaFile */ ".tga",
         /* BmpFile */ ".bmp",
         /* PfmFile */ ".hdr",
-        /* ExrFile */ ".hdr"
+        /* ExrFile */ ".exr",
+        /* RawFile */ ".raw"
     };
 
+    const char* Bitmap::getFileExtension(FileFormat fileFormat)
+    {
+        assert(fileFormat != FileFormat::AutoDetect);
+        return kExtensions[static_cast<uint32_t>(fileFormat)] + 1;
+    }
+
     static Bitmap::FileFormat detectFileFormat(const Texture::SharedPtr& pTex)
     {
         auto format = pTex->getFormat();
@@ -257,6 +393,20 @@ namespace Falcor
         }
     }
 
+    bool Bitmap::saveImageAsync(const std::string& filename, uint32_t width, uint32_t height, FileFormat fileFormat, ExportFlags exportFlags, ResourceFormat resourceFormat, bool isTopDown, std::vector<uint8_t> data, bool wait)
+    {
+        ImageEncodeQueue::Job job;
+        job.filename = filename;
+        job.width = width;
+        job.height = height;
+        job.fileFormat = fileFormat;
+        job.exportFlags = exportFlags;
+        job.resourceFormat = resourceFormat;
+        job.isTopDown = isTopDown;
+        job.data = std::move(data);
+        return ImageEncodeQueue::instance().push(std::move(job), wait);
+    }
+
     void Bitmap::saveImage(const std::string& filename, uint32_t width, uint32_t height, FileFormat fileFormat, ExportFlags exportFlags, ResourceFormat resourceFormat, bool isTopDown, void* pData)
     {
         if(pData == nullptr)
@@ -264,6 +414,14 @@ namespace Falcor
             logError("Bitmap::saveImage provided no data to save.");
             return;
         }
+
+        if (fileFormat == FileFormat::RawFile)
+        {
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            file.write((const char*)pData, (size_t)width * height * getFormatBytesPerBlock(resourceFormat));
+            if (file.fail()) logError("Bitmap::saveImage failed to write raw file " + filename);
+            return;
+        }
         
         if(is_set(exportFlags, ExportFlags::Uncompressed) && is_set(exportFlags, ExportFlags::Lossy))
         {
@@ -27,6 +27,8 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
+#include <future>
 
 namespace Falcor
 {
@@ -53,12 +55,24 @@ namespace Falcor
             BmpFile,    //< BMP file for lossless uncompressed 8-bits images with optional alpha
             PfmFile,    //< PFM file for floating point HDR images with 32-bit float per channel
             ExrFile,    //< EXR file for floating point HDR images with 16-bit float per channel
+            RawFile,    //< Raw pixel data without a header, stored exactly as it is in memory. Fastest to write
             AutoDetect  //< Detect format from texture parameters
         };
 
         using UniquePtr = std::unique_ptr<Bitmap>;
         using UniqueConstPtr = std::unique_ptr<const Bitmap>;
 
+        /** The resource formats the consumer of the bitmap supports. Images in unsupported formats are converted while loading.
+        */
+        struct FormatCaps
+        {
+            bool rgb32Float = false;    ///< If false, 96-bit images are expanded to RGBA32Float
+        };
+
+        /** Get the format capabilities of the current device. If there's no device, returns the default capabilities.
+        */
+        static FormatCaps getDeviceFormatCaps();
+
         /** Create a new object from file
             \param[in] filename Filename, including a path. If the file can't be found relative to the current directory, Falcor will search for it in the common directories.
             \param[in] isTopDown Control the memory layout of the image. If true, the top-left pixel is the first pixel in the buffer, otherwise the bottom-left pixel is first.
@@ -66,6 +80,32 @@ namespace Falcor
         */
         static UniqueConstPtr createFromFile(const std::string& filename, bool isTopDown);
 
+        /** Create a new object from file, converting it to formats the caller supports. Doesn't require a device.
+            \param[in] filename Filename, including a path. If the file can't be found relative to the current directory, Falcor will search for it in the common directories.
+            \param[in] isTopDown Control the memory layout of the image. If true, the top-left pixel is the first pixel in the buffer, otherwise the bottom-left pixel is first.
+            \param[in] caps The supported formats
+            \return If loading was successful, a new object. Otherwise, nullptr.
+        */
+        static UniqueConstPtr createFromFile(const std::string& filename, bool isTopDown, const FormatCaps& caps);
+
+        /** Decode an image file stored in memory. Doesn't require a device and can be called from any thread.
+            \param[in] pData The file content
+            \param[in] size The file size in bytes
+            \param[in] filename The name of the file. Used for error messages and to detect the format if the content doesn't identify it.
+            \param[in] isTopDown Control the memory layout of the image. If true, the top-left pixel is the first pixel in the buffer, otherwise the bottom-left pixel is first.
+            \param[in] caps The supported formats
+            \return If decoding was successful, a new object. Otherwise, nullptr.
+        */
+        static UniqueConstPtr createFromMemory(const void* pData, size_t size, const std::string& filename, bool isTopDown, const FormatCaps& caps);
+
+        /** Load a batch of image files in the background. Files are memory-mapped and decoded in parallel on the task scheduler.
+            \param[in] filenames The files to load. Files are searched for in the data directories, like createFromFile().
+            \param[in] isTopDown Control the memory layout of the images. If true, the top-left pixel is the first pixel in the buffer, otherwise the bottom-left pixel is first.
+            \param[in] caps The supported formats
+            \return A future for each file, in the order of the filenames. The future holds nullptr if loading failed.
+        */
+        static std::vector<std::future<UniqueConstPtr>> loadMany(const std::vector<std::string>& filenames, bool isTopDown, const FormatCaps& caps);
+
         /** Store a memory buffer to a PNG file.
             \param[in] filename Output filename. Can include a path - absolute or relative to the executable directory.
             \param[in] width The width of the image.
@@ -78,6 +118,17 @@ namespace Falcor
         */
         static void saveImage(const std::string& filename, uint32_t width, uint32_t height, FileFormat fileFormat, ExportFlags exportFlags, ResourceFormat resourceFormat, bool isTopDown, void* pData);
 
+        /** Store a memory buffer to a file in the background. The image is encoded by the global ImageEncodeQueue.
+            Parameters are the same as saveImage(), except that the function takes ownership of the data.
+            \param[in] wait If true and the encoder queue is full, blocks until there's room for the image. Otherwise, the image is dropped.
+            \return true if the image was queued, false if it was dropped
+        */
+        static bool saveImageAsync(const std::string& filename, uint32_t width, uint32_t height, FileFormat fileFormat, ExportFlags exportFlags, ResourceFormat resourceFormat, bool isTopDown, std::vector<uint8_t> data, bool wait = true);
+
+        /** Get the file extension of a file format, without the leading dot
+        */
+        static const char* getFileExtension(FileFormat fileFormat);
+
         /**  Open dialog to save image to a file
             \param[in] pTexture Texture to save to file
              
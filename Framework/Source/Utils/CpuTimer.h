@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <chrono>
+#include <stdint.h>
 
 namespace Falcor
 {
@@ -44,6 +45,13 @@ namespace Falcor
             return std::chrono::high_resolution_clock::now();
         }
 
+        /** Returns the current time in nanoseconds. The value is meaningless on it's own, use it to calculate durations.
+        */
+        static uint64_t getCurrentTimeNs()
+        {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(getCurrentTimePoint().time_since_epoch()).count();
+        }
+
         /** Update the timer.
             \return The TimePoint of the last update() call.
                 This value is meaningless on it's own. Call CCpuTimer#calcDuration() to get the duration that passed between 2 TimePoints
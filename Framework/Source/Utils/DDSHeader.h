@@ -115,7 +115,8 @@ namespace Falcor
             DdsHeader header;
             DdsHeaderDX10 dx10Header;
             bool hasDX10Header;
-            std::vector<uint8_t> data;
+            const uint8_t* pData = nullptr;     ///< The subresource data. Points into the file mapping, so it's only valid while the file is mapped
+            size_t dataSize = 0;
         };
     }
 }
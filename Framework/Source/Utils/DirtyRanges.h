@@ -0,0 +1,121 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <algorithm>
+
+namespace Falcor
+{
+    /** Tracks the modified byte ranges of a buffer.
+        The ranges are kept sorted and disjoint. Overlapping ranges, and ranges separated by a gap of at most the merge distance, are coalesced when added.
+    */
+    class DirtyRanges
+    {
+    public:
+        struct Range
+        {
+            size_t begin;   ///> The first dirty byte
+            size_t end;     ///> One past the last dirty byte
+            size_t size() const { return end - begin; }
+        };
+
+        /** Constructor
+            \param[in] mergeDistance Ranges separated by a gap of at most this many bytes are merged. Uploading a small gap is usually cheaper than issuing another copy.
+            \param[in] maxRanges The maximum number of ranges to track. When exceeded, the two closest ranges are merged.
+        */
+        DirtyRanges(size_t mergeDistance = 0, size_t maxRanges = 64) : mMergeDistance(mergeDistance), mMaxRanges(std::max<size_t>(maxRanges, 1)) {}
+
+        /** Mark a range as dirty
+            \param[in] offset The offset of the first byte
+            \param[in] size The number of bytes
+        */
+        void add(size_t offset, size_t size)
+        {
+            if (size == 0) return;
+            Range range = { offset, offset + size };
+
+            // Find the first range which isn't completely before the new range, then absorb all the ranges which touch it
+            auto first = std::lower_bound(mRanges.begin(), mRanges.end(), range.begin, [this](const Range& r, size_t begin) { return r.end + mMergeDistance < begin; });
+            auto last = first;
+            while (last != mRanges.end() && last->begin <= range.end + mMergeDistance)
+            {
+                range.begin = std::min(range.begin, last->begin);
+                range.end = std::max(range.end, last->end);
+                last++;
+            }
+
+            if (first == last)
+            {
+                mRanges.insert(first, range);
+                if (mRanges.size() > mMaxRanges) mergeClosest();
+            }
+            else
+            {
+                *first = range;
+                mRanges.erase(first + 1, last);
+            }
+        }
+
+        /** Remove all the ranges
+        */
+        void clear() { mRanges.clear(); }
+
+        /** Check if there are any dirty ranges
+        */
+        bool empty() const { return mRanges.empty(); }
+
+        /** Get the dirty ranges, sorted by offset
+        */
+        const std::vector<Range>& getRanges() const { return mRanges; }
+
+        /** Get the total number of bytes covered by the ranges
+        */
+        size_t getDirtyBytes() const
+        {
+            size_t bytes = 0;
+            for (const auto& r : mRanges) bytes += r.size();
+            return bytes;
+        }
+
+    private:
+        void mergeClosest()
+        {
+            size_t closest = 0;
+            for (size_t i = 1; i + 1 < mRanges.size(); i++)
+            {
+                if (mRanges[i + 1].begin - mRanges[i].end < mRanges[closest + 1].begin - mRanges[closest].end) closest = i;
+            }
+            mRanges[closest].end = mRanges[closest + 1].end;
+            mRanges.erase(mRanges.begin() + closest + 1);
+        }
+
+        std::vector<Range> mRanges;
+        size_t mMergeDistance;
+        size_t mMaxRanges;
+    };
+}
@@ -0,0 +1,162 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ImageEncodeQueue.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    std::atomic<ImageEncodeQueue*> ImageEncodeQueue::spInstance = { nullptr };
+    static std::mutex sInstanceMutex;
+
+    ImageEncodeQueue::SharedPtr ImageEncodeQueue::create(uint32_t workerCount, uint32_t capacity)
+    {
+        return SharedPtr(new ImageEncodeQueue(workerCount, capacity));
+    }
+
+    ImageEncodeQueue& ImageEncodeQueue::instance()
+    {
+        ImageEncodeQueue* pInstance = spInstance.load(std::memory_order_acquire);
+        if (pInstance == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(sInstanceMutex);
+            pInstance = spInstance.load(std::memory_order_relaxed);
+            if (pInstance == nullptr)
+            {
+                pInstance = new ImageEncodeQueue(0, 0);
+                spInstance.store(pInstance, std::memory_order_release);
+            }
+        }
+        return *pInstance;
+    }
+
+    void ImageEncodeQueue::shutdown()
+    {
+        std::lock_guard<std::mutex> lock(sInstanceMutex);
+        delete spInstance.exchange(nullptr);
+    }
+
+    ImageEncodeQueue::ImageEncodeQueue(uint32_t workerCount, uint32_t capacity)
+    {
+        if (workerCount == 0)
+        {
+            uint32_t hwThreads = std::thread::hardware_concurrency();
+            workerCount = std::min(std::max(hwThreads / 2, 1u), 4u);
+        }
+        mCapacity = capacity ? capacity : workerCount * 2;
+
+        mThreads.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++)
+        {
+            mThreads.emplace_back(&ImageEncodeQueue::workerThread, this);
+        }
+    }
+
+    ImageEncodeQueue::~ImageEncodeQueue()
+    {
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mShutdown = true;
+        }
+        mWorkCondition.notify_all();
+        for (auto& t : mThreads)
+        {
+            if (t.joinable()) t.join();
+        }
+    }
+
+    bool ImageEncodeQueue::push(Job job, bool wait)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (mJobs.size() >= mCapacity)
+        {
+            if (wait == false)
+            {
+                mDroppedJobs++;
+                return false;
+            }
+            mSpaceCondition.wait(lock, [this]() { return mJobs.size() < mCapacity; });
+        }
+        mJobs.push_back(std::move(job));
+        lock.unlock();
+        mWorkCondition.notify_one();
+        return true;
+    }
+
+    void ImageEncodeQueue::flush()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mIdleCondition.wait(lock, [this]() { return mJobs.empty() && mActiveJobs == 0; });
+    }
+
+    uint32_t ImageEncodeQueue::getPendingCount() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return (uint32_t)mJobs.size() + mActiveJobs;
+    }
+
+    uint64_t ImageEncodeQueue::getDroppedCount() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mDroppedJobs;
+    }
+
+    void ImageEncodeQueue::encode(Job& job)
+    {
+        Bitmap::saveImage(job.filename, job.width, job.height, job.fileFormat, job.exportFlags, job.resourceFormat, job.isTopDown, job.data.data());
+    }
+
+    void ImageEncodeQueue::workerThread()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWorkCondition.wait(lock, [this]() { return mShutdown || mJobs.empty() == false; });
+                if (mJobs.empty()) return;
+                job = std::move(mJobs.front());
+                mJobs.pop_front();
+                mActiveJobs++;
+            }
+            mSpaceCondition.notify_one();
+
+            encode(job);
+            job.data = std::vector<uint8_t>();
+
+            bool idle;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mActiveJobs--;
+                idle = mJobs.empty() && mActiveJobs == 0;
+            }
+            if (idle) mIdleCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,132 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Utils/Bitmap.h"
+
+namespace Falcor
+{
+    /** Bounded queue of images waiting to be written to disk, processed by a set of dedicated encoder threads.
+        Image encoding is slow (PNG compression of a 1080p frame takes tens of milliseconds) and mostly serial, so it runs on its own threads instead of the task scheduler, where it would starve short-lived tasks.
+        The queue has a fixed capacity. Once it's full, push() blocks the producer until an encoder is done with an image, which keeps memory usage bounded when capturing long sequences.
+    */
+    class ImageEncodeQueue
+    {
+    public:
+        using SharedPtr = std::shared_ptr<ImageEncodeQueue>;
+
+        /** An image to encode. The queue takes ownership of the pixel data.
+        */
+        struct Job
+        {
+            std::string filename;                                           ///< Output filename
+            uint32_t width = 0;                                             ///< Image width
+            uint32_t height = 0;                                            ///< Image height
+            Bitmap::FileFormat fileFormat = Bitmap::FileFormat::PngFile;    ///< Destination file format
+            Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None;    ///< Export flags, see Bitmap::saveImage()
+            ResourceFormat resourceFormat = ResourceFormat::Unknown;        ///< The format of the pixel data
+            bool isTopDown = true;                                          ///< The memory layout of the pixel data
+            std::vector<uint8_t> data;                                      ///< Tightly packed pixel data
+        };
+
+        /** Create a new queue.
+            \param[in] workerCount Number of encoder threads. 0 will use half the hardware threads, up to 4.
+            \param[in] capacity Maximum number of images waiting to be encoded. 0 will use two images per encoder thread.
+        */
+        static SharedPtr create(uint32_t workerCount = 0, uint32_t capacity = 0);
+
+        /** Get the global queue. It's a singleton, you'll always get the same object
+        */
+        static ImageEncodeQueue& instance();
+
+        /** Destroy the global queue. Waits for all the pending images to be written and joins the encoder threads. Calling instance() afterwards creates a new queue.
+        */
+        static void shutdown();
+
+        /** Destroy the queue. Waits for all the pending images to be written.
+        */
+        ~ImageEncodeQueue();
+
+        /** Add an image to the queue. Thread-safe.
+            \param[in] job The image to encode
+            \param[in] wait If true and the queue is full, blocks until there's room for the image. Otherwise, the image is dropped.
+            \return true if the image was queued, false if it was dropped
+        */
+        bool push(Job job, bool wait = true);
+
+        /** Block until all the queued images were written to disk
+        */
+        void flush();
+
+        /** Get the number of images which were queued and not written yet
+        */
+        uint32_t getPendingCount() const;
+
+        /** Get the number of images which were dropped because the queue was full
+        */
+        uint64_t getDroppedCount() const;
+
+        /** Get the number of encoder threads
+        */
+        uint32_t getWorkerCount() const { return (uint32_t)mThreads.size(); }
+
+        /** Get the maximum number of images waiting to be encoded
+        */
+        uint32_t getCapacity() const { return mCapacity; }
+
+        /** Encode an image on the calling thread. This is what the encoder threads execute.
+            Calls Bitmap::saveImage(), which may modify the data in place.
+        */
+        static void encode(Job& job);
+
+    private:
+        ImageEncodeQueue(uint32_t workerCount, uint32_t capacity);
+        void workerThread();
+
+        static std::atomic<ImageEncodeQueue*> spInstance;
+
+        std::vector<std::thread> mThreads;
+        uint32_t mCapacity;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mWorkCondition;     // Signaled when a job was queued or on shutdown
+        std::condition_variable mSpaceCondition;    // Signaled when a job was removed from the queue
+        std::condition_variable mIdleCondition;     // Signaled when the last in-flight job completed
+        std::deque<Job> mJobs;
+        uint32_t mActiveJobs = 0;                   // Jobs removed from the queue which are still being encoded
+        uint64_t mDroppedJobs = 0;
+        bool mShutdown = false;
+    };
+}
@@ -28,7 +28,15 @@
 #include "Framework.h"
 #include "Logger.h"
 #include "Utils/Platform/OS.h"
+#include "Utils/MpscQueue.h"
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace Falcor
 {
@@ -38,10 +46,22 @@ namespace Falcor
     bool Logger::sShowErrorBox = false;
 #endif
 
-    FILE* Logger::sLogFile = nullptr;
     Logger::Level Logger::sVerbosity = Logger::Level::Warning;
 
-    static FILE* openLogFile()
+    static const char kBinaryLogMagic[8] = { 'F', 'L', 'O', 'G', 'B', 'I', 'N', '1' };
+    static const uint32_t kDefaultRateLimitRepeats = 10;
+    static const float kDefaultRateLimitWindow = 5.0f;
+
+    static const std::chrono::steady_clock::time_point gStartTime = std::chrono::steady_clock::now();
+
+    static uint32_t getLogThreadID()
+    {
+        static std::atomic<uint32_t> sNextID = { 0 };
+        thread_local uint32_t id = sNextID++;
+        return id;
+    }
+
+    static FILE* openLogFile(const char* extension)
     {
         FILE* pFile = nullptr;
 
@@ -52,9 +72,9 @@ namespace Falcor
         std::string prefix = std::string(filename);
         std::string executableDir = getExecutableDirectory();
         std::string logFile;
-        if(findAvailableFilename(prefix, executableDir, "log", logFile))
+        if(findAvailableFilename(prefix, executableDir, extension, logFile))
         {
-            pFile = std::fopen(logFile.c_str(), "w");
+            pFile = std::fopen(logFile.c_str(), "wb");
             if(pFile != nullptr)
             {
                 // Success
@@ -66,12 +86,294 @@ namespace Falcor
         return pFile;
     }
 
+    const char* getLogLevelString(Logger::Level L)
+    {
+        const char* c = nullptr;
+#define create_level_case(_l) case _l: c = "(" #_l ")" ;break;
+        switch(L)
+        {
+            create_level_case(Logger::Level::Info);
+            create_level_case(Logger::Level::Warning);
+            create_level_case(Logger::Level::Error);
+            create_level_case(Logger::Level::Fatal);
+        default:
+            should_not_get_here();
+        }
+#undef create_level_case
+        return c;
+    }
+
+    namespace
+    {
+        struct LogRecord
+        {
+            uint64_t timestamp = 0;         // Nanoseconds since the application started
+            uint32_t threadID = 0;
+            Logger::Level level = Logger::Level::Info;
+            const char* subsystem = nullptr;
+            std::string msg;
+        };
+
+        std::string formatRecord(const LogRecord& record)
+        {
+            char prefix[64];
+            std::snprintf(prefix, sizeof(prefix), "[%12.6f][T%u] ", double(record.timestamp) * 1e-9, record.threadID);
+            std::string s = prefix + std::string(getLogLevelString(record.level)) + "\t";
+            if (record.subsystem)
+            {
+                s += std::string("[") + record.subsystem + "] ";
+            }
+            return s + record.msg + "\n";
+        }
+
+        /** Background thread writing the queued log records
+        */
+        class LogWriter
+        {
+        public:
+            ~LogWriter() { Logger::shutdown(); }
+
+            void push(LogRecord&& record);
+            void flush();
+            void stop();
+
+            std::atomic<Logger::OutputFormat> format = { Logger::OutputFormat::Text };
+            std::atomic<uint32_t> rateLimitRepeats = { kDefaultRateLimitRepeats };
+            std::atomic<float> rateLimitWindow = { kDefaultRateLimitWindow };
+
+        private:
+            void start();
+            void run();
+            void write(const LogRecord& record);
+            void output(const LogRecord& record);
+            void reportSuppressed(LogRecord& record, uint32_t& suppressed);
+
+            MpscQueue<LogRecord> mQueue;
+            std::atomic<uint64_t> mPushedCount = { 0 };
+            std::atomic<bool> mStarted = { false };
+            std::atomic<bool> mWriterSleeping = { false };
+
+            std::mutex mMutex;
+            std::condition_variable mWakeWriter;
+            std::condition_variable mRecordsWritten;
+            uint64_t mWrittenCount = 0;     // Protected by mMutex
+            bool mStop = false;             // Protected by mMutex
+            bool mRunning = false;          // Protected by mMutex
+            std::thread mThread;
+
+            // Only accessed by the writer thread
+            struct RepeatState
+            {
+                uint64_t windowStart = 0;
+                uint32_t count = 0;
+                uint32_t suppressed = 0;
+                LogRecord lastSuppressed;
+            };
+            std::unordered_map<std::string, RepeatState> mRepeats;
+            FILE* mpFile = nullptr;
+            Logger::OutputFormat mFileFormat = Logger::OutputFormat::Text;
+        };
+
+        void LogWriter::start()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mStarted.load() || mStop) return;
+            mRunning = true;
+            mThread = std::thread(&LogWriter::run, this);
+            mStarted.store(true);
+        }
+
+        void LogWriter::push(LogRecord&& record)
+        {
+            if (mStarted.load(std::memory_order_acquire) == false) start();
+
+            mQueue.push(std::move(record));
+            mPushedCount.fetch_add(1);
+
+            // Only take the lock if the writer is waiting for work
+            if (mWriterSleeping.load())
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mWakeWriter.notify_one();
+            }
+        }
+
+        void LogWriter::flush()
+        {
+            if (mStarted.load() == false) return;
+
+            uint64_t target = mPushedCount.load();
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeWriter.notify_one();
+            mRecordsWritten.wait(lock, [&]() { return mWrittenCount >= target || mRunning == false; });
+        }
+
+        void LogWriter::stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStop = true;
+                mWakeWriter.notify_one();
+            }
+
+            if (mThread.joinable())
+            {
+                mThread.join();
+            }
+        }
+
+        void LogWriter::run()
+        {
+            while (true)
+            {
+                uint64_t written = 0;
+                LogRecord record;
+                while (mQueue.pop(record))
+                {
+                    write(record);
+                    written++;
+                }
+                if (mpFile) fflush(mpFile);
+
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWrittenCount += written;
+                if (written) mRecordsWritten.notify_all();
+
+                if (mWrittenCount < mPushedCount.load())
+                {
+                    // A producer is in the middle of a push
+                    lock.unlock();
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                if (mStop) break;
+
+                mWriterSleeping.store(true);
+                if (mWrittenCount >= mPushedCount.load())
+                {
+                    // Producers only notify when they see the writer sleeping, the timeout is a safety net
+                    mWakeWriter.wait_for(lock, std::chrono::milliseconds(100));
+                }
+                mWriterSleeping.store(false);
+            }
+
+            for (auto& repeat : mRepeats)
+            {
+                reportSuppressed(repeat.second.lastSuppressed, repeat.second.suppressed);
+            }
+            mRepeats.clear();
+
+            if (mpFile)
+            {
+                fclose(mpFile);
+                mpFile = nullptr;
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRunning = false;
+            mRecordsWritten.notify_all();
+        }
+
+        void LogWriter::write(const LogRecord& record)
+        {
+            const uint32_t maxRepeats = rateLimitRepeats.load(std::memory_order_relaxed);
+            if (maxRepeats > 0)
+            {
+                const uint64_t window = uint64_t(double(rateLimitWindow.load(std::memory_order_relaxed)) * 1e9);
+                std::string key = std::to_string((int)record.level) + (record.subsystem ? record.subsystem : "") + '\x1f' + record.msg;
+                RepeatState& state = mRepeats[key];
+
+                if (state.count == 0 || record.timestamp >= state.windowStart + window)
+                {
+                    reportSuppressed(state.lastSuppressed, state.suppressed);
+                    state.windowStart = record.timestamp;
+                    state.count = 0;
+                }
+
+                if (++state.count > maxRepeats)
+                {
+                    state.suppressed++;
+                    state.lastSuppressed = record;
+                    return;
+                }
+
+                // Forget messages whose window expired, so that the table doesn't grow forever
+                if (mRepeats.size() > 4096)
+                {
+                    for (auto it = mRepeats.begin(); it != mRepeats.end();)
+                    {
+                        if (record.timestamp >= it->second.windowStart + window && it->second.suppressed == 0) it = mRepeats.erase(it);
+                        else ++it;
+                    }
+                }
+            }
+
+            output(record);
+        }
+
+        void LogWriter::reportSuppressed(LogRecord& record, uint32_t& suppressed)
+        {
+            if (suppressed == 0) return;
+
+            record.msg = "Message repeated " + std::to_string(suppressed) + " more times: " + record.msg;
+            output(record);
+            suppressed = 0;
+        }
+
+        void LogWriter::output(const LogRecord& record)
+        {
+            Logger::OutputFormat requestedFormat = format.load(std::memory_order_relaxed);
+            if (mpFile == nullptr || requestedFormat != mFileFormat)
+            {
+                if (mpFile) fclose(mpFile);
+                mFileFormat = requestedFormat;
+                mpFile = openLogFile(mFileFormat == Logger::OutputFormat::Text ? "log" : "flog");
+                if (mpFile == nullptr) return;
+
+                if (mFileFormat == Logger::OutputFormat::Binary)
+                {
+                    fwrite(kBinaryLogMagic, sizeof(kBinaryLogMagic), 1, mpFile);
+                }
+            }
+
+            if (mFileFormat == Logger::OutputFormat::Text)
+            {
+                std::string s = formatRecord(record);
+                fwrite(s.data(), 1, s.size(), mpFile);
+                if (isDebuggerPresent())
+                {
+                    printToDebugWindow(s);
+                }
+            }
+            else
+            {
+                // Fixed-size header followed by the strings
+                uint32_t subsystemLength = record.subsystem ? (uint32_t)strlen(record.subsystem) : 0;
+                uint32_t msgLength = (uint32_t)record.msg.size();
+                int32_t level = (int32_t)record.level;
+                fwrite(&record.timestamp, sizeof(record.timestamp), 1, mpFile);
+                fwrite(&record.threadID, sizeof(record.threadID), 1, mpFile);
+                fwrite(&level, sizeof(level), 1, mpFile);
+                fwrite(&subsystemLength, sizeof(subsystemLength), 1, mpFile);
+                fwrite(&msgLength, sizeof(msgLength), 1, mpFile);
+                if (subsystemLength) fwrite(record.subsystem, 1, subsystemLength, mpFile);
+                fwrite(record.msg.data(), 1, msgLength, mpFile);
+                if (isDebuggerPresent())
+                {
+                    printToDebugWindow(formatRecord(record));
+                }
+            }
+        }
+
+        LogWriter gLogWriter;
+    }
+
     bool Logger::init()
     {
 #if _LOG_ENABLED
-        sLogFile = openLogFile();
-        sInit = sLogFile != nullptr;
-        assert(sInit);
+        // The log file is created by the writer thread when the first message is logged
+        sInit = true;
 #endif
         return sInit;
     }
@@ -81,44 +383,92 @@ namespace Falcor
     void Logger::shutdown()
     {
 #if _LOG_ENABLED
-        if(sLogFile)
-        {
-            fclose(sLogFile);
-            sLogFile = nullptr;
-            sInit = false;
-        }
+        sInit = false;
+        gLogWriter.stop();
 #endif
     }
 
-    const char* getLogLevelString(Logger::Level L)
+    void Logger::setOutputFormat(OutputFormat format)
     {
-        const char* c = nullptr;
-#define create_level_case(_l) case _l: c = "(" #_l ")" ;break;
-        switch(L)
+        gLogWriter.format = format;
+    }
+
+    void Logger::setRateLimit(uint32_t maxRepeats, float windowSeconds)
+    {
+        gLogWriter.rateLimitRepeats = maxRepeats;
+        gLogWriter.rateLimitWindow = windowSeconds;
+    }
+
+    void Logger::flush()
+    {
+#if _LOG_ENABLED
+        gLogWriter.flush();
+#endif
+    }
+
+    bool Logger::convertBinaryLog(const std::string& binaryFilename, const std::string& textFilename)
+    {
+        std::ifstream in(binaryFilename, std::ios::binary);
+        char magic[sizeof(kBinaryLogMagic)];
+        if (!in.read(magic, sizeof(magic)) || memcmp(magic, kBinaryLogMagic, sizeof(magic)) != 0)
         {
-            create_level_case(Logger::Level::Info);
-            create_level_case(Logger::Level::Warning);
-            create_level_case(Logger::Level::Error);
-        default:
-            should_not_get_here();
+            logError("Can't convert log file " + binaryFilename + ". It's not a binary log file");
+            return false;
         }
-#undef create_level_case
-        return c;
+
+        std::ofstream out(textFilename);
+        while (in.peek() != EOF)
+        {
+            LogRecord record;
+            int32_t level;
+            uint32_t subsystemLength, msgLength;
+            in.read((char*)&record.timestamp, sizeof(record.timestamp));
+            in.read((char*)&record.threadID, sizeof(record.threadID));
+            in.read((char*)&level, sizeof(level));
+            in.read((char*)&subsystemLength, sizeof(subsystemLength));
+            in.read((char*)&msgLength, sizeof(msgLength));
+            if (!in || level < (int32_t)Level::Info || level > (int32_t)Level::Fatal)
+            {
+                logError("Can't convert log file " + binaryFilename + ". The file is corrupt");
+                return false;
+            }
+
+            std::string subsystem(subsystemLength, '\0');
+            record.msg.resize(msgLength);
+            in.read(&subsystem[0], subsystemLength);
+            in.read(&record.msg[0], msgLength);
+            if (!in)
+            {
+                logError("Can't convert log file " + binaryFilename + ". The file is truncated");
+                return false;
+            }
+
+            record.level = (Level)level;
+            record.subsystem = subsystemLength ? subsystem.c_str() : nullptr;
+            out << formatRecord(record);
+        }
+        return true;
     }
 
-    void Logger::log(Level L, const std::string& msg, bool forceMsgBox)
+    void Logger::log(Level L, const std::string& msg, bool forceMsgBox, const char* subsystem)
     {
 #if _LOG_ENABLED
         if(sInit)
         {
             if(L >= sVerbosity)
             {
-                std::string s = getLogLevelString(L) + std::string("\t") + msg + "\n";
-                std::fprintf(sLogFile, "%s", s.c_str());
-                fflush(sLogFile);   // Slows down execution, but ensures that the message will be printed in case of a crash
-                if (isDebuggerPresent())
+                LogRecord record;
+                record.timestamp = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gStartTime).count();
+                record.threadID = getLogThreadID();
+                record.level = L;
+                record.subsystem = subsystem;
+                record.msg = msg;
+                gLogWriter.push(std::move(record));
+
+                // Make sure errors reach the file in case the application crashes
+                if (L >= Level::Error)
                 {
-                    printToDebugWindow(s);
+                    gLogWriter.flush();
                 }
             }
         }
@@ -31,9 +31,17 @@
 
 namespace Falcor
 {
+    /** Identifies the part of the framework a log message comes from. The name must be a string literal or otherwise outlive the logger.
+    */
+    struct LogSubsystem
+    {
+        const char* name;
+    };
+
     /** Container class for logging messages. 
     *   To enable log messages, make sure _LOG_ENABLED is set to true in FalcorConfig.h.
     *   Messages are printed to a log file in the application directory. Using Logger#ShowBoxOnError() you can control if a message box will be shown as well.
+    *   Messages are queued and written by a background thread, so logging doesn't block on I/O. Errors are flushed before log() returns.
     */
     class Logger
     {
@@ -49,6 +57,14 @@ namespace Falcor
             Disabled = -1
         };
 
+        /** Log file format
+        */
+        enum class OutputFormat
+        {
+            Text,       ///< Human-readable text file (.log)
+            Binary,     ///< Binary records (.flog), cheaper to write. Use convertBinaryLog() to read it.
+        };
+
         /** Shutdown the logger and close the log file.
         */
         static void shutdown();
@@ -71,17 +87,40 @@ namespace Falcor
         */
         static void setVerbosity(Level level) { sVerbosity = level; }
 
+        /** Set the log file format. Changing the format starts a new log file.
+        */
+        static void setOutputFormat(OutputFormat format);
+
+        /** Limit how often the same message is written. Repeats beyond the limit are counted and reported once the window expires.
+            \param[in] maxRepeats Number of times a message can be written in a window. 0 disables rate limiting.
+            \param[in] windowSeconds The window length in seconds
+        */
+        static void setRateLimit(uint32_t maxRepeats, float windowSeconds);
+
+        /** Block until all the queued messages were written to the log file
+        */
+        static void flush();
+
+        /** Convert a binary log file to text
+            \param[in] binaryFilename The binary log file
+            \param[in] textFilename The text file to create
+            \return true if the conversion succeeded, false if the binary file can't be read or is corrupt
+        */
+        static bool convertBinaryLog(const std::string& binaryFilename, const std::string& textFilename);
+
     private:
         friend void logInfo(const std::string& msg, bool forceMsgBox);
         friend void logWarning(const std::string& msg, bool forceMsgBox);
         friend void logError(const std::string& msg, bool forceMsgBox);
         friend void logErrorAndExit(const std::string& msg, bool forceMsgBox);
+        friend void logInfo(LogSubsystem subsystem, const std::string& msg);
+        friend void logWarning(LogSubsystem subsystem, const std::string& msg);
+        friend void logError(LogSubsystem subsystem, const std::string& msg);
 
-        static void log(Level L, const std::string& msg, bool forceMsgBox = false);
+        static void log(Level L, const std::string& msg, bool forceMsgBox = false, const char* subsystem = nullptr);
 
         Logger() = delete;
         static bool sShowErrorBox;
-        static FILE* sLogFile;
         static bool sInit;
         static Level sVerbosity;
         static bool init();
@@ -91,4 +130,7 @@ namespace Falcor
     inline void logWarning(const std::string& msg, bool forceMsgBox = false) { Logger::log(Logger::Level::Warning, msg, forceMsgBox); }
     inline void logError(const std::string& msg, bool forceMsgBox = false) { Logger::log(Logger::Level::Error, msg, forceMsgBox); }
     inline void logErrorAndExit(const std::string& msg, bool forceMsgBox = false) { Logger::log(Logger::Level::Error, msg + "\nTerminating...", forceMsgBox); exit(1); }
+    inline void logInfo(LogSubsystem subsystem, const std::string& msg) { Logger::log(Logger::Level::Info, msg, false, subsystem.name); }
+    inline void logWarning(LogSubsystem subsystem, const std::string& msg) { Logger::log(Logger::Level::Warning, msg, false, subsystem.name); }
+    inline void logError(LogSubsystem subsystem, const std::string& msg) { Logger::log(Logger::Level::Error, msg, false, subsystem.name); }
 }
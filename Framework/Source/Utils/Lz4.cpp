@@ -0,0 +1,216 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Lz4.h"
+#include <cstring>
+#include <vector>
+
+namespace Falcor
+{
+    static const size_t kMinMatch = 4;
+    static const size_t kLastLiterals = 5;      // The last 5 bytes of a block are always literals
+    static const size_t kMatchStartLimit = 12;  // The last match must start at least 12 bytes before the end of the block
+    static const size_t kMaxOffset = 65535;
+    static const uint32_t kHashLog = 16;
+
+    static uint32_t read32(const uint8_t* p)
+    {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static uint32_t hashSequence(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - kHashLog);
+    }
+
+    static uint8_t* writeLength(uint8_t* pOut, size_t length)
+    {
+        while (length >= 255)
+        {
+            *pOut++ = 255;
+            length -= 255;
+        }
+        *pOut++ = (uint8_t)length;
+        return pOut;
+    }
+
+    static uint8_t* writeLiterals(uint8_t* pOut, uint8_t& token, const uint8_t* pLiterals, size_t length)
+    {
+        if (length >= 15)
+        {
+            token = 15 << 4;
+            pOut = writeLength(pOut, length - 15);
+        }
+        else
+        {
+            token = (uint8_t)(length << 4);
+        }
+        if (length) std::memcpy(pOut, pLiterals, length);
+        return pOut + length;
+    }
+
+    size_t lz4Compress(const void* pSrcData, size_t srcSize, void* pDstData, size_t dstCapacity)
+    {
+        if (dstCapacity < lz4CompressBound(srcSize)) return 0;
+
+        const uint8_t* pSrc = (const uint8_t*)pSrcData;
+        uint8_t* pOut = (uint8_t*)pDstData;
+        size_t anchor = 0;
+
+        if (srcSize >= kMatchStartLimit)
+        {
+            std::vector<uint32_t> table(size_t(1) << kHashLog, 0);
+            const size_t matchEndLimit = srcSize - kLastLiterals;
+            const size_t matchStartLimit = srcSize - kMatchStartLimit;
+
+            size_t pos = 0;
+            while (pos <= matchStartLimit)
+            {
+                const uint32_t sequence = read32(pSrc + pos);
+                uint32_t& entry = table[hashSequence(sequence)];
+                size_t candidate = entry;
+                entry = (uint32_t)pos;
+
+                if (candidate >= pos || pos - candidate > kMaxOffset || read32(pSrc + candidate) != sequence)
+                {
+                    pos++;
+                    continue;
+                }
+
+                // Extend the match backwards into the pending literals, then forward
+                while (pos > anchor && candidate > 0 && pSrc[pos - 1] == pSrc[candidate - 1])
+                {
+                    pos--;
+                    candidate--;
+                }
+                size_t length = kMinMatch;
+                while (pos + length < matchEndLimit && pSrc[pos + length] == pSrc[candidate + length])
+                {
+                    length++;
+                }
+
+                // Emit the sequence - token, literals, offset, match length
+                uint8_t* pToken = pOut++;
+                uint8_t token;
+                pOut = writeLiterals(pOut, token, pSrc + anchor, pos - anchor);
+                const size_t offset = pos - candidate;
+                *pOut++ = (uint8_t)(offset & 0xff);
+                *pOut++ = (uint8_t)(offset >> 8);
+                const size_t matchLength = length - kMinMatch;
+                if (matchLength >= 15)
+                {
+                    token |= 15;
+                    pOut = writeLength(pOut, matchLength - 15);
+                }
+                else
+                {
+                    token |= (uint8_t)matchLength;
+                }
+                *pToken = token;
+
+                pos += length;
+                anchor = pos;
+            }
+        }
+
+        // The last sequence only has literals
+        uint8_t* pToken = pOut++;
+        pOut = writeLiterals(pOut, *pToken, pSrc + anchor, srcSize - anchor);
+        return pOut - (uint8_t*)pDstData;
+    }
+
+    static bool readLength(const uint8_t*& pIn, const uint8_t* pInEnd, size_t& length)
+    {
+        uint8_t b;
+        do
+        {
+            if (pIn >= pInEnd) return false;
+            b = *pIn++;
+            length += b;
+        } while (b == 255);
+        return true;
+    }
+
+    bool lz4Decompress(const void* pSrcData, size_t srcSize, void* pDstData, size_t dstSize)
+    {
+        const uint8_t* pIn = (const uint8_t*)pSrcData;
+        const uint8_t* const pInEnd = pIn + srcSize;
+        uint8_t* const pDst = (uint8_t*)pDstData;
+        uint8_t* pOut = pDst;
+        uint8_t* const pOutEnd = pDst + dstSize;
+
+        while (pIn < pInEnd)
+        {
+            const uint8_t token = *pIn++;
+
+            // Literals
+            size_t literals = token >> 4;
+            if (literals == 15 && readLength(pIn, pInEnd, literals) == false) return false;
+            if (literals > size_t(pInEnd - pIn) || literals > size_t(pOutEnd - pOut)) return false;
+            if (literals) std::memcpy(pOut, pIn, literals);
+            pIn += literals;
+            pOut += literals;
+
+            // The last sequence ends after the literals
+            if (pIn == pInEnd) return pOut == pOutEnd;
+
+            // Match
+            if (pInEnd - pIn < 2) return false;
+            const size_t offset = size_t(pIn[0]) | (size_t(pIn[1]) << 8);
+            pIn += 2;
+            if (offset == 0 || offset > size_t(pOut - pDst)) return false;
+
+            size_t length = token & 15;
+            if (length == 15 && readLength(pIn, pInEnd, length) == false) return false;
+            length += kMinMatch;
+            if (length > size_t(pOutEnd - pOut)) return false;
+
+            const uint8_t* pMatch = pOut - offset;
+            if (offset >= length)
+            {
+                std::memcpy(pOut, pMatch, length);
+                pOut += length;
+            }
+            else
+            {
+                // Overlapping copy, repeats the last 'offset' bytes. Blocks of up to 'offset' bytes don't overlap.
+                const size_t blockSize = offset >= 8 ? 8 : 1;
+                for (; length >= blockSize; length -= blockSize)
+                {
+                    std::memcpy(pOut, pMatch, blockSize);
+                    pOut += blockSize;
+                    pMatch += blockSize;
+                }
+                while (length--) *pOut++ = *pMatch++;
+            }
+        }
+        return false;
+    }
+}
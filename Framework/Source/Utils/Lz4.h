@@ -0,0 +1,57 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Falcor
+{
+    /** Get the worst-case size of LZ4-compressed data
+        \param[in] size The uncompressed size in bytes
+    */
+    inline size_t lz4CompressBound(size_t size) { return size + size / 255 + 16; }
+
+    /** Compress data into an LZ4 block. The output uses the standard LZ4 block format, so it can be decoded by any LZ4 implementation.
+        The compressor is a fast greedy one. It favors speed over compression ratio.
+        \param[in] pSrc The data to compress
+        \param[in] srcSize The data size in bytes
+        \param[out] pDst The destination buffer
+        \param[in] dstCapacity The destination buffer size. Must be at least lz4CompressBound(srcSize).
+        \return The compressed size, or 0 if the destination buffer is too small
+    */
+    size_t lz4Compress(const void* pSrc, size_t srcSize, void* pDst, size_t dstCapacity);
+
+    /** Decompress an LZ4 block. The input is validated, corrupted data can't cause reads or writes out of bounds.
+        \param[in] pSrc The compressed block
+        \param[in] srcSize The compressed size in bytes
+        \param[out] pDst The destination buffer
+        \param[in] dstSize The exact uncompressed size
+        \return true if the block was decoded and its uncompressed size matches dstSize, otherwise false
+    */
+    bool lz4Decompress(const void* pSrc, size_t srcSize, void* pDst, size_t dstSize);
+}
@@ -0,0 +1,166 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <cstring>
+#include <string>
+#include "Utils/Platform/OS.h"
+
+namespace Falcor
+{
+    /** Read-only binary stream over a memory-mapped file.
+        Has the same read interface as BinaryFileStream, but can also return views into the mapping, so large payloads can be consumed without copying them.
+        Reading past the end of the file puts the stream into a failed state, after which all reads fail.
+    */
+    class MappedFileStream
+    {
+    public:
+        /** Default constructor.
+        */
+        MappedFileStream() {};
+
+        /** Constructor that opens a file
+            \param[in] filename Full path of the file to open
+        */
+        MappedFileStream(const std::string& filename)
+        {
+            open(filename);
+        }
+
+        MappedFileStream(const MappedFileStream&) = delete;
+        MappedFileStream& operator=(const MappedFileStream&) = delete;
+
+        /** Destructor
+        */
+        ~MappedFileStream()
+        {
+            close();
+        }
+
+        /** Map a file. Closes the previously opened file.
+            \param[in] filename Full path of the file to open
+            \return true if the file was mapped, otherwise false
+        */
+        bool open(const std::string& filename)
+        {
+            close();
+            mFail = (mapFile(filename, mFile) == false);
+            return !mFail;
+        }
+
+        /** Unmap the file. Views returned by readView() become invalid.
+        */
+        void close()
+        {
+            unmapFile(mFile);
+            mOffset = 0;
+            mFail = false;
+        }
+
+        /** Check if a file is mapped
+        */
+        bool isOpen() const { return mFile.pData != nullptr; }
+
+        /** Get the current read position in bytes from the start of the file
+        */
+        size_t getOffset() const { return mOffset; }
+
+        /** Get the number of bytes remaining in the file
+        */
+        size_t getRemainingStreamSize() const { return mFile.size - mOffset; }
+
+        /** Checks for validity of the stream
+            \return Returns true if no errors have been encountered and the end of the stream has not been reached
+        */
+        bool isGood() const { return !mFail && mOffset < mFile.size; }
+
+        /** Checks for stream errors.
+            \return Returns true if the file couldn't be mapped or a read went past the end of the file
+        */
+        bool isFail() const { return mFail; }
+
+        /** Checks if the end of file has been reached.
+        */
+        bool isEof() const { return mOffset >= mFile.size; }
+
+        /** Get a view into the mapping and advance the stream. The memory is valid until the stream is closed.
+            Note that the view is not necessarily aligned.
+            \param[in] count Number of bytes to read
+            \return Pointer to the data, or nullptr if there aren't enough bytes left in the file
+        */
+        const uint8_t* readView(size_t count)
+        {
+            if (mFail || count > getRemainingStreamSize())
+            {
+                mFail = true;
+                return nullptr;
+            }
+            const uint8_t* pData = mFile.pData + mOffset;
+            mOffset += count;
+            return pData;
+        }
+
+        /** Get a view at an absolute offset. Doesn't move the stream.
+            \param[in] offset Offset in bytes from the start of the file
+            \param[in] count Number of bytes
+            \return Pointer to the data, or nullptr if the range isn't inside the file
+        */
+        const uint8_t* getView(size_t offset, size_t count) const
+        {
+            if (offset > mFile.size || count > mFile.size - offset) return nullptr;
+            return mFile.pData + offset;
+        }
+
+        /** Skip data in the stream
+            \param[in] count Bytes to skip
+        */
+        void skip(size_t count) { readView(count); }
+
+        /** Copy data out of the stream. On failure the destination is zeroed.
+            \param[out] pData Pointer to a buffer to copy the data into
+            \param[in] count Number of bytes to read
+        */
+        MappedFileStream& read(void* pData, size_t count)
+        {
+            const uint8_t* pSrc = readView(count);
+            if (pSrc) std::memcpy(pData, pSrc, count);
+            else std::memset(pData, 0, count);
+            return *this;
+        }
+
+        /** Extracts a single value from the stream
+            \param[out] val Reference of value to extract into
+        */
+        template<typename T>
+        MappedFileStream& operator>>(T& val) { return read(&val, sizeof(T)); }
+
+    private:
+        MappedFile mFile;
+        size_t mOffset = 0;
+        bool mFail = false;
+    };
+}
@@ -0,0 +1,115 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <atomic>
+#include <utility>
+
+namespace Falcor
+{
+    /** Unbounded lock-free multi-producer, single-consumer queue.
+        push() can be called from any thread, pop() must only be called from a single consumer thread.
+        Based on Dmitry Vyukov's intrusive MPSC node-based queue. Each push allocates a node.
+    */
+    template<typename T>
+    class MpscQueue
+    {
+    public:
+        MpscQueue() : mpHead(&mStub), mpTail(&mStub) {}
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        ~MpscQueue()
+        {
+            T value;
+            while (pop(value));
+        }
+
+        /** Add an item to the queue. Thread-safe.
+        */
+        void push(T value)
+        {
+            Node* pNode = new Node;
+            pNode->value = std::move(value);
+            pushNode(pNode);
+        }
+
+        /** Remove the oldest item from the queue. Only call from the consumer thread.
+            Can return false while a producer is in the middle of a push() even if older items are queued, the consumer should try again later.
+            \param[out] value The removed item
+            \return true if an item was removed, false if the queue is empty
+        */
+        bool pop(T& value)
+        {
+            Node* pTail = mpTail;
+            Node* pNext = pTail->pNext.load(std::memory_order_acquire);
+
+            // Skip the stub node
+            if (pTail == &mStub)
+            {
+                if (pNext == nullptr) return false;
+                mpTail = pNext;
+                pTail = pNext;
+                pNext = pNext->pNext.load(std::memory_order_acquire);
+            }
+
+            if (pNext == nullptr)
+            {
+                // pTail is the last node. A producer might be linking a new node after it
+                if (pTail != mpHead.load(std::memory_order_acquire)) return false;
+
+                // Re-insert the stub so that pTail can be removed
+                pushNode(&mStub);
+                pNext = pTail->pNext.load(std::memory_order_acquire);
+                if (pNext == nullptr) return false;
+            }
+
+            mpTail = pNext;
+            value = std::move(pTail->value);
+            delete pTail;
+            return true;
+        }
+
+    private:
+        struct Node
+        {
+            std::atomic<Node*> pNext = { nullptr };
+            T value;
+        };
+
+        void pushNode(Node* pNode)
+        {
+            pNode->pNext.store(nullptr, std::memory_order_relaxed);
+            Node* pPrev = mpHead.exchange(pNode, std::memory_order_acq_rel);
+            pPrev->pNext.store(pNode, std::memory_order_release);
+        }
+
+        std::atomic<Node*> mpHead;  // Producers push here
+        Node* mpTail;               // Consumer pops from here
+        Node mStub;
+    };
+}
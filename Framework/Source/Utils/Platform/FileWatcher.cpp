@@ -0,0 +1,351 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "FileWatcher.h"
+#include "Utils/Platform/OS.h"
+#include "Utils/StringUtils.h"
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace Falcor
+{
+    namespace
+    {
+        std::string normalizePath(const std::string& path)
+        {
+            std::string canonical = canonicalizeFilename(path);
+            return canonical.size() ? canonical : replaceSubstring(path, "\\", "/");
+        }
+
+#ifdef __linux__
+        std::string getDirectory(const std::string& path)
+        {
+            size_t slash = path.find_last_of('/');
+            return (slash == std::string::npos) ? "." : path.substr(0, slash);
+        }
+#else
+        time_t getModifiedTimeIfExists(const std::string& path)
+        {
+            return doesFileExist(path) ? getFileModifiedTime(path) : 0;
+        }
+
+        const uint32_t kPollIntervalMs = 250;
+#endif
+    }
+
+    FileWatcher& FileWatcher::instance()
+    {
+        static FileWatcher watcher;
+        return watcher;
+    }
+
+    FileWatcher::FileWatcher()
+    {
+#ifdef __linux__
+        mInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (mInotifyFd < 0 || mWakeFd < 0)
+        {
+            logWarning("FileWatcher: can't initialize inotify. Changes to files will not be detected automatically");
+            return;
+        }
+#endif
+        mRunning = true;
+        mThread = std::thread(&FileWatcher::threadFunc, this);
+    }
+
+    FileWatcher::~FileWatcher()
+    {
+        shutdown();
+    }
+
+    void FileWatcher::shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRunning = false;
+            mSubscriptions.clear();
+            mPathSubscribers.clear();
+            mPendingChanges.clear();
+        }
+        wake();
+        if (mThread.joinable()) mThread.join();
+
+#ifdef __linux__
+        if (mInotifyFd >= 0) close(mInotifyFd);
+        if (mWakeFd >= 0) close(mWakeFd);
+        mInotifyFd = mWakeFd = -1;
+        mDirectoryWatches.clear();
+        mWatchDirectories.clear();
+        mDirectoryRefCount.clear();
+#else
+        mModifiedTimes.clear();
+#endif
+    }
+
+    FileWatcher::SubscriptionID FileWatcher::subscribe(const std::string& path, const Callback& callback)
+    {
+        std::string fullpath = normalizePath(path);
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mRunning == false) return kInvalidSubscription;
+
+        auto& subscribers = mPathSubscribers[fullpath];
+        if (subscribers.empty() && addToBackend(fullpath) == false)
+        {
+            mPathSubscribers.erase(fullpath);
+            return kInvalidSubscription;
+        }
+
+        SubscriptionID id = mNextID++;
+        subscribers.push_back(id);
+        mSubscriptions[id] = { fullpath, callback };
+        return id;
+    }
+
+    void FileWatcher::unsubscribe(SubscriptionID id)
+    {
+        // Wait for running callbacks to finish
+        std::lock_guard<std::recursive_mutex> callbackLock(mCallbackMutex);
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto it = mSubscriptions.find(id);
+        if (it == mSubscriptions.end()) return;
+        std::string path = it->second.path;
+        mSubscriptions.erase(it);
+
+        auto& subscribers = mPathSubscribers[path];
+        subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), id), subscribers.end());
+        if (subscribers.empty())
+        {
+            mPathSubscribers.erase(path);
+            mPendingChanges.erase(path);
+            removeFromBackend(path);
+        }
+    }
+
+    void FileWatcher::watchDataFile(const std::string& path)
+    {
+        std::string fullpath = normalizePath(path);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mDataFiles.insert(fullpath).second == false) return;
+        }
+        subscribe(fullpath, [this](const std::string&) { mDataFilesChanged = true; });
+    }
+
+    void FileWatcher::onFileChanged(const std::string& path)
+    {
+        // Called with the mutex held
+        if (mPathSubscribers.find(path) != mPathSubscribers.end())
+        {
+            mPendingChanges[path] = Clock::now();
+        }
+    }
+
+    void FileWatcher::threadFunc()
+    {
+        while (true)
+        {
+            // Sleep until something happens, or until the next pending change is due
+            uint32_t timeoutMs = (uint32_t)-1;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mRunning == false) break;
+                auto now = Clock::now();
+                for (const auto& change : mPendingChanges)
+                {
+                    auto due = change.second + std::chrono::milliseconds(mDebounceMs.load());
+                    uint32_t remaining = (due <= now) ? 0 : (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(due - now).count() + 1;
+                    timeoutMs = std::min(timeoutMs, remaining);
+                }
+            }
+
+            waitForChanges(timeoutMs);
+            dispatchChanges();
+        }
+    }
+
+    void FileWatcher::dispatchChanges()
+    {
+        std::lock_guard<std::recursive_mutex> callbackLock(mCallbackMutex);
+        std::vector<std::pair<std::string, Callback>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto now = Clock::now();
+            auto debounce = std::chrono::milliseconds(mDebounceMs.load());
+            for (auto it = mPendingChanges.begin(); it != mPendingChanges.end();)
+            {
+                if (now - it->second < debounce)
+                {
+                    ++it;
+                    continue;
+                }
+
+                for (SubscriptionID id : mPathSubscribers[it->first])
+                {
+                    callbacks.push_back({ it->first, mSubscriptions[id].callback });
+                }
+                it = mPendingChanges.erase(it);
+            }
+        }
+
+        // Call the callbacks without holding the mutex, so that they can subscribe/unsubscribe
+        for (const auto& c : callbacks)
+        {
+            c.second(c.first);
+        }
+    }
+
+#ifdef __linux__
+    bool FileWatcher::addToBackend(const std::string& path)
+    {
+        std::string dir = getDirectory(path);
+        if (mDirectoryRefCount[dir]++ > 0) return true;
+
+        // Watch the directory rather than the file. Editors often save by writing a new file and renaming it over the old one, which would end a watch on the file itself.
+        int wd = inotify_add_watch(mInotifyFd, dir.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+        if (wd < 0)
+        {
+            logWarning("FileWatcher: can't watch directory '" + dir + "'");
+            mDirectoryRefCount.erase(dir);
+            return false;
+        }
+        mDirectoryWatches[dir] = wd;
+        mWatchDirectories[wd] = dir;
+        return true;
+    }
+
+    void FileWatcher::removeFromBackend(const std::string& path)
+    {
+        std::string dir = getDirectory(path);
+        auto it = mDirectoryRefCount.find(dir);
+        if (it == mDirectoryRefCount.end() || --it->second > 0) return;
+
+        mDirectoryRefCount.erase(it);
+        int wd = mDirectoryWatches[dir];
+        inotify_rm_watch(mInotifyFd, wd);
+        mDirectoryWatches.erase(dir);
+        mWatchDirectories.erase(wd);
+    }
+
+    void FileWatcher::waitForChanges(uint32_t timeoutMs)
+    {
+        pollfd fds[2] = {};
+        fds[0].fd = mInotifyFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = mWakeFd;
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, (timeoutMs == (uint32_t)-1) ? -1 : (int)timeoutMs) <= 0) return;
+
+        if (fds[1].revents & POLLIN)
+        {
+            uint64_t value;
+            while (read(mWakeFd, &value, sizeof(value)) > 0) {}
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            alignas(inotify_event) char buffer[16 * 1024];
+            ssize_t size;
+            while ((size = read(mInotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                for (ssize_t offset = 0; offset < size;)
+                {
+                    const inotify_event* pEvent = (const inotify_event*)(buffer + offset);
+                    offset += sizeof(inotify_event) + pEvent->len;
+
+                    // The kernel dropped events, so any file might have changed. Report all of them rather than missing an edit.
+                    if (pEvent->mask & IN_Q_OVERFLOW)
+                    {
+                        logWarning("FileWatcher: the inotify event queue overflowed. Reporting all the watched files as changed");
+                        for (const auto& subscribers : mPathSubscribers) onFileChanged(subscribers.first);
+                        continue;
+                    }
+                    if (pEvent->len == 0) continue;
+
+                    auto dirIt = mWatchDirectories.find(pEvent->wd);
+                    if (dirIt != mWatchDirectories.end())
+                    {
+                        onFileChanged(dirIt->second + "/" + pEvent->name);
+                    }
+                }
+            }
+        }
+    }
+
+    void FileWatcher::wake()
+    {
+        if (mWakeFd < 0) return;
+        uint64_t value = 1;
+        ssize_t written = write(mWakeFd, &value, sizeof(value));
+        (void)written;
+    }
+#else
+    bool FileWatcher::addToBackend(const std::string& path)
+    {
+        mModifiedTimes[path] = getModifiedTimeIfExists(path);
+        return true;
+    }
+
+    void FileWatcher::removeFromBackend(const std::string& path)
+    {
+        mModifiedTimes.erase(path);
+    }
+
+    void FileWatcher::waitForChanges(uint32_t timeoutMs)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mWakeCond.wait_for(lock, std::chrono::milliseconds(std::min(timeoutMs, kPollIntervalMs)), [this]() { return mWakeRequested; });
+        mWakeRequested = false;
+
+        for (auto& file : mModifiedTimes)
+        {
+            time_t modifiedTime = getModifiedTimeIfExists(file.first);
+            if (modifiedTime != file.second)
+            {
+                file.second = modifiedTime;
+                onFileChanged(file.first);
+            }
+        }
+    }
+
+    void FileWatcher::wake()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mWakeRequested = true;
+        }
+        mWakeCond.notify_one();
+    }
+#endif
+}
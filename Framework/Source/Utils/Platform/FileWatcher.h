@@ -0,0 +1,130 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Falcor
+{
+    /** Watches files for modifications.
+        A single background thread waits for change notifications and calls the subscribers' callbacks. On Linux the notifications come from inotify, other platforms poll the files' modification time.
+        Callbacks are debounced. A burst of changes to the same file (an editor saving in several steps, for example) results in a single call once the file stays unchanged for the debounce interval.
+        Callbacks are called from the background thread.
+    */
+    class FileWatcher
+    {
+    public:
+        using Callback = std::function<void(const std::string& path)>;
+        using SubscriptionID = uint64_t;
+        static const SubscriptionID kInvalidSubscription = 0;
+
+        /** Get the global watcher. The background thread is started on first use.
+        */
+        static FileWatcher& instance();
+
+        /** Call a function when a file changes
+            \param[in] path The file to watch. The file doesn't have to exist yet.
+            \param[in] callback The function to call
+            \return A subscription ID to pass to unsubscribe(), or kInvalidSubscription if the file can't be watched
+        */
+        SubscriptionID subscribe(const std::string& path, const Callback& callback);
+
+        /** Remove a subscription. Once the function returns, the callback will not be called again.
+            It's OK to call it from inside a callback.
+        */
+        void unsubscribe(SubscriptionID id);
+
+        /** Set the time a file must stay unchanged before the callbacks are called
+        */
+        void setDebounceInterval(uint32_t milliseconds) { mDebounceMs = milliseconds; }
+
+        /** Watch a data file (a scene or a texture, for example). Samples check for changes using consumeDataFileChanges() and call IRenderer::onDataReload().
+        */
+        void watchDataFile(const std::string& path);
+
+        /** Check if any of the data files changed since the last call
+        */
+        bool consumeDataFileChanges() { return mDataFilesChanged.exchange(false); }
+
+        /** Stop the background thread and remove all subscriptions
+        */
+        void shutdown();
+
+        ~FileWatcher();
+    private:
+        FileWatcher();
+        void threadFunc();
+        bool addToBackend(const std::string& path);
+        void removeFromBackend(const std::string& path);
+        void waitForChanges(uint32_t timeoutMs);
+        void dispatchChanges();
+        void onFileChanged(const std::string& path);
+        void wake();
+
+        using Clock = std::chrono::steady_clock;
+
+        struct Subscription
+        {
+            std::string path;
+            Callback callback;
+        };
+
+        std::mutex mMutex;
+        std::recursive_mutex mCallbackMutex;    // Held while calling callbacks, so that unsubscribe() can wait for a running callback
+        std::unordered_map<SubscriptionID, Subscription> mSubscriptions;
+        std::unordered_map<std::string, std::vector<SubscriptionID>> mPathSubscribers;
+        std::unordered_map<std::string, Clock::time_point> mPendingChanges;    // Changed files and the time of their last change
+        std::unordered_set<std::string> mDataFiles;
+        SubscriptionID mNextID = 1;
+
+        std::atomic<uint32_t> mDebounceMs = { 100 };
+        std::atomic<bool> mDataFilesChanged = { false };
+        bool mRunning = false;
+        std::thread mThread;
+
+#ifdef __linux__
+        int mInotifyFd = -1;
+        int mWakeFd = -1;
+        std::unordered_map<std::string, int> mDirectoryWatches;         // Watched directory to inotify watch descriptor
+        std::unordered_map<int, std::string> mWatchDirectories;         // Watch descriptor to directory
+        std::unordered_map<std::string, uint32_t> mDirectoryRefCount;   // Number of watched paths in each directory
+#else
+        std::unordered_map<std::string, time_t> mModifiedTimes;
+        std::condition_variable mWakeCond;
+        bool mWakeRequested = false;
+#endif
+    };
+}
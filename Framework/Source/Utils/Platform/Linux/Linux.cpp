@@ -30,6 +30,7 @@
 #include "Utils/StringUtils.h"
 #include "Utils/Platform/OS.h"
 #include "Utils/Logger.h"
+#include "Utils/Platform/FileWatcher.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -42,6 +43,8 @@
 #include <algorithm>
 #include <experimental/filesystem>
 #include <dlfcn.h>
+#include <sys/mman.h>
+#include <unistd.h>
 namespace fs = std::experimental::filesystem;
 
 namespace Falcor
@@ -188,17 +191,37 @@ namespace Falcor
         struct stat sb;
         return (stat(pathname, &sb) == 0) && S_ISDIR(sb.st_mode);
     }
+
+    bool createDirectory(const std::string& path)
+    {
+        return mkdir(path.c_str(), 0777) == 0;
+    }
     
+    static std::mutex gMonitoredFilesMutex;
+    static std::unordered_map<std::string, FileWatcher::SubscriptionID> gMonitoredFiles;
+
     void monitorFileUpdates(const std::string& filePath, const std::function<void()>& callback)
     {
-        (void)filePath; (void)callback;
-        should_not_get_here();
+        // Only one callback per file, like on Windows
+        closeSharedFile(filePath);
+        FileWatcher::SubscriptionID id = FileWatcher::instance().subscribe(filePath, [callback](const std::string&) { if (callback) callback(); });
+        if (id == FileWatcher::kInvalidSubscription) return;
+
+        std::lock_guard<std::mutex> lock(gMonitoredFilesMutex);
+        gMonitoredFiles[filePath] = id;
     }
 
     void closeSharedFile(const std::string& filePath)
     {
-        (void)filePath;
-        should_not_get_here();
+        FileWatcher::SubscriptionID id;
+        {
+            std::lock_guard<std::mutex> lock(gMonitoredFilesMutex);
+            auto it = gMonitoredFiles.find(filePath);
+            if (it == gMonitoredFiles.end()) return;
+            id = it->second;
+            gMonitoredFiles.erase(it);
+        }
+        FileWatcher::instance().unsubscribe(id);
     }
 
     std::string getTempFilename()
@@ -513,4 +536,42 @@ namespace Falcor
     {
         return dlsym(dll, funcName.c_str());
     }
+
+    bool mapFile(const std::string& filename, MappedFile& file)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            return false;
+        }
+
+        struct stat fileStat;
+        void* pData = MAP_FAILED;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            pData = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        // The mapping keeps a reference to the file
+        close(fd);
+        if (pData == MAP_FAILED)
+        {
+            return false;
+        }
+
+        madvise(pData, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+        file.pData = (const uint8_t*)pData;
+        file.size = (size_t)fileStat.st_size;
+        file.pHandle = nullptr;
+        return true;
+    }
+
+    void unmapFile(MappedFile& file)
+    {
+        if (file.pData)
+        {
+            munmap((void*)file.pData, file.size);
+        }
+        file = MappedFile();
+    }
 }
\ No newline at end of file
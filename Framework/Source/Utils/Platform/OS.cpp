@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "Utils/Platform/OS.h"
 #include "Utils/StringUtils.h"
+#include <cstdio>
 #include <fstream>
 #include <experimental/filesystem>
 namespace fs = std::experimental::filesystem;
@@ -204,4 +205,15 @@ namespace Falcor
         str.assign(std::istreambuf_iterator<char>(filestream), std::istreambuf_iterator<char>());
         return str;
     }
+
+    bool replaceFile(const std::string& source, const std::string& destination)
+    {
+        // rename() replaces the destination atomically on POSIX. The Windows CRT refuses to overwrite an existing file, so only then remove it and retry
+        if (std::rename(source.c_str(), destination.c_str()) == 0) return true;
+        std::remove(destination.c_str());
+        if (std::rename(source.c_str(), destination.c_str()) == 0) return true;
+
+        std::remove(source.c_str());
+        return false;
+    }
 }
\ No newline at end of file
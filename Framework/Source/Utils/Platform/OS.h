@@ -306,6 +306,14 @@ namespace Falcor
     */
     std::string readFile(const std::string& filename);
 
+    /** Move a file over another one. Where the OS supports it, the destination is replaced atomically, so readers see either the old or the new file.
+        Used to publish files written to a temporary name. If the move fails, the source file is deleted.
+        \param[in] source The file to move
+        \param[in] destination The file to replace
+        \return true if the destination was replaced
+    */
+    bool replaceFile(const std::string& source, const std::string& destination);
+
     /** Load a shared-library
     */
     DllHandle loadDll(const std::string& libPath);
@@ -318,5 +326,25 @@ namespace Falcor
     */
     void* getDllProcAddress(DllHandle dll, const std::string& funcName);
 
+    /** A read-only view of a file mapped into memory
+    */
+    struct MappedFile
+    {
+        const uint8_t* pData = nullptr;     ///< The file content
+        size_t size = 0;                    ///< The file size in bytes
+        void* pHandle = nullptr;            ///< Platform-specific mapping handle
+    };
+
+    /** Map a file into memory for reading. Pages are loaded on first access, so the file content isn't copied.
+        \param[in] filename The full path of the file
+        \param[out] file The mapped file. Release it with unmapFile().
+        \return true if the file was mapped, false if it doesn't exist, is empty or can't be mapped
+    */
+    bool mapFile(const std::string& filename, MappedFile& file);
+
+    /** Release a file mapped with mapFile()
+    */
+    void unmapFile(MappedFile& file);
+
     /*! @} */
 };
\ No newline at end of file
@@ -552,4 +552,49 @@ namespace Falcor
     {
         return GetProcAddress(dll, funcName.c_str());
     }
+
+    bool mapFile(const std::string& filename, MappedFile& file)
+    {
+        HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        HANDLE hMapping = nullptr;
+        if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0)
+        {
+            hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+
+        // The mapping keeps a reference to the file
+        CloseHandle(hFile);
+        if (hMapping == nullptr)
+        {
+            return false;
+        }
+
+        const void* pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        if (pData == nullptr)
+        {
+            CloseHandle(hMapping);
+            return false;
+        }
+
+        file.pData = (const uint8_t*)pData;
+        file.size = (size_t)size.QuadPart;
+        file.pHandle = hMapping;
+        return true;
+    }
+
+    void unmapFile(MappedFile& file)
+    {
+        if (file.pData)
+        {
+            UnmapViewOfFile(file.pData);
+            CloseHandle(file.pHandle);
+        }
+        file = MappedFile();
+    }
 }
@@ -29,11 +29,18 @@
 #include "Profiler.h"
 #include "API/GpuTimer.h"
 #include "API/LowLevel/FencedPool.h"
+#include "API/VariablesBuffer.h"
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace Falcor
 {
@@ -43,9 +50,406 @@ namespace Falcor
     uint32_t Profiler::sCurrentLevel = 0;
     uint32_t Profiler::sGpuTimerIndex = 0;
     std::vector<Profiler::EventData*> Profiler::sProfilerVector;
+    std::vector<Profiler::EventData*> Profiler::sEventsById;
 
     std::hash<std::string> HashedString::hashFunc;
 
+    // The buffer upload statistics of the last frame
+    static VariablesBuffer::UploadStats gUploadStats;
+
+    namespace
+    {
+        // Static initialization runs on the main thread
+        const std::thread::id kMainThreadId = std::this_thread::get_id();
+
+        struct CpuEventRecord
+        {
+            uint64_t timeNs;
+            uint32_t eventId;
+            uint32_t isBegin;
+        };
+
+        /** Single-producer/single-consumer ring-buffer. The owning thread writes records, the aggregator reads them.
+            When the buffer is full new records are dropped and counted.
+        */
+        struct ThreadEventBuffer
+        {
+            static const uint64_t kCapacity = 1 << 14;
+
+            void push(uint32_t eventId, bool isBegin)
+            {
+                uint64_t write = writeIndex.load(std::memory_order_relaxed);
+                if (write - readIndex.load(std::memory_order_acquire) >= kCapacity)
+                {
+                    droppedCount.store(droppedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return;
+                }
+                CpuEventRecord& record = records[write & (kCapacity - 1)];
+                record.timeNs = CpuTimer::getCurrentTimeNs();
+                record.eventId = eventId;
+                record.isBegin = isBegin ? 1 : 0;
+                writeIndex.store(write + 1, std::memory_order_release);
+            }
+
+            CpuEventRecord records[kCapacity];
+            std::atomic<uint64_t> writeIndex = { 0 };
+            std::atomic<uint64_t> readIndex = { 0 };
+            std::atomic<uint64_t> droppedCount = { 0 };
+            uint32_t threadIndex = 0;
+            bool isMainThread = false;
+            std::atomic<bool> threadExited = { false };
+        };
+
+        /** Drains the per-thread buffers on a background thread.
+            Rolls up the events of every non-main thread into per-frame totals, and collects the raw records of all threads while a trace capture is active.
+        */
+        class CpuEventAggregator
+        {
+        public:
+            struct EventTotal
+            {
+                uint32_t eventId;
+                uint32_t level;
+                uint32_t callCount;
+                double cpuMs;
+            };
+
+            struct ThreadFrameData
+            {
+                uint32_t threadIndex;
+                uint64_t droppedCount;
+                std::vector<EventTotal> events;
+            };
+
+            ~CpuEventAggregator()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mWakeMutex);
+                    mTerminate = true;
+                }
+                mWakeCondition.notify_all();
+                if (mThread.joinable()) mThread.join();
+            }
+
+            uint32_t registerName(const HashedString& name)
+            {
+                std::lock_guard<std::mutex> lock(mNamesMutex);
+                auto it = mNameIds.find(name.hash);
+                if (it != mNameIds.end()) return it->second;
+                uint32_t id = (uint32_t)mNames.size();
+                mNames.push_back(name.str);
+                mNameIds[name.hash] = id;
+                return id;
+            }
+
+            std::string getName(uint32_t eventId)
+            {
+                std::lock_guard<std::mutex> lock(mNamesMutex);
+                return eventId < mNames.size() ? mNames[eventId] : std::string();
+            }
+
+            ThreadEventBuffer* registerThread()
+            {
+                std::lock_guard<std::mutex> lock(mBuffersMutex);
+                ThreadEventBuffer* pBuffer = nullptr;
+
+                // Reuse the buffer of a thread which exited, once the aggregator consumed all of its records
+                for (const auto& pOld : mBuffers)
+                {
+                    if (pOld->threadExited.load() && pOld->readIndex.load() == pOld->writeIndex.load())
+                    {
+                        pBuffer = pOld.get();
+                        pBuffer->threadExited = false;
+                        break;
+                    }
+                }
+
+                if (pBuffer == nullptr)
+                {
+                    pBuffer = new ThreadEventBuffer;
+                    pBuffer->threadIndex = (uint32_t)mBuffers.size();
+                    mBuffers.push_back(std::unique_ptr<ThreadEventBuffer>(pBuffer));
+                }
+                pBuffer->isMainThread = (std::this_thread::get_id() == kMainThreadId);
+                if (mThread.joinable() == false) mThread = std::thread(&CpuEventAggregator::threadFunc, this);
+                return pBuffer;
+            }
+
+            void endFrame()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mWakeMutex);
+                    mFrameBoundaryNs = CpuTimer::getCurrentTimeNs();
+                }
+                mWakeCondition.notify_all();
+            }
+
+            std::vector<ThreadFrameData> getLastFrame()
+            {
+                std::lock_guard<std::mutex> lock(mPublishMutex);
+                return mPublishedFrame;
+            }
+
+            void startCapture()
+            {
+                drain(0);
+                std::lock_guard<std::mutex> lock(mDrainMutex);
+                mCaptureRecords.clear();
+                mCaptureStartNs = CpuTimer::getCurrentTimeNs();
+                mCapturing = true;
+            }
+
+            bool endCapture(const std::string& filename);
+
+            bool isCapturing()
+            {
+                std::lock_guard<std::mutex> lock(mDrainMutex);
+                return mCapturing;
+            }
+
+        private:
+            struct ThreadState
+            {
+                std::vector<std::pair<uint32_t, uint64_t>> openEvents;  // Event ID and start time
+                std::vector<EventTotal> frameEvents[2];                 // Current frame and the frame following the pending boundary
+                std::unordered_map<uint32_t, size_t> frameIndices[2];
+            };
+
+            struct CaptureRecord
+            {
+                uint32_t threadIndex;
+                CpuEventRecord record;
+            };
+
+            static const size_t kMaxCaptureRecords = 1 << 24;
+
+            void threadFunc()
+            {
+                while (true)
+                {
+                    uint64_t boundary = 0;
+                    {
+                        std::unique_lock<std::mutex> lock(mWakeMutex);
+                        mWakeCondition.wait_for(lock, std::chrono::milliseconds(2), [this]() { return mTerminate || mFrameBoundaryNs != 0; });
+                        if (mTerminate) break;
+                        std::swap(boundary, mFrameBoundaryNs);
+                    }
+                    drain(boundary);
+                }
+            }
+
+            void drain(uint64_t frameBoundaryNs)
+            {
+                std::vector<ThreadEventBuffer*> buffers;
+                {
+                    std::lock_guard<std::mutex> lock(mBuffersMutex);
+                    for (const auto& pBuffer : mBuffers) buffers.push_back(pBuffer.get());
+                }
+
+                std::lock_guard<std::mutex> lock(mDrainMutex);
+                mThreadStates.resize(buffers.size());
+
+                for (ThreadEventBuffer* pBuffer : buffers)
+                {
+                    ThreadState& state = mThreadStates[pBuffer->threadIndex];
+                    uint64_t read = pBuffer->readIndex.load(std::memory_order_relaxed);
+                    uint64_t write = pBuffer->writeIndex.load(std::memory_order_acquire);
+                    for (; read < write; read++)
+                    {
+                        const CpuEventRecord& record = pBuffer->records[read & (ThreadEventBuffer::kCapacity - 1)];
+                        if (mCapturing && mCaptureRecords.size() < kMaxCaptureRecords) mCaptureRecords.push_back({ pBuffer->threadIndex, record });
+
+                        // The main thread events are already accounted for by the Profiler
+                        if (pBuffer->isMainThread) continue;
+
+                        // Records after the frame boundary belong to the next frame
+                        uint32_t frame = (frameBoundaryNs && record.timeNs >= frameBoundaryNs) ? 1 : 0;
+                        if (record.isBegin)
+                        {
+                            // Create the entry when the event starts, so that parents are listed before their children
+                            getFrameEvent(state, frame, record.eventId);
+                            state.openEvents.push_back({ record.eventId, record.timeNs });
+                        }
+                        else
+                        {
+                            // Unwind unmatched begin records, which can be left behind by dropped records or by a thread which exited inside an event
+                            auto match = std::find_if(state.openEvents.rbegin(), state.openEvents.rend(), [&record](const auto& e) { return e.first == record.eventId; });
+                            if (match == state.openEvents.rend()) continue;
+                            state.openEvents.resize(state.openEvents.rend() - match);
+
+                            uint64_t startNs = state.openEvents.back().second;
+                            state.openEvents.pop_back();
+                            EventTotal& total = getFrameEvent(state, frame, record.eventId);
+                            total.callCount++;
+                            total.cpuMs += double(record.timeNs - startNs) * 1.0e-6;
+                        }
+                    }
+                    pBuffer->readIndex.store(read, std::memory_order_release);
+                }
+
+                if (frameBoundaryNs) publishFrame(buffers);
+            }
+
+            EventTotal& getFrameEvent(ThreadState& state, uint32_t frame, uint32_t eventId)
+            {
+                auto it = state.frameIndices[frame].find(eventId);
+                if (it == state.frameIndices[frame].end())
+                {
+                    it = state.frameIndices[frame].insert({ eventId, state.frameEvents[frame].size() }).first;
+                    state.frameEvents[frame].push_back({ eventId, (uint32_t)state.openEvents.size(), 0, 0 });
+                }
+                return state.frameEvents[frame][it->second];
+            }
+
+            void publishFrame(const std::vector<ThreadEventBuffer*>& buffers)
+            {
+                std::vector<ThreadFrameData> frame;
+                for (ThreadEventBuffer* pBuffer : buffers)
+                {
+                    ThreadState& state = mThreadStates[pBuffer->threadIndex];
+                    if (state.frameEvents[0].size())
+                    {
+                        frame.push_back({ pBuffer->threadIndex, pBuffer->droppedCount.load(std::memory_order_relaxed), std::move(state.frameEvents[0]) });
+                    }
+                    state.frameEvents[0] = std::move(state.frameEvents[1]);
+                    state.frameIndices[0] = std::move(state.frameIndices[1]);
+                    state.frameEvents[1].clear();
+                    state.frameIndices[1].clear();
+                }
+
+                std::lock_guard<std::mutex> lock(mPublishMutex);
+                mPublishedFrame = std::move(frame);
+            }
+
+            std::thread mThread;
+            std::mutex mWakeMutex;
+            std::condition_variable mWakeCondition;
+            uint64_t mFrameBoundaryNs = 0;
+            bool mTerminate = false;
+
+            std::mutex mNamesMutex;
+            std::vector<std::string> mNames;
+            std::unordered_map<size_t, uint32_t> mNameIds;
+
+            std::mutex mBuffersMutex;
+            std::vector<std::unique_ptr<ThreadEventBuffer>> mBuffers;
+
+            std::mutex mDrainMutex;
+            std::vector<ThreadState> mThreadStates;
+            bool mCapturing = false;
+            uint64_t mCaptureStartNs = 0;
+            std::vector<CaptureRecord> mCaptureRecords;
+
+            std::mutex mPublishMutex;
+            std::vector<ThreadFrameData> mPublishedFrame;
+        };
+
+        std::string escapeJsonString(const std::string& str)
+        {
+            std::string result;
+            for (char c : str)
+            {
+                if (c == '"' || c == '\\') result += '\\';
+                if ((unsigned char)c < 0x20) continue;
+                result += c;
+            }
+            return result;
+        }
+
+        bool CpuEventAggregator::endCapture(const std::string& filename)
+        {
+            drain(0);
+            std::vector<CaptureRecord> records;
+            uint64_t startNs;
+            {
+                std::lock_guard<std::mutex> lock(mDrainMutex);
+                if (mCapturing == false) return false;
+                mCapturing = false;
+                records.swap(mCaptureRecords);
+                startNs = mCaptureStartNs;
+            }
+
+            std::ofstream out(filename.c_str());
+            if (out.fail())
+            {
+                logError("Profiler::endCapture() - can't open file '" + filename + "'");
+                return false;
+            }
+
+            out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+            uint32_t threadCount;
+            {
+                std::lock_guard<std::mutex> lock(mBuffersMutex);
+                threadCount = (uint32_t)mBuffers.size();
+                for (uint32_t i = 0; i < threadCount; i++)
+                {
+                    std::string threadName = mBuffers[i]->isMainThread ? "Main" : "Thread " + std::to_string(i);
+                    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":\"" << threadName << "\"}},\n";
+                }
+            }
+
+            char timestamp[32];
+            for (const auto& r : records)
+            {
+                if (r.record.timeNs < startNs) continue;
+                snprintf(timestamp, arraysize(timestamp), "%.3f", double(r.record.timeNs - startNs) * 1.0e-3);
+                out << "{\"name\":\"" << escapeJsonString(getName(r.record.eventId)) << "\",\"ph\":\"" << (r.record.isBegin ? "B" : "E") << "\",\"ts\":" << timestamp << ",\"pid\":0,\"tid\":" << r.threadIndex << "},\n";
+            }
+            // The trace format doesn't allow trailing commas, close the list with an empty metadata event
+            out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"" << escapeJsonString(getExecutableName()) << "\"}}\n]}\n";
+            return out.good();
+        }
+
+        CpuEventAggregator gAggregator;
+
+        // Releases the thread's buffer for reuse when the thread exits
+        struct ThreadEventBufferOwner
+        {
+            ~ThreadEventBufferOwner() { if (pBuffer) pBuffer->threadExited = true; }
+            ThreadEventBuffer* pBuffer = nullptr;
+        };
+        thread_local ThreadEventBuffer* tpEventBuffer = nullptr;
+        thread_local ThreadEventBufferOwner tEventBufferOwner;
+
+        ThreadEventBuffer* getThreadEventBuffer()
+        {
+            // Kept in a separate trivial thread_local, which is cheaper to access than the owner object
+            if (tpEventBuffer == nullptr)
+            {
+                tpEventBuffer = gAggregator.registerThread();
+                tEventBufferOwner.pBuffer = tpEventBuffer;
+            }
+            return tpEventBuffer;
+        }
+    }
+
+    uint32_t Profiler::registerEventName(const HashedString& name)
+    {
+        // Names are only registered with the aggregator, which takes a lock, the first time a thread uses them
+        thread_local std::unordered_map<size_t, uint32_t> tEventIds;
+        auto it = tEventIds.find(name.hash);
+        if (it != tEventIds.end()) return it->second;
+
+        uint32_t eventId = gAggregator.registerName(name);
+        tEventIds[name.hash] = eventId;
+        return eventId;
+    }
+
+    void Profiler::startCapture()
+    {
+        gAggregator.startCapture();
+    }
+
+    bool Profiler::endCapture(const std::string& filename)
+    {
+        return gAggregator.endCapture(filename);
+    }
+
+    bool Profiler::isCapturing()
+    {
+        return gAggregator.isCapturing();
+    }
+
     void Profiler::initNewEvent(EventData *pEvent, const HashedString& name)
     {
         pEvent->name = name.str;
@@ -85,9 +489,30 @@ namespace Falcor
         }
     }
 
+    Profiler::EventData* Profiler::getEvent(const HashedString& name, uint32_t eventId)
+    {
+        if (eventId >= sEventsById.size()) sEventsById.resize(eventId + 1, nullptr);
+        if (sEventsById[eventId] == nullptr) sEventsById[eventId] = getEvent(name);
+        return sEventsById[eventId];
+    }
+
     void Profiler::startEvent(const HashedString& name, bool showInMsg)
     {
-        EventData* pData = getEvent(name);
+        startEvent(name, registerEventName(name), showInMsg);
+    }
+
+    void Profiler::endEvent(const HashedString& name)
+    {
+        endEvent(registerEventName(name));
+    }
+
+    void Profiler::startEvent(const HashedString& name, uint32_t eventId, bool showInMsg)
+    {
+        ThreadEventBuffer* pBuffer = getThreadEventBuffer();
+        pBuffer->push(eventId, true);
+        if (pBuffer->isMainThread == false) return;
+
+        EventData* pData = getEvent(name, eventId);
         sProfilerVector.push_back(pData);
         pData->showInMsg = showInMsg;
         pData->level = sCurrentLevel;
@@ -103,9 +528,20 @@ namespace Falcor
         sCurrentLevel++;
     }
 
-    void Profiler::endEvent(const HashedString& name)
+    void Profiler::endEvent(const HashedString& name, uint32_t eventId)
     {
-        EventData* pData = getEvent(name);
+        endEvent(eventId);
+    }
+
+    void Profiler::endEvent(uint32_t eventId)
+    {
+        ThreadEventBuffer* pBuffer = getThreadEventBuffer();
+        pBuffer->push(eventId, false);
+        if (pBuffer->isMainThread == false) return;
+
+        // startEvent() created the event data, unless the events were cleared in between
+        if (eventId >= sEventsById.size() || sEventsById[eventId] == nullptr) return;
+        EventData* pData = sEventsById[eventId];
         pData->cpuEnd = CpuTimer::getCurrentTimePoint();
         pData->cpuTotal += CpuTimer::calcDuration(pData->cpuStart, pData->cpuEnd);
 
@@ -178,6 +614,27 @@ namespace Falcor
             results += event;
         }
 
+        // Events recorded on other threads, rolled up by the aggregator
+        for (const auto& thread : gAggregator.getLastFrame())
+        {
+            results += "Thread " + std::to_string(thread.threadIndex);
+            if (thread.droppedCount) results += " (" + std::to_string(thread.droppedCount) + " events dropped)";
+            results += "\n";
+
+            for (const auto& e : thread.events)
+            {
+                std::string name = gAggregator.getName(e.eventId);
+                char event[1000];
+                int32_t nameIndent = (e.level + 1) * 2 + 1;
+                int32_t cpuIndent = std::max(0, 30 - (nameIndent + (int32_t)name.size()));
+                snprintf(event, 1000, "%*s%s %*.2f %14s (%u calls)\n", nameIndent, " ", name.c_str(), cpuIndent, e.cpuMs, "-", e.callCount);
+                results += event;
+            }
+        }
+
+        char uploads[256];
+        snprintf(uploads, 256, "Buffer uploads: %llu buffers, %llu copies, %.1f KB (%.1f KB modified)\n", (unsigned long long)gUploadStats.bufferCount, (unsigned long long)gUploadStats.rangeCount, gUploadStats.uploadedBytes / 1024.0, gUploadStats.dirtyBytes / 1024.0);
+        results += uploads;
         return results;
     }
 
@@ -191,6 +648,9 @@ namespace Falcor
         }
         sProfilerVector.clear();
         sGpuTimerIndex = 1 - sGpuTimerIndex;
+        gAggregator.endFrame();
+        gUploadStats = VariablesBuffer::getUploadStats();
+        VariablesBuffer::resetUploadStats();
     }
 
 #if _PROFILING_LOG == 1
@@ -219,6 +679,7 @@ namespace Falcor
         }
         sProfilerEvents.clear();
         sProfilerVector.clear();
+        sEventsById.clear();
         sCurrentLevel = 0;
         sGpuTimerIndex = 0;
     }
@@ -58,6 +58,8 @@ namespace Falcor
         This class uses the most accurately available CPU and GPU timers to profile given events. It automatically creates event hierarchies based on the order of the calls made.
         This class uses a double-buffering scheme for GPU profiling to avoid GPU stalls.
         CProfilerEvent is a wrapper class which together with scoping can simplify event profiling.
+        Events can be started from any thread. Every thread records begin/end timestamps into its own lock-free ring-buffer, which is drained by a background aggregator thread.
+        GPU timers and the event hierarchy are only maintained for the main thread, events from other threads are rolled up per-thread and reported by \ref getEventsString().
     */
     class Profiler
     {
@@ -101,6 +103,39 @@ namespace Falcor
         */
         static void endEvent(const HashedString& name);
 
+        /** Start profiling an event using a pre-registered event ID. This is the fast-path used by the PROFILE() macro.
+            \param[in] name The event name.
+            \param[in] eventId The ID returned by \ref registerEventName for this name.
+        */
+        static void startEvent(const HashedString& name, uint32_t eventId, bool showInMsg = true);
+
+        /** Finish profiling an event using a pre-registered event ID.
+        */
+        static void endEvent(const HashedString& name, uint32_t eventId);
+
+        /** Finish profiling an event using a pre-registered event ID. The event must have been started with the same ID.
+        */
+        static void endEvent(uint32_t eventId);
+
+        /** Get a compact ID for an event name. IDs are stable for the lifetime of the process. This function is thread-safe.
+            Every thread caches the IDs it looked up, so only the first lookup of a name on a thread takes a lock.
+        */
+        static uint32_t registerEventName(const HashedString& name);
+
+        /** Start capturing the CPU events of all threads into a trace.
+        */
+        static void startCapture();
+
+        /** Stop capturing and save the trace in the Chrome trace-event JSON format. The file can be opened in chrome://tracing.
+            \param[in] filename The output file
+            \return false if no capture was in progress or the file couldn't be written, otherwise true
+        */
+        static bool endCapture(const std::string& filename);
+
+        /** Check if a trace capture is in progress
+        */
+        static bool isCapturing();
+
         /** Finish profiling for the entire frame.
             Due to the double-buffering nature of the profiler, the results returned are for the previous frame.
             \param[out] profileResults A string containing the the profiling results.
@@ -149,11 +184,13 @@ namespace Falcor
         static void clearEvents();
 
     private:
+        static EventData* getEvent(const HashedString& name, uint32_t eventId);
         static double getGpuTime(const EventData* pData);
         static double getCpuTime(const EventData* pData);
 
         static std::map<size_t, EventData*> sProfilerEvents;
         static std::vector<EventData*> sProfilerVector;
+        static std::vector<EventData*> sEventsById;
         static uint32_t sCurrentLevel;
         static uint32_t sGpuTimerIndex;
     };
@@ -165,19 +202,36 @@ namespace Falcor
     class ProfilerEvent
     {
     public:
-        /** C'tor
+        /** C'tor. The name is only looked up if profiling is enabled.
         */
-        ProfilerEvent(const HashedString& name) : mName(name) { if(gProfileEnabled) { Profiler::startEvent(name); } }
+        ProfilerEvent(const HashedString& name) : mEventId(kUnregisteredId) { start(name); }
+
+        /** C'tor. Takes an ID previously returned from Profiler#registerEventName(), skipping the name lookup.
+        */
+        ProfilerEvent(const HashedString& name, uint32_t eventId) : mEventId(eventId) { start(name); }
+
         /** D'tor
         */
-        ~ProfilerEvent() { if(gProfileEnabled) {Profiler::endEvent(mName); }}
+        ~ProfilerEvent() { if(mStarted) {Profiler::endEvent(mEventId); }}
 
     private:
-        const HashedString mName;
+        void start(const HashedString& name)
+        {
+            mStarted = gProfileEnabled;
+            if (mStarted)
+            {
+                if (mEventId == kUnregisteredId) mEventId = Profiler::registerEventName(name);
+                Profiler::startEvent(name, mEventId);
+            }
+        }
+
+        static const uint32_t kUnregisteredId = uint32_t(-1);
+        uint32_t mEventId;
+        bool mStarted;
     };
 
 #if _PROFILING_ENABLED
-#define PROFILE(_name) static const Falcor::HashedString hashed ## _name(#_name); Falcor::ProfilerEvent _profileEvent(hashed ## _name);
+#define PROFILE(_name) static const Falcor::HashedString hashed ## _name(#_name); static const uint32_t eventId ## _name = Falcor::Profiler::registerEventName(hashed ## _name); Falcor::ProfilerEvent _profileEvent(hashed ## _name, eventId ## _name);
 #else
 #define PROFILE(_name)
 #endif
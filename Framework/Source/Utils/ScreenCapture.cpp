@@ -0,0 +1,132 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ScreenCapture.h"
+#include "API/Texture.h"
+#include "Utils/Platform/OS.h"
+#include <iomanip>
+#include <sstream>
+
+namespace Falcor
+{
+    ScreenCapture::UniquePtr ScreenCapture::create(uint32_t latency, ImageEncodeQueue::SharedPtr pQueue)
+    {
+        return UniquePtr(new ScreenCapture(latency, pQueue));
+    }
+
+    ScreenCapture::ScreenCapture(uint32_t latency, ImageEncodeQueue::SharedPtr pQueue) : mLatency(latency), mpOwnedQueue(pQueue)
+    {
+        mpQueue = pQueue ? pQueue.get() : &ImageEncodeQueue::instance();
+    }
+
+    ScreenCapture::~ScreenCapture()
+    {
+        flush();
+    }
+
+    void ScreenCapture::capture(CopyContext* pContext, const Texture* pTexture, const std::string& filename, Bitmap::FileFormat fileFormat, Bitmap::ExportFlags exportFlags, uint32_t mipLevel, uint32_t arraySlice)
+    {
+        assert(fileFormat != Bitmap::FileFormat::AutoDetect);
+        PendingCapture capture;
+        capture.pTask = pContext->asyncReadTextureSubresource(pTexture, pTexture->getSubresourceIndex(arraySlice, mipLevel));
+        capture.job.filename = filename;
+        capture.job.width = pTexture->getWidth(mipLevel);
+        capture.job.height = pTexture->getHeight(mipLevel);
+        capture.job.fileFormat = fileFormat;
+        capture.job.exportFlags = exportFlags;
+        capture.job.resourceFormat = pTexture->getFormat();
+        capture.job.isTopDown = true;
+        capture.frame = mFrame;
+        mPending.push_back(std::move(capture));
+    }
+
+    void ScreenCapture::beginSequence(const std::string& prefix, const std::string& directory, uint32_t frameCount, Bitmap::FileFormat fileFormat, Bitmap::ExportFlags exportFlags)
+    {
+        mSequence.active = true;
+        mSequence.prefix = prefix;
+        mSequence.directory = directory;
+        mSequence.frameCount = frameCount;
+        mSequence.nextFrame = 0;
+        mSequence.fileFormat = fileFormat;
+        mSequence.exportFlags = exportFlags;
+    }
+
+    std::string ScreenCapture::captureSequenceFrame(CopyContext* pContext, const Texture* pTexture)
+    {
+        if (mSequence.active == false) return "";
+
+        std::stringstream ss;
+        ss << mSequence.directory << '/' << mSequence.prefix << '.' << std::setw(6) << std::setfill('0') << mSequence.nextFrame << '.' << Bitmap::getFileExtension(mSequence.fileFormat);
+        std::string filename = ss.str();
+        capture(pContext, pTexture, filename, mSequence.fileFormat, mSequence.exportFlags);
+
+        mSequence.nextFrame++;
+        if (mSequence.frameCount && mSequence.nextFrame >= mSequence.frameCount) mSequence.active = false;
+        return filename;
+    }
+
+    void ScreenCapture::retire()
+    {
+        PendingCapture& capture = mPending.front();
+        capture.job.data = capture.pTask->getData();
+        mpQueue->push(std::move(capture.job));
+        mPending.pop_front();
+    }
+
+    void ScreenCapture::endFrame()
+    {
+        mFrame++;
+        // Read-backs complete in order, so stop at the first one which isn't done
+        while (mPending.size() && (mPending.front().pTask->isReady() || mFrame - mPending.front().frame >= mLatency))
+        {
+            retire();
+        }
+    }
+
+    void ScreenCapture::flush()
+    {
+        while (mPending.size()) retire();
+        mpQueue->flush();
+        mReservedFilenames.clear();
+    }
+
+    bool ScreenCapture::findAvailableFilename(const std::string& prefix, const std::string& directory, const std::string& extension, std::string& filename)
+    {
+        for (uint32_t i = 0; i < (uint32_t)-1; i++)
+        {
+            filename = directory + '/' + prefix + '.' + std::to_string(i) + "." + extension;
+            if (doesFileExist(filename) == false && mReservedFilenames.count(filename) == 0)
+            {
+                mReservedFilenames.insert(filename);
+                return true;
+            }
+        }
+        filename = "";
+        return false;
+    }
+}
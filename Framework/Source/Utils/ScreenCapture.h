@@ -0,0 +1,139 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <deque>
+#include <set>
+#include "API/CopyContext.h"
+#include "Utils/Bitmap.h"
+#include "Utils/ImageEncodeQueue.h"
+
+namespace Falcor
+{
+    class Texture;
+
+    /** Captures textures to image files without stalling the render thread.
+        Captures are read back with CopyContext::asyncReadTextureSubresource(). The data is only fetched a few frames later, once the GPU finished the copy, and handed to an ImageEncodeQueue which writes the files in the background.
+        Call endFrame() once per frame to retire finished read-backs.
+    */
+    class ScreenCapture
+    {
+    public:
+        using UniquePtr = std::unique_ptr<ScreenCapture>;
+
+        /** Create a new object.
+            \param[in] latency Number of frames a read-back can stay in flight. Once a read-back is this old, endFrame() will wait for it.
+            \param[in] pQueue The queue encoding the images. If nullptr, will use the global queue.
+        */
+        static UniquePtr create(uint32_t latency = 2, ImageEncodeQueue::SharedPtr pQueue = nullptr);
+
+        /** Destroy the object. Waits for all the pending captures to be written.
+        */
+        ~ScreenCapture();
+
+        /** Capture a texture's subresource to a file. Records the read-back into the context and returns immediately.
+            \param[in] pContext The context to record the copy into. The context is flushed.
+            \param[in] pTexture The texture to capture
+            \param[in] filename Output filename
+            \param[in] fileFormat Destination image file format
+            \param[in] exportFlags Save flags, see Bitmap::ExportFlags
+            \param[in] mipLevel Requested mip-level
+            \param[in] arraySlice Requested array-slice
+        */
+        void capture(CopyContext* pContext, const Texture* pTexture, const std::string& filename, Bitmap::FileFormat fileFormat = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None, uint32_t mipLevel = 0, uint32_t arraySlice = 0);
+
+        /** Start capturing a sequence of frames. Files are named <directory>/<prefix>.<frame>.<extension>, with the frame number starting at 0 and padded to 6 digits.
+            \param[in] prefix Filename prefix
+            \param[in] directory Output directory
+            \param[in] frameCount Number of frames to capture. 0 will capture until endSequence() is called.
+            \param[in] fileFormat Destination image file format
+            \param[in] exportFlags Save flags, see Bitmap::ExportFlags
+        */
+        void beginSequence(const std::string& prefix, const std::string& directory, uint32_t frameCount, Bitmap::FileFormat fileFormat = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None);
+
+        /** Stop capturing the current sequence
+        */
+        void endSequence() { mSequence.active = false; }
+
+        /** Check if a sequence is being captured
+        */
+        bool isSequenceActive() const { return mSequence.active; }
+
+        /** Capture the next frame of the current sequence. Ends the sequence once all the requested frames were captured.
+            \param[in] pContext The context to record the copy into
+            \param[in] pTexture The texture to capture
+            \return The output filename, or an empty string if no sequence is active
+        */
+        std::string captureSequenceFrame(CopyContext* pContext, const Texture* pTexture);
+
+        /** Retire the read-backs which completed or reached the latency limit and queue them for encoding. Call once per frame.
+        */
+        void endFrame();
+
+        /** Wait until all the captures were written to disk
+        */
+        void flush();
+
+        /** Find a filename which doesn't exist and isn't the target of a pending capture. See findAvailableFilename() in OS.h.
+        */
+        bool findAvailableFilename(const std::string& prefix, const std::string& directory, const std::string& extension, std::string& filename);
+
+        /** Get the number of read-backs in flight
+        */
+        uint32_t getPendingReadbackCount() const { return (uint32_t)mPending.size(); }
+
+    private:
+        ScreenCapture(uint32_t latency, ImageEncodeQueue::SharedPtr pQueue);
+        void retire();
+
+        struct PendingCapture
+        {
+            CopyContext::ReadTextureTask::SharedPtr pTask;
+            ImageEncodeQueue::Job job;      // Everything but the data
+            uint64_t frame;
+        };
+
+        struct Sequence
+        {
+            bool active = false;
+            std::string prefix;
+            std::string directory;
+            uint32_t frameCount = 0;
+            uint32_t nextFrame = 0;
+            Bitmap::FileFormat fileFormat = Bitmap::FileFormat::PngFile;
+            Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None;
+        };
+
+        uint32_t mLatency;
+        uint64_t mFrame = 0;
+        std::deque<PendingCapture> mPending;
+        std::set<std::string> mReservedFilenames;   // Files which are captured but might not have been written yet
+        Sequence mSequence;
+        ImageEncodeQueue::SharedPtr mpOwnedQueue;
+        ImageEncodeQueue* mpQueue;
+    };
+}
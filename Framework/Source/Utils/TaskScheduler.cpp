@@ -0,0 +1,287 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TaskScheduler.h"
+
+namespace Falcor
+{
+    std::atomic<TaskScheduler*> TaskScheduler::spInstance = { nullptr };
+    static std::mutex sInstanceMutex;
+
+    // Identifies the worker thread we're running on. Used to push spawned tasks into the local queue
+    static thread_local const TaskScheduler* tpCurrentScheduler = nullptr;
+    static thread_local uint32_t tWorkerIndex = 0;
+
+    TaskScheduler::SharedPtr TaskScheduler::create(uint32_t threadCount)
+    {
+        return SharedPtr(new TaskScheduler(threadCount));
+    }
+
+    TaskScheduler& TaskScheduler::instance()
+    {
+        TaskScheduler* pInstance = spInstance.load(std::memory_order_acquire);
+        if (pInstance == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(sInstanceMutex);
+            pInstance = spInstance.load(std::memory_order_relaxed);
+            if (pInstance == nullptr)
+            {
+                pInstance = new TaskScheduler(0);
+                spInstance.store(pInstance, std::memory_order_release);
+            }
+        }
+        return *pInstance;
+    }
+
+    void TaskScheduler::shutdown()
+    {
+        std::lock_guard<std::mutex> lock(sInstanceMutex);
+        delete spInstance.exchange(nullptr);
+    }
+
+    TaskScheduler::TaskScheduler(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+        {
+            uint32_t hwThreads = std::thread::hardware_concurrency();
+            threadCount = hwThreads > 1 ? hwThreads - 1 : 1;
+        }
+
+        mQueues.resize(threadCount);
+        for (auto& pQueue : mQueues) pQueue = std::make_unique<WorkerQueue>();
+
+        mThreads.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            mThreads.emplace_back(&TaskScheduler::workerThread, this, i);
+        }
+    }
+
+    TaskScheduler::~TaskScheduler()
+    {
+        // The workers only exit once the queues are empty, so the pending tasks still run
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mShutdown = true;
+            mWorkEpoch++;
+        }
+        mSleepCondition.notify_all();
+
+        for (auto& t : mThreads)
+        {
+            if (t.joinable()) t.join();
+        }
+    }
+
+    TaskScheduler::TaskHandle TaskScheduler::schedule(TaskFunc func, const std::vector<TaskHandle>& dependencies)
+    {
+        TaskHandle pTask = std::make_shared<Task>();
+        pTask->mFunc = std::move(func);
+
+        // The extra reference makes sure the task is not queued before we finished registering with all the dependencies
+        pTask->mPendingDependencies = (uint32_t)dependencies.size() + 1;
+        for (const auto& pDependency : dependencies)
+        {
+            if (pDependency)
+            {
+                std::lock_guard<std::mutex> lock(pDependency->mMutex);
+                if (pDependency->isComplete() == false)
+                {
+                    pDependency->mContinuations.push_back(pTask);
+                    continue;
+                }
+            }
+            pTask->mPendingDependencies--;
+        }
+
+        if (pTask->mPendingDependencies.fetch_sub(1) == 1) enqueue(pTask);
+        return pTask;
+    }
+
+    void TaskScheduler::parallelFor(size_t begin, size_t end, const RangeFunc& func, size_t grainSize)
+    {
+        if (end <= begin) return;
+
+        size_t count = end - begin;
+        if (grainSize == 0)
+        {
+            size_t chunkCount = (getThreadCount() + 1) * 4;
+            grainSize = std::max<size_t>(1, (count + chunkCount - 1) / chunkCount);
+        }
+
+        if (count <= grainSize)
+        {
+            func(begin, end);
+            return;
+        }
+
+        std::vector<TaskHandle> tasks;
+        tasks.reserve(count / grainSize);
+        for (size_t chunkStart = begin + grainSize; chunkStart < end; chunkStart += grainSize)
+        {
+            size_t chunkEnd = std::min(chunkStart + grainSize, end);
+            tasks.push_back(schedule([&func, chunkStart, chunkEnd]() { func(chunkStart, chunkEnd); }));
+        }
+
+        // The calling thread processes the first chunk, then helps with the rest
+        func(begin, begin + grainSize);
+        wait(tasks);
+    }
+
+    void TaskScheduler::wait(const TaskHandle& pTask)
+    {
+        if (pTask == nullptr) return;
+
+        while (pTask->isComplete() == false)
+        {
+            TaskHandle pOther = popTask();
+            if (pOther)
+            {
+                execute(pOther);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            if (pTask->isComplete() || mQueuedTasks.load() > 0) continue;
+            uint64_t epoch = mWorkEpoch;
+            mSleepCondition.wait(lock, [this, epoch]() { return mWorkEpoch != epoch; });
+        }
+    }
+
+    void TaskScheduler::wait(const std::vector<TaskHandle>& tasks)
+    {
+        for (const auto& pTask : tasks) wait(pTask);
+    }
+
+    void TaskScheduler::workerThread(uint32_t index)
+    {
+        tpCurrentScheduler = this;
+        tWorkerIndex = index;
+
+        while (true)
+        {
+            TaskHandle pTask = popTask();
+            if (pTask)
+            {
+                execute(pTask);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            if (mQueuedTasks.load() > 0) continue;
+            if (mShutdown) break;
+            uint64_t epoch = mWorkEpoch;
+            mSleepCondition.wait(lock, [this, epoch]() { return mWorkEpoch != epoch; });
+        }
+
+        tpCurrentScheduler = nullptr;
+    }
+
+    void TaskScheduler::enqueue(TaskHandle pTask)
+    {
+        // Tasks spawned by a worker go into its own queue, external tasks are distributed round-robin
+        uint32_t queueIndex = (tpCurrentScheduler == this) ? tWorkerIndex : (mNextQueue++ % (uint32_t)mQueues.size());
+
+        // Count the task before it becomes visible, otherwise a thread could pop it and decrement the counter below zero
+        mQueuedTasks++;
+        {
+            WorkerQueue& queue = *mQueues[queueIndex];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(pTask));
+        }
+        notifyWork();
+    }
+
+    TaskScheduler::TaskHandle TaskScheduler::popTask()
+    {
+        if (mQueuedTasks.load() == 0) return nullptr;
+
+        uint32_t queueCount = (uint32_t)mQueues.size();
+        bool isWorker = (tpCurrentScheduler == this);
+        uint32_t firstQueue = isWorker ? tWorkerIndex : 0;
+
+        // Pop from the back of our own queue
+        if (isWorker)
+        {
+            WorkerQueue& queue = *mQueues[firstQueue];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.size())
+            {
+                TaskHandle pTask = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                mQueuedTasks--;
+                return pTask;
+            }
+        }
+
+        // Steal from the front of the other queues
+        for (uint32_t i = isWorker ? 1 : 0; i < queueCount; i++)
+        {
+            WorkerQueue& queue = *mQueues[(firstQueue + i) % queueCount];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.size())
+            {
+                TaskHandle pTask = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                mQueuedTasks--;
+                return pTask;
+            }
+        }
+        return nullptr;
+    }
+
+    void TaskScheduler::execute(const TaskHandle& pTask)
+    {
+        pTask->mFunc();
+        pTask->mFunc = nullptr;
+
+        std::vector<TaskHandle> continuations;
+        {
+            std::lock_guard<std::mutex> lock(pTask->mMutex);
+            pTask->mComplete.store(true, std::memory_order_release);
+            continuations.swap(pTask->mContinuations);
+        }
+
+        for (auto& pContinuation : continuations)
+        {
+            if (pContinuation->mPendingDependencies.fetch_sub(1) == 1) enqueue(std::move(pContinuation));
+        }
+
+        // Wake up threads waiting for this task
+        notifyWork();
+    }
+
+    void TaskScheduler::notifyWork()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mWorkEpoch++;
+        }
+        mSleepCondition.notify_all();
+    }
+}
@@ -0,0 +1,156 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+    /** Work-stealing task scheduler.
+        Each worker thread owns a task deque. Tasks spawned from a worker are pushed to the back of its own deque and popped in LIFO order, idle workers steal from the front of other workers' deques.
+        Tasks can depend on other tasks, a task is only queued once all of its dependencies completed.
+        Waiting on a task executes other pending tasks instead of blocking, so it is safe to wait (or call parallelFor()) from inside a task.
+    */
+    class TaskScheduler
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TaskScheduler>;
+        using TaskFunc = std::function<void()>;
+        using RangeFunc = std::function<void(size_t begin, size_t end)>;
+
+        /** A scheduled task. Use it to wait for completion or as a dependency of other tasks.
+        */
+        class Task
+        {
+        public:
+            /** Check if the task finished executing
+            */
+            bool isComplete() const { return mComplete.load(std::memory_order_acquire); }
+        private:
+            friend class TaskScheduler;
+            TaskFunc mFunc;
+            std::atomic<uint32_t> mPendingDependencies = { 0 };
+            std::atomic<bool> mComplete = { false };
+            std::mutex mMutex;  // Protects mContinuations
+            std::vector<std::shared_ptr<Task>> mContinuations;
+        };
+        using TaskHandle = std::shared_ptr<Task>;
+
+        /** Create a new scheduler.
+            \param[in] threadCount Number of worker threads. 0 will create one thread per hardware thread, minus one for the calling thread.
+        */
+        static SharedPtr create(uint32_t threadCount = 0);
+
+        /** Get the global scheduler. It's a singleton, you'll always get the same object
+        */
+        static TaskScheduler& instance();
+
+        /** Destroy the global scheduler. Runs the pending tasks and joins the worker threads. Calling instance() afterwards creates a new scheduler.
+        */
+        static void shutdown();
+
+        ~TaskScheduler();
+
+        /** Schedule a task.
+            \param[in] func The function to execute
+            \param[in] dependencies Tasks which must complete before this task can start
+            \return A handle to the new task
+        */
+        TaskHandle schedule(TaskFunc func, const std::vector<TaskHandle>& dependencies = {});
+
+        /** Schedule a continuation, which will run once pTask completed
+        */
+        TaskHandle then(const TaskHandle& pTask, TaskFunc func) { return schedule(std::move(func), { pTask }); }
+
+        /** Schedule a function and get a future holding its result
+        */
+        template<typename Func>
+        auto async(Func&& func) -> std::future<decltype(func())>
+        {
+            using ResultType = decltype(func());
+            auto pPackagedTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+            std::future<ResultType> result = pPackagedTask->get_future();
+            schedule([pPackagedTask]() { (*pPackagedTask)(); });
+            return result;
+        }
+
+        /** Split a range into chunks and process them in parallel. Returns once all the chunks were processed.
+            \param[in] begin First index in the range
+            \param[in] end One past the last index in the range
+            \param[in] func Function processing the sub-range [begin, end)
+            \param[in] grainSize Number of elements per chunk. 0 will create 4 chunks per thread.
+        */
+        void parallelFor(size_t begin, size_t end, const RangeFunc& func, size_t grainSize = 0);
+
+        /** Wait for a task to complete. The calling thread will execute pending tasks while waiting.
+        */
+        void wait(const TaskHandle& pTask);
+
+        /** Wait for a list of tasks to complete
+        */
+        void wait(const std::vector<TaskHandle>& tasks);
+
+        /** Get the number of worker threads
+        */
+        uint32_t getThreadCount() const { return (uint32_t)mThreads.size(); }
+
+    private:
+        TaskScheduler(uint32_t threadCount);
+
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<TaskHandle> tasks;
+        };
+
+        void workerThread(uint32_t index);
+        void enqueue(TaskHandle pTask);
+        TaskHandle popTask();
+        void execute(const TaskHandle& pTask);
+        void notifyWork();
+
+        static std::atomic<TaskScheduler*> spInstance;
+
+        std::vector<std::thread> mThreads;
+        std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+        std::atomic<uint32_t> mNextQueue = { 0 };
+        std::atomic<uint32_t> mQueuedTasks = { 0 };
+
+        std::mutex mSleepMutex;
+        std::condition_variable mSleepCondition;
+        uint64_t mWorkEpoch = 0;    // Incremented whenever a task is queued or completed. Protected by mSleepMutex
+        bool mShutdown = false;
+    };
+}
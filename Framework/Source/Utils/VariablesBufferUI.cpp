@@ -144,7 +144,10 @@ namespace Falcor
     void VariablesBufferUI::renderUIMemberInternal(Gui* pGui, const std::string& memberName, size_t memberOffset, size_t memberSize, const std::string& memberTypeString, const ReflectionBasicType::Type& memberType, size_t arraySize)
     {
         // Display data from the stage memory
-        mVariablesBufferRef.mDirty |= renderGuiWidgetFromType(pGui, memberType, memberOffset, memberName, mVariablesBufferRef.mData);
+        if (renderGuiWidgetFromType(pGui, memberType, memberOffset, memberName, mVariablesBufferRef.mData))
+        {
+            mVariablesBufferRef.markDirty(memberOffset, memberSize);
+        }
 
         // Display name and then reflection data as tooltip
         std::string toolTipString = "Offset: " + std::to_string(memberOffset);
@@ -28,6 +28,8 @@
 #include "Framework.h"
 #include "VideoEncoder.h"
 #include "Utils/BinaryFileStream.h"
+#include "Utils/CpuTimer.h"
+#include <algorithm>
 
 extern "C"
 {
@@ -100,7 +102,7 @@ namespace Falcor
         return false;
     }
 
-    AVCodecContext* createCodecContext(AVFormatContext* pCtx, uint32_t width, uint32_t height, uint32_t fps, float bitrateMbps, uint32_t gopSize, AVCodecID codecID, AVCodec* pCodec)
+    AVCodecContext* createCodecContext(AVFormatContext* pCtx, uint32_t width, uint32_t height, uint32_t fps, float bitrateMbps, uint32_t gopSize, uint32_t threadCount, AVCodecID codecID, AVCodec* pCodec)
     {
         // Initialize the codec context
         AVCodecContext* pCodecCtx = avcodec_alloc_context3(pCodec);
@@ -112,6 +114,10 @@ namespace Falcor
         pCodecCtx->gop_size = gopSize;
         pCodecCtx->pix_fmt = getPictureFormatFromCodec(codecID);
 
+        // Let the codec use all the threading modes it supports
+        pCodecCtx->thread_count = (int)threadCount;
+        pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
         // Some formats want stream headers to be separate
         if(pCtx->oformat->flags & AVFMT_GLOBALHEADER)
         {
@@ -167,7 +173,7 @@ namespace Falcor
         return pFrame;
     }
 
-    bool openVideo(AVCodec* pCodec, AVCodecContext* pCodecCtx, AVFrame*& pFrame, const std::string& filename)
+    bool openVideo(AVCodec* pCodec, AVCodecContext* pCodecCtx, const std::string& filename)
     {
         AVDictionary* param = nullptr;
 
@@ -189,13 +195,6 @@ namespace Falcor
             return error(filename, "Can't open video codec.");
         }
         av_dict_free(&param);
-
-        // create a frame
-        pFrame = allocateFrame(pCodecCtx->pix_fmt, pCodecCtx->width, pCodecCtx->height, filename);
-        if(pFrame == nullptr)
-        {
-            return false;
-        }
         return true;
     }
 
@@ -250,14 +249,14 @@ namespace Falcor
             return false;
         }
 
-        mpCodecContext = createCodecContext(mpOutputContext, desc.width, desc.height, desc.fps, desc.bitrateMbps, desc.gopSize, getCodecID(desc.codec), pVideoCodec);
+        mpCodecContext = createCodecContext(mpOutputContext, desc.width, desc.height, desc.fps, desc.bitrateMbps, desc.gopSize, desc.threadCount, getCodecID(desc.codec), pVideoCodec);
         if(mpCodecContext == nullptr)
         {
             return false;
         }
 
         // Open the video stream
-        if(openVideo(pVideoCodec, mpCodecContext, mpFrame, mFilename) == false)
+        if(openVideo(pVideoCodec, mpCodecContext, mFilename) == false)
         {
             return false;
         }
@@ -285,16 +284,28 @@ namespace Falcor
 
         mFormat = desc.format;
         mRowPitch = getFormatBytesPerBlock(desc.format) * desc.width;
-        if(desc.flipY)
-        {
-            mpFlippedImage = new uint8_t[desc.height * mRowPitch];
-        }
+        mImageSize = size_t(desc.height) * mRowPitch;
+        mFlipY = desc.flipY;
 
         mpSwsContext = sws_getContext(desc.width, desc.height, getPictureFormatFromFalcorFormat(desc.format), desc.width, desc.height, mpCodecContext->pix_fmt, SWS_POINT, nullptr, nullptr, nullptr);
         if(mpSwsContext == nullptr)
         {
             return error(mFilename, "Failed to allocate SWScale context");
         }
+
+        // Allocate the frame ring and start the pipeline
+        mRing.resize(std::max(desc.queueSize, 1u));
+        for(auto& slot : mRing)
+        {
+            slot.image.resize(mImageSize);
+            slot.pFrame = allocateFrame(mpCodecContext->pix_fmt, desc.width, desc.height, mFilename);
+            if(slot.pFrame == nullptr)
+            {
+                return false;
+            }
+        }
+        mConvertThread = std::thread(&VideoEncoder::convertThread, this);
+        mEncodeThread = std::thread(&VideoEncoder::encodeThread, this);
         return true;
     }
 
@@ -333,6 +344,15 @@ namespace Falcor
 
     void VideoEncoder::endCapture()
     {
+        // Let the worker threads finish the pending frames
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mCondition.notify_all();
+        if(mConvertThread.joinable()) mConvertThread.join();
+        if(mEncodeThread.joinable()) mEncodeThread.join();
+
         if(mpOutputContext)
         {
             // Flush the codex
@@ -343,55 +363,188 @@ namespace Falcor
 
             avio_closep(&mpOutputContext->pb);
             avcodec_free_context(&mpCodecContext);
-            av_frame_free(&mpFrame);
             sws_freeContext(mpSwsContext);
             avformat_free_context(mpOutputContext);
             mpOutputContext = nullptr;
             mpOutputStream = nullptr;
         }
-        safe_delete(mpFlippedImage)
+
+        for(auto& slot : mRing)
+        {
+            av_frame_free(&slot.pFrame);
+        }
+        mRing.clear();
     }
 
-    void VideoEncoder::appendFrame(const void* pData)
+    VideoEncoder::FrameSlot* VideoEncoder::acquireSlot()
     {
-        if(mpFlippedImage)
+        std::unique_lock<std::mutex> lock(mMutex);
+        if(mRing.empty() || mStopping || mFailed)
         {
-            // Flip the image
-            for(int32_t h = 0; h < mpCodecContext->height; h++)
+            return nullptr;
+        }
+
+        // Wait for the encoder to release the oldest slot
+        if(mAppended - mEncoded == mRing.size())
+        {
+            if(mStats.stalledFrames == 0)
+            {
+                logWarning("VideoEncoder can't keep up when writing " + mFilename + ". appendFrame() will block until the pending frames are encoded.");
+            }
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            mCondition.wait(lock, [this]() { return mAppended - mEncoded < mRing.size() || mFailed; });
+            mStats.stalledFrames++;
+            mStats.stallTimeMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+            if(mFailed)
             {
-                const uint8_t* pSrc = (uint8_t*)pData + h * mRowPitch;
-                uint8_t* pDst = mpFlippedImage + (mpCodecContext->height - 1 - h) * mRowPitch;
-                memcpy(pDst, pSrc, mRowPitch);
+                return nullptr;
             }
+        }
+
+        // No other thread touches the slot until submitSlot() is called
+        return &mRing[mAppended % mRing.size()];
+    }
+
+    void VideoEncoder::submitSlot()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mAppended++;
+            mStats.framesAppended++;
+        }
+        mCondition.notify_all();
+    }
+
+    void VideoEncoder::appendFrame(const void* pData)
+    {
+        FrameSlot* pSlot = acquireSlot();
+        if(pSlot)
+        {
+            // The slot might hold a larger buffer which was moved in, only copy the image
+            pSlot->image.resize(mImageSize);
+            memcpy(pSlot->image.data(), pData, mImageSize);
+            submitSlot();
+        }
+    }
 
-            pData = mpFlippedImage;
+    void VideoEncoder::appendFrame(std::vector<uint8_t>&& data)
+    {
+        if(data.size() < mImageSize)
+        {
+            logError("VideoEncoder::appendFrame() - the frame is smaller than the image. Dropping it.");
+            return;
         }
 
-        uint8_t* src[AV_NUM_DATA_POINTERS] = {0};
-        int32_t rowPitch[AV_NUM_DATA_POINTERS] = {0};
-        src[0] = (uint8_t*)pData;
-        rowPitch[0] = (int32_t)mRowPitch;
+        FrameSlot* pSlot = acquireSlot();
+        if(pSlot)
+        {
+            pSlot->image.swap(data);
+            // Drop the padding, so that every slot holds an image of the same size. Shrinking doesn't reallocate.
+            pSlot->image.resize(mImageSize);
+            submitSlot();
+        }
+    }
 
-        // Scale and convert the image
-        sws_scale(mpSwsContext, src, rowPitch, 0, mpCodecContext->height, mpFrame->data, mpFrame->linesize);
+    void VideoEncoder::convertThread()
+    {
+        const int32_t height = mpCodecContext->height;
+        std::unique_lock<std::mutex> lock(mMutex);
+        while(true)
+        {
+            mCondition.wait(lock, [this]() { return mConverted < mAppended || mStopping; });
+            if(mConverted == mAppended)
+            {
+                return;
+            }
+            FrameSlot& slot = mRing[mConverted % mRing.size()];
+            lock.unlock();
+
+            // The codec might still reference the buffer it got the last time the slot was encoded
+            bool success = av_frame_make_writable(slot.pFrame) >= 0;
+            if(success)
+            {
+                // Flip the image by reading the rows backwards
+                const uint8_t* src[AV_NUM_DATA_POINTERS] = {0};
+                int32_t rowPitch[AV_NUM_DATA_POINTERS] = {0};
+                src[0] = mFlipY ? slot.image.data() + (height - 1) * mRowPitch : slot.image.data();
+                rowPitch[0] = mFlipY ? -(int32_t)mRowPitch : (int32_t)mRowPitch;
+
+                // Scale and convert the image
+                sws_scale(mpSwsContext, src, rowPitch, 0, height, slot.pFrame->data, slot.pFrame->linesize);
+            }
+            else
+            {
+                error(mFilename, "Can't allocate video frame");
+            }
 
-        // Encode the frame
-        int r = avcodec_send_frame(mpCodecContext, mpFrame);
-        mpFrame->pts++;
+            lock.lock();
+            mFailed = mFailed || !success;
+            mConverted++;
+            mCondition.notify_all();
+        }
+    }
+
+    bool VideoEncoder::sendFrame(AVFrame* pFrame)
+    {
+        int r = avcodec_send_frame(mpCodecContext, pFrame);
         if(r == AVERROR(EAGAIN))
         {
+            // The codec's output is full. Write the pending packets and send the frame again
             if(flush(mpCodecContext, mpOutputContext, mpOutputStream, mFilename) == false)
             {
-                return;
+                return false;
             }
+            r = avcodec_send_frame(mpCodecContext, pFrame);
         }
-        else if(r < 0)
+
+        if(r < 0)
         {
-            error(mFilename, "Can't send video frame");
-            return;
+            return error(mFilename, "Can't send video frame");
+        }
+
+        // Write the packets which are ready, so they don't pile up inside the codec
+        return flush(mpCodecContext, mpOutputContext, mpOutputStream, mFilename);
+    }
+
+    void VideoEncoder::encodeThread()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while(true)
+        {
+            mCondition.wait(lock, [this]() { return mEncoded < mConverted || (mStopping && mConverted == mAppended); });
+            if(mEncoded == mConverted)
+            {
+                return;
+            }
+            FrameSlot& slot = mRing[mEncoded % mRing.size()];
+            int64_t pts = (int64_t)mEncoded;
+            bool failed = mFailed;
+            lock.unlock();
+
+            // After a failure, keep draining the ring so appendFrame() never waits forever
+            bool success = true;
+            if(failed == false)
+            {
+                slot.pFrame->pts = pts;
+                success = sendFrame(slot.pFrame);
+            }
+
+            lock.lock();
+            mFailed = mFailed || !success;
+            if(failed == false && success) mStats.framesEncoded++;
+            mEncoded++;
+            mCondition.notify_all();
         }
     }
 
+    VideoEncoder::Stats VideoEncoder::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Stats stats = mStats;
+        stats.queuedFrames = (uint32_t)(mAppended - mEncoded);
+        return stats;
+    }
+
     const std::string VideoEncoder::getSupportedContainerForCodec(CodecID codec)
     {
         const std::string AVI = std::string("AVI (Audio Video Interleaved)") + '\0' + "*.avi" + '\0';
@@ -26,7 +26,11 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 struct AVFormatContext;
 struct AVStream;
@@ -36,6 +40,10 @@ struct AVCodecContext;
 
 namespace Falcor
 {
+    /** Encodes a stream of images into a video file.
+        Encoding is pipelined over two worker threads: one converts the images to the codec's pixel format, the other runs the codec and writes the file. libavcodec additionally uses frame and slice threading when the codec supports it.
+        The stages exchange frames through a ring of preallocated buffers. When the ring is full, appendFrame() blocks until the encoder catches up. See getStats() to find out how often that happened.
+    */
     class VideoEncoder
     {
     public:
@@ -62,28 +70,86 @@ namespace Falcor
             ResourceFormat format = ResourceFormat::BGRA8UnormSrgb;
             bool flipY = false;
             std::string filename;
+            uint32_t queueSize = 4;     ///< Number of frames in flight between appendFrame() and the codec
+            uint32_t threadCount = 0;   ///< Number of threads used by the codec. 0 lets libavcodec choose based on the CPU count
+        };
+
+        /** Pipeline statistics
+        */
+        struct Stats
+        {
+            uint64_t framesAppended = 0;    ///< Number of appendFrame() calls
+            uint64_t framesEncoded = 0;     ///< Number of frames sent to the codec
+            uint64_t stalledFrames = 0;     ///< Number of appendFrame() calls which blocked because the pipeline was full
+            double stallTimeMs = 0;         ///< Total time appendFrame() spent blocked
+            uint32_t queuedFrames = 0;      ///< Number of frames currently in the pipeline
         };
 
         ~VideoEncoder();
 
         static UniquePtr create(const Desc& desc);
+
+        /** Add a frame to the video. The data is copied, so the buffer can be reused once the function returns.
+            Blocks if the pipeline is full.
+        */
         void appendFrame(const void* pData);
+
+        /** Add a frame to the video, taking ownership of the data. Avoids copying the image.
+            The data can be larger than the image, for example a padded readback buffer. Only the first height * row-pitch bytes are encoded.
+            Blocks if the pipeline is full.
+        */
+        void appendFrame(std::vector<uint8_t>&& data);
+
+        /** Encode the pending frames and close the file
+        */
         void endCapture();
 
+        /** Get the pipeline statistics
+        */
+        Stats getStats() const;
+
         static const std::string getSupportedContainerForCodec(CodecID codec);
     private:
         VideoEncoder(const std::string& filename);
         bool init(const Desc& desc);
 
+        /** A slot in the frame ring
+        */
+        struct FrameSlot
+        {
+            std::vector<uint8_t> image;     // The image passed to appendFrame()
+            AVFrame* pFrame = nullptr;      // The image converted to the codec's format
+        };
+
+        FrameSlot* acquireSlot();
+        void submitSlot();
+        void convertThread();
+        void encodeThread();
+        bool sendFrame(AVFrame* pFrame);
+
         AVFormatContext* mpOutputContext = nullptr;
         AVStream*        mpOutputStream  = nullptr;
-        AVFrame*         mpFrame         = nullptr;
         SwsContext*      mpSwsContext    = nullptr;
         AVCodecContext*  mpCodecContext = nullptr;
 
         const std::string mFilename;
         ResourceFormat mFormat;
         uint32_t mRowPitch = 0;
-        uint8_t* mpFlippedImage = nullptr; // Used in case the image memory layout if bottom->top
+        size_t mImageSize = 0;          // height * row pitch. Every slot image has exactly this size
+        bool mFlipY = false;
+
+        // The frames move through the ring in order. Each counter is the total number of frames which finished a stage, so slot (counter % ring size) is the next one the stage will process.
+        std::vector<FrameSlot> mRing;
+        uint64_t mAppended = 0;         // Written by appendFrame()
+        uint64_t mConverted = 0;        // Written by the convert thread
+        uint64_t mEncoded = 0;          // Written by the encode thread. Slots below this count are free
+        bool mStopping = false;
+        bool mFailed = false;
+        Stats mStats;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mCondition;
+        std::thread mConvertThread;
+        std::thread mEncodeThread;
     };
-}
\ No newline at end of file
+}
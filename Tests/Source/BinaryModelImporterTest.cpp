@@ -0,0 +1,201 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BinaryModelImporterTest.h"
+#include "Graphics/Model/Loaders/BinaryModelSpec.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/MappedFileStream.h"
+
+static const uint32_t kBenchmarkGridSize = 1024;
+
+void BinaryModelImporterTest::addTests()
+{
+    addTestToList<TestMappedFileStream>();
+    addTestToList<TestLoadScene>();
+    addTestToList<TestTruncatedScene>();
+    addTestToList<BenchmarkLoadScene>();
+}
+
+static void writeString(BinaryFileStream& stream, const std::string& str)
+{
+    stream << int32_t(str.size());
+    stream.write(str.data(), str.size());
+}
+
+/** Write a version 8 binary scene with a single grid mesh.
+    The vertices hold interleaved positions, tangents (which the importer skips) and normals.
+    \param[in] filename The file to write
+    \param[in] size The grid size in quads
+    \param[in] instanceCount Number of instances of the mesh
+    \return The file size in bytes
+*/
+static size_t writeGridScene(const std::string& filename, uint32_t size, uint32_t instanceCount)
+{
+    BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+    stream.write("BinScene", 8);
+    stream << int32_t(8);
+    stream << int32_t(0) << int32_t(1) << int32_t(instanceCount);    // Textures, meshes, instances
+
+    // Mesh header and attributes
+    const uint32_t vertexCount = (size + 1) * (size + 1);
+    stream << int32_t(3) << int32_t(vertexCount) << int32_t(1);
+    stream << int32_t(AttribType_Position) << int32_t(AttribFormat_F32) << int32_t(3);
+    stream << int32_t(AttribType_Tangent) << int32_t(AttribFormat_F32) << int32_t(3);
+    stream << int32_t(AttribType_Normal) << int32_t(AttribFormat_F32) << int32_t(3);
+
+    std::vector<glm::vec3> vertices;
+    vertices.reserve(vertexCount * 3);
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        vertices.push_back(glm::vec3(float(v % (size + 1)), float(v / (size + 1)), 0));
+        vertices.push_back(glm::vec3(1, 0, 0));
+        vertices.push_back(glm::vec3(0, 0, 1));
+    }
+    stream.write(vertices.data(), vertices.size() * sizeof(glm::vec3));
+
+    // Submesh material, no textures
+    stream << glm::vec3(0) << glm::vec4(1) << glm::vec3(0) << 1.0f;
+    stream << 0.0f << 0.0f;
+    for (int32_t i = 0; i < TextureType_Glossiness + 1; i++) stream << int32_t(-1);
+
+    std::vector<uint32_t> indices;
+    indices.reserve(size * size * 6);
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            uint32_t v0 = y * (size + 1) + x;
+            uint32_t v2 = v0 + size + 1;
+            indices.insert(indices.end(), { v0, v0 + 1, v2, v0 + 1, v2 + 1, v2 });
+        }
+    }
+    stream << int32_t(indices.size() / 3);
+    stream.write(indices.data(), indices.size() * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < instanceCount; i++)
+    {
+        stream << int32_t(0) << int32_t(1) << glm::translate(glm::mat4(), glm::vec3(float(i), 0, 0));
+        writeString(stream, "instance" + std::to_string(i));
+        writeString(stream, "");
+    }
+    stream.close();
+
+    return MappedFileStream(filename).getRemainingStreamSize();
+}
+
+testing_func(BinaryModelImporterTest, TestMappedFileStream)
+{
+    std::string filename = getTempFilename();
+    {
+        BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+        stream << uint32_t(42) << 1.5f;
+        stream.write("payload", 7);
+    }
+
+    MappedFileStream stream(filename);
+    uint32_t u = 0;
+    float f = 0;
+    stream >> u >> f;
+    if (stream.isOpen() == false || u != 42 || f != 1.5f) return test_fail("Values weren't read correctly");
+
+    const uint8_t* pPayload = stream.readView(7);
+    if (pPayload == nullptr || memcmp(pPayload, "payload", 7) != 0) return test_fail("View doesn't point to the payload");
+    if (stream.isEof() == false || stream.isFail()) return test_fail("Stream should be at the end of the file");
+    if (stream.readView(1) != nullptr || stream.isFail() == false) return test_fail("Reading past the end of the file should fail");
+    stream.close();
+    std::remove(filename.c_str());
+
+    if (MappedFileStream(filename).isOpen()) return test_fail("Opening a missing file should fail");
+    return test_pass();
+}
+
+testing_func(BinaryModelImporterTest, TestLoadScene)
+{
+    const uint32_t size = 16;
+    const uint32_t instanceCount = 3;
+    std::string filename = getTempFilename() + ".bin";
+    writeGridScene(filename, size, instanceCount);
+
+    Model::SharedPtr pModel = Model::createFromFile(filename.c_str());
+    std::remove(filename.c_str());
+    if (pModel == nullptr) return test_fail("Can't load the scene");
+    if (pModel->getMeshCount() != 1 || pModel->getMeshInstanceCount(0) != instanceCount) return test_fail("Wrong mesh instance count");
+
+    const Mesh::SharedPtr& pMesh = pModel->getMeshInstance(0, 0)->getObject();
+    if (pMesh->getVertexCount() != (size + 1) * (size + 1)) return test_fail("Wrong vertex count");
+    if (pMesh->getIndexCount() != size * size * 6) return test_fail("Wrong index count");
+
+    // Position, normal and the generated bitangent. The tangent isn't used by Falcor.
+    if (pMesh->getVao()->getVertexLayout()->getBufferCount() != 3) return test_fail("Wrong vertex buffer count");
+    return test_pass();
+}
+
+testing_func(BinaryModelImporterTest, TestTruncatedScene)
+{
+    std::string filename = getTempFilename() + ".bin";
+    size_t fileSize = writeGridScene(filename, 16, 1);
+
+    // Cut the file in the middle of the vertex data
+    std::vector<uint8_t> data(fileSize / 2);
+    {
+        MappedFileStream stream(filename);
+        stream.read(data.data(), data.size());
+    }
+    {
+        BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+        stream.write(data.data(), data.size());
+    }
+
+    Model::SharedPtr pModel = Model::createFromFile(filename.c_str());
+    std::remove(filename.c_str());
+    if (pModel) return test_fail("Loading a truncated file should fail");
+    return test_pass();
+}
+
+testing_func(BinaryModelImporterTest, BenchmarkLoadScene)
+{
+    std::string filename = getTempFilename() + ".bin";
+    size_t fileSize = writeGridScene(filename, kBenchmarkGridSize, 1);
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    Model::SharedPtr pModel = Model::createFromFile(filename.c_str(), Model::LoadFlags::DontGenerateTangentSpace);
+    float loadTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    std::remove(filename.c_str());
+
+    float sizeInMB = float(fileSize) / (1024 * 1024);
+    std::cout << sizeInMB << "MB scene loaded in " << loadTime << "ms (" << sizeInMB * 1000 / loadTime << "MB/s)\n";
+    if (pModel == nullptr) return test_fail("Can't load the scene");
+    return test_pass();
+}
+
+int main()
+{
+    BinaryModelImporterTest bmit;
+    bmit.init(true);
+    bmit.run();
+    return 0;
+}
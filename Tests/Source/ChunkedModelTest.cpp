@@ -0,0 +1,366 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ChunkedModelTest.h"
+#include "Graphics/Model/Loaders/BinaryModelExporter.h"
+#include "Graphics/Model/Loaders/ChunkedModelSpec.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/MappedFileStream.h"
+#include "Utils/Hash.h"
+#include "Utils/Lz4.h"
+#include <fstream>
+#include <random>
+
+static const uint32_t kBenchmarkGridSize = 1024;
+
+void ChunkedModelTest::addTests()
+{
+    addTestToList<TestXxHash64>();
+    addTestToList<TestLz4>();
+    addTestToList<TestConvertAssimpModel>();
+    addTestToList<TestConvertBinaryModel>();
+    addTestToList<TestPartialLoad>();
+    addTestToList<TestCorruptedChunk>();
+    addTestToList<BenchmarkLoadModel>();
+}
+
+/** Writes an OBJ file with gridCount separate grids of size x size quads.
+*/
+static void writeGridObj(const std::string& filename, uint32_t size, uint32_t gridCount)
+{
+    std::ofstream file(filename);
+    const uint32_t rowSize = size + 1;
+    for (uint32_t g = 0; g < gridCount; g++)
+    {
+        file << "o grid" << g << "\n";
+        for (uint32_t y = 0; y <= size; y++)
+        {
+            for (uint32_t x = 0; x <= size; x++)
+            {
+                file << "v " << float(x) + float(g * (size + 1)) << " 0 " << float(y) << "\n";
+                file << "vt " << float(x) / size << " " << float(y) / size << "\n";
+            }
+        }
+        file << "vn 0 1 0\n";
+
+        const uint32_t base = g * rowSize * rowSize + 1;
+        const uint32_t normal = g + 1;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                uint32_t v0 = base + y * rowSize + x;
+                uint32_t v1 = v0 + 1;
+                uint32_t v2 = v0 + rowSize;
+                uint32_t v3 = v2 + 1;
+                file << "f " << v0 << "/" << v0 << "/" << normal << " " << v2 << "/" << v2 << "/" << normal << " " << v1 << "/" << v1 << "/" << normal << "\n";
+                file << "f " << v1 << "/" << v1 << "/" << normal << " " << v2 << "/" << v2 << "/" << normal << " " << v3 << "/" << v3 << "/" << normal << "\n";
+            }
+        }
+    }
+}
+
+static std::vector<uint8_t> readBuffer(const Buffer::SharedPtr& pBuffer, size_t size)
+{
+    const uint8_t* pData = (const uint8_t*)pBuffer->map(Buffer::MapType::Read);
+    std::vector<uint8_t> data(pData, pData + size);
+    pBuffer->unmap();
+    return data;
+}
+
+/** Check that two models have the same meshes, instances and index data
+*/
+static bool compareModels(const Model* pExpected, const Model* pModel, std::string& error)
+{
+    if (pModel->getMeshCount() != pExpected->getMeshCount())
+    {
+        error = "Wrong mesh count";
+        return false;
+    }
+
+    for (uint32_t i = 0; i < pModel->getMeshCount(); i++)
+    {
+        const Mesh* pExpectedMesh = pExpected->getMesh(i).get();
+        const Mesh* pMesh = pModel->getMesh(i).get();
+        if (pMesh->getVertexCount() != pExpectedMesh->getVertexCount() || pMesh->getIndexCount() != pExpectedMesh->getIndexCount())
+        {
+            error = "Wrong vertex or index count";
+            return false;
+        }
+
+        if (pModel->getMeshInstanceCount(i) != pExpected->getMeshInstanceCount(i))
+        {
+            error = "Wrong instance count";
+            return false;
+        }
+
+        size_t indexBufferSize = pMesh->getIndexCount() * sizeof(uint32_t);
+        if (readBuffer(pMesh->getVao()->getIndexBuffer(), indexBufferSize) != readBuffer(pExpectedMesh->getVao()->getIndexBuffer(), indexBufferSize))
+        {
+            error = "Index buffers don't match";
+            return false;
+        }
+
+        if (pMesh->getMaterial()->getBaseColor() != pExpectedMesh->getMaterial()->getBaseColor())
+        {
+            error = "Materials don't match";
+            return false;
+        }
+    }
+    return true;
+}
+
+static void writeFile(const std::string& filename, const std::vector<uint8_t>& data)
+{
+    BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+    stream.write(data.data(), data.size());
+}
+
+static std::vector<uint8_t> readFile(const std::string& filename)
+{
+    MappedFileStream stream(filename);
+    std::vector<uint8_t> data(stream.getRemainingStreamSize());
+    stream.read(data.data(), data.size());
+    return data;
+}
+
+testing_func(ChunkedModelTest, TestXxHash64)
+{
+    struct TestVector
+    {
+        std::string data;
+        uint64_t seed;
+        uint64_t hash;
+    };
+
+    // Reference values from the xxHash library
+    const TestVector vectors[] =
+    {
+        { "", 0, 0xef46db3751d8e999ull },
+        { "", 1, 0xd5afba1336a3be4bull },
+        { "a", 0, 0xd24ec4f1a98c6e5bull },
+        { "abc", 0, 0x44bc2cf5ad770999ull },
+        { "Nobody inspects the spammish repetition", 0, 0xfbcea83c8a378bf1ull },
+        { "Nobody inspects the spammish repetition", 1, 0x43f425448d954db6ull },
+    };
+
+    for (const auto& v : vectors)
+    {
+        if (xxHash64(v.data.data(), v.data.size(), v.seed) != v.hash) return test_fail("Wrong hash for \"" + v.data + "\"");
+    }
+    return test_pass();
+}
+
+testing_func(ChunkedModelTest, TestLz4)
+{
+    // A block compressed by the LZ4 reference implementation
+    const std::string text = "Falcor Falcor Falcor Falcor Falcor Falcor Falcor!";
+    const uint8_t reference[] = { 0x7f, 0x46, 0x61, 0x6c, 0x63, 0x6f, 0x72, 0x20, 0x07, 0x00, 0x12, 0x50, 0x6c, 0x63, 0x6f, 0x72, 0x21 };
+    std::vector<uint8_t> decoded(text.size());
+    if (lz4Decompress(reference, sizeof(reference), decoded.data(), decoded.size()) == false || memcmp(decoded.data(), text.data(), text.size()) != 0)
+    {
+        return test_fail("Can't decode a reference LZ4 block");
+    }
+
+    // Round trips of random, repetitive and mixed data
+    std::mt19937 rng(17);
+    for (size_t size : { 0, 1, 13, 64, 1000, 65536, 1000000 })
+    {
+        for (uint32_t kind = 0; kind < 3; kind++)
+        {
+            std::vector<uint8_t> data(size);
+            for (size_t i = 0; i < size; i++)
+            {
+                uint8_t random = uint8_t(rng());
+                data[i] = (kind == 0) ? random : (kind == 1) ? uint8_t(i % 7) : ((i / 100) % 2 ? random : uint8_t(i % 251));
+            }
+
+            std::vector<uint8_t> compressed(lz4CompressBound(size));
+            size_t compressedSize = lz4Compress(data.data(), size, compressed.data(), compressed.size());
+            if (compressedSize == 0 && size > 0) return test_fail("Compression failed");
+            if (kind == 1 && size >= 1000 && compressedSize > size / 20) return test_fail("Repetitive data isn't compressed");
+
+            std::vector<uint8_t> result(size);
+            if (lz4Decompress(compressed.data(), compressedSize, result.data(), size) == false || result != data) return test_fail("Round trip failed");
+
+            // Truncated blocks and wrong sizes must be rejected
+            if (size > 0 && lz4Decompress(compressed.data(), compressedSize - 1, result.data(), size)) return test_fail("Truncated block was accepted");
+            if (size > 0 && lz4Decompress(compressed.data(), compressedSize, result.data(), size - 1)) return test_fail("Block was decoded into a smaller buffer");
+        }
+    }
+
+    std::vector<uint8_t> data(1000, 1);
+    std::vector<uint8_t> compressed(10);
+    if (lz4Compress(data.data(), data.size(), compressed.data(), compressed.size()) != 0) return test_fail("Compression should fail when the buffer is smaller than the bound");
+    return test_pass();
+}
+
+testing_func(ChunkedModelTest, TestConvertAssimpModel)
+{
+    std::string objFilename = getTempFilename() + ".obj";
+    writeGridObj(objFilename, 16, 2);
+    Model::SharedPtr pExpected = Model::createFromFile(objFilename.c_str(), Model::LoadFlags::DontMergeMeshes);
+    if (pExpected == nullptr) return test_fail("Can't load the source model");
+
+    for (ChunkCompression compression : { ChunkCompression::None, ChunkCompression::LZ4 })
+    {
+        std::string filename = getTempFilename() + ".bin";
+        bool converted = BinaryModelExporter::convertToChunkedFile(objFilename, filename, Model::LoadFlags::DontMergeMeshes, compression);
+        Model::SharedPtr pModel = converted ? Model::createFromFile(filename.c_str()) : nullptr;
+        std::remove(filename.c_str());
+        if (pModel == nullptr) return test_fail("Can't convert and load the model");
+
+        std::string error;
+        if (compareModels(pExpected.get(), pModel.get(), error) == false) return test_fail(error);
+    }
+    std::remove(objFilename.c_str());
+    return test_pass();
+}
+
+testing_func(ChunkedModelTest, TestConvertBinaryModel)
+{
+    std::string objFilename = getTempFilename() + ".obj";
+    std::string binFilename = getTempFilename() + ".bin";
+    std::string filename = getTempFilename() + ".bin";
+    writeGridObj(objFilename, 16, 1);
+    Model::SharedPtr pExpected = Model::createFromFile(objFilename.c_str());
+    std::remove(objFilename.c_str());
+    if (pExpected == nullptr) return test_fail("Can't load the source model");
+
+    // The binary scene format is the source, the chunked file must load into the same model
+    pExpected->exportToBinaryFile(binFilename);
+    pExpected = Model::createFromFile(binFilename.c_str());
+    bool converted = BinaryModelExporter::convertToChunkedFile(binFilename, filename);
+    Model::SharedPtr pModel = converted ? Model::createFromFile(filename.c_str()) : nullptr;
+    std::remove(binFilename.c_str());
+    std::remove(filename.c_str());
+    if (pExpected == nullptr || pModel == nullptr) return test_fail("Can't convert and load the model");
+
+    std::string error;
+    if (compareModels(pExpected.get(), pModel.get(), error) == false) return test_fail(error);
+    return test_pass();
+}
+
+testing_func(ChunkedModelTest, TestPartialLoad)
+{
+    const uint32_t gridCount = 3;
+    std::string objFilename = getTempFilename() + ".obj";
+    std::string filename = getTempFilename() + ".bin";
+    writeGridObj(objFilename, 8, gridCount);
+    bool converted = BinaryModelExporter::convertToChunkedFile(objFilename, filename, Model::LoadFlags::DontMergeMeshes);
+    std::remove(objFilename.c_str());
+    if (converted == false) return test_fail("Can't convert the model");
+
+    Model::SharedPtr pFull = Model::createFromFile(filename.c_str());
+    Model::SharedPtr pPartial = Model::createFromChunkedFile(filename.c_str(), { 2, 0 });
+    Model::SharedPtr pInvalid = Model::createFromChunkedFile(filename.c_str(), { gridCount });
+    std::remove(filename.c_str());
+
+    if (pFull == nullptr || pFull->getMeshCount() != gridCount) return test_fail("Can't load the full model");
+    if (pPartial == nullptr || pPartial->getMeshCount() != 2) return test_fail("Partial load should only load the requested meshes");
+    if (pPartial->getVertexCount() * gridCount != pFull->getVertexCount() * 2) return test_fail("Partial load has the wrong vertex count");
+    if (pInvalid) return test_fail("Loading geometry which doesn't exist should fail");
+    return test_pass();
+}
+
+testing_func(ChunkedModelTest, TestCorruptedChunk)
+{
+    std::string objFilename = getTempFilename() + ".obj";
+    std::string filename = getTempFilename() + ".bin";
+    writeGridObj(objFilename, 16, 1);
+    bool converted = BinaryModelExporter::convertToChunkedFile(objFilename, filename);
+    std::remove(objFilename.c_str());
+    if (converted == false) return test_fail("Can't convert the model");
+
+    // Move the first chunk back by a byte. It stays inside the file, but uncompressed chunks can't be read in place anymore
+    const std::vector<uint8_t> original = readFile(filename);
+    std::vector<uint8_t> data = original;
+    const ChunkedFileHeader* pHeader = (const ChunkedFileHeader*)data.data();
+    ChunkTocEntry* pToc = (ChunkTocEntry*)(data.data() + pHeader->tocOffset);
+    pToc[0].offset -= 1;
+    writeFile(filename, data);
+    Model::SharedPtr pMisaligned = Model::createFromFile(filename.c_str());
+
+    // The instances chunk is the last one, so the last byte of the file is always chunk data
+    data = original;
+    data.back() ^= 0xff;
+    writeFile(filename, data);
+    Model::SharedPtr pCorrupted = Model::createFromFile(filename.c_str());
+
+    data.resize(data.size() - 1);
+    writeFile(filename, data);
+    Model::SharedPtr pTruncated = Model::createFromFile(filename.c_str());
+    std::remove(filename.c_str());
+
+    if (pMisaligned) return test_fail("Loading a file with a misaligned chunk should fail");
+    if (pCorrupted) return test_fail("The content hash didn't detect a corrupted chunk");
+    if (pTruncated) return test_fail("Loading a truncated file should fail");
+    return test_pass();
+}
+
+testing_func(ChunkedModelTest, BenchmarkLoadModel)
+{
+    std::string objFilename = getTempFilename() + ".obj";
+    std::string binFilename = getTempFilename() + ".bin";
+    writeGridObj(objFilename, kBenchmarkGridSize, 4);
+    Model::SharedPtr pModel = Model::createFromFile(objFilename.c_str(), Model::LoadFlags::DontMergeMeshes);
+    std::remove(objFilename.c_str());
+    if (pModel == nullptr) return test_fail("Can't load the source model");
+    pModel->exportToBinaryFile(binFilename);
+
+    auto measure = [](const std::string& filename, const std::string& name)
+    {
+        size_t fileSize = MappedFileStream(filename).getRemainingStreamSize();
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        Model::SharedPtr pLoaded = Model::createFromFile(filename.c_str(), Model::LoadFlags::DontGenerateTangentSpace);
+        float loadTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        float sizeInMB = float(fileSize) / (1024 * 1024);
+        std::cout << name << ": " << sizeInMB << "MB loaded in " << loadTime << "ms\n";
+        return pLoaded != nullptr;
+    };
+
+    bool success = measure(binFilename, "Binary scene");
+    for (ChunkCompression compression : { ChunkCompression::None, ChunkCompression::LZ4 })
+    {
+        std::string filename = getTempFilename() + ".bin";
+        success = success && BinaryModelExporter::exportToChunkedFile(filename, pModel.get(), compression);
+        success = success && measure(filename, (compression == ChunkCompression::None) ? "Chunked" : "Chunked LZ4");
+        std::remove(filename.c_str());
+    }
+    std::remove(binFilename.c_str());
+
+    if (success == false) return test_fail("Can't export or load the model");
+    return test_pass();
+}
+
+int main()
+{
+    ChunkedModelTest cmt;
+    cmt.init(true);
+    cmt.run();
+    return 0;
+}
@@ -0,0 +1,173 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "DdsLoaderTest.h"
+#include "Graphics/TextureHelper.h"
+#include "Utils/DDSHeader.h"
+#include <fstream>
+#include <functional>
+
+using namespace DdsHelper;
+
+static const uint32_t kTextureSize = 32;
+static const uint32_t kMipCount = 6;
+
+void DdsLoaderTest::addTests()
+{
+    addTestToList<TestMipSkip>();
+    addTestToList<TestGlobalMipSkip>();
+    addTestToList<TestTruncatedFile>();
+    addTestToList<TestCorruptedHeader>();
+}
+
+/** Returns the texels of a mip-level. Every level has a different pattern, so the test can tell which level was loaded
+*/
+static std::vector<uint8_t> createMipTexels(uint32_t mip)
+{
+    uint32_t size = max(kTextureSize >> mip, 1U);
+    std::vector<uint8_t> texels(size * size * 4);
+    for (size_t i = 0; i < texels.size(); i++) texels[i] = uint8_t(i * 3 + mip * 50);
+    return texels;
+}
+
+/** Writes an RGBA8 DDS file with a full mip-chain and returns its full path
+    \param[in] truncateBytes Number of bytes to drop from the end of the file
+    \param[in] patchHeader Optional function which modifies the header before it's written
+*/
+static std::string writeDds(size_t truncateBytes = 0, const std::function<void(DdsHeader&)>& patchHeader = nullptr)
+{
+    std::vector<uint8_t> file(sizeof(uint32_t) + sizeof(DdsHeader));
+    uint32_t magic = 0x20534444;
+    std::memcpy(file.data(), &magic, sizeof(magic));
+
+    DdsHeader header = {};
+    header.headerSize = sizeof(DdsHeader);
+    header.flags = DdsHeader::kCapsMask | DdsHeader::kHeightMask | DdsHeader::kWidthMask | DdsHeader::kPixelFormatMask | DdsHeader::kMipCountMask;
+    header.width = kTextureSize;
+    header.height = kTextureSize;
+    header.mipCount = kMipCount;
+    header.pixelFormat.structSize = sizeof(DdsHeader::PixelFormat);
+    header.pixelFormat.flags = DdsHeader::PixelFormat::kRgbMask | DdsHeader::PixelFormat::kAlphaPixelsMask;
+    header.pixelFormat.bitcount = 32;
+    header.pixelFormat.rMask = 0x000000FF;
+    header.pixelFormat.gMask = 0x0000FF00;
+    header.pixelFormat.bMask = 0x00FF0000;
+    header.pixelFormat.aMask = 0xFF000000;
+    header.caps[0] = DdsHeader::kCapsTextureMask | DdsHeader::kCapsMipMapMask | DdsHeader::kCapsComplexMask;
+    if (patchHeader) patchHeader(header);
+    std::memcpy(file.data() + sizeof(uint32_t), &header, sizeof(header));
+
+    for (uint32_t mip = 0; mip < kMipCount; mip++)
+    {
+        std::vector<uint8_t> texels = createMipTexels(mip);
+        file.insert(file.end(), texels.begin(), texels.end());
+    }
+    file.resize(file.size() - truncateBytes);
+
+    std::string filename = getTempFilename() + ".dds";
+    std::ofstream out(filename, std::ios::binary);
+    out.write((const char*)file.data(), file.size());
+    return filename;
+}
+
+/** Checks that the texture holds the file's mip-levels starting at firstMip
+*/
+static bool checkMips(const Texture::SharedPtr& pTexture, uint32_t firstMip)
+{
+    if (pTexture == nullptr) return false;
+    if (pTexture->getWidth() != (kTextureSize >> firstMip) || pTexture->getMipCount() != kMipCount - firstMip) return false;
+
+    auto& pContext = gpDevice->getRenderContext();
+    for (uint32_t mip = 0; mip < pTexture->getMipCount(); mip++)
+    {
+        // Compare the first row, the readback might be padded to the row-pitch alignment
+        std::vector<uint8> data = pContext->readTextureSubresource(pTexture.get(), pTexture->getSubresourceIndex(0, mip));
+        std::vector<uint8_t> expected = createMipTexels(mip + firstMip);
+        size_t rowSize = pTexture->getWidth(mip) * 4;
+        if (data.size() < rowSize || std::memcmp(data.data(), expected.data(), rowSize) != 0) return false;
+    }
+    return true;
+}
+
+testing_func(DdsLoaderTest, TestMipSkip)
+{
+    std::string filename = writeDds();
+    bool success = checkMips(createTextureFromDDSFile(filename, false, false, Texture::BindFlags::ShaderResource, 0), 0);
+    success = success && checkMips(createTextureFromDDSFile(filename, false, false, Texture::BindFlags::ShaderResource, 2), 2);
+    // Skipping more levels than the file has keeps the last one
+    success = success && checkMips(createTextureFromDDSFile(filename, false, false, Texture::BindFlags::ShaderResource, 100), kMipCount - 1);
+    std::remove(filename.c_str());
+    return success ? test_pass() : test_fail("Wrong mip-levels were loaded");
+}
+
+testing_func(DdsLoaderTest, TestGlobalMipSkip)
+{
+    std::string filename = writeDds();
+    setDdsMipSkip(3);
+    bool success = checkMips(createTextureFromFile(filename, false, false), 3);
+    setDdsMipSkip(0);
+    success = success && checkMips(createTextureFromFile(filename, false, false), 0);
+    std::remove(filename.c_str());
+    return success ? test_pass() : test_fail("createTextureFromFile() ignored the mip skip");
+}
+
+testing_func(DdsLoaderTest, TestTruncatedFile)
+{
+    // Cut into the last mip-level, and into the header
+    std::string filename = writeDds(1);
+    bool success = createTextureFromDDSFile(filename, false, false) == nullptr;
+    std::remove(filename.c_str());
+
+    size_t dataSize = 0;
+    for (uint32_t mip = 0; mip < kMipCount; mip++) dataSize += createMipTexels(mip).size();
+    filename = writeDds(dataSize + sizeof(DdsHeader) / 2);
+    success = success && createTextureFromDDSFile(filename, false, false) == nullptr;
+    std::remove(filename.c_str());
+    return success ? test_pass() : test_fail("A truncated file was loaded");
+}
+
+testing_func(DdsLoaderTest, TestCorruptedHeader)
+{
+    // A 32x32 texture can't have more than 6 mip-levels
+    std::string filename = writeDds(0, [](DdsHeader& header) { header.mipCount = 40; });
+    bool success = createTextureFromDDSFile(filename, false, false) == nullptr;
+    std::remove(filename.c_str());
+
+    // The size of the first mip-level doesn't fit in 64 bits
+    filename = writeDds(0, [](DdsHeader& header) { header.width = 0xFFFFFFFF; header.height = 0xFFFFFFFF; header.mipCount = 1; });
+    success = success && createTextureFromDDSFile(filename, false, false) == nullptr;
+    std::remove(filename.c_str());
+    return success ? test_pass() : test_fail("A file with an invalid header was loaded");
+}
+
+int main()
+{
+    DdsLoaderTest dlt;
+    dlt.init(true);
+    dlt.run();
+    return 0;
+}
@@ -0,0 +1,139 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "DirtyRangesTest.h"
+#include "Utils/DirtyRanges.h"
+
+static const uint32_t kRandomIterations = 10000;
+static const size_t kBufferSize = 256;
+static const uint32_t kElementCount = 1024;
+
+void DirtyRangesTest::addTests()
+{
+    addTestToList<TestCoalescing>();
+    addTestToList<TestRandomWrites>();
+    addTestToList<TestPartialUpload>();
+}
+
+testing_func(DirtyRangesTest, TestCoalescing)
+{
+    DirtyRanges ranges;
+    ranges.add(0, 16);
+    ranges.add(32, 16);
+    if (ranges.getRanges().size() != 2) return test_fail("Disjoint ranges shouldn't be merged");
+    ranges.add(16, 16);
+    if (ranges.getRanges().size() != 1 || ranges.getDirtyBytes() != 48) return test_fail("Adjacent ranges should be merged");
+    ranges.add(8, 4);
+    if (ranges.getRanges().size() != 1 || ranges.getDirtyBytes() != 48) return test_fail("A contained range shouldn't change the set");
+
+    DirtyRanges gapped(8);
+    gapped.add(0, 4);
+    gapped.add(12, 4);
+    gapped.add(64, 4);
+    if (gapped.getRanges().size() != 2 || gapped.getRanges()[0].end != 16) return test_fail("Ranges within the merge distance should be merged");
+
+    DirtyRanges limited(0, 2);
+    limited.add(0, 4);
+    limited.add(100, 4);
+    limited.add(10, 4);
+    if (limited.getRanges().size() != 2 || limited.getRanges()[0].end != 14) return test_fail("The closest ranges should be merged when exceeding the range count");
+
+    ranges.clear();
+    if (ranges.empty() == false) return test_fail("The set should be empty after clear()");
+    return test_pass();
+}
+
+testing_func(DirtyRangesTest, TestRandomWrites)
+{
+    for (uint32_t i = 0; i < kRandomIterations; i++)
+    {
+        size_t mergeDistance = rand() % 8;
+        size_t maxRanges = 1 + rand() % 8;
+        DirtyRanges ranges(mergeDistance, maxRanges);
+        std::vector<bool> written(kBufferSize, false);
+
+        uint32_t writeCount = 1 + rand() % 32;
+        for (uint32_t w = 0; w < writeCount; w++)
+        {
+            size_t offset = rand() % kBufferSize;
+            size_t size = std::min<size_t>(rand() % 16, kBufferSize - offset);
+            ranges.add(offset, size);
+            for (size_t b = offset; b < offset + size; b++) written[b] = true;
+        }
+
+        const auto& r = ranges.getRanges();
+        if (r.size() > maxRanges) return test_fail("Too many ranges");
+        for (size_t j = 0; j < r.size(); j++)
+        {
+            if (r[j].begin >= r[j].end) return test_fail("Found an empty range");
+            if (j > 0 && r[j].begin <= r[j - 1].end + mergeDistance) return test_fail("Ranges are not sorted or not coalesced");
+        }
+
+        // Every written byte must be covered
+        size_t current = 0;
+        for (size_t b = 0; b < kBufferSize; b++)
+        {
+            while (current < r.size() && r[current].end <= b) current++;
+            bool covered = current < r.size() && r[current].begin <= b;
+            if (written[b] && covered == false) return test_fail("A written byte is not covered by the ranges");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(DirtyRangesTest, TestPartialUpload)
+{
+    ComputeProgram::SharedPtr pProgram = ComputeProgram::createFromFile("DirtyRangesTest.cs.hlsl", "main");
+    StructuredBuffer::SharedPtr pBuffer = StructuredBuffer::create(pProgram, "gBuffer", kElementCount);
+    if (pBuffer == nullptr) return test_fail("Can't create the structured buffer");
+
+    std::vector<uint32_t> expected(kElementCount);
+    for (uint32_t i = 0; i < kElementCount; i++) expected[i] = i;
+    pBuffer->setBlob(expected.data(), 0, kElementCount * sizeof(uint32_t));
+    pBuffer->uploadToGPU();
+
+    // Modify a range in the middle of the buffer, so that only part of the buffer is uploaded
+    const uint32_t first = kElementCount / 4 + 3;
+    const uint32_t count = kElementCount / 8;
+    for (uint32_t i = first; i < first + count; i++) expected[i] = 0xF000 + i;
+    pBuffer->setBlob(expected.data() + first, first * sizeof(uint32_t), count * sizeof(uint32_t));
+    pBuffer->uploadToGPU();
+
+    const uint32_t* pGpuData = (const uint32_t*)pBuffer->map(Buffer::MapType::Read);
+    bool match = (std::memcmp(pGpuData, expected.data(), kElementCount * sizeof(uint32_t)) == 0);
+    pBuffer->unmap();
+    if (match == false) return test_fail("The GPU copy doesn't match the CPU data after a partial upload");
+    return test_pass();
+}
+
+int main()
+{
+    DirtyRangesTest drt;
+    drt.init(true);
+    drt.run();
+    return 0;
+}
@@ -0,0 +1,179 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "DrawListTest.h"
+
+static const uint32_t kBenchmarkModelCount = 8;
+static const uint32_t kBenchmarkMeshCount = 25;
+static const uint32_t kBenchmarkInstanceCount = 300;
+static const uint32_t kBenchmarkFrameCount = 20;
+
+/** Creates a model with meshCount separate quads. The meshes don't have GPU buffers or materials, which is all the CPU stage of the renderer needs.
+*/
+static Model::SharedPtr createBenchmarkModel(uint32_t meshCount)
+{
+    Model::SharedPtr pModel = Model::create();
+    for (uint32_t i = 0; i < meshCount; i++)
+    {
+        const glm::vec3 corner(float(rand() % 20), 0, float(rand() % 20));
+        BoundingBox box = BoundingBox::fromMinMax(corner, corner + glm::vec3(1, 0, 1));
+        Mesh::SharedPtr pMesh = Mesh::create({}, 4, nullptr, 6, nullptr, Vao::Topology::TriangleList, nullptr, box, false);
+        pModel->addMeshInstance(pMesh, glm::mat4());
+    }
+    return pModel;
+}
+
+/** Counts the state changes the renderer would make when replaying a draw list
+*/
+static void countStateChanges(const std::vector<SceneRenderer::DrawPacket>& packets, uint32_t& modelChanges, uint32_t& meshChanges)
+{
+    modelChanges = meshChanges = 0;
+    uint32_t modelID = uint32_t(-1);
+    uint32_t meshIndex = uint32_t(-1);
+    for (const auto& packet : packets)
+    {
+        if (packet.modelID != modelID) modelChanges++;
+        if (packet.meshIndex != meshIndex) meshChanges++;
+        modelID = packet.modelID;
+        meshIndex = packet.meshIndex;
+    }
+}
+
+void DrawListTest::addTests()
+{
+    addTestToList<TestSortKeyOrder>();
+    addTestToList<TestSortKeepsTraversalOrder>();
+    addTestToList<BenchmarkDrawList>();
+}
+
+testing_func(DrawListTest, TestSortKeyOrder)
+{
+    // The program is the most significant part of the key, the VAO the least
+    if (SceneRenderer::makeSortKey(0, 0, 1) <= SceneRenderer::makeSortKey(0, 0, 0)) return test_fail("VAO ID doesn't affect the key");
+    if (SceneRenderer::makeSortKey(0, 1, 0) <= SceneRenderer::makeSortKey(0, 0, 1000000)) return test_fail("Material ID should be more significant than VAO ID");
+    if (SceneRenderer::makeSortKey(1, 0, 0) <= SceneRenderer::makeSortKey(0, 1000000, 1000000)) return test_fail("Program ID should be more significant than material ID");
+
+    // IDs that don't fit are clamped instead of overflowing into the other fields
+    if (SceneRenderer::makeSortKey(0, 0, uint32_t(-1)) >= SceneRenderer::makeSortKey(0, 1, 0)) return test_fail("VAO ID overflows into the material ID");
+    if (SceneRenderer::makeSortKey(0, uint32_t(-1), 0) >= SceneRenderer::makeSortKey(1, 0, 0)) return test_fail("Material ID overflows into the program ID");
+    return test_pass();
+}
+
+testing_func(DrawListTest, TestSortKeepsTraversalOrder)
+{
+    std::vector<SceneRenderer::DrawPacket> packets(10000);
+    for (uint32_t i = 0; i < (uint32_t)packets.size(); i++)
+    {
+        packets[i] = {};
+        packets[i].sortKey = SceneRenderer::makeSortKey(rand() % 3, rand() % 5, rand() % 7);
+        packets[i].sequence = i;
+        // The traversal visits the models in order
+        packets[i].modelID = i / 2500;
+    }
+
+    SceneRenderer::sortDrawPackets(packets);
+    for (size_t i = 1; i < packets.size(); i++)
+    {
+        const auto& prev = packets[i - 1];
+        const auto& cur = packets[i];
+        if (prev.modelID > cur.modelID) return test_fail("Packets are not grouped by model");
+        if (prev.modelID != cur.modelID) continue;
+        if (prev.sortKey > cur.sortKey) return test_fail("Packets are not sorted by key");
+        if (prev.sortKey == cur.sortKey && prev.sequence > cur.sequence) return test_fail("Packets with equal keys are not in traversal order");
+    }
+    return test_pass();
+}
+
+testing_func(DrawListTest, BenchmarkDrawList)
+{
+    // Many instances of models with a lot of small meshes, scattered around the camera
+    Scene::SharedPtr pScene = Scene::create();
+    for (uint32_t m = 0; m < kBenchmarkModelCount; m++)
+    {
+        Model::SharedPtr pModel = createBenchmarkModel(kBenchmarkMeshCount);
+        for (uint32_t i = 0; i < kBenchmarkInstanceCount; i++)
+        {
+            glm::vec3 translation(float(rand() % 1000) - 500, 0, float(rand() % 1000) - 500);
+            pScene->addModelInstance(pModel, "instance" + std::to_string(i), translation);
+        }
+    }
+    const uint32_t packetCount = kBenchmarkModelCount * kBenchmarkMeshCount * kBenchmarkInstanceCount;
+
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+    pCamera->setDepthRange(0.1f, 1000);
+
+    // The first build includes the BVH construction. The meshes have no materials, so the program can't depend on them.
+    SceneRenderer::SharedPtr pRenderer = SceneRenderer::create(pScene);
+    pRenderer->toggleStaticMaterialCompilation(false);
+    pCamera->setPosition(glm::vec3(0, 50, 0));
+    pCamera->setTarget(glm::vec3(100, 0, 100));
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    pRenderer->buildDrawList(pCamera.get());
+    float firstBuildTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // Move the camera every frame, so every build culls the scene again
+    float buildTime = 0;
+    size_t visiblePackets = 0;
+    for (uint32_t frame = 0; frame < kBenchmarkFrameCount; frame++)
+    {
+        pCamera->setPosition(glm::vec3(float(frame), 50, 0));
+        start = CpuTimer::getCurrentTimePoint();
+        visiblePackets += pRenderer->buildDrawList(pCamera.get()).size();
+        buildTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    }
+    std::cout << packetCount << " mesh instances, " << visiblePackets / kBenchmarkFrameCount << " visible. First build " << firstBuildTime << "ms, build " << buildTime / kBenchmarkFrameCount << "ms per frame\n";
+
+    // Compare the state changes with and without sorting, without culling so every packet is drawn
+    pRenderer->toggleMeshCulling(false);
+    uint32_t modelChanges, meshChanges;
+    pRenderer->toggleDrawSorting(false);
+    const std::vector<SceneRenderer::DrawPacket>& packets = pRenderer->buildDrawList(pCamera.get());
+    if (packets.size() != packetCount) return test_fail("The draw list doesn't contain every mesh instance");
+    countStateChanges(packets, modelChanges, meshChanges);
+    std::cout << "Unsorted: " << modelChanges << " model, " << meshChanges << " mesh changes\n";
+
+    pRenderer->toggleDrawSorting(true);
+    start = CpuTimer::getCurrentTimePoint();
+    pRenderer->buildDrawList(pCamera.get());
+    float sortedTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    if (packets.size() != packetCount) return test_fail("Sorting changed the number of packets");
+    countStateChanges(packets, modelChanges, meshChanges);
+    std::cout << "Sorted: " << modelChanges << " model, " << meshChanges << " mesh changes. Unculled build " << sortedTime << "ms\n";
+
+    if (modelChanges != kBenchmarkModelCount) return test_fail("Sorted packets should change the model once per model");
+    if (meshChanges > kBenchmarkModelCount * kBenchmarkMeshCount) return test_fail("Sorted packets should change the mesh at most once per mesh");
+    return test_pass();
+}
+
+int main()
+{
+    DrawListTest dlt;
+    dlt.init();
+    dlt.run();
+    return 0;
+}
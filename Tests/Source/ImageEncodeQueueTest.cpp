@@ -0,0 +1,195 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ImageEncodeQueueTest.h"
+#include "Utils/ImageEncodeQueue.h"
+#include <fstream>
+#include <iterator>
+
+void ImageEncodeQueueTest::addTests()
+{
+    addTestToList<TestRawFiles>();
+    addTestToList<TestMatchesSaveImage>();
+    addTestToList<TestDropWhenFull>();
+    addTestToList<BenchmarkEncode>();
+}
+
+/** Creates an RGBA8 frame with smooth gradients and some noise, similar to a rendered image
+*/
+static std::vector<uint8_t> createFrame(uint32_t width, uint32_t height, uint32_t seed)
+{
+    std::vector<uint8_t> texels(width * height * 4);
+    uint32_t rng = seed * 747796405u + 2891336453u;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            rng = rng * 1664525u + 1013904223u;
+            uint8_t* pTexel = texels.data() + (y * width + x) * 4;
+            pTexel[0] = uint8_t(((x + seed) * 255) / width);
+            pTexel[1] = uint8_t((y * 255) / height);
+            pTexel[2] = uint8_t(128 + (rng >> 28));
+            pTexel[3] = 0xff;
+        }
+    }
+    return texels;
+}
+
+static std::vector<uint8_t> readFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static ImageEncodeQueue::Job createJob(const std::string& filename, uint32_t width, uint32_t height, Bitmap::FileFormat fileFormat, std::vector<uint8_t> data)
+{
+    ImageEncodeQueue::Job job;
+    job.filename = filename;
+    job.width = width;
+    job.height = height;
+    job.fileFormat = fileFormat;
+    job.resourceFormat = ResourceFormat::RGBA8Unorm;
+    job.data = std::move(data);
+    return job;
+}
+
+testing_func(ImageEncodeQueueTest, TestRawFiles)
+{
+    const uint32_t width = 64, height = 32, frameCount = 16;
+    ImageEncodeQueue::SharedPtr pQueue = ImageEncodeQueue::create(2, 2);
+
+    std::vector<std::string> filenames;
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        filenames.push_back(getTempFilename() + ".raw");
+        if (pQueue->push(createJob(filenames.back(), width, height, Bitmap::FileFormat::RawFile, createFrame(width, height, i))) == false)
+        {
+            return test_fail("Blocking push() dropped an image");
+        }
+    }
+    pQueue->flush();
+    if (pQueue->getPendingCount() != 0) return test_fail("flush() returned before all the images were written");
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        if (readFile(filenames[i]) != createFrame(width, height, i)) return test_fail("Raw file content doesn't match the image");
+        std::remove(filenames[i].c_str());
+    }
+    return test_pass();
+}
+
+testing_func(ImageEncodeQueueTest, TestMatchesSaveImage)
+{
+    const uint32_t width = 97, height = 41;
+    std::string syncFile = getTempFilename() + ".png";
+    std::string asyncFile = getTempFilename() + ".png";
+
+    std::vector<uint8_t> frame = createFrame(width, height, 7);
+    std::vector<uint8_t> copy = frame;
+    Bitmap::saveImage(syncFile, width, height, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::None, ResourceFormat::RGBA8Unorm, true, copy.data());
+    bool queued = Bitmap::saveImageAsync(asyncFile, width, height, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::None, ResourceFormat::RGBA8Unorm, true, frame);
+    // Destroying the global queue writes the pending images. The next call to instance() creates a new queue.
+    ImageEncodeQueue::shutdown();
+
+    std::vector<uint8_t> syncData = readFile(syncFile);
+    std::vector<uint8_t> asyncData = readFile(asyncFile);
+    std::remove(syncFile.c_str());
+    std::remove(asyncFile.c_str());
+
+    if (queued == false) return test_fail("saveImageAsync() dropped the image");
+    if (syncData.empty() || syncData != asyncData) return test_fail("The queued image doesn't match the one written by saveImage()");
+    return test_pass();
+}
+
+testing_func(ImageEncodeQueueTest, TestDropWhenFull)
+{
+    const uint32_t width = 512, height = 512, frameCount = 16;
+    ImageEncodeQueue::SharedPtr pQueue = ImageEncodeQueue::create(1, 2);
+    std::vector<uint8_t> frame = createFrame(width, height, 0);
+    std::string filename = getTempFilename() + ".png";
+
+    uint32_t queuedCount = 0;
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        if (pQueue->push(createJob(filename, width, height, Bitmap::FileFormat::PngFile, frame), false)) queuedCount++;
+    }
+    pQueue->flush();
+    std::remove(filename.c_str());
+
+    // At most one image is being encoded while the queue holds two more
+    if (queuedCount == frameCount || queuedCount + pQueue->getDroppedCount() != frameCount)
+    {
+        return test_fail("Non-blocking push() didn't drop the images which didn't fit in the queue");
+    }
+    return test_pass();
+}
+
+testing_func(ImageEncodeQueueTest, BenchmarkEncode)
+{
+    const uint32_t width = 1920, height = 1080, frameCount = 16;
+    std::vector<std::vector<uint8_t>> frames;
+    for (uint32_t i = 0; i < frameCount; i++) frames.push_back(createFrame(width, height, i));
+
+    for (auto fileFormat : { Bitmap::FileFormat::PngFile, Bitmap::FileFormat::RawFile })
+    {
+        std::string prefix = getTempFilename();
+        auto getFilename = [&](uint32_t i) { return prefix + "." + std::to_string(i) + "." + Bitmap::getFileExtension(fileFormat); };
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            std::vector<uint8_t> copy = frames[i];
+            Bitmap::saveImage(getFilename(i), width, height, fileFormat, Bitmap::ExportFlags::None, ResourceFormat::RGBA8Unorm, true, copy.data());
+        }
+        double serialTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // Measure how long the producer is blocked separately from the total time, that's what the render thread pays
+        ImageEncodeQueue::SharedPtr pQueue = ImageEncodeQueue::create();
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            pQueue->push(createJob(getFilename(i), width, height, fileFormat, frames[i]));
+        }
+        double producerTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        pQueue->flush();
+        double queueTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        for (uint32_t i = 0; i < frameCount; i++) std::remove(getFilename(i).c_str());
+
+        std::cout << frameCount << " " << width << "x" << height << " " << Bitmap::getFileExtension(fileFormat) << " frames: serial " << serialTime << "ms, "
+            << pQueue->getWorkerCount() << " encoder threads " << queueTime << "ms (producer blocked " << producerTime << "ms)\n";
+    }
+    return test_pass();
+}
+
+int main()
+{
+    ImageEncodeQueueTest ieqt;
+    ieqt.init();
+    ieqt.run();
+    return 0;
+}
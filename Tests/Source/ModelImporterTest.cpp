@@ -0,0 +1,275 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ModelImporterTest.h"
+#include "Graphics/Model/Loaders/ModelImporter.h"
+#include "Graphics/Model/Loaders/AssimpModelImporter.h"
+#include "assimp/scene.h"
+#include <map>
+#include <unordered_map>
+
+static const uint32_t kRandomMeshCount = 1000;
+static const uint32_t kBenchmarkGridSize = 1000;
+static const uint32_t kBenchmarkMeshCount = 64;
+static const uint32_t kBenchmarkMeshGridSize = 128;
+
+void ModelImporterTest::addTests()
+{
+    addTestToList<TestAdjacencyMatchesReference>();
+    addTestToList<TestAdjacencyGrid>();
+    addTestToList<BenchmarkAdjacency>();
+    addTestToList<TestStagingMatchesMesh>();
+    addTestToList<TestStagingAdjacency>();
+    addTestToList<BenchmarkStaging>();
+}
+
+/** The half-edge map implementation the importers used to have
+*/
+static std::vector<uint32_t> generateReferenceAdjacency(const std::vector<uint32_t>& indices)
+{
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> halfEdges;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        uint32_t p0 = indices[i];
+        uint32_t p1 = indices[i + 1];
+        uint32_t p2 = indices[i + 2];
+        halfEdges.insert(std::make_pair(std::make_pair(p0, p1), p2));
+        halfEdges.insert(std::make_pair(std::make_pair(p1, p2), p0));
+        halfEdges.insert(std::make_pair(std::make_pair(p2, p0), p1));
+    }
+
+    auto findOpposite = [&halfEdges](uint32_t a, uint32_t b)
+    {
+        auto it = halfEdges.find(std::make_pair(a, b));
+        return (it == halfEdges.end()) ? uint32_t(-1) : it->second;
+    };
+
+    std::vector<uint32_t> adjIndices(2 * indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        uint32_t* pAdj = adjIndices.data() + 2 * i;
+        pAdj[0] = indices[i];
+        pAdj[1] = findOpposite(indices[i + 1], indices[i]);
+        pAdj[2] = indices[i + 1];
+        pAdj[3] = findOpposite(indices[i + 2], indices[i + 1]);
+        pAdj[4] = indices[i + 2];
+        pAdj[5] = findOpposite(indices[i], indices[i + 2]);
+    }
+    return adjIndices;
+}
+
+/** Create a grid of size x size quads, 2 triangles per quad
+*/
+static std::vector<uint32_t> createGrid(uint32_t size)
+{
+    std::vector<uint32_t> indices;
+    indices.reserve(size * size * 6);
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            uint32_t v0 = y * (size + 1) + x;
+            uint32_t v1 = v0 + 1;
+            uint32_t v2 = v0 + size + 1;
+            uint32_t v3 = v2 + 1;
+            indices.insert(indices.end(), { v0, v1, v2, v1, v3, v2 });
+        }
+    }
+    return indices;
+}
+
+testing_func(ModelImporterTest, TestAdjacencyMatchesReference)
+{
+    // Small vertex counts create plenty of duplicated and non-manifold edges
+    for (uint32_t m = 0; m < kRandomMeshCount; m++)
+    {
+        uint32_t vertexCount = 1 + rand() % 64;
+        uint32_t triangleCount = rand() % 256;
+        std::vector<uint32_t> indices(triangleCount * 3);
+        for (auto& i : indices) i = rand() % vertexCount;
+
+        if (ModelImporter::generateAdjacencyIndices(indices) != generateReferenceAdjacency(indices)) return test_fail("Adjacency doesn't match the half-edge map results");
+    }
+    return test_pass();
+}
+
+testing_func(ModelImporterTest, TestAdjacencyGrid)
+{
+    const uint32_t size = 16;
+    std::vector<uint32_t> adj = ModelImporter::generateAdjacencyIndices(createGrid(size));
+
+    // Each interior edge is shared by 2 triangles, boundary edges have no neighbor
+    uint32_t boundaryCount = 0;
+    for (size_t i = 1; i < adj.size(); i += 2)
+    {
+        if (adj[i] == uint32_t(-1)) boundaryCount++;
+    }
+    if (boundaryCount != 4 * size) return test_fail("Wrong number of boundary edges");
+    return test_pass();
+}
+
+testing_func(ModelImporterTest, BenchmarkAdjacency)
+{
+    std::vector<uint32_t> indices = createGrid(kBenchmarkGridSize);
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    std::vector<uint32_t> adj = ModelImporter::generateAdjacencyIndices(indices);
+    float hashTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // Building the half-edge map alone, which the importers used to do for every mesh
+    start = CpuTimer::getCurrentTimePoint();
+    std::unordered_map<uint64_t, uint32_t> halfEdges;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (uint32_t e = 0; e < 3; e++)
+        {
+            uint64_t key = (uint64_t(indices[i + e]) << 32) | indices[i + (e + 1) % 3];
+            halfEdges.insert(std::make_pair(key, indices[i + (e + 2) % 3]));
+        }
+    }
+    float mapTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << indices.size() / 3 << " triangles: adjacency " << hashTime << "ms, half-edge map construction " << mapTime << "ms\n";
+    if (adj.size() != indices.size() * 2) return test_fail("Wrong adjacency index count");
+    return test_pass();
+}
+
+/** Create an aiMesh with positions, normals and texture coordinates from a grid
+*/
+static aiMesh* createGridAiMesh(uint32_t size)
+{
+    std::vector<uint32_t> indices = createGrid(size);
+    aiMesh* pMesh = new aiMesh;
+    pMesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    pMesh->mNumVertices = (size + 1) * (size + 1);
+    pMesh->mVertices = new aiVector3D[pMesh->mNumVertices];
+    pMesh->mNormals = new aiVector3D[pMesh->mNumVertices];
+    pMesh->mTextureCoords[0] = new aiVector3D[pMesh->mNumVertices];
+    pMesh->mNumUVComponents[0] = 2;
+    for (uint32_t v = 0; v < pMesh->mNumVertices; v++)
+    {
+        float x = float(v % (size + 1)) / size;
+        float y = float(v / (size + 1)) / size;
+        pMesh->mVertices[v] = aiVector3D(x, y, 0);
+        pMesh->mNormals[v] = aiVector3D(0, 0, 1);
+        pMesh->mTextureCoords[0][v] = aiVector3D(x, y, 0);
+    }
+
+    pMesh->mNumFaces = (uint32_t)indices.size() / 3;
+    pMesh->mFaces = new aiFace[pMesh->mNumFaces];
+    for (uint32_t f = 0; f < pMesh->mNumFaces; f++)
+    {
+        aiFace& face = pMesh->mFaces[f];
+        face.mNumIndices = 3;
+        face.mIndices = new unsigned int[3];
+        for (uint32_t i = 0; i < 3; i++) face.mIndices[i] = indices[f * 3 + i];
+    }
+    return pMesh;
+}
+
+testing_func(ModelImporterTest, TestStagingMatchesMesh)
+{
+    const uint32_t size = 8;
+    std::unique_ptr<aiMesh> pAiMesh(createGridAiMesh(size));
+    AssimpModelImporter::MeshStagingData staging;
+    if (AssimpModelImporter::stageMesh(pAiMesh.get(), Model::LoadFlags::None, {}, staging) == false) return test_fail("Staging failed");
+
+    if (staging.indices != createGrid(size)) return test_fail("Staged indices don't match the mesh faces");
+    if (staging.topology != Vao::Topology::TriangleList) return test_fail("Wrong topology");
+    if (staging.vertexCount != pAiMesh->mNumVertices) return test_fail("Wrong vertex count");
+    if (pAiMesh->mBitangents != nullptr) return test_fail("Staging modified the aiMesh");
+
+    // Position, normal, bitangent and texcoord, each in its own buffer
+    if (staging.pLayout->getBufferCount() != 4 || staging.vertexData.size() != 4) return test_fail("Wrong vertex buffer count");
+    for (uint32_t i = 0; i < staging.pLayout->getBufferCount(); i++)
+    {
+        const auto& pVbLayout = staging.pLayout->getBufferLayout(i);
+        if (staging.vertexData[i].size() != pVbLayout->getStride() * staging.vertexCount) return test_fail("Wrong vertex buffer size");
+
+        if (pVbLayout->getElementShaderLocation(0) == VERTEX_POSITION_LOC)
+        {
+            if (memcmp(staging.vertexData[i].data(), pAiMesh->mVertices, staging.vertexData[i].size()) != 0) return test_fail("Positions weren't packed correctly");
+        }
+        if (pVbLayout->getElementShaderLocation(0) == VERTEX_BITANGENT_LOC)
+        {
+            const glm::vec3* pBitangents = (const glm::vec3*)staging.vertexData[i].data();
+            for (uint32_t v = 0; v < staging.vertexCount; v++)
+            {
+                if (glm::length(pBitangents[v]) == 0) return test_fail("Bitangents weren't generated");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(ModelImporterTest, TestStagingAdjacency)
+{
+    std::unique_ptr<aiMesh> pAiMesh(createGridAiMesh(8));
+    AssimpModelImporter::MeshStagingData staging;
+    if (AssimpModelImporter::stageMesh(pAiMesh.get(), Model::LoadFlags::GenerateAdjacency, {}, staging) == false) return test_fail("Staging failed");
+    if (staging.topology != Vao::Topology::TriangleListAdj) return test_fail("Wrong topology");
+    if (staging.indices != ModelImporter::generateAdjacencyIndices(createGrid(8))) return test_fail("Wrong adjacency indices");
+    return test_pass();
+}
+
+testing_func(ModelImporterTest, BenchmarkStaging)
+{
+    aiScene scene;
+    scene.mNumMeshes = kBenchmarkMeshCount;
+    scene.mMeshes = new aiMesh*[kBenchmarkMeshCount];
+    for (uint32_t m = 0; m < kBenchmarkMeshCount; m++) scene.mMeshes[m] = createGridAiMesh(kBenchmarkMeshGridSize);
+
+    // The importer used to process the meshes one after the other
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    std::vector<AssimpModelImporter::MeshStagingData> serial(kBenchmarkMeshCount);
+    for (uint32_t m = 0; m < kBenchmarkMeshCount; m++)
+    {
+        AssimpModelImporter::stageMesh(scene.mMeshes[m], Model::LoadFlags::None, {}, serial[m]);
+    }
+    float serialTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    start = CpuTimer::getCurrentTimePoint();
+    std::vector<AssimpModelImporter::MeshStagingData> parallel;
+    bool success = AssimpModelImporter::stageMeshes(&scene, Model::LoadFlags::None, {}, parallel);
+    float parallelTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << kBenchmarkMeshCount << " meshes: serial staging " << serialTime << "ms, parallel staging " << parallelTime << "ms\n";
+    if (success == false) return test_fail("Staging failed");
+    for (uint32_t m = 0; m < kBenchmarkMeshCount; m++)
+    {
+        if (parallel[m].indices != serial[m].indices || parallel[m].vertexData != serial[m].vertexData) return test_fail("Parallel staging doesn't match serial staging");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    ModelImporterTest mit;
+    mit.init();
+    mit.run();
+    return 0;
+}
@@ -0,0 +1,132 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ParameterBlockTest.h"
+
+static const uint32_t kBenchmarkSetCount = 1000000;
+
+void ParameterBlockTest::addTests()
+{
+    addTestToList<TestHandleMatchesName>();
+    addTestToList<TestStaleHandle>();
+    addTestToList<BenchmarkHandleSets>();
+}
+
+static GraphicsVars::SharedPtr createVars(const GraphicsProgram::SharedPtr& pProgram)
+{
+    return GraphicsVars::create(pProgram->getActiveVersion()->getReflector());
+}
+
+testing_func(ParameterBlockTest, TestHandleMatchesName)
+{
+    GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("ParameterBlockTest.ps.hlsl", "", "main");
+    GraphicsVars::SharedPtr pVars = createVars(pProgram);
+    const ParameterBlock::SharedPtr& pBlock = pVars->getDefaultBlock();
+    ConstantBuffer::SharedPtr pCB = pVars->getConstantBuffer("gMaterial");
+
+    using HandleType = ParameterBlock::VarHandle::Type;
+    ParameterBlock::VarHandle baseColor = pBlock->getHandle("gMaterial.baseColor");
+    ParameterBlock::VarHandle roughness = pBlock->getHandle("gMaterial.roughness");
+    if (baseColor.type != HandleType::Variable || baseColor.varType != ReflectionBasicType::Type::Float4) return test_fail("Wrong type tag for gMaterial.baseColor");
+    if (baseColor.offset != pCB->getVariableOffset("baseColor")) return test_fail("Handle offset doesn't match the offset found by name");
+    if (roughness.offset != pCB->getVariableOffset("roughness")) return test_fail("Handle offset doesn't match the offset found by name");
+    if (pBlock->getHandle("gMaterial").type != HandleType::ConstantBuffer) return test_fail("Wrong type tag for gMaterial");
+    if (pBlock->getHandle("gMaterial.doesNotExist").isValid()) return test_fail("Handle to a missing variable should be invalid");
+
+    if (pBlock->setVariable(baseColor, vec4(1, 2, 3, 4)) == false) return test_fail("Can't set a variable using a handle");
+    if (pBlock->setVariable(baseColor, 1.0f)) return test_fail("Setting a value with the wrong type should fail");
+
+    ParameterBlock::VarHandle texture = pBlock->getHandle("gTexture");
+    ParameterBlock::VarHandle sampler = pBlock->getHandle("gSampler");
+    if (texture.type != HandleType::Texture || sampler.type != HandleType::Sampler) return test_fail("Wrong type tag for a resource");
+
+    Texture::SharedPtr pTexture = Texture::create2D(1, 1, ResourceFormat::RGBA8Unorm, 1, 1);
+    Sampler::SharedPtr pSampler = Sampler::create(Sampler::Desc());
+    if (pBlock->setTexture(texture, pTexture) == false || pBlock->getTexture("gTexture") != pTexture) return test_fail("Can't set a texture using a handle");
+    if (pBlock->setSampler(sampler, pSampler) == false || pBlock->getSampler("gSampler") != pSampler) return test_fail("Can't set a sampler using a handle");
+    if (pBlock->setTexture(sampler, pTexture)) return test_fail("Setting a texture using a sampler handle should fail");
+    return test_pass();
+}
+
+testing_func(ParameterBlockTest, TestStaleHandle)
+{
+    GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("ParameterBlockTest.ps.hlsl", "", "main");
+    GraphicsVars::SharedPtr pVars = createVars(pProgram);
+    ParameterBlock::VarHandle roughness = pVars->getDefaultBlock()->getHandle("gMaterial.roughness");
+
+    // Vars created from the same program version share the reflection, so the handle can be used with both
+    GraphicsVars::SharedPtr pOtherVars = createVars(pProgram);
+    if (pOtherVars->getDefaultBlock()->setVariable(roughness, 0.5f) == false) return test_fail("Handle should be valid for vars created from the same program version");
+
+    // Changing the program version invalidates the handle
+    pProgram->addDefine("_USE_EMISSIVE");
+    GraphicsVars::SharedPtr pNewVars = createVars(pProgram);
+    const ParameterBlock::SharedPtr& pNewBlock = pNewVars->getDefaultBlock();
+    if (pNewBlock->isHandleCompatible(roughness)) return test_fail("Handle should be rejected after the program version changed");
+    if (pNewBlock->setVariable(roughness, 0.5f)) return test_fail("Setting a variable with a stale handle should fail");
+
+    roughness = pNewBlock->getHandle("gMaterial.roughness");
+    if (pNewBlock->setVariable(roughness, 0.5f) == false) return test_fail("Re-resolved handle should be valid");
+    return test_pass();
+}
+
+testing_func(ParameterBlockTest, BenchmarkHandleSets)
+{
+    GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("ParameterBlockTest.ps.hlsl", "", "main");
+    GraphicsVars::SharedPtr pVars = createVars(pProgram);
+    const ParameterBlock::SharedPtr& pBlock = pVars->getDefaultBlock();
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kBenchmarkSetCount; i++)
+    {
+        ConstantBuffer::SharedPtr pCB = pVars->getConstantBuffer("gMaterial");
+        pCB->setVariable("baseColor", vec4((float)i));
+        pCB->setVariable("roughness", (float)i);
+    }
+    float nameTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    ParameterBlock::VarHandle baseColor = pBlock->getHandle("gMaterial.baseColor");
+    ParameterBlock::VarHandle roughness = pBlock->getHandle("gMaterial.roughness");
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kBenchmarkSetCount; i++)
+    {
+        pBlock->setVariable(baseColor, vec4((float)i));
+        pBlock->setVariable(roughness, (float)i);
+    }
+    float handleTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << 2 * kBenchmarkSetCount << " sets: by name " << nameTime << "ms, by handle " << handleTime << "ms\n";
+    return test_pass();
+}
+
+int main()
+{
+    ParameterBlockTest pbt;
+    pbt.init(true);
+    pbt.run();
+    return 0;
+}
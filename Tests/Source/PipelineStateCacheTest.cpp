@@ -0,0 +1,304 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "PipelineStateCacheTest.h"
+#include "API/PipelineStateCache.h"
+#include <fstream>
+
+static const uint32_t kBenchmarkStateCount = 1000;
+
+void PipelineStateCacheTest::addTests()
+{
+    addTestToList<TestGraphicsStateKey>();
+    addTestToList<TestComputeStateKey>();
+    addTestToList<TestLookup>();
+    addTestToList<TestPruning>();
+    addTestToList<TestPersistence>();
+    addTestToList<TestCorruptedFile>();
+    addTestToList<BenchmarkLookup>();
+}
+
+/** Stands in for a state object, the cache doesn't need the device
+*/
+struct FakeStateObject
+{
+    uint32_t id;
+};
+
+static PipelineStateKey createKey(uint32_t id)
+{
+    PipelineStateKey key;
+    return key.add(std::string("FakeState")).add(id);
+}
+
+/** Returns a factory which counts the calls, records the blob it received and returns a blob derived from the ID
+*/
+static PipelineStateCache::Factory createFactory(uint32_t id, uint32_t& calls, std::vector<uint8_t>& receivedBlob)
+{
+    return [id, &calls, &receivedBlob](const std::vector<uint8_t>& cachedBlob, std::vector<uint8_t>& newBlob) -> std::shared_ptr<void>
+    {
+        calls++;
+        receivedBlob = cachedBlob;
+        newBlob.assign(16 + id % 16, uint8_t(id));
+        return std::make_shared<FakeStateObject>(FakeStateObject{ id });
+    };
+}
+
+static GraphicsStateObject::Desc createGraphicsDesc(RasterizerState::CullMode cullMode)
+{
+    GraphicsStateObject::Desc desc;
+    desc.setRasterizerState(RasterizerState::create(RasterizerState::Desc().setCullMode(cullMode)));
+    desc.setDepthStencilState(DepthStencilState::create(DepthStencilState::Desc().setDepthFunc(DepthStencilState::Func::LessEqual)));
+    desc.setBlendState(BlendState::create(BlendState::Desc().setRtBlend(0, true)));
+    desc.setFboFormats(Fbo::Desc().setColorTarget(0, ResourceFormat::RGBA8Unorm).setDepthStencilTarget(ResourceFormat::D32Float));
+    desc.setPrimitiveType(GraphicsStateObject::PrimitiveType::Triangle);
+    return desc;
+}
+
+testing_func(PipelineStateCacheTest, TestGraphicsStateKey)
+{
+    // Identical states created separately, like two passes would, must have the same key
+    PipelineStateKey key = PipelineStateKey::create(createGraphicsDesc(RasterizerState::CullMode::Back));
+    PipelineStateKey sameKey = PipelineStateKey::create(createGraphicsDesc(RasterizerState::CullMode::Back));
+    if (key != sameKey || key.getHash() != sameKey.getHash()) return test_fail("Identical graphics states have different keys");
+
+    if (PipelineStateKey::create(createGraphicsDesc(RasterizerState::CullMode::None)) == key) return test_fail("Different rasterizer states have the same key");
+
+    GraphicsStateObject::Desc desc = createGraphicsDesc(RasterizerState::CullMode::Back);
+    desc.setFboFormats(Fbo::Desc().setColorTarget(0, ResourceFormat::RGBA16Float).setDepthStencilTarget(ResourceFormat::D32Float));
+    if (PipelineStateKey::create(desc) == key) return test_fail("Different render-target formats have the same key");
+
+    desc = createGraphicsDesc(RasterizerState::CullMode::Back);
+    desc.setSampleMask(0xf);
+    if (PipelineStateKey::create(desc) == key) return test_fail("Different sample masks have the same key");
+
+    desc = createGraphicsDesc(RasterizerState::CullMode::Back);
+    desc.setBlendState(BlendState::create(BlendState::Desc().setRtBlend(0, true).setRenderTargetWriteMask(0, true, true, true, false)));
+    if (PipelineStateKey::create(desc) == key) return test_fail("Different blend states have the same key");
+    return test_pass();
+}
+
+testing_func(PipelineStateCacheTest, TestComputeStateKey)
+{
+    PipelineStateKey key = PipelineStateKey::create(ComputeStateObject::Desc());
+    if (key != PipelineStateKey::create(ComputeStateObject::Desc())) return test_fail("Identical compute states have different keys");
+    if (key == PipelineStateKey::create(GraphicsStateObject::Desc())) return test_fail("A compute state and a graphics state have the same key");
+
+    // The order of the values is part of the key
+    PipelineStateKey a, b;
+    a.add(uint32_t(1)).add(uint32_t(2));
+    b.add(uint32_t(2)).add(uint32_t(1));
+    if (a == b || a.getHash() == b.getHash()) return test_fail("Keys with swapped values are equal");
+    return test_pass();
+}
+
+testing_func(PipelineStateCacheTest, TestLookup)
+{
+    PipelineStateCache& cache = PipelineStateCache::instance();
+    cache.clear();
+    cache.resetStats();
+
+    uint32_t calls = 0;
+    std::vector<uint8_t> receivedBlob;
+    auto pObject = cache.findOrCreate(createKey(1), createFactory(1, calls, receivedBlob));
+    if (pObject == nullptr || calls != 1 || receivedBlob.size()) return test_fail("A new state wasn't created");
+    if (cache.findOrCreate(createKey(1), createFactory(1, calls, receivedBlob)) != pObject || calls != 1) return test_fail("An existing state was created again");
+    if (cache.findOrCreate(createKey(2), createFactory(2, calls, receivedBlob)) == pObject || calls != 2) return test_fail("A different key returned the same state");
+
+    // The cache only holds weak references. A released state is created again, using its driver blob.
+    pObject = nullptr;
+    pObject = cache.findOrCreate(createKey(1), createFactory(1, calls, receivedBlob));
+    if (calls != 3 || receivedBlob != std::vector<uint8_t>(17, 1)) return test_fail("A released state wasn't created from its blob");
+
+    // A failing factory doesn't add anything
+    auto nullFactory = [](const std::vector<uint8_t>&, std::vector<uint8_t>&) { return std::shared_ptr<void>(); };
+    if (cache.findOrCreate(createKey(3), nullFactory) != nullptr) return test_fail("A failed creation returned an object");
+
+    PipelineStateCache::Stats stats = cache.getStats();
+    if (stats.hits != 1 || stats.misses != 3 || stats.blobHits != 1 || stats.entryCount != 2) return test_fail("Wrong statistics");
+    cache.clear();
+    return test_pass();
+}
+
+testing_func(PipelineStateCacheTest, TestPruning)
+{
+    PipelineStateCache& cache = PipelineStateCache::instance();
+    cache.clear();
+
+    // A live state without a blob and a released state with a blob must survive the pruning
+    uint32_t calls = 0;
+    std::vector<uint8_t> receivedBlob;
+    auto blobless = [&calls](const std::vector<uint8_t>&, std::vector<uint8_t>&) -> std::shared_ptr<void>
+    {
+        calls++;
+        return std::make_shared<FakeStateObject>(FakeStateObject{ 0 });
+    };
+    auto pLive = cache.findOrCreate(createKey(0), blobless);
+    cache.findOrCreate(createKey(1), createFactory(1, calls, receivedBlob));
+
+    // Released states without a blob can't be restored, their entries must not accumulate
+    const uint32_t kKeyCount = 10000;
+    for (uint32_t i = 2; i < kKeyCount; i++) cache.findOrCreate(createKey(i), blobless);
+    size_t entryCount = cache.getStats().entryCount;
+
+    calls = 0;
+    bool liveFound = cache.findOrCreate(createKey(0), blobless) == pLive && calls == 0;
+    cache.findOrCreate(createKey(1), createFactory(1, calls, receivedBlob));
+    bool blobFound = receivedBlob == std::vector<uint8_t>(17, 1);
+    cache.clear();
+
+    if (entryCount >= kKeyCount / 2) return test_fail("Released entries without a blob weren't pruned");
+    if (liveFound == false) return test_fail("A live state was pruned");
+    if (blobFound == false) return test_fail("An entry with a blob was pruned");
+    return test_pass();
+}
+
+testing_func(PipelineStateCacheTest, TestPersistence)
+{
+    PipelineStateCache& cache = PipelineStateCache::instance();
+    cache.clear();
+
+    uint32_t calls = 0;
+    std::vector<uint8_t> receivedBlob;
+    std::vector<std::shared_ptr<void>> objects;
+    for (uint32_t i = 0; i < 100; i++) objects.push_back(cache.findOrCreate(createKey(i), createFactory(i, calls, receivedBlob)));
+
+    std::string filename = getTempFilename();
+    if (cache.save(filename) == false) return test_fail("Can't save the cache");
+    objects.clear();
+    cache.clear();
+    cache.resetStats();
+
+    // Simulate the next run
+    if (cache.load(filename) == false) return test_fail("Can't load the cache");
+    bool success = cache.getStats().entryCount == 100;
+    for (uint32_t i = 0; i < 100 && success; i++)
+    {
+        cache.findOrCreate(createKey(i), createFactory(i, calls, receivedBlob));
+        success = receivedBlob == std::vector<uint8_t>(16 + i % 16, uint8_t(i));
+    }
+    success = success && cache.getStats().blobHits == 100;
+
+    // Loading the same file again doesn't add entries
+    success = success && cache.load(filename) && cache.getStats().entryCount == 100;
+    std::remove(filename.c_str());
+    cache.clear();
+    return success ? test_pass() : test_fail("The loaded blobs don't match the saved ones");
+}
+
+testing_func(PipelineStateCacheTest, TestCorruptedFile)
+{
+    PipelineStateCache& cache = PipelineStateCache::instance();
+    cache.clear();
+
+    uint32_t calls = 0;
+    std::vector<uint8_t> receivedBlob;
+    std::vector<std::shared_ptr<void>> objects;
+    for (uint32_t i = 0; i < 10; i++) objects.push_back(cache.findOrCreate(createKey(i), createFactory(i, calls, receivedBlob)));
+    std::string filename = getTempFilename();
+    cache.save(filename);
+    objects.clear();
+    cache.clear();
+
+    std::vector<char> data;
+    {
+        std::ifstream in(filename, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // Every truncation must be rejected without adding entries
+    bool success = data.size() > 16;
+    for (size_t size = 0; size < data.size() && success; size++)
+    {
+        std::ofstream(filename, std::ios::binary | std::ios::trunc).write(data.data(), size);
+        success = cache.load(filename) == false && cache.getStats().entryCount == 0;
+    }
+
+    // Huge sizes must not be allocated
+    std::vector<char> corrupted = data;
+    memset(corrupted.data() + 16, 0xff, 8);
+    std::ofstream(filename, std::ios::binary | std::ios::trunc).write(corrupted.data(), corrupted.size());
+    success = success && cache.load(filename) == false;
+
+    success = success && cache.load(filename + ".missing") == false;
+    std::remove(filename.c_str());
+    cache.clear();
+    return success ? test_pass() : test_fail("A corrupted file was accepted");
+}
+
+testing_func(PipelineStateCacheTest, BenchmarkLookup)
+{
+    PipelineStateCache& cache = PipelineStateCache::instance();
+    cache.clear();
+
+    uint32_t calls = 0;
+    std::vector<uint8_t> receivedBlob;
+    std::vector<std::shared_ptr<void>> objects;
+    std::vector<PipelineStateKey> keys;
+    for (uint32_t i = 0; i < kBenchmarkStateCount; i++)
+    {
+        keys.push_back(PipelineStateKey::create(createGraphicsDesc(RasterizerState::CullMode::Back)).add(i));
+        objects.push_back(cache.findOrCreate(keys.back(), createFactory(i, calls, receivedBlob)));
+    }
+
+    // Compare with a linear scan over the states, like the per-state graphs did
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    bool success = true;
+    for (const auto& key : keys)
+    {
+        success = success && cache.findOrCreate(key, createFactory(0, calls, receivedBlob)) != nullptr;
+    }
+    float cacheTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    start = CpuTimer::getCurrentTimePoint();
+    size_t found = 0;
+    for (const auto& key : keys)
+    {
+        for (const auto& other : keys)
+        {
+            if (key == other)
+            {
+                found++;
+                break;
+            }
+        }
+    }
+    float scanTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << kBenchmarkStateCount << " lookups: cache " << cacheTime << "ms, linear scan " << scanTime << "ms\n";
+    success = success && calls == kBenchmarkStateCount && found == keys.size();
+    cache.clear();
+    return success ? test_pass() : test_fail("Lookups created new states");
+}
+
+int main()
+{
+    PipelineStateCacheTest psct;
+    psct.init();
+    psct.run();
+    return 0;
+}
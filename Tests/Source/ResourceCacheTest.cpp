@@ -0,0 +1,136 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ResourceCacheTest.h"
+
+using ResourceLifetime = ResourceCache::ResourceLifetime;
+
+static const uint32_t kRandomGraphCount = 100;
+static const uint32_t kMaxPassCount = 32;
+static const uint32_t kMaxResourceCount = 64;
+static const uint32_t kDescCount = 4;
+
+void ResourceCacheTest::addTests()
+{
+    addTestToList<TestPackingNeverOverlaps>();
+    addTestToList<TestDeferredGraph>();
+}
+
+/** Check that resources sharing an allocation have the same description, don't overlap and that non-transient resources are alone
+*/
+static std::string validatePacking(const std::vector<ResourceLifetime>& lifetimes, const std::vector<uint32_t>& allocations, uint32_t allocationCount)
+{
+    for (size_t a = 0; a < lifetimes.size(); a++)
+    {
+        if (allocations[a] >= allocationCount) return "Allocation index out of range";
+        for (size_t b = a + 1; b < lifetimes.size(); b++)
+        {
+            if (allocations[a] != allocations[b]) continue;
+            if (lifetimes[a].transient == false || lifetimes[b].transient == false) return "Non-transient resource shares an allocation";
+            if (lifetimes[a].descIndex != lifetimes[b].descIndex) return "Resources with different descriptions share an allocation";
+            bool overlap = lifetimes[a].firstUsed <= lifetimes[b].lastUsed && lifetimes[b].firstUsed <= lifetimes[a].lastUsed;
+            if (overlap) return "Resources with overlapping lifetimes share an allocation";
+        }
+    }
+    return "";
+}
+
+testing_func(ResourceCacheTest, TestPackingNeverOverlaps)
+{
+    for (uint32_t g = 0; g < kRandomGraphCount; g++)
+    {
+        uint32_t passCount = 1 + rand() % kMaxPassCount;
+        uint32_t resourceCount = 1 + rand() % kMaxResourceCount;
+        std::vector<ResourceLifetime> lifetimes(resourceCount);
+        for (auto& lifetime : lifetimes)
+        {
+            lifetime.firstUsed = rand() % passCount;
+            lifetime.lastUsed = lifetime.firstUsed + rand() % (passCount - lifetime.firstUsed);
+            lifetime.descIndex = rand() % kDescCount;
+            lifetime.transient = (rand() % 8) != 0;
+        }
+
+        uint32_t allocationCount;
+        std::vector<uint32_t> allocations = ResourceCache::packResources(lifetimes, allocationCount);
+        std::string error = validatePacking(lifetimes, allocations, allocationCount);
+        if (error.size()) return test_fail(error);
+
+        // The packing is optimal when each description uses as many allocations as its peak number of live resources
+        uint32_t expectedCount = 0;
+        for (uint32_t d = 0; d < kDescCount; d++)
+        {
+            uint32_t peak = 0;
+            for (uint32_t t = 0; t < passCount; t++)
+            {
+                uint32_t live = 0;
+                for (const auto& lifetime : lifetimes)
+                {
+                    if (lifetime.transient && lifetime.descIndex == d && lifetime.firstUsed <= t && t <= lifetime.lastUsed) live++;
+                }
+                peak = std::max(peak, live);
+            }
+            expectedCount += peak;
+        }
+        for (const auto& lifetime : lifetimes) expectedCount += lifetime.transient ? 0 : 1;
+        if (allocationCount != expectedCount) return test_fail("Packing doesn't use the minimal number of allocations");
+    }
+    return test_pass();
+}
+
+testing_func(ResourceCacheTest, TestDeferredGraph)
+{
+    // GBuffer -> Lighting -> SSAO -> Composite -> ToneMapping, with the tone-mapped result being the graph output
+    const uint32_t kColor = 0;
+    const uint32_t kDepth = 1;
+    std::vector<ResourceLifetime> lifetimes =
+    {
+        { 0, 1, kColor, true },             // GBuffer.albedo, read by Lighting
+        { 0, 1, kColor, true },             // GBuffer.normals, read by Lighting
+        { 0, 2, kDepth, true },             // GBuffer.depth, read by Lighting and SSAO
+        { 1, 3, kColor, true },             // Lighting.color, read by Composite
+        { 2, 3, kColor, true },             // SSAO.ao, read by Composite
+        { 3, 4, kColor, true },             // Composite.color, read by ToneMapping
+        { 4, uint32_t(-1), kColor, false }, // ToneMapping.dst, graph output
+    };
+
+    uint32_t allocationCount;
+    std::vector<uint32_t> allocations = ResourceCache::packResources(lifetimes, allocationCount);
+    std::string error = validatePacking(lifetimes, allocations, allocationCount);
+    if (error.size()) return test_fail(error);
+
+    // At most 3 color targets are live at the same time, plus the depth buffer and the graph output
+    if (allocationCount != 5) return test_fail("Expected 5 allocations, got " + std::to_string(allocationCount));
+    return test_pass();
+}
+
+int main()
+{
+    ResourceCacheTest rct;
+    rct.init();
+    rct.run();
+    return 0;
+}
@@ -0,0 +1,171 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "SceneBvhTest.h"
+#include "Graphics/Scene/SceneBvh.h"
+
+static const uint32_t kLeafCount = 5000;
+static const uint32_t kCameraCount = 16;
+
+static float randomFloat(float minVal, float maxVal)
+{
+    return minVal + (maxVal - minVal) * (float(rand()) / float(RAND_MAX));
+}
+
+static glm::vec3 randomVec3(float minVal, float maxVal)
+{
+    return glm::vec3(randomFloat(minVal, maxVal), randomFloat(minVal, maxVal), randomFloat(minVal, maxVal));
+}
+
+static BoundingBox randomBox()
+{
+    glm::vec3 center = randomVec3(-100, 100);
+    glm::vec3 extent = randomVec3(0.1f, 5);
+    return BoundingBox::fromMinMax(center - extent, center + extent);
+}
+
+static Camera::SharedPtr randomCamera()
+{
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setPosition(randomVec3(-120, 120));
+    pCamera->setTarget(randomVec3(-50, 50));
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+    pCamera->setAspectRatio(randomFloat(0.5f, 2));
+    pCamera->setDepthRange(0.1f, randomFloat(50, 300));
+    return pCamera;
+}
+
+// Compares the hierarchy's visibility against the per-mesh test SceneRenderer::cullMeshInstance() uses when there's no hierarchy
+static bool compareWithBruteForce(const SceneBvh* pBvh, const std::vector<BoundingBox>& boxes, uint32_t& visibleCount, std::string& error)
+{
+    std::vector<uint8_t> visibility;
+    visibleCount = 0;
+    for (uint32_t c = 0; c < kCameraCount; c++)
+    {
+        Camera::SharedPtr pCamera = randomCamera();
+        glm::vec4 planes[6];
+        pCamera->getFrustumPlanes(planes);
+        pBvh->cull(planes, visibility);
+
+        if (visibility.size() != boxes.size())
+        {
+            error = "cull() returned " + std::to_string(visibility.size()) + " leaves, expected " + std::to_string(boxes.size());
+            return false;
+        }
+
+        for (uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+        {
+            bool visible = (pCamera->isObjectCulled(boxes[i]) == false);
+            if ((visibility[i] != 0) != visible)
+            {
+                error = "Leaf " + std::to_string(i) + " is " + (visible ? "visible" : "culled") + " but the hierarchy " + (visible ? "culled" : "didn't cull") + " it";
+                return false;
+            }
+            visibleCount += visible ? 1 : 0;
+        }
+    }
+    return true;
+}
+
+// Makes sure the random cameras exercise both outcomes
+static bool isCoverageValid(uint32_t visibleCount, uint32_t leafCount)
+{
+    return (visibleCount > 0) && (visibleCount < kCameraCount * leafCount);
+}
+
+void SceneBvhTest::addTests()
+{
+    addTestToList<TestBuildAndCull>();
+    addTestToList<TestRefitAndCull>();
+}
+
+testing_func(SceneBvhTest, TestBuildAndCull)
+{
+    srand(1);
+    SceneBvh::SharedPtr pBvh = SceneBvh::create();
+
+    // An empty hierarchy culls nothing and reports no leaves
+    std::vector<BoundingBox> boxes;
+    pBvh->build(boxes);
+    std::vector<uint8_t> visibility(3, 1);
+    glm::vec4 planes[6];
+    randomCamera()->getFrustumPlanes(planes);
+    pBvh->cull(planes, visibility);
+    if (visibility.empty() == false) return test_fail("Culling an empty hierarchy returned leaves");
+
+    // Leaf counts around the node width exercise partially filled nodes
+    for (uint32_t leafCount : { 1u, 3u, 4u, 5u, 17u, kLeafCount })
+    {
+        boxes.resize(leafCount);
+        for (auto& box : boxes) box = randomBox();
+        pBvh->build(boxes);
+        if (pBvh->getLeafCount() != leafCount) return test_fail("Wrong leaf count after build()");
+
+        uint32_t visibleCount;
+        std::string error;
+        if (compareWithBruteForce(pBvh.get(), boxes, visibleCount, error) == false) return test_fail(error + " (" + std::to_string(leafCount) + " leaves)");
+        if (leafCount == kLeafCount && isCoverageValid(visibleCount, leafCount) == false) return test_fail("The random cameras didn't produce both visible and culled leaves");
+    }
+    return test_pass();
+}
+
+testing_func(SceneBvhTest, TestRefitAndCull)
+{
+    srand(2);
+    std::vector<BoundingBox> boxes(kLeafCount);
+    for (auto& box : boxes) box = randomBox();
+    SceneBvh::SharedPtr pBvh = SceneBvh::create();
+    pBvh->build(boxes);
+
+    // Move a subset of the leaves, including large moves that break the spatial coherence of the tree
+    for (uint32_t iteration = 0; iteration < 4; iteration++)
+    {
+        for (uint32_t i = 0; i < kLeafCount; i++)
+        {
+            if (rand() % 3) continue;
+            BoundingBox& box = boxes[i];
+            glm::vec3 offset = randomVec3(-2, 2);
+            box = (iteration % 2) ? randomBox() : BoundingBox::fromMinMax(box.getMinPos() + offset, box.getMaxPos() + offset + randomVec3(0, 1));
+            pBvh->setLeafBounds(i, box);
+        }
+        pBvh->refit();
+
+        uint32_t visibleCount;
+        std::string error;
+        if (compareWithBruteForce(pBvh.get(), boxes, visibleCount, error) == false) return test_fail(error + " (refit iteration " + std::to_string(iteration) + ")");
+        if (isCoverageValid(visibleCount, kLeafCount) == false) return test_fail("The random cameras didn't produce both visible and culled leaves");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    SceneBvhTest sbt;
+    sbt.init();
+    sbt.run();
+    return 0;
+}
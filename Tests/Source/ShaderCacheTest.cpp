@@ -0,0 +1,224 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ShaderCacheTest.h"
+#include "Graphics/Program/ShaderCache.h"
+#include <fstream>
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+
+/** Builds a key the way Program does, with one line per compilation input
+*/
+static std::string makeKey(const std::string& profile, const std::string& define)
+{
+    return "Version 1\nProfile " + profile + "\nFile /shaders/Test.slang\nEntryPoint 1 0 main\nDefine " + define + "\n";
+}
+
+static void writeFile(const std::string& filename, const std::string& content)
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file << content;
+}
+
+static std::vector<uint8_t> readFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string& filename, const std::vector<uint8_t>& data, size_t size)
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write((const char*)data.data(), size);
+}
+
+/** Returns the entries in the cache directory
+*/
+static std::vector<std::string> getEntryFiles()
+{
+    std::vector<std::string> files;
+    for (const auto& file : fs::directory_iterator(ShaderCache::getDirectory()))
+    {
+        if (file.path().extension() == ".fsc") files.push_back(file.path().string());
+    }
+    return files;
+}
+
+static ShaderCache::Entry createEntry(const std::string& dependency)
+{
+    ShaderCache::Entry entry;
+    entry.dependencies.push_back({ dependency, ShaderCache::hashFile(dependency) });
+    entry.code.resize(3);
+    entry.code[0] = { 1, 2, 3, 4 };
+    entry.code[2] = std::vector<uint8_t>(1000, 0xCD);
+    entry.reflection.push_back({ 5, 6, 7 });
+    entry.reflection.push_back({});
+    return entry;
+}
+
+void ShaderCacheTest::addTests()
+{
+    addTestToList<TestKeyStability>();
+    addTestToList<TestKeyChanges>();
+    addTestToList<TestDependencyChanges>();
+    addTestToList<TestRoundTrip>();
+    addTestToList<TestRejectCorrupted>();
+}
+
+void ShaderCacheTest::onInit()
+{
+    // Use an empty directory, so the tests can find the entries they wrote
+    std::string directory = getTempFilename();
+    std::remove(directory.c_str());
+    createDirectory(directory);
+    ShaderCache::setDirectory(directory);
+}
+
+testing_func(ShaderCacheTest, TestKeyStability)
+{
+    // Entry filenames are FNV-1a hashes of the key, they must not change between runs or builds
+    if (ShaderCache::hash("", 0) != 0xcbf29ce484222325ull) return test_fail("Wrong hash for an empty key");
+    if (ShaderCache::hash("a", 1) != 0xaf63dc4c8601ec8cull) return test_fail("Wrong hash for 'a'");
+
+    std::string include = getTempFilename();
+    writeFile(include, "float4 f() { return 1; }");
+    ShaderCache::store(makeKey("ps_5_0", "A=1"), createEntry(include));
+
+    // An identical key built again finds the entry
+    ShaderCache::Entry entry;
+    if (ShaderCache::load(makeKey("ps_5_0", "A=1"), entry) == false) return test_fail("An identical key didn't find the entry");
+    std::remove(include.c_str());
+    return test_pass();
+}
+
+testing_func(ShaderCacheTest, TestKeyChanges)
+{
+    std::string include = getTempFilename();
+    writeFile(include, "float4 f() { return 2; }");
+    const std::string key = makeKey("ps_5_0", "B=1");
+    ShaderCache::store(key, createEntry(include));
+
+    ShaderCache::Entry entry;
+    if (ShaderCache::load(key, entry) == false) return test_fail("The stored entry wasn't found");
+    if (ShaderCache::load(makeKey("ps_5_0", "B=2"), entry)) return test_fail("Changing a define didn't change the key");
+    if (ShaderCache::load(makeKey("ps_6_0", "B=1"), entry)) return test_fail("Changing the target didn't change the key");
+    if (ShaderCache::load(key.substr(0, key.size() - 1), entry)) return test_fail("A prefix of the key found the entry");
+    std::remove(include.c_str());
+    return test_pass();
+}
+
+testing_func(ShaderCacheTest, TestDependencyChanges)
+{
+    const std::string original = "float4 f() { return 3; }";
+    std::string include = getTempFilename();
+    writeFile(include, original);
+    const std::string key = makeKey("ps_5_0", "C=1");
+    ShaderCache::store(key, createEntry(include));
+
+    ShaderCache::Entry entry;
+    if (ShaderCache::load(key, entry) == false) return test_fail("The stored entry wasn't found");
+
+    // Changing the include invalidates the entry. The file can be rewritten within the modification time resolution, so its size changes as well
+    writeFile(include, "float4 f() { return 42; }");
+    if (ShaderCache::load(key, entry)) return test_fail("Changing an include's content didn't invalidate the entry");
+
+    // Only the content matters, not the modification time
+    writeFile(include, original);
+    if (ShaderCache::load(key, entry) == false) return test_fail("Restoring the include's content didn't validate the entry");
+
+    std::remove(include.c_str());
+    if (ShaderCache::load(key, entry)) return test_fail("Deleting an include didn't invalidate the entry");
+    return test_pass();
+}
+
+testing_func(ShaderCacheTest, TestRoundTrip)
+{
+    std::string include = getTempFilename();
+    writeFile(include, "float4 f() { return 4; }");
+    const std::string key = makeKey("ps_5_0", "D=1");
+    const ShaderCache::Entry stored = createEntry(include);
+    ShaderCache::store(key, stored);
+
+    // Replacing an entry overwrites it
+    ShaderCache::Entry replaced = stored;
+    replaced.code[1] = { 9, 9 };
+    ShaderCache::store(key, replaced);
+
+    ShaderCache::Entry loaded;
+    if (ShaderCache::load(key, loaded) == false) return test_fail("The stored entry wasn't found");
+    if (loaded.dependencies.size() != 1 || loaded.dependencies[0].path != include || loaded.dependencies[0].hash != stored.dependencies[0].hash) return test_fail("Dependencies don't match");
+    if (loaded.code != replaced.code) return test_fail("Code doesn't match");
+    if (loaded.reflection != replaced.reflection) return test_fail("Reflection data doesn't match");
+    std::remove(include.c_str());
+    return test_pass();
+}
+
+testing_func(ShaderCacheTest, TestRejectCorrupted)
+{
+    for (const auto& file : getEntryFiles()) std::remove(file.c_str());
+
+    std::string include = getTempFilename();
+    writeFile(include, "float4 f() { return 5; }");
+    const std::string key = makeKey("ps_5_0", "E=1");
+    ShaderCache::store(key, createEntry(include));
+
+    std::vector<std::string> files = getEntryFiles();
+    if (files.size() != 1) return test_fail("Expected a single entry file, found " + std::to_string(files.size()));
+    const std::vector<uint8_t> data = readFile(files[0]);
+
+    ShaderCache::Entry entry;
+    if (ShaderCache::load(key, entry) == false) return test_fail("The stored entry wasn't found");
+
+    // Truncated entries, as left behind by a crash while writing
+    for (size_t size = 0; size < data.size(); size += (size < 64) ? 1 : 97)
+    {
+        writeFile(files[0], data, size);
+        if (ShaderCache::load(key, entry)) return test_fail("An entry truncated to " + std::to_string(size) + " bytes was accepted");
+    }
+
+    // Single corrupted bytes anywhere in the file
+    for (size_t offset = 0; offset < data.size(); offset += (offset < 64) ? 1 : 31)
+    {
+        std::vector<uint8_t> corrupted = data;
+        corrupted[offset] ^= 0x5A;
+        writeFile(files[0], corrupted, corrupted.size());
+        if (ShaderCache::load(key, entry)) return test_fail("An entry with a corrupted byte at offset " + std::to_string(offset) + " was accepted");
+    }
+
+    writeFile(files[0], data, data.size());
+    if (ShaderCache::load(key, entry) == false) return test_fail("The restored entry wasn't found");
+    std::remove(include.c_str());
+    return test_pass();
+}
+
+int main()
+{
+    ShaderCacheTest sct;
+    sct.init();
+    sct.run();
+    return 0;
+}
@@ -0,0 +1,186 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "SkeletalAnimationTest.h"
+
+static const uint32_t kBenchmarkSkeletonCount = 1000;
+static const uint32_t kBenchmarkBoneCount = 64;
+static const uint32_t kBenchmarkKeyCount = 200;
+static const uint32_t kBenchmarkFrameCount = 60;
+
+void SkeletalAnimationTest::addTests()
+{
+    addTestToList<TestKeyframeLookup>();
+    addTestToList<TestBatchedHierarchy>();
+    addTestToList<BenchmarkSkeletons>();
+}
+
+AnimationController::UniquePtr SkeletalAnimationTest::createSkeleton(uint32_t boneCount, uint32_t keyCount, float duration)
+{
+    // A chain of bones, each parented to the previous one
+    std::vector<Bone> bones(boneCount);
+    std::vector<Animation::AnimationSet> animationSets(boneCount);
+    for (uint32_t i = 0; i < boneCount; i++)
+    {
+        bones[i].boneID = i;
+        bones[i].parentID = (i == 0) ? AnimationController::kInvalidBoneID : i - 1;
+        bones[i].name = "Bone" + std::to_string(i);
+        bones[i].offset = glm::translate(mat4(), vec3(0, -float(i), 0));
+        bones[i].localTransform = mat4();
+        bones[i].originalLocalTransform = mat4();
+        bones[i].globalTransform = mat4();
+
+        animationSets[i].boneID = i;
+        for (uint32_t k = 0; k < keyCount; k++)
+        {
+            float time = duration * float(k) / float(keyCount);
+            animationSets[i].translation.addKey(time, vec3(time, 0, 0));
+            animationSets[i].scaling.addKey(time, vec3(1));
+            animationSets[i].rotation.addKey(time, glm::angleAxis(0.01f * float(k + i), vec3(0, 1, 0)));
+        }
+    }
+
+    AnimationController::UniquePtr pController = AnimationController::create(bones);
+    pController->addAnimation(Animation::create("Test", animationSets, duration, 1));
+    pController->setActiveAnimation(0);
+    return pController;
+}
+
+testing_func(SkeletalAnimationTest, TestKeyframeLookup)
+{
+    // A single bone translating along X with the key time, so the expected translation is the current time
+    const float duration = 100;
+    AnimationController::UniquePtr pController = createSkeleton(1, 50, duration);
+
+    // Play forward, scrub backwards and jump around the timeline
+    std::vector<double> times;
+    for (double t = 0; t < 98; t += 0.25) times.push_back(t);
+    for (double t = 97; t > 0; t -= 3.5) times.push_back(t);
+    for (uint32_t i = 0; i < 200; i++) times.push_back(TestHelper::randFloatZeroToOne() * 98);
+
+    for (double t : times)
+    {
+        pController->animate(t);
+        float x = pController->getBoneMatrices()[0][3].x;
+        if (TestHelper::nearCompare(x, (float)t) == false)
+        {
+            return test_fail("Wrong translation at time " + std::to_string(t));
+        }
+    }
+    return test_pass();
+}
+
+testing_func(SkeletalAnimationTest, TestBatchedHierarchy)
+{
+    const uint32_t boneCount = 16;
+    const uint32_t keyCount = 20;
+    const float duration = 10;
+    std::vector<AnimationController::UniquePtr> controllers;
+    std::vector<AnimationController*> batch;
+    for (uint32_t i = 0; i < 32; i++)
+    {
+        controllers.push_back(createSkeleton(boneCount, keyCount, duration));
+        batch.push_back(controllers.back().get());
+    }
+
+    const double time = 3.3;
+    AnimationController::animate(batch, time);
+
+    // Evaluate the chain with full 4x4 matrices. The time falls between two keys, so interpolate them the same way the controller does
+    const uint32_t key = uint32_t(time * keyCount / duration);
+    const float keyTime = duration * float(key) / float(keyCount);
+    std::vector<mat4> expected(boneCount);
+    mat4 global;
+    for (uint32_t i = 0; i < boneCount; i++)
+    {
+        float nextTime = duration * float(key + 1) / float(keyCount);
+        float ratio = (float(time) - keyTime) / (nextTime - keyTime);
+        vec3 translation(glm::mix(keyTime, nextTime, ratio), 0, 0);
+        glm::quat rotation = glm::slerp(glm::angleAxis(0.01f * float(key + i), vec3(0, 1, 0)), glm::angleAxis(0.01f * float(key + 1 + i), vec3(0, 1, 0)), ratio);
+        global = global * glm::translate(mat4(), translation) * glm::mat4_cast(rotation);
+        expected[i] = global * glm::translate(mat4(), vec3(0, -float(i), 0));
+    }
+
+    for (const auto& pController : controllers)
+    {
+        for (uint32_t i = 0; i < boneCount; i++)
+        {
+            mat4 invTranspose = glm::transpose(glm::inverse(expected[i]));
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                for (uint32_t r = 0; r < 4; r++)
+                {
+                    // Positions along the chain are tens of units away from the origin, so allow for the slerp approximation error
+                    if (std::abs(pController->getBoneMatrices()[i][c][r] - expected[i][c][r]) > 0.05f ||
+                        std::abs(pController->getBoneInvTransposeMatrices()[i][c][r] - invTranspose[c][r]) > 0.05f)
+                    {
+                        return test_fail("Wrong transform for bone " + std::to_string(i));
+                    }
+                }
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(SkeletalAnimationTest, BenchmarkSkeletons)
+{
+    std::vector<AnimationController::UniquePtr> controllers;
+    for (uint32_t i = 0; i < kBenchmarkSkeletonCount; i++)
+    {
+        controllers.push_back(createSkeleton(kBenchmarkBoneCount, kBenchmarkKeyCount, 10));
+    }
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t frame = 0; frame < kBenchmarkFrameCount; frame++)
+    {
+        double time = frame / 60.0;
+        for (auto& pController : controllers) pController->animate(time);
+    }
+    float serialTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::vector<AnimationController*> batch;
+    for (auto& pController : controllers) batch.push_back(pController.get());
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t frame = 0; frame < kBenchmarkFrameCount; frame++)
+    {
+        AnimationController::animate(batch, frame / 60.0);
+    }
+    float batchedTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << kBenchmarkSkeletonCount << " skeletons with " << kBenchmarkBoneCount << " bones: " << serialTime / kBenchmarkFrameCount << "ms per frame serial, ";
+    std::cout << batchedTime / kBenchmarkFrameCount << "ms per frame batched\n";
+    return test_pass();
+}
+
+int main()
+{
+    SkeletalAnimationTest sat;
+    sat.init();
+    sat.run();
+    return 0;
+}
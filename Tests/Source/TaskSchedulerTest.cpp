@@ -0,0 +1,152 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TaskSchedulerTest.h"
+#include <atomic>
+
+static const uint32_t kBenchmarkTaskCount = 4096;
+static const uint32_t kBenchmarkTaskWork = 20000;
+
+static uint64_t benchmarkWork(uint32_t seed)
+{
+    uint64_t h = seed;
+    for (uint32_t i = 0; i < kBenchmarkTaskWork; i++)
+    {
+        h = h * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return h;
+}
+
+void TaskSchedulerTest::addTests()
+{
+    addTestToList<TestParallelFor>();
+    addTestToList<TestDependencies>();
+    addTestToList<TestAsync>();
+    addTestToList<BenchmarkVsThreadPool>();
+}
+
+testing_func(TaskSchedulerTest, TestParallelFor)
+{
+    TaskScheduler::SharedPtr pScheduler = TaskScheduler::create(4);
+    const size_t count = 100000;
+    std::vector<uint32_t> visited(count, 0);
+    pScheduler->parallelFor(0, count, [&](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) visited[i]++; });
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (visited[i] != 1) return test_fail("parallelFor() didn't visit every element exactly once");
+    }
+
+    // Nested loops must not dead-lock
+    std::atomic<uint32_t> nestedCount(0);
+    pScheduler->parallelFor(0, 64, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            pScheduler->parallelFor(0, 64, [&](size_t b, size_t e) { nestedCount += (uint32_t)(e - b); }, 4);
+        }
+    }, 1);
+
+    if (nestedCount != 64 * 64) return test_fail("Nested parallelFor() produced wrong results");
+    return test_pass();
+}
+
+testing_func(TaskSchedulerTest, TestDependencies)
+{
+    TaskScheduler::SharedPtr pScheduler = TaskScheduler::create(4);
+    for (uint32_t iteration = 0; iteration < 100; iteration++)
+    {
+        std::atomic<uint32_t> step(0);
+        bool orderValid = true;
+        auto pFirst = pScheduler->schedule([&]() { orderValid = orderValid && (step++ == 0); });
+        auto pSecond = pScheduler->then(pFirst, [&]() { orderValid = orderValid && (step++ == 1); });
+        auto pIndependent = pScheduler->schedule([&]() {});
+        auto pLast = pScheduler->schedule([&]() { orderValid = orderValid && (step++ == 2); }, { pFirst, pSecond, pIndependent });
+        pScheduler->wait(pLast);
+
+        if (orderValid == false || step != 3) return test_fail("Tasks executed before their dependencies completed");
+        if (pFirst->isComplete() == false || pSecond->isComplete() == false) return test_fail("Dependency not marked as complete");
+    }
+    return test_pass();
+}
+
+testing_func(TaskSchedulerTest, TestAsync)
+{
+    std::vector<std::future<uint32_t>> futures;
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        futures.push_back(TaskScheduler::instance().async([i]() { return i * i; }));
+    }
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        if (futures[i].get() != i * i) return test_fail("Future returned the wrong value");
+    }
+    return test_pass();
+}
+
+testing_func(TaskSchedulerTest, BenchmarkVsThreadPool)
+{
+    std::vector<uint64_t> poolResults(kBenchmarkTaskCount);
+    std::vector<uint64_t> schedulerResults(kBenchmarkTaskCount);
+
+    // Round-robin pool. Every job spawns a thread and joins whatever job was previously assigned to the slot
+    CpuTimer::TimePoint poolStart = CpuTimer::getCurrentTimePoint();
+    {
+        ThreadPool<16> pool;
+        for (uint32_t i = 0; i < kBenchmarkTaskCount; i++)
+        {
+            pool.getAvailable() = std::thread([&poolResults, i]() { poolResults[i] = benchmarkWork(i); });
+        }
+    }
+    float poolTime = CpuTimer::calcDuration(poolStart, CpuTimer::getCurrentTimePoint());
+
+    TaskScheduler::SharedPtr pScheduler = TaskScheduler::create();
+    CpuTimer::TimePoint schedulerStart = CpuTimer::getCurrentTimePoint();
+    {
+        std::vector<TaskScheduler::TaskHandle> tasks(kBenchmarkTaskCount);
+        for (uint32_t i = 0; i < kBenchmarkTaskCount; i++)
+        {
+            tasks[i] = pScheduler->schedule([&schedulerResults, i]() { schedulerResults[i] = benchmarkWork(i); });
+        }
+        pScheduler->wait(tasks);
+    }
+    float schedulerTime = CpuTimer::calcDuration(schedulerStart, CpuTimer::getCurrentTimePoint());
+
+    std::cout << "ThreadPool<16>: " << poolTime << "ms, TaskScheduler (" << pScheduler->getThreadCount() << " workers): " << schedulerTime << "ms\n";
+
+    if (poolResults != schedulerResults) return test_fail("ThreadPool and TaskScheduler results don't match");
+    return test_pass();
+}
+
+int main()
+{
+    TaskSchedulerTest tst;
+    tst.init();
+    tst.run();
+    return 0;
+}
@@ -0,0 +1,265 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TextureBakerTest.h"
+#include "Graphics/TextureBaker.h"
+#include "Utils/Bitmap.h"
+#include <fstream>
+
+void TextureBakerTest::addTests()
+{
+    addTestToList<TestSrgbMips>();
+    addTestToList<TestCompressionQuality>();
+    addTestToList<TestBakedFile>();
+    addTestToList<BenchmarkCompress>();
+}
+
+/** Creates a smooth RGBA8 test image
+*/
+static std::vector<uint8_t> createImage(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> texels(width * height * 4);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint8_t* pTexel = texels.data() + (y * width + x) * 4;
+            pTexel[0] = uint8_t(128 + 100 * std::sin(x * 0.05f));
+            pTexel[1] = uint8_t(128 + 100 * std::cos(y * 0.07f));
+            pTexel[2] = uint8_t(64 + (x * y / 64) % 64);
+            pTexel[3] = uint8_t((x + y) * 2);
+        }
+    }
+    return texels;
+}
+
+// Reference decoders for the blocks TextureBaker creates
+static void decodeColorBlock(const uint8_t* pBlock, uint8_t texels[16][4])
+{
+    uint16_t c[2];
+    uint32_t bits;
+    std::memcpy(c, pBlock, 4);
+    std::memcpy(&bits, pBlock + 4, 4);
+    int palette[4][3];
+    for (uint32_t e = 0; e < 2; e++)
+    {
+        int r = (c[e] >> 11) & 0x1F, g = (c[e] >> 5) & 0x3F, b = c[e] & 0x1F;
+        palette[e][0] = (r << 3) | (r >> 2);
+        palette[e][1] = (g << 2) | (g >> 4);
+        palette[e][2] = (b << 3) | (b >> 2);
+    }
+    for (uint32_t ch = 0; ch < 3; ch++)
+    {
+        palette[2][ch] = (2 * palette[0][ch] + palette[1][ch]) / 3;
+        palette[3][ch] = (palette[0][ch] + 2 * palette[1][ch]) / 3;
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        for (uint32_t ch = 0; ch < 3; ch++) texels[i][ch] = uint8_t(palette[(bits >> (i * 2)) & 3][ch]);
+    }
+}
+
+static void decodeBC4Block(const uint8_t* pBlock, uint8_t texels[16][4], uint32_t channel)
+{
+    int palette[8] = { pBlock[0], pBlock[1] };
+    for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < 6; i++) bits |= uint64_t(pBlock[2 + i]) << (i * 8);
+    for (uint32_t i = 0; i < 16; i++) texels[i][channel] = uint8_t(palette[(bits >> (i * 3)) & 7]);
+}
+
+static uint32_t readBits(const uint8_t* pBlock, uint32_t& position, uint32_t count)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < count; i++, position++) value |= ((pBlock[position >> 3] >> (position & 7)) & 1) << i;
+    return value;
+}
+
+static void decodeBC7Mode6Block(const uint8_t* pBlock, uint8_t texels[16][4])
+{
+    static const uint32_t kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    uint32_t position = 7;
+    uint32_t endpoints[2][4];
+    for (uint32_t ch = 0; ch < 4; ch++)
+    {
+        endpoints[0][ch] = readBits(pBlock, position, 7);
+        endpoints[1][ch] = readBits(pBlock, position, 7);
+    }
+    for (uint32_t e = 0; e < 2; e++)
+    {
+        uint32_t pBit = readBits(pBlock, position, 1);
+        for (uint32_t ch = 0; ch < 4; ch++) endpoints[e][ch] = (endpoints[e][ch] << 1) | pBit;
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t w = kWeights[readBits(pBlock, position, i == 0 ? 3 : 4)];
+        for (uint32_t ch = 0; ch < 4; ch++) texels[i][ch] = uint8_t(((64 - w) * endpoints[0][ch] + w * endpoints[1][ch] + 32) >> 6);
+    }
+}
+
+/** Decompress an image and return the PSNR of the first channelCount channels
+*/
+static double calcPsnr(const std::vector<uint8_t>& texels, const std::vector<uint8_t>& blocks, uint32_t width, uint32_t height, ResourceFormat format, uint32_t channelCount)
+{
+    const uint32_t blockSize = getFormatBytesPerBlock(format);
+    const uint32_t blocksX = (width + 3) / 4;
+    double squaredError = 0;
+    for (uint32_t by = 0; by < (height + 3) / 4; by++)
+    {
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            const uint8_t* pBlock = blocks.data() + (by * blocksX + bx) * blockSize;
+            uint8_t decoded[16][4] = {};
+            switch (format)
+            {
+            case ResourceFormat::BC1Unorm: decodeColorBlock(pBlock, decoded); break;
+            case ResourceFormat::BC3Unorm: decodeBC4Block(pBlock, decoded, 3); decodeColorBlock(pBlock + 8, decoded); break;
+            case ResourceFormat::BC4Unorm: decodeBC4Block(pBlock, decoded, 0); break;
+            case ResourceFormat::BC5Unorm: decodeBC4Block(pBlock, decoded, 0); decodeBC4Block(pBlock + 8, decoded, 1); break;
+            case ResourceFormat::BC7Unorm: decodeBC7Mode6Block(pBlock, decoded); break;
+            default: should_not_get_here();
+            }
+
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                uint32_t x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x >= width || y >= height) continue;
+                for (uint32_t ch = 0; ch < channelCount; ch++)
+                {
+                    double d = double(decoded[i][ch]) - texels[(y * width + x) * 4 + ch];
+                    squaredError += d * d;
+                }
+            }
+        }
+    }
+    double mse = squaredError / (double(width) * height * channelCount);
+    return (mse == 0) ? 100.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+testing_func(TextureBakerTest, TestSrgbMips)
+{
+    // Alternating black and white columns. The average in linear space is sRGB 188, alpha is averaged as-is
+    const uint32_t width = 64;
+    std::vector<uint8_t> texels(width * 2 * 4);
+    for (uint32_t i = 0; i < width * 2; i++) std::memset(texels.data() + i * 4, (i % 2) ? 0xFF : 0, 4);
+
+    for (auto filter : { TextureBaker::MipFilter::Box, TextureBaker::MipFilter::Kaiser })
+    {
+        TextureBaker::Image image = TextureBaker::generateMips(texels.data(), width, 2, true, filter);
+        if (image.mips.size() != 7 || image.mips[1].size() != width / 2 * 4) return test_fail("Wrong mip-chain size");
+        // Check a pixel away from the edges
+        const uint8_t* pTexel = image.mips[1].data() + width / 4 * 4;
+        if (std::abs(pTexel[0] - 188) > 2 || std::abs(pTexel[3] - 128) > 1) return test_fail("Mips are not sRGB-correct");
+    }
+
+    TextureBaker::Image linear = TextureBaker::generateMips(texels.data(), width, 2, false, TextureBaker::MipFilter::Box);
+    return (linear.mips[1][0] == 128) ? test_pass() : test_fail("Wrong linear mips");
+}
+
+testing_func(TextureBakerTest, TestCompressionQuality)
+{
+    // Not a multiple of the block size, to cover the edge blocks
+    const uint32_t width = 61, height = 35;
+    std::vector<uint8_t> texels = createImage(width, height);
+    struct
+    {
+        ResourceFormat format;
+        uint32_t channelCount;
+        double minPsnr;
+    } formats[] =
+    {
+        { ResourceFormat::BC1Unorm, 3, 35 },
+        { ResourceFormat::BC3Unorm, 4, 35 },
+        { ResourceFormat::BC4Unorm, 1, 45 },
+        { ResourceFormat::BC5Unorm, 2, 45 },
+        { ResourceFormat::BC7Unorm, 4, 38 },
+    };
+
+    for (const auto& f : formats)
+    {
+        std::vector<uint8_t> blocks = TextureBaker::compress(texels.data(), width, height, f.format);
+        if (blocks.size() != 16 * 9 * getFormatBytesPerBlock(f.format)) return test_fail("Wrong compressed size");
+        double psnr = calcPsnr(texels, blocks, width, height, f.format, f.channelCount);
+        if (psnr < f.minPsnr) return test_fail(to_string(f.format) + " PSNR is " + std::to_string(psnr));
+    }
+    return test_pass();
+}
+
+testing_func(TextureBakerTest, TestBakedFile)
+{
+    const uint32_t size = 64;
+    std::string filename = getTempFilename() + ".png";
+    std::vector<uint8_t> texels = createImage(size, size);
+    Bitmap::saveImage(filename, size, size, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, true, texels.data());
+
+    const TextureBaker::Policy policy = TextureBaker::getPolicy();
+    TextureBaker::setPolicy(TextureBaker::Policy::PreferBaked);
+    bool success = TextureBaker::findBakedFile(filename, true, true).empty();
+    TextureBaker::setPolicy(TextureBaker::Policy::BakeOnLoad);
+    std::string bakedFilename = TextureBaker::findBakedFile(filename, true, true);
+    success = success && bakedFilename.size() && doesFileExist(bakedFilename);
+    TextureBaker::setPolicy(TextureBaker::Policy::PreferBaked);
+    success = success && TextureBaker::findBakedFile(filename, true, true) == bakedFilename;
+    // Different load options use a different file
+    success = success && TextureBaker::findBakedFile(filename, false, true).empty();
+    TextureBaker::setPolicy(policy);
+
+    // Editing the image invalidates the baked file
+    texels[0] ^= 0xFF;
+    Bitmap::saveImage(filename, size, size, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, true, texels.data());
+    success = success && TextureBaker::getBakedFilename(filename, true, true) != bakedFilename;
+
+    std::remove(bakedFilename.c_str());
+    std::remove(filename.c_str());
+    return success ? test_pass() : test_fail("Wrong baked file");
+}
+
+testing_func(TextureBakerTest, BenchmarkCompress)
+{
+    const uint32_t size = 1024;
+    std::vector<uint8_t> texels = createImage(size, size);
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    TextureBaker::Image image = TextureBaker::generateMips(texels.data(), size, size, true, TextureBaker::MipFilter::Kaiser);
+    std::cout << "Kaiser mip-chain: " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) << "ms\n";
+
+    for (auto format : { ResourceFormat::BC1Unorm, ResourceFormat::BC7Unorm })
+    {
+        start = CpuTimer::getCurrentTimePoint();
+        std::vector<uint8_t> blocks = TextureBaker::compress(texels.data(), size, size, format);
+        std::cout << to_string(format) << " " << size << "x" << size << ": " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) << "ms\n";
+    }
+    return test_pass();
+}
+
+int main()
+{
+    TextureBakerTest tbt;
+    tbt.init();
+    tbt.run();
+    return 0;
+}
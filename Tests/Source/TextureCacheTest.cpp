@@ -0,0 +1,183 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TextureCacheTest.h"
+#include "Graphics/TextureCache.h"
+#include "Utils/Bitmap.h"
+#include <fstream>
+
+static const uint32_t kTextureSize = 64;
+
+void TextureCacheTest::addTests()
+{
+    addTestToList<TestDataDedup>();
+    addTestToList<TestFileDedup>();
+    addTestToList<TestEviction>();
+    addTestToList<BenchmarkCachedLoad>();
+}
+
+static std::vector<uint8_t> createTexels(uint8_t seed)
+{
+    std::vector<uint8_t> texels(kTextureSize * kTextureSize * 4);
+    for (size_t i = 0; i < texels.size(); i++) texels[i] = uint8_t(i * 7 + seed);
+    return texels;
+}
+
+static Texture::SharedPtr createTexture(const std::vector<uint8_t>& texels, ResourceFormat format = ResourceFormat::RGBA8Unorm)
+{
+    return TextureCache::instance().create2D(kTextureSize, kTextureSize, format, 1, texels.data(), texels.size(), "");
+}
+
+/** Writes a PNG file and returns its full path
+*/
+static std::string writeImage(uint8_t seed)
+{
+    std::string filename = getTempFilename() + ".png";
+    std::vector<uint8_t> texels = createTexels(seed);
+    Bitmap::saveImage(filename, kTextureSize, kTextureSize, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, true, texels.data());
+    return filename;
+}
+
+static void copyFile(const std::string& src, const std::string& dst)
+{
+    std::ifstream in(src, std::ios::binary);
+    std::ofstream out(dst, std::ios::binary);
+    out << in.rdbuf();
+}
+
+testing_func(TextureCacheTest, TestDataDedup)
+{
+    TextureCache& cache = TextureCache::instance();
+    cache.clear();
+    cache.resetStats();
+
+    std::vector<uint8_t> texels = createTexels(0);
+    Texture::SharedPtr pTexture = createTexture(texels);
+    // A copy of the data at a different address must be found by content
+    std::vector<uint8_t> copy = texels;
+    if (createTexture(copy) != pTexture) return test_fail("Identical texture data created two textures");
+    if (createTexture(texels, ResourceFormat::RGBA8UnormSrgb) == pTexture) return test_fail("Different formats returned the same texture");
+    if (createTexture(createTexels(1)) == pTexture) return test_fail("Different texture data returned the same texture");
+
+    TextureCache::Stats stats = cache.getStats();
+    if (stats.misses != 3 || stats.contentHits != 1 || stats.textureCount != 3) return test_fail("Wrong statistics");
+    if (stats.memorySize != 3 * texels.size() || stats.unreferencedMemorySize != 2 * texels.size()) return test_fail("Wrong memory size");
+    cache.clear();
+    return test_pass();
+}
+
+testing_func(TextureCacheTest, TestFileDedup)
+{
+    TextureCache& cache = TextureCache::instance();
+    cache.clear();
+    cache.resetStats();
+
+    std::string filename = writeImage(0);
+    std::string copyName = getTempFilename() + ".png";
+    copyFile(filename, copyName);
+
+    Texture::SharedPtr pTexture = cache.createFromFile(filename, false, false);
+    if (pTexture == nullptr) return test_fail("Can't load the texture");
+    if (cache.containsFile(filename) == false) return test_fail("The file is not in the cache");
+    if (cache.createFromFile(filename, false, false) != pTexture) return test_fail("Loading a file twice created two textures");
+    if (cache.createFromFile(copyName, false, false) != pTexture) return test_fail("Loading a copy of a file created another texture");
+    if (cache.createFromFile(filename, false, true) == pTexture) return test_fail("Different load options returned the same texture");
+
+    TextureCache::Stats stats = cache.getStats();
+    if (stats.misses != 2 || stats.pathHits != 1 || stats.contentHits != 1) return test_fail("Wrong statistics");
+
+    pTexture = nullptr;
+    cache.clear();
+    if (cache.containsFile(filename)) return test_fail("The file is still in the cache after clear()");
+    std::remove(filename.c_str());
+    std::remove(copyName.c_str());
+    return test_pass();
+}
+
+testing_func(TextureCacheTest, TestEviction)
+{
+    TextureCache& cache = TextureCache::instance();
+    cache.clear();
+    cache.resetStats();
+    const size_t budget = cache.getMemoryBudget();
+    const size_t textureSize = kTextureSize * kTextureSize * 4;
+    cache.setMemoryBudget(2 * textureSize);
+
+    // Keep the first texture, and release the other ones
+    std::vector<uint8_t> texels[4] = { createTexels(0), createTexels(1), createTexels(2), createTexels(3) };
+    Texture::SharedPtr pFirst = createTexture(texels[0]);
+    for (uint32_t i = 1; i < 4; i++) createTexture(texels[i]);
+
+    TextureCache::Stats stats = cache.getStats();
+    bool success = stats.evictions == 2 && stats.memorySize <= 2 * textureSize;
+    // The referenced texture must still be cached even though it is the least recently used one
+    success = success && createTexture(texels[0]) == pFirst;
+    // The most recently used unreferenced texture is still cached, the older ones were evicted
+    success = success && cache.getStats().contentHits == 1;
+    createTexture(texels[3]);
+    success = success && cache.getStats().contentHits == 2;
+
+    // Over the budget, referenced textures are kept
+    pFirst = nullptr;
+    Texture::SharedPtr pTextures[3] = { createTexture(texels[0]), createTexture(texels[1]), createTexture(texels[2]) };
+    stats = cache.getStats();
+    success = success && stats.textureCount == 3 && stats.unreferencedMemorySize == 0;
+
+    cache.setMemoryBudget(budget);
+    cache.clear();
+    return success ? test_pass() : test_fail("Wrong eviction");
+}
+
+testing_func(TextureCacheTest, BenchmarkCachedLoad)
+{
+    TextureCache& cache = TextureCache::instance();
+    cache.clear();
+    std::string filename = writeImage(0);
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    Texture::SharedPtr pTexture = cache.createFromFile(filename, true, false);
+    float loadTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    const uint32_t kIterations = 1000;
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kIterations; i++) cache.createFromFile(filename, true, false);
+    float cachedTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / kIterations;
+
+    std::cout << "Texture load: " << loadTime << "ms, cached: " << cachedTime << "ms\n";
+    pTexture = nullptr;
+    cache.clear();
+    std::remove(filename.c_str());
+    return (cachedTime < loadTime) ? test_pass() : test_fail("A cached load is slower than loading the file");
+}
+
+int main()
+{
+    TextureCacheTest tct;
+    tct.init(true);
+    tct.run();
+    return 0;
+}
@@ -0,0 +1,147 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "VideoEncoderTest.h"
+#include "Utils/Video/VideoEncoder.h"
+#include <fstream>
+
+void VideoEncoderTest::addTests()
+{
+    addTestToList<TestEncodeFrames>();
+    addTestToList<BenchmarkEncode>();
+}
+
+/** Creates a BGRA8 frame with a pattern moving over time
+*/
+static std::vector<uint8_t> createFrame(uint32_t width, uint32_t height, uint32_t frame)
+{
+    std::vector<uint8_t> texels(width * height * 4);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint8_t* pTexel = texels.data() + (y * width + x) * 4;
+            pTexel[0] = uint8_t(x + frame * 4);
+            pTexel[1] = uint8_t(y + frame * 2);
+            pTexel[2] = uint8_t((x ^ y) + frame);
+            pTexel[3] = 0xff;
+        }
+    }
+    return texels;
+}
+
+static VideoEncoder::Desc createDesc(const std::string& filename, uint32_t width, uint32_t height, VideoEncoder::CodecID codec)
+{
+    VideoEncoder::Desc desc;
+    desc.filename = filename;
+    desc.width = width;
+    desc.height = height;
+    desc.codec = codec;
+    desc.format = ResourceFormat::BGRA8UnormSrgb;
+    desc.bitrateMbps = 20;
+    return desc;
+}
+
+testing_func(VideoEncoderTest, TestEncodeFrames)
+{
+    const uint32_t width = 320, height = 240, frameCount = 30;
+    for (auto codec : { VideoEncoder::CodecID::RawVideo, VideoEncoder::CodecID::MPEG4 })
+    {
+        std::string filename = getTempFilename() + ".avi";
+        VideoEncoder::Desc desc = createDesc(filename, width, height, codec);
+        desc.flipY = (codec == VideoEncoder::CodecID::MPEG4);
+        VideoEncoder::UniquePtr pEncoder = VideoEncoder::create(desc);
+        if (pEncoder == nullptr) return test_fail("Failed to create the encoder");
+
+        // Use both the copying and the moving versions of appendFrame(). The moved frames are padded like a readback buffer, the copied frames must not be read past the image afterwards.
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            std::vector<uint8_t> frame = createFrame(width, height, i);
+            if (i & 1)
+            {
+                pEncoder->appendFrame(frame.data());
+            }
+            else
+            {
+                frame.resize(frame.size() + 4096);
+                pEncoder->appendFrame(std::move(frame));
+            }
+        }
+        pEncoder->endCapture();
+
+        VideoEncoder::Stats stats = pEncoder->getStats();
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        size_t fileSize = file.good() ? (size_t)file.tellg() : 0;
+        file.close();
+        std::remove(filename.c_str());
+
+        if (stats.framesAppended != frameCount || stats.framesEncoded != frameCount || stats.queuedFrames != 0) return test_fail("Not all the frames were encoded");
+        if (codec == VideoEncoder::CodecID::RawVideo && fileSize < width * height * 3 * frameCount) return test_fail("The raw video file is too small");
+        if (fileSize == 0) return test_fail("The video file is empty");
+    }
+    return test_pass();
+}
+
+testing_func(VideoEncoderTest, BenchmarkEncode)
+{
+    const uint32_t width = 1920, height = 1080, frameCount = 120;
+    std::vector<std::vector<uint8_t>> frames;
+    for (uint32_t i = 0; i < 8; i++) frames.push_back(createFrame(width, height, i));
+
+    for (auto codec : { VideoEncoder::CodecID::RawVideo, VideoEncoder::CodecID::MPEG4 })
+    {
+        std::string filename = getTempFilename() + ".avi";
+        VideoEncoder::UniquePtr pEncoder = VideoEncoder::create(createDesc(filename, width, height, codec));
+        if (pEncoder == nullptr) return test_fail("Failed to create the encoder");
+
+        // The time spent in appendFrame() is what the render thread pays, the rest overlaps with rendering
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        double appendTime = 0;
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            CpuTimer::TimePoint appendStart = CpuTimer::getCurrentTimePoint();
+            pEncoder->appendFrame(frames[i % frames.size()].data());
+            appendTime += CpuTimer::calcDuration(appendStart, CpuTimer::getCurrentTimePoint());
+        }
+        pEncoder->endCapture();
+        double totalTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        std::remove(filename.c_str());
+
+        VideoEncoder::Stats stats = pEncoder->getStats();
+        std::cout << (codec == VideoEncoder::CodecID::RawVideo ? "Raw" : "MPEG4") << " " << width << "x" << height << ": " << frameCount * 1000 / totalTime << " fps, appendFrame() "
+            << appendTime / frameCount << "ms/frame, stalled on " << stats.stalledFrames << " frames\n";
+    }
+    return test_pass();
+}
+
+int main()
+{
+    VideoEncoderTest vet;
+    vet.init();
+    vet.run();
+    return 0;
+}